@@ -1,6 +1,8 @@
 #include "bindings.h"
 #include "logs.h"
 #include <ReactCommon/CallInvokerHolder.h>
+#include <android/asset_manager.h>
+#include <android/asset_manager_jni.h>
 #include <fbjni/fbjni.h>
 #include <jni.h>
 #include <jsi/jsi.h>
@@ -10,6 +12,10 @@ namespace jsi = facebook::jsi;
 namespace react = facebook::react;
 namespace jni = facebook::jni;
 
+struct JAssetManager : jni::JavaClass<JAssetManager> {
+  static constexpr auto kJavaDescriptor = "Landroid/content/res/AssetManager;";
+};
+
 // This file is not using raw jni but rather fbjni, do not change how the native
 // functions are registered
 // https://github.com/facebookincubator/fbjni/blob/main/docs/quickref.md
@@ -27,15 +33,49 @@ private:
   static void installNativeJsi(
       jni::alias_ref<jni::JObject> thiz, jlong jsiRuntimePtr,
       jni::alias_ref<react::CallInvokerHolder::javaobject> jsCallInvokerHolder,
-      jni::alias_ref<jni::JString> dbPath) {
+      jni::alias_ref<jni::JString> dbPath,
+      jni::alias_ref<JAssetManager> assetManager) {
     auto jsiRuntime = reinterpret_cast<jsi::Runtime *>(jsiRuntimePtr);
     auto jsCallInvoker = jsCallInvokerHolder->cthis()->getCallInvoker();
     std::string dbPathStr = dbPath->toStdString();
 
     opsqlite::install(*jsiRuntime, jsCallInvoker, dbPathStr.c_str(),
                       "libcrsqlite", "libsqlite_vec", "");
+
+    // The native asset manager is only valid while the Java one is alive
+    assetManagerRef = jni::make_global(assetManager);
+    AAssetManager *manager = AAssetManager_fromJava(
+        jni::Environment::current(), assetManagerRef.get());
+    opsqlite::set_asset_reader([manager](std::string const &name) {
+      return readAsset(manager, name);
+    });
+  }
+
+  // Uncompressed assets are mapped from the APK without a copy
+  static ArrayBuffer readAsset(AAssetManager *manager,
+                               std::string const &name) {
+    AAsset *asset =
+        AAssetManager_open(manager, name.c_str(), AASSET_MODE_BUFFER);
+    if (asset == nullptr) {
+      throw std::runtime_error("[op-sqlite] Asset not found: " + name);
+    }
+
+    auto *data = static_cast<const uint8_t *>(AAsset_getBuffer(asset));
+    if (data == nullptr) {
+      AAsset_close(asset);
+      throw std::runtime_error("[op-sqlite] Could not read asset: " + name);
+    }
+
+    return ArrayBuffer{
+        .data = std::shared_ptr<uint8_t>(const_cast<uint8_t *>(data),
+                                         [asset](uint8_t *) {
+                                           AAsset_close(asset);
+                                         }),
+        .size = static_cast<size_t>(AAsset_getLength64(asset))};
   }
 
+  static inline jni::global_ref<JAssetManager> assetManagerRef;
+
   static void clearStateNativeJsi(jni::alias_ref<jni::JObject> thiz) {
     opsqlite::invalidate();
   }
@@ -1,5 +1,6 @@
 package com.op.sqlite
 
+import android.content.res.AssetManager
 import com.facebook.react.bridge.ReactContext
 import com.facebook.react.turbomodule.core.CallInvokerHolderImpl
 import com.facebook.react.common.annotations.FrameworkAPI
@@ -9,7 +10,8 @@ class OPSQLiteBridge {
     private external fun installNativeJsi(
         jsContextNativePointer: Long,
         jsCallInvokerHolder: CallInvokerHolderImpl,
-        docPath: String
+        docPath: String,
+        assetManager: AssetManager
     )
     private external fun clearStateNativeJsi()
 
@@ -23,7 +25,8 @@ class OPSQLiteBridge {
         installNativeJsi(
             jsContextPointer,
             jsCallInvokerHolder,
-            dbPath
+            dbPath,
+            context.assets
         )
     }
 
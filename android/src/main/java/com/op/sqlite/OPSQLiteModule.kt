@@ -32,6 +32,7 @@ internal class OPSQLiteModule(context: ReactApplicationContext?) : ReactContextB
         constants["ANDROID_EXTERNAL_FILES_PATH"] = externalFilesDir
         constants["IOS_DOCUMENT_PATH"] = ""
         constants["IOS_LIBRARY_PATH"] = ""
+        constants["IOS_BUNDLE_PATH"] = ""
         return constants
     }
 
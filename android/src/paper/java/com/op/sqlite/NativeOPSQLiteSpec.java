@@ -48,6 +48,7 @@ public abstract class NativeOPSQLiteSpec extends ReactContextBaseJavaModule impl
           "ANDROID_DATABASE_PATH",
           "ANDROID_EXTERNAL_FILES_PATH",
           "ANDROID_FILES_PATH",
+          "IOS_BUNDLE_PATH",
           "IOS_DOCUMENT_PATH",
           "IOS_LIBRARY_PATH"
       ));
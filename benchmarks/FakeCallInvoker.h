@@ -0,0 +1,58 @@
+#pragma once
+
+#include <ReactCommon/CallInvoker.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <jsi/jsi.h>
+#include <mutex>
+
+namespace opsqlite::benchmarks {
+
+namespace jsi = facebook::jsi;
+namespace react = facebook::react;
+
+/// Stands in for the JS thread of an app. invokeAsync only queues the call,
+/// the thread that owns the runtime runs the queue with run_pending
+class FakeCallInvoker : public react::CallInvoker {
+  public:
+    explicit FakeCallInvoker(jsi::Runtime &rt) : rt(rt) {}
+
+    using react::CallInvoker::invokeAsync;
+    using react::CallInvoker::invokeSync;
+
+    void invokeAsync(react::CallFunc &&func) noexcept override {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.push_back(std::move(func));
+        }
+        condition.notify_one();
+    }
+
+    /// Must be called from the runtime thread
+    void invokeSync(react::CallFunc &&func) override { func(rt); }
+
+    /// Runs every queued call, waiting up to timeout for the first one.
+    /// Returns the number of calls that ran
+    size_t run_pending(std::chrono::milliseconds timeout) {
+        std::deque<react::CallFunc> calls;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait_for(lock, timeout, [&] { return !pending.empty(); });
+            calls.swap(pending);
+        }
+
+        for (auto &call : calls) {
+            call(rt);
+        }
+        return calls.size();
+    }
+
+  private:
+    jsi::Runtime &rt;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<react::CallFunc> pending;
+};
+
+} // namespace opsqlite::benchmarks
@@ -0,0 +1,90 @@
+#include "allocations.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace opsqlite::benchmarks {
+
+static std::atomic<uint64_t> allocations{0};
+static std::atomic<uint64_t> allocated_bytes{0};
+static std::atomic<int64_t> live_bytes{0};
+static std::atomic<int64_t> peak_live_bytes{0};
+
+// Every block is prefixed with its size so delete can account for it, the
+// prefix keeps the alignment malloc guarantees
+static constexpr size_t header_size = alignof(std::max_align_t);
+
+static void *counted_malloc(size_t size) {
+    auto block = static_cast<char *>(std::malloc(size + header_size));
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+    *reinterpret_cast<size_t *>(block) = size;
+
+    auto signed_size = static_cast<int64_t>(size);
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    int64_t live =
+        live_bytes.fetch_add(signed_size, std::memory_order_relaxed) +
+        signed_size;
+
+    int64_t peak = peak_live_bytes.load(std::memory_order_relaxed);
+    while (live > peak && !peak_live_bytes.compare_exchange_weak(
+                              peak, live, std::memory_order_relaxed)) {
+    }
+
+    return block + header_size;
+}
+
+static void counted_free(void *ptr) {
+    if (ptr == nullptr) {
+        return;
+    }
+
+    auto block = static_cast<char *>(ptr) - header_size;
+    live_bytes.fetch_sub(
+        static_cast<int64_t>(*reinterpret_cast<size_t *>(block)),
+        std::memory_order_relaxed);
+    std::free(block);
+}
+
+AllocationStats allocation_stats() {
+    return {.allocations = allocations.load(std::memory_order_relaxed),
+            .bytes = allocated_bytes.load(std::memory_order_relaxed),
+            .live_bytes = live_bytes.load(std::memory_order_relaxed),
+            .peak_live_bytes = peak_live_bytes.load(std::memory_order_relaxed)};
+}
+
+void reset_peak_allocated_bytes() {
+    peak_live_bytes.store(live_bytes.load(std::memory_order_relaxed),
+                          std::memory_order_relaxed);
+}
+
+} // namespace opsqlite::benchmarks
+
+// The standard library nothrow variants forward to these, over-aligned
+// allocations keep the default implementation and are not counted
+void *operator new(size_t size) {
+    return opsqlite::benchmarks::counted_malloc(size);
+}
+
+void *operator new[](size_t size) {
+    return opsqlite::benchmarks::counted_malloc(size);
+}
+
+void operator delete(void *ptr) noexcept {
+    opsqlite::benchmarks::counted_free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+    opsqlite::benchmarks::counted_free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    opsqlite::benchmarks::counted_free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept {
+    opsqlite::benchmarks::counted_free(ptr);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+
+namespace opsqlite::benchmarks {
+
+/// Native heap usage seen by the global operator new/delete replaced in
+/// allocations.cpp. Linking that file into a benchmark enables the counters
+struct AllocationStats {
+    uint64_t allocations;
+    uint64_t bytes;
+    // Bytes currently allocated and the highest value since the last
+    // reset_peak_allocated_bytes
+    int64_t live_bytes;
+    int64_t peak_live_bytes;
+};
+
+AllocationStats allocation_stats();
+void reset_peak_allocated_bytes();
+
+} // namespace opsqlite::benchmarks
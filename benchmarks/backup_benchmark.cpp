@@ -0,0 +1,214 @@
+// Latency of queries on a connection while db.backup copies it. A producer
+// thread queues a lookup or an update every millisecond on the same
+// ThreadPool the backup steps run on, the way DBHostObject::step_backup
+// queues them, and the queue latency of those queries is reported for each
+// --pages value. -1 copies everything in one step, which is what blocks the
+// app today. Updates made during the backup have to end up in the copy, so
+// it is compared with the source, which is only read once the last step
+// finished, then restored into another connection and compared again
+//
+// Usage: op-sqlite-backup-benchmark [--mb 64] [--pages -1,100,1000]
+//                                   [--sleep 0] [--csv]
+
+#include "Backup.h"
+#include "OPThreadPool.h"
+#include "QueryStats.h"
+#include "bridge.h"
+#include "common.h"
+#include <atomic>
+#include <future>
+#include <iostream>
+#include <thread>
+
+using namespace opsqlite;
+using namespace opsqlite::benchmarks;
+
+struct Options {
+    size_t megabytes = 64;
+    std::vector<int> pages = {-1, 100, 1000};
+    int sleep_ms = 0;
+    bool csv = false;
+};
+
+static const std::string checksum_sql =
+    "SELECT count(*) || ':' || sum(number) || ':' || "
+    "sum(length(payload)) FROM bench";
+
+static std::string checksum(sqlite3 *db) {
+    auto result = opsqlite_execute(db, checksum_sql, nullptr);
+    return std::get<std::string>(result.rows[0][0]);
+}
+
+static size_t create_source(sqlite3 *db, size_t megabytes) {
+    // 4KiB payloads, so one row is about a page
+    size_t rows = megabytes * 256;
+    opsqlite_execute(db,
+                     "CREATE TABLE bench (id INTEGER PRIMARY KEY, number "
+                     "INTEGER, payload BLOB)",
+                     nullptr);
+    opsqlite_execute(db,
+                     "WITH RECURSIVE seq(n) AS (SELECT 1 UNION ALL SELECT n + "
+                     "1 FROM seq WHERE n < " +
+                         std::to_string(rows) +
+                         ") INSERT INTO bench SELECT n, n, randomblob(4000) "
+                         "FROM seq",
+                     nullptr);
+    return rows;
+}
+
+/// Set on the worker by the last step, the promise for the main thread
+struct BackupRun {
+    std::atomic<bool> backed_up{false};
+    std::promise<void> done;
+};
+
+/// Same scheduling as DBHostObject::step_backup
+static void queue_step(ThreadPool &pool, std::shared_ptr<OnlineBackup> backup,
+                       BackupRun &run) {
+    auto step = [&pool, backup, &run] {
+        try {
+            int status = backup->step();
+            if (status != SQLITE_DONE) {
+                queue_step(pool, backup, run);
+                return;
+            }
+            backup->finish();
+            run.backed_up = true;
+            run.done.set_value();
+        } catch (...) {
+            run.done.set_exception(std::current_exception());
+        }
+    };
+
+    auto delay = backup->get_options().sleep;
+    if (delay.count() > 0) {
+        pool.queue_delayed_work(step, delay, Priority::Background);
+    } else {
+        pool.queueWork(step, Priority::Background);
+    }
+}
+
+int main(int argc, char **argv) {
+    Options options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--csv") {
+            options.csv = true;
+        } else if (arg == "--mb" && i + 1 < argc) {
+            options.megabytes = std::stoull(argv[++i]);
+        } else if (arg == "--pages" && i + 1 < argc) {
+            options.pages.clear();
+            std::stringstream list(argv[++i]);
+            std::string item;
+            while (std::getline(list, item, ',')) {
+                options.pages.push_back(std::stoi(item));
+            }
+        } else if (arg == "--sleep" && i + 1 < argc) {
+            options.sleep_ms = std::stoi(argv[++i]);
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--mb 64] [--pages -1,100,1000] [--sleep 0] "
+                         "[--csv]\n";
+            return 1;
+        }
+    }
+
+    Table table({"pages/step", "backup ms", "queries", "p50 ms", "p99 ms",
+                 "max ms"},
+                options.csv);
+
+    try {
+        TempDir dir;
+        sqlite3 *db = opsqlite_open("source.sqlite", dir.path(), "", "", "");
+        auto rows = static_cast<long long>(
+            create_source(db, options.megabytes));
+        table.print_header();
+
+        for (auto pages : options.pages) {
+            auto path = dir.path() + "/backup-" + std::to_string(pages) +
+                        ".sqlite";
+            BackupOptions backup_options;
+            backup_options.pages_per_step = pages;
+            backup_options.sleep = std::chrono::milliseconds(options.sleep_ms);
+
+            ThreadPool pool;
+            Samples latencies;
+            std::atomic<bool> finished{false};
+            BackupRun run;
+            auto backup_done = run.done.get_future();
+
+            auto started_at = now_ns();
+            pool.queueWork(
+                [&] {
+                    try {
+                        auto backup = std::make_shared<OnlineBackup>(
+                            db, path, OnlineBackup::Direction::ToFile,
+                            backup_options);
+                        queue_step(pool, backup, run);
+                    } catch (...) {
+                        run.done.set_exception(std::current_exception());
+                    }
+                },
+                Priority::Background);
+
+            std::thread producer([&] {
+                for (long long i = 0; !finished; i++) {
+                    pool.queueWork([&, i, queued_at = now_ns()] {
+                        latencies.add(
+                            static_cast<double>(now_ns() - queued_at) / 1e6);
+                        std::vector<JSVariant> params = {i % rows + 1};
+                        opsqlite_execute(
+                            db,
+                            i % 10 == 0 && !run.backed_up
+                                ? "UPDATE bench SET number = number + 1 "
+                                  "WHERE id = ?"
+                                : "SELECT length(payload) FROM bench WHERE "
+                                  "id = ?",
+                            &params);
+                    });
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            });
+
+            backup_done.get();
+            double ms = static_cast<double>(now_ns() - started_at) / 1e6;
+            finished = true;
+            producer.join();
+            pool.waitFinished();
+            auto expected = checksum(db);
+
+            sqlite3 *copy = opsqlite_open("backup-" + std::to_string(pages) +
+                                              ".sqlite",
+                                          dir.path(), "", "", "");
+            auto integrity =
+                opsqlite_execute(copy, "PRAGMA integrity_check", nullptr);
+            if (std::get<std::string>(integrity.rows[0][0]) != "ok" ||
+                checksum(copy) != expected) {
+                throw std::runtime_error("Backup differs from the source");
+            }
+            opsqlite_close(copy);
+
+            sqlite3 *restored =
+                opsqlite_open("restored.sqlite", dir.path(), "", "", "");
+            restore_database(restored, path, backup_options);
+            if (checksum(restored) != expected) {
+                throw std::runtime_error("Restore differs from the backup");
+            }
+            opsqlite_close(restored);
+
+            table.print_row({std::to_string(pages), format_number(ms, 1),
+                             std::to_string(latencies.values.size()),
+                             format_number(latencies.percentile(0.5), 2),
+                             format_number(latencies.percentile(0.99), 2),
+                             format_number(latencies.percentile(1), 2)});
+        }
+
+        opsqlite_close(db);
+    } catch (std::exception &exc) {
+        std::cerr << "[op-sqlite] " << exc.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
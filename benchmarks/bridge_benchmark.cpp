@@ -0,0 +1,257 @@
+// Microbenchmarks for the JSI free layer of op-sqlite (bridge.cpp). Every case
+// runs against a synthetic table of the given width (columns) and size (rows)
+// in a fresh database, no JS runtime is involved
+//
+// Usage: op-sqlite-bridge-benchmark [--widths 4,16,32] [--rows 100,10000]
+//                                   [--iterations 5] [--csv]
+
+#include "SqlImport.h"
+#include "bridge.h"
+#include "common.h"
+#include <fstream>
+#include <functional>
+#include <iostream>
+
+using namespace opsqlite;
+using namespace opsqlite::benchmarks;
+
+struct Options {
+    std::vector<size_t> widths = {4, 16, 32};
+    std::vector<size_t> rows = {100, 10000, 100000};
+    size_t iterations = 5;
+    bool csv = false;
+};
+
+/// Columns cycle through integer, real and text values
+static std::string column_type(size_t column) {
+    switch (column % 3) {
+    case 0:
+        return "INTEGER";
+    case 1:
+        return "REAL";
+    default:
+        return "TEXT";
+    }
+}
+
+static JSVariant column_value(size_t column, size_t row) {
+    switch (column % 3) {
+    case 0:
+        return static_cast<long long>(row * 31 + column);
+    case 1:
+        return static_cast<double>(row) / static_cast<double>(column + 1);
+    default:
+        return "value " + std::to_string(row) + "-" + std::to_string(column);
+    }
+}
+
+static std::string column_literal(size_t column, size_t row) {
+    auto value = column_value(column, row);
+
+    if (std::holds_alternative<std::string>(value)) {
+        return "'" + std::get<std::string>(value) + "'";
+    }
+    if (std::holds_alternative<double>(value)) {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%.17g", std::get<double>(value));
+        return buffer;
+    }
+    return std::to_string(std::get<long long>(value));
+}
+
+static std::string create_table_sql(const std::string &table, size_t width) {
+    std::string sql = "CREATE TABLE " + table + " (id INTEGER PRIMARY KEY";
+    for (size_t i = 0; i < width; i++) {
+        sql += ", c" + std::to_string(i) + " " + column_type(i);
+    }
+    return sql + ")";
+}
+
+static std::string insert_prefix(const std::string &table, size_t width) {
+    std::string sql = "INSERT INTO " + table + " (";
+    for (size_t i = 0; i < width; i++) {
+        sql += (i == 0 ? "c" : ", c") + std::to_string(i);
+    }
+    return sql + ") VALUES (";
+}
+
+static std::vector<BatchArguments>
+insert_commands(const std::string &table, size_t width, size_t rows) {
+    std::string sql = insert_prefix(table, width);
+    for (size_t i = 0; i < width; i++) {
+        sql += i == 0 ? "?" : ", ?";
+    }
+    sql += ")";
+
+    std::vector<BatchArguments> commands;
+    commands.reserve(rows);
+    for (size_t row = 0; row < rows; row++) {
+        std::vector<JSVariant> params;
+        params.reserve(width);
+        for (size_t column = 0; column < width; column++) {
+            params.push_back(column_value(column, row));
+        }
+        commands.push_back({sql, std::move(params)});
+    }
+    return commands;
+}
+
+/// One INSERT per line, like a dump written by the sqlite3 shell
+static void write_sql_dump(const std::string &path, const std::string &table,
+                           size_t width, size_t rows) {
+    std::ofstream dump(path);
+    std::string prefix = insert_prefix(table, width);
+
+    for (size_t row = 0; row < rows; row++) {
+        dump << prefix;
+        for (size_t column = 0; column < width; column++) {
+            dump << (column == 0 ? "" : ", ") << column_literal(column, row);
+        }
+        dump << ");\n";
+    }
+}
+
+static void expect_rows(size_t actual, size_t expected, const char *name) {
+    if (actual != expected) {
+        throw std::runtime_error(std::string(name) + " returned " +
+                                 std::to_string(actual) + " rows, expected " +
+                                 std::to_string(expected));
+    }
+}
+
+static void run_case(const Table &table, const Options &options,
+                     const char *name, size_t width, size_t rows,
+                     const std::function<void()> &setup,
+                     const std::function<size_t()> &body) {
+    Samples samples;
+
+    // First run warms up the page cache and sqlite's schema
+    for (size_t i = 0; i <= options.iterations; i++) {
+        setup();
+        size_t result_rows = 0;
+        double ms = time_ms([&] { result_rows = body(); });
+        expect_rows(result_rows, rows, name);
+        if (i > 0) {
+            samples.add(ms);
+        }
+    }
+
+    double median = samples.percentile(0.5);
+    table.print_row({name, std::to_string(width), std::to_string(rows),
+                     format_number(samples.min()), format_number(median),
+                     format_number(samples.percentile(0.95)),
+                     format_number(static_cast<double>(rows) / median * 1000,
+                                   0)});
+}
+
+static void run_suite(const Table &table, const Options &options,
+                      const std::string &path, size_t width, size_t rows) {
+    std::string name = "bench-" + std::to_string(width) + "-" +
+                       std::to_string(rows) + ".sqlite";
+    sqlite3 *db = opsqlite_open(name, path, "", "", "");
+
+    opsqlite_execute(db, create_table_sql("bench", width), nullptr);
+    opsqlite_execute(db, create_table_sql("bench_insert", width), nullptr);
+    opsqlite_execute(db, create_table_sql("bench_import", width), nullptr);
+
+    auto commands = insert_commands("bench", width, rows);
+    opsqlite_execute_batch(db, &commands);
+
+    auto insert = insert_commands("bench_insert", width, rows);
+    std::string dump_path = path + "/" + name + ".sql";
+    write_sql_dump(dump_path, "bench_import", width, rows);
+
+    const std::string select = "SELECT * FROM bench";
+    auto no_setup = [] {};
+
+    run_case(table, options, "execute", width, rows, no_setup, [&] {
+        return opsqlite_execute(db, select, nullptr).rows.size();
+    });
+
+    run_case(table, options, "execute_raw", width, rows, no_setup, [&] {
+        std::vector<std::vector<JSVariant>> results;
+        opsqlite_execute_raw(db, select, nullptr, &results);
+        return results.size();
+    });
+
+    run_case(table, options, "execute_host_objects", width, rows, no_setup,
+             [&] {
+                 std::vector<DumbHostObject> results;
+                 auto metadata =
+                     std::make_shared<std::vector<SmartHostObject>>();
+                 opsqlite_execute_host_objects(db, select, nullptr, &results,
+                                               metadata);
+                 return results.size();
+             });
+
+    run_case(
+        table, options, "execute_batch", width, rows,
+        [&] { opsqlite_execute(db, "DELETE FROM bench_insert", nullptr); },
+        [&] {
+            return static_cast<size_t>(
+                opsqlite_execute_batch(db, &insert).affectedRows);
+        });
+
+    run_case(
+        table, options, "import_sql_file", width, rows,
+        [&] { opsqlite_execute(db, "DELETE FROM bench_import", nullptr); },
+        [&] {
+            return static_cast<size_t>(
+                import_sql_file(db, dump_path).affectedRows);
+        });
+
+    // Read only, so the image is used in place when the library has client
+    // data and copied otherwise
+    auto image = opsqlite_serialize(db);
+    run_case(table, options, "deserialize", width, rows, no_setup, [&] {
+        sqlite3 *copy = nullptr;
+        sqlite3_open(":memory:", &copy);
+        opsqlite_deserialize(copy, image, true);
+        auto count = opsqlite_execute(copy, select, nullptr).rows.size();
+        sqlite3_close_v2(copy);
+        return count;
+    });
+
+    opsqlite_remove(db, name, path);
+}
+
+int main(int argc, char **argv) {
+    Options options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--csv") {
+            options.csv = true;
+        } else if (arg == "--widths" && i + 1 < argc) {
+            options.widths = parse_list(argv[++i]);
+        } else if (arg == "--rows" && i + 1 < argc) {
+            options.rows = parse_list(argv[++i]);
+        } else if (arg == "--iterations" && i + 1 < argc) {
+            options.iterations = std::stoull(argv[++i]);
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--widths 4,16,32] [--rows 100,10000,100000]"
+                         " [--iterations 5] [--csv]\n";
+            return 1;
+        }
+    }
+
+    Table table({"case", "width", "rows", "min ms", "median ms", "p95 ms",
+                 "rows/s"},
+                options.csv);
+    table.print_header();
+
+    try {
+        TempDir dir;
+        for (auto width : options.widths) {
+            for (auto rows : options.rows) {
+                run_suite(table, options, dir.path(), width, rows);
+            }
+        }
+    } catch (std::exception &exc) {
+        std::cerr << "[op-sqlite] " << exc.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace opsqlite::benchmarks {
+
+/// Folder under the system temp directory, deleted with its contents when the
+/// object goes out of scope
+class TempDir {
+  public:
+    TempDir() {
+        auto pattern =
+            (std::filesystem::temp_directory_path() / "op-sqlite-XXXXXX")
+                .string();
+        if (mkdtemp(pattern.data()) == nullptr) {
+            throw std::runtime_error("Could not create temporary folder");
+        }
+        dir = pattern;
+    }
+    TempDir(const TempDir &) = delete;
+    TempDir &operator=(const TempDir &) = delete;
+    ~TempDir() {
+        std::error_code error;
+        std::filesystem::remove_all(dir, error);
+    }
+
+    const std::string &path() const { return dir; }
+
+  private:
+    std::string dir;
+};
+
+template <typename F> double time_ms(F &&fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+struct Samples {
+    std::vector<double> values;
+
+    void add(double value) { values.push_back(value); }
+
+    /// Nearest rank percentile, p between 0 and 1
+    double percentile(double p) const {
+        if (values.empty()) {
+            return 0;
+        }
+        auto sorted = values;
+        std::sort(sorted.begin(), sorted.end());
+        auto rank = static_cast<size_t>(p * static_cast<double>(sorted.size()));
+        return sorted[std::min(rank, sorted.size() - 1)];
+    }
+
+    double min() const {
+        return values.empty() ? 0
+                              : *std::min_element(values.begin(), values.end());
+    }
+};
+
+/// Parses comma separated numbers, e.g. "100,10000"
+inline std::vector<size_t> parse_list(const std::string &arg) {
+    std::vector<size_t> list;
+    std::stringstream stream(arg);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        list.push_back(std::stoull(item));
+    }
+    return list;
+}
+
+inline std::string format_number(double value, int precision = 3) {
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.*f", precision, value);
+    return buffer;
+}
+
+/// Prints aligned columns for humans or CSV for scripts comparing runs
+class Table {
+  public:
+    Table(std::vector<std::string> columns, bool csv)
+        : columns(std::move(columns)), csv(csv) {}
+
+    void print_header() const { print_row(columns); }
+
+    void print_row(const std::vector<std::string> &cells) const {
+        for (size_t i = 0; i < cells.size(); i++) {
+            if (csv) {
+                printf(i == 0 ? "%s" : ",%s", cells[i].c_str());
+            } else if (i == 0) {
+                printf("%-24s", cells[i].c_str());
+            } else {
+                printf("%14s", cells[i].c_str());
+            }
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+
+  private:
+    std::vector<std::string> columns;
+    bool csv;
+};
+
+} // namespace opsqlite::benchmarks
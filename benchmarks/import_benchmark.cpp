@@ -0,0 +1,374 @@
+// Throughput of the native file imports: db.loadFile on a dump in the format
+// of the sqlite3 shell's .dump, next to sqlite3_exec running the same file as
+// one string, and db.importCsv/importNdjson next to executeBatch with the
+// already parsed rows, which is what importing a CSV from JS costs at best.
+// db.exportQuery writes the same table back out in every format.
+// Values include text with quotes, separators and new lines, so every
+// imported table is also compared with the source to check nothing was lost,
+// exported CSV and NDJSON by importing them again
+//
+// Usage: op-sqlite-import-benchmark [--rows 100000] [--chunk 0,10000] [--csv]
+
+#include "QueryExport.h"
+#include "TableImport.h"
+#include "bridge.h"
+#include "common.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace opsqlite;
+using namespace opsqlite::benchmarks;
+
+struct Options {
+    size_t rows = 100000;
+    std::vector<size_t> chunks = {0, 10000};
+    bool csv = false;
+};
+
+static const char *schema =
+    "CREATE TABLE bench (id INTEGER PRIMARY KEY, number INTEGER, real REAL, "
+    "label TEXT, payload BLOB, note TEXT);\n"
+    "CREATE TRIGGER bench_note AFTER INSERT ON bench WHEN new.note IS NULL "
+    "BEGIN SELECT 1; SELECT 2; END;\n";
+
+static const char *catalogue_schema =
+    "CREATE TABLE catalogue (id INTEGER PRIMARY KEY, sku TEXT, price REAL, "
+    "stock INTEGER, title TEXT, tags TEXT)";
+
+static const std::string insert_sql =
+    "SELECT 'INSERT INTO bench VALUES(' || quote(id) || ',' || quote(number) "
+    "|| ',' || quote(real) || ',' || quote(label) || ',' || quote(payload) "
+    "|| ',' || quote(note) || ');' FROM bench ORDER BY id";
+
+static const std::string catalogue_sql =
+    "SELECT quote(id) || ',' || quote(sku) || ',' || quote(price) || ',' || "
+    "quote(stock) || ',' || quote(title) || ',' || quote(tags) FROM "
+    "catalogue ORDER BY id";
+
+static const std::string csv_sql =
+    "SELECT id || ',' || sku || ',' || price || ',' || ifnull(stock, '') || "
+    "',\"' || replace(title, '\"', '\"\"') || '\",\"' || "
+    "replace(tags, '\"', '\"\"') || '\"' FROM catalogue ORDER BY id";
+
+static const std::string ndjson_sql =
+    "SELECT json_object('id', id, 'sku', sku, 'price', price, 'stock', "
+    "stock, 'title', title, 'tags', json(tags)) FROM catalogue ORDER BY id";
+
+/// The rows of a query as lines, e.g. one INSERT per row like the sqlite3
+/// shell writes
+static std::string lines(sqlite3 *db, const std::string &sql) {
+    auto result = opsqlite_execute(db, sql, nullptr);
+    std::string text;
+    for (const auto &row : result.rows) {
+        text += std::get<std::string>(row[0]);
+        text += '\n';
+    }
+    return text;
+}
+
+static void write_file(const std::string &path, const std::string &content) {
+    std::ofstream file(path);
+    file << content;
+}
+
+static sqlite3 *create_source(const std::string &dir, size_t rows) {
+    sqlite3 *db = opsqlite_open("source.sqlite", dir, "", "", "");
+    auto seq = "WITH RECURSIVE seq(n) AS (SELECT 1 UNION ALL SELECT n + 1 "
+               "FROM seq WHERE n < " +
+               std::to_string(rows) + ") ";
+
+    opsqlite_execute(db, schema, nullptr);
+    opsqlite_execute(db, catalogue_schema, nullptr);
+    opsqlite_execute(
+        db,
+        seq + "INSERT INTO bench SELECT n, (n - " + std::to_string(rows / 2) +
+            ") * 2147483648, n / 7.0, 'row ' || n || '; it''s\n' || "
+            "hex(randomblob(8)), randomblob(n % 32), "
+            "CASE WHEN n % 5 = 0 THEN NULL ELSE 'note' END FROM seq",
+        nullptr);
+    opsqlite_execute(
+        db,
+        seq + "INSERT INTO catalogue SELECT n, 'SKU-' || hex(randomblob(4)), "
+              "(n % 10000) / 100.0, CASE WHEN n % 7 = 0 THEN NULL ELSE n % "
+              "500 END, 'Item \"' || n || '\", size ' || char(65 + n % 5) || "
+              "CASE WHEN n % 3 = 0 THEN '\nsecond line' ELSE '' END, "
+              "json_array('tag' || (n % 10), 'tag' || (n % 3)) FROM seq",
+        nullptr);
+    return db;
+}
+
+static size_t file_size(const std::string &path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    return static_cast<size_t>(file.tellg());
+}
+
+static std::string read_file(const std::string &path) {
+    std::ifstream file(path);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+/// The imported table has to produce the same rows as the source
+static void verify(sqlite3 *db, const std::string &sql,
+                   const std::string &expected) {
+    if (lines(db, sql) != expected) {
+        throw std::runtime_error("Imported rows differ from the source");
+    }
+}
+
+/// Quoted fields with "" escapes in the first record, while the fields of
+/// the reader are still being allocated, as values and as header names
+static void verify_escaped_first_record(const std::string &dir) {
+    auto path = dir + "/escaped.csv";
+    sqlite3 *db = opsqlite_open("escaped.sqlite", dir, "", "", "");
+    opsqlite_execute(db, "CREATE TABLE escaped (one TEXT, two TEXT, three "
+                         "TEXT); CREATE TABLE named (\"on\"\"e\", two, three)",
+                     nullptr);
+
+    TableImportOptions options;
+    options.table = "escaped";
+    options.header = false;
+    write_file(path, "\"a\"\"b\",c,d\n\"x\",\"y\"\"\",z\n");
+    import_csv_file(db, path, options);
+    verify(db, "SELECT one || '|' || two || '|' || three FROM escaped",
+           "a\"b|c|d\nx|y\"|z\n");
+
+    options.table = "named";
+    options.header = true;
+    write_file(path, "\"on\"\"e\",two,three\n1,2,3\n");
+    import_csv_file(db, path, options);
+    verify(db, "SELECT \"on\"\"e\" || two || three FROM named", "123\n");
+    opsqlite_close(db);
+}
+
+/// \u escapes: a surrogate pair becomes one code point, a high surrogate
+/// followed by anything but a low one or a non-ASCII byte fails the row
+static void verify_json_escapes(const std::string &dir) {
+    auto path = dir + "/escapes.ndjson";
+    sqlite3 *db = opsqlite_open("escapes.sqlite", dir, "", "", "");
+    opsqlite_execute(db, "CREATE TABLE escapes (one TEXT)", nullptr);
+
+    TableImportOptions options;
+    options.table = "escapes";
+    write_file(path, "{\"one\": \"\\uD83D\\uDE00 \\u00e9\"}\n");
+    import_ndjson_file(db, path, options);
+    verify(db, "SELECT one FROM escapes", "\xF0\x9F\x98\x80 \xC3\xA9\n");
+
+    for (const char *line : {"{\"one\": \"\\uD800\\u0041\"}\n",
+                             "{\"one\": \"\\u00\xE9\xE9\"}\n"}) {
+        write_file(path, line);
+        std::string error;
+        try {
+            import_ndjson_file(db, path, options);
+        } catch (std::exception &exc) {
+            error = exc.what();
+        }
+        if (error.find("invalid") == std::string::npos) {
+            throw std::runtime_error("Invalid \\u escape was imported: " +
+                                     std::string(line));
+        }
+    }
+    opsqlite_close(db);
+}
+
+/// Arrow columns take their type from the first batch, later integers are
+/// widened to reals and other values that do not fit fail the export
+static void verify_arrow_types(const std::string &dir) {
+    auto path = dir + "/types.arrow";
+    sqlite3 *db = opsqlite_open("types.sqlite", dir, "", "", "");
+    ExportOptions options;
+    options.format = ExportFormat::Arrow;
+    options.batch_size = 1;
+
+    export_query(db, "SELECT 4.5 AS v UNION ALL SELECT 3", nullptr, path,
+                 options);
+    if (read_file(path).compare(0, 6, "ARROW1") != 0) {
+        throw std::runtime_error("Arrow export has no file magic");
+    }
+
+    options.batch_size = 2;
+    std::string error;
+    try {
+        export_query(db,
+                     "SELECT NULL AS v UNION ALL SELECT 3 UNION ALL SELECT 4.5",
+                     nullptr, path, options);
+    } catch (std::exception &exc) {
+        error = exc.what();
+    }
+    if (error.find("row 3: column v holds a real") == std::string::npos) {
+        throw std::runtime_error("Arrow export changed a real into an "
+                                 "integer: " +
+                                 error);
+    }
+    opsqlite_close(db);
+}
+
+/// What JS hands to executeBatch after parsing a CSV itself
+static std::vector<BatchArguments> catalogue_commands(sqlite3 *source) {
+    auto result = opsqlite_execute(
+        source, "SELECT * FROM catalogue ORDER BY id", nullptr);
+    std::vector<BatchArguments> commands;
+    commands.reserve(result.rows.size());
+    for (auto &row : result.rows) {
+        commands.push_back(
+            {"INSERT INTO catalogue VALUES (?, ?, ?, ?, ?, ?)", row});
+    }
+    return commands;
+}
+
+int main(int argc, char **argv) {
+    Options options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--csv") {
+            options.csv = true;
+        } else if (arg == "--rows" && i + 1 < argc) {
+            options.rows = std::stoull(argv[++i]);
+        } else if (arg == "--chunk" && i + 1 < argc) {
+            options.chunks = parse_list(argv[++i]);
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--rows 100000] [--chunk 0,10000] [--csv]\n";
+            return 1;
+        }
+    }
+
+    Table table({"importer", "chunk", "ms", "rows/s", "MB/s"}, options.csv);
+
+    try {
+        TempDir dir;
+        sqlite3 *source = create_source(dir.path(), options.rows);
+        auto bench_rows = lines(source, insert_sql);
+        auto catalogue_rows = lines(source, catalogue_sql);
+        auto commands = catalogue_commands(source);
+
+        auto dump_path = dir.path() + "/dump.sql";
+        auto csv_path = dir.path() + "/catalogue.csv";
+        auto ndjson_path = dir.path() + "/catalogue.ndjson";
+        write_file(dump_path, "PRAGMA foreign_keys=OFF;\nBEGIN TRANSACTION;\n" +
+                                  std::string(schema) + bench_rows +
+                                  "COMMIT;\n");
+        write_file(csv_path, "id,sku,price,stock,title,tags\n" +
+                                 lines(source, csv_sql));
+        write_file(ndjson_path, lines(source, ndjson_sql));
+        opsqlite_close(source);
+        verify_escaped_first_record(dir.path());
+        verify_json_escapes(dir.path());
+        verify_arrow_types(dir.path());
+
+        auto rows = static_cast<double>(options.rows);
+        table.print_header();
+
+        // path is the file the importer read, empty for executeBatch
+        auto print = [&](const std::string &name, const std::string &chunk,
+                         const std::string &path, double ms) {
+            auto megabytes =
+                static_cast<double>(path.empty() ? 0 : file_size(path)) /
+                (1024 * 1024);
+            table.print_row(
+                {name, chunk, format_number(ms, 1),
+                 format_number(rows / ms * 1000, 0),
+                 path.empty() ? "-" : format_number(megabytes / ms * 1000, 1)});
+        };
+
+        int targets = 0;
+        auto open_target = [&](bool catalogue) {
+            auto name = "target-" + std::to_string(targets++) + ".sqlite";
+            sqlite3 *db = opsqlite_open(name, dir.path(), "", "", "");
+            if (catalogue) {
+                opsqlite_execute(db, catalogue_schema, nullptr);
+            }
+            return db;
+        };
+
+        {
+            auto dump = read_file(dump_path);
+            sqlite3 *db = open_target(false);
+            double ms = time_ms([&] {
+                if (sqlite3_exec(db, dump.c_str(), nullptr, nullptr,
+                                 nullptr) != SQLITE_OK) {
+                    throw std::runtime_error(sqlite3_errmsg(db));
+                }
+            });
+            verify(db, insert_sql, bench_rows);
+            print("sqlite3_exec sql", "-", dump_path, ms);
+            opsqlite_close(db);
+        }
+
+        {
+            sqlite3 *db = open_target(true);
+            double ms = time_ms([&] { opsqlite_execute_batch(db, &commands); });
+            verify(db, catalogue_sql, catalogue_rows);
+            print("executeBatch rows", "-", "", ms);
+            opsqlite_close(db);
+        }
+
+        for (auto chunk : options.chunks) {
+            auto chunk_name = chunk == 0 ? "file" : std::to_string(chunk);
+            TableImportOptions import_options;
+            import_options.chunk_size = chunk;
+            import_options.table = "catalogue";
+
+            sqlite3 *db = open_target(false);
+            double ms = time_ms(
+                [&] { import_sql_file(db, dump_path, import_options); });
+            verify(db, insert_sql, bench_rows);
+            print("import_sql_file", chunk_name, dump_path, ms);
+            opsqlite_close(db);
+
+            db = open_target(true);
+            ms = time_ms(
+                [&] { import_csv_file(db, csv_path, import_options); });
+            verify(db, catalogue_sql, catalogue_rows);
+            print("import_csv_file", chunk_name, csv_path, ms);
+            opsqlite_close(db);
+
+            db = open_target(true);
+            ms = time_ms(
+                [&] { import_ndjson_file(db, ndjson_path, import_options); });
+            verify(db, catalogue_sql, catalogue_rows);
+            print("import_ndjson_file", chunk_name, ndjson_path, ms);
+            opsqlite_close(db);
+        }
+
+        sqlite3 *exported = opsqlite_open("source.sqlite", dir.path(), "", "",
+                                          "");
+        for (auto format : {ExportFormat::Csv, ExportFormat::Ndjson,
+                            ExportFormat::Arrow}) {
+            ExportOptions export_options;
+            export_options.format = format;
+            auto name = format == ExportFormat::Csv      ? "csv"
+                        : format == ExportFormat::Ndjson ? "ndjson"
+                                                         : "arrow";
+            auto path = dir.path() + "/export." + name;
+            double ms = time_ms([&] {
+                export_query(exported, "SELECT * FROM catalogue ORDER BY id",
+                             nullptr, path, export_options);
+            });
+            print("export_query " + std::string(name), "-", path, ms);
+
+            if (format == ExportFormat::Arrow) {
+                continue;
+            }
+            TableImportOptions import_options;
+            import_options.table = "catalogue";
+            sqlite3 *db = open_target(true);
+            if (format == ExportFormat::Csv) {
+                import_csv_file(db, path, import_options);
+            } else {
+                import_ndjson_file(db, path, import_options);
+            }
+            verify(db, catalogue_sql, catalogue_rows);
+            opsqlite_close(db);
+        }
+        opsqlite_close(exported);
+    } catch (std::exception &exc) {
+        std::cerr << "[op-sqlite] " << exc.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
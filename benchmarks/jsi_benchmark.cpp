@@ -0,0 +1,233 @@
+// End to end benchmark of the JSI layer. op-sqlite is installed into a host
+// Hermes runtime, the workloads in a JS file call the native database object
+// and every call is timed until its promise settles, so the argument and
+// result conversions in utils.cpp are included
+//
+// Usage: op-sqlite-jsi-benchmark [--script workloads.js] [--iterations 50]
+//                                [--csv]
+
+#include "FakeCallInvoker.h"
+#include "allocations.h"
+#include "bindings.h"
+#include "common.h"
+#include <fstream>
+#include <hermes/hermes.h>
+#include <iostream>
+#include <optional>
+
+using namespace opsqlite;
+using namespace opsqlite::benchmarks;
+
+struct Options {
+    std::string script = OP_SQLITE_DEFAULT_WORKLOADS;
+    size_t iterations = 50;
+    bool csv = false;
+};
+
+struct Workload {
+    std::string name;
+    jsi::Function fn;
+};
+
+static std::string read_file(const std::string &path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open " + path);
+    }
+    return {std::istreambuf_iterator<char>(file),
+            std::istreambuf_iterator<char>()};
+}
+
+/// Bytes the JS engine allocated so far, 0 when it does not report them
+static int64_t js_allocated_bytes(jsi::Runtime &rt) {
+    auto info = rt.instrumentation().getHeapInfo(false);
+    auto it = info.find("hermes_totalAllocatedBytes");
+    return it == info.end() ? 0 : it->second;
+}
+
+/// Runs the queued invoker calls and microtasks until the value settles,
+/// like awaiting it on the JS thread. Plain values return right away
+static void await_value(jsi::Runtime &rt, FakeCallInvoker &invoker,
+                        const jsi::Value &value) {
+    rt.drainMicrotasks();
+
+    if (!value.isObject()) {
+        return;
+    }
+    auto object = value.asObject(rt);
+    if (!object.hasProperty(rt, "then")) {
+        return;
+    }
+
+    bool settled = false;
+    std::optional<std::string> error;
+
+    auto on_resolve = jsi::Function::createFromHostFunction(
+        rt, jsi::PropNameID::forAscii(rt, "resolve"), 1,
+        [&](jsi::Runtime &, const jsi::Value &, const jsi::Value *,
+            size_t) -> jsi::Value {
+            settled = true;
+            return jsi::Value::undefined();
+        });
+    auto on_reject = jsi::Function::createFromHostFunction(
+        rt, jsi::PropNameID::forAscii(rt, "reject"), 1,
+        [&](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *args,
+            size_t count) -> jsi::Value {
+            settled = true;
+            error = count > 0 ? args[0].toString(rt).utf8(rt) : "rejected";
+            return jsi::Value::undefined();
+        });
+
+    object.getPropertyAsFunction(rt, "then")
+        .callWithThis(rt, object, on_resolve, on_reject);
+
+    while (!settled) {
+        rt.drainMicrotasks();
+        if (!settled) {
+            invoker.run_pending(std::chrono::milliseconds(100));
+        }
+    }
+
+    if (error) {
+        throw std::runtime_error(*error);
+    }
+}
+
+static jsi::Function host_function(jsi::Runtime &rt, const char *name,
+                                   jsi::HostFunctionType fn) {
+    return jsi::Function::createFromHostFunction(
+        rt, jsi::PropNameID::forAscii(rt, name), 2, std::move(fn));
+}
+
+static void run(jsi::Runtime &rt, FakeCallInvoker &invoker,
+                const Options &options) {
+    std::vector<Workload> workloads;
+    std::optional<jsi::Function> setup;
+
+    rt.global().setProperty(
+        rt, "workload",
+        host_function(rt, "workload",
+                      [&](jsi::Runtime &rt, const jsi::Value &,
+                          const jsi::Value *args, size_t) -> jsi::Value {
+                          workloads.push_back(
+                              {args[0].asString(rt).utf8(rt),
+                               args[1].asObject(rt).asFunction(rt)});
+                          return jsi::Value::undefined();
+                      }));
+    rt.global().setProperty(
+        rt, "setup",
+        host_function(rt, "setup",
+                      [&](jsi::Runtime &rt, const jsi::Value &,
+                          const jsi::Value *args, size_t) -> jsi::Value {
+                          setup = args[0].asObject(rt).asFunction(rt);
+                          return jsi::Value::undefined();
+                      }));
+    rt.global().setProperty(
+        rt, "print",
+        host_function(rt, "print",
+                      [](jsi::Runtime &rt, const jsi::Value &,
+                         const jsi::Value *args, size_t) -> jsi::Value {
+                          std::cerr << args[0].toString(rt).utf8(rt) << "\n";
+                          return jsi::Value::undefined();
+                      }));
+
+    rt.evaluateJavaScript(
+        std::make_shared<jsi::StringBuffer>(read_file(options.script)),
+        options.script);
+
+    auto proxy = rt.global().getPropertyAsObject(rt, "__OPSQLiteProxy");
+    jsi::Object open_options(rt);
+    open_options.setProperty(rt, "name", "jsi-benchmark.sqlite");
+    jsi::Value db =
+        proxy.getPropertyAsFunction(rt, "open").call(rt, open_options);
+
+    if (setup) {
+        await_value(rt, invoker, setup->call(rt, db));
+    }
+
+    Table table({"workload", "calls", "median ms", "p95 ms", "p99 ms",
+                 "allocs/call", "native B/call", "js B/call"},
+                options.csv);
+    table.print_header();
+
+    for (auto &workload : workloads) {
+        // Warm up, the first call also compiles the workload
+        await_value(rt, invoker, workload.fn.call(rt, db));
+
+        Samples latency;
+        auto allocations_before = allocation_stats();
+        auto js_bytes_before = js_allocated_bytes(rt);
+
+        for (size_t i = 0; i < options.iterations; i++) {
+            latency.add(time_ms([&] {
+                await_value(rt, invoker, workload.fn.call(rt, db));
+            }));
+        }
+
+        auto allocations_after = allocation_stats();
+        auto calls = static_cast<double>(options.iterations);
+        table.print_row(
+            {workload.name, std::to_string(options.iterations),
+             format_number(latency.percentile(0.5)),
+             format_number(latency.percentile(0.95)),
+             format_number(latency.percentile(0.99)),
+             format_number(static_cast<double>(allocations_after.allocations -
+                                               allocations_before.allocations) /
+                               calls,
+                           0),
+             format_number(static_cast<double>(allocations_after.bytes -
+                                               allocations_before.bytes) /
+                               calls,
+                           0),
+             format_number(static_cast<double>(js_allocated_bytes(rt) -
+                                               js_bytes_before) /
+                               calls,
+                           0)});
+    }
+
+    db.asObject(rt).getPropertyAsFunction(rt, "close").call(rt);
+    // Drops the host objects while the runtime is still alive
+    workloads.clear();
+    setup.reset();
+    opsqlite::invalidate();
+}
+
+int main(int argc, char **argv) {
+    Options options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--csv") {
+            options.csv = true;
+        } else if (arg == "--script" && i + 1 < argc) {
+            options.script = argv[++i];
+        } else if (arg == "--iterations" && i + 1 < argc) {
+            options.iterations = std::stoull(argv[++i]);
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--script workloads.js] [--iterations 50] [--csv]\n";
+            return 1;
+        }
+    }
+
+    try {
+        TempDir dir;
+        auto runtime = facebook::hermes::makeHermesRuntime(
+            ::hermes::vm::RuntimeConfig::Builder()
+                .withMicrotaskQueue(true)
+                .build());
+        auto invoker = std::make_shared<FakeCallInvoker>(*runtime);
+
+        opsqlite::install(*runtime, invoker, dir.path().c_str(), "", "", "");
+        run(*runtime, *invoker, options);
+    } catch (jsi::JSError &error) {
+        std::cerr << "[op-sqlite] " << error.getMessage() << "\n"
+                  << error.getStack() << "\n";
+        return 1;
+    } catch (std::exception &exc) {
+        std::cerr << "[op-sqlite] " << exc.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,114 @@
+// Stress workloads for op-sqlite-jsi-benchmark, run with
+// --script benchmarks/jsi_stress.js. Bursts of queued writes make the worker
+// fire the update and commit hooks and fill the pending reactive queries
+// while the JS thread subscribes, unsubscribes, flushes and runs executeSync
+// on the same connection. Build with -DOP_SQLITE_SANITIZER=thread to check
+// the hooks for data races
+var BURST = 200;
+var updates = 0;
+var commits = 0;
+var reactive_results = 0;
+
+function priority(i) {
+  return { priority: ['interactive', 'normal', 'background'][i % 3] };
+}
+
+function subscribe(db, i) {
+  return db.reactiveExecute({
+    query: 'SELECT count(*) AS total FROM stress WHERE value % 4 = ?',
+    arguments: [i % 4],
+    fireOn: [{ table: 'stress' }],
+    callback: function () {
+      reactive_results++;
+    },
+  });
+}
+
+setup(function (db) {
+  db.executeSync(
+    'CREATE TABLE stress (id INTEGER PRIMARY KEY, value INTEGER, label TEXT)'
+  );
+  db.updateHook(function () {
+    updates++;
+  });
+  db.commitHook(function () {
+    commits++;
+  });
+});
+
+workload('burst of 200 inserts with hooks', function (db) {
+  var promises = [];
+  for (var i = 0; i < BURST; i++) {
+    promises.push(
+      db.execute(
+        'INSERT INTO stress (value, label) VALUES (?, ?)',
+        [i, 'row ' + i],
+        priority(i)
+      )
+    );
+  }
+  return Promise.all(promises);
+});
+
+workload('reactive queries while writing', function (db) {
+  var subscriptions = [];
+  var promises = [];
+
+  for (var i = 0; i < BURST; i++) {
+    if (i % 20 === 0) {
+      subscriptions.push(subscribe(db, i));
+    }
+    // Unsubscribing while the worker may be matching the query in on_update
+    if (i % 30 === 0 && subscriptions.length > 1) {
+      subscriptions.shift()();
+    }
+
+    promises.push(
+      db.execute('UPDATE stress SET value = value + 1 WHERE id = ?', [i + 1])
+    );
+    if (i % 10 === 0) {
+      promises.push(db.flushPendingReactiveQueries());
+    }
+  }
+
+  return Promise.all(promises)
+    .then(function () {
+      return db.flushPendingReactiveQueries();
+    })
+    .then(function () {
+      subscriptions.forEach(function (unsubscribe) {
+        unsubscribe();
+      });
+    });
+});
+
+workload('executeSync between queued writes', function (db) {
+  var promises = [];
+  for (var i = 0; i < BURST; i++) {
+    promises.push(
+      db.executeBatch(
+        [['INSERT INTO stress (value, label) VALUES (?, ?)', [i, 'batch']]],
+        priority(i)
+      )
+    );
+    if (i % 25 === 0) {
+      db.executeSync('SELECT count(*) FROM stress');
+    }
+  }
+  return Promise.all(promises);
+});
+
+workload('hooks fired', function () {
+  if (updates === 0 || commits === 0 || reactive_results === 0) {
+    throw new Error(
+      'Hooks did not fire: ' +
+        updates +
+        ' updates, ' +
+        commits +
+        ' commits, ' +
+        reactive_results +
+        ' reactive results'
+    );
+  }
+  return updates;
+});
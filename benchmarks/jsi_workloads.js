@@ -0,0 +1,97 @@
+// Workloads run by op-sqlite-jsi-benchmark. `db` is the object returned by
+// __OPSQLiteProxy.open, not the wrapper from src/index.ts, so only the
+// native side and its JSI conversions are measured. A workload returns a
+// promise or a plain value
+var ROWS = 1000;
+var statement;
+
+setup(function (db) {
+  db.executeSync(
+    'CREATE TABLE bench (id INTEGER PRIMARY KEY, name TEXT, age INTEGER, score REAL, bio TEXT)'
+  );
+  db.executeSync(
+    'CREATE TABLE bench_write (id INTEGER PRIMARY KEY, name TEXT, age INTEGER, score REAL)'
+  );
+  statement = db.prepareStatement('SELECT * FROM bench WHERE id = ?');
+
+  var commands = [];
+  for (var i = 0; i < ROWS; i++) {
+    commands.push([
+      'INSERT INTO bench (name, age, score, bio) VALUES (?, ?, ?, ?)',
+      ['name ' + i, i % 90, i / 7, 'lorem ipsum '.repeat(8) + i],
+    ]);
+  }
+  return db.executeBatch(commands);
+});
+
+workload('execute 1 row', function (db) {
+  return db.execute('SELECT * FROM bench WHERE id = ?', [1]);
+});
+
+workload('execute 1000 rows', function (db) {
+  return db.execute('SELECT * FROM bench');
+});
+
+workload('executeRaw 1000 rows', function (db) {
+  return db.executeRaw('SELECT * FROM bench');
+});
+
+workload('executeWithHostObjects 1000 rows', function (db) {
+  return db.executeWithHostObjects('SELECT * FROM bench');
+});
+
+workload('executeSync 1000 rows', function (db) {
+  return db.executeSync('SELECT * FROM bench');
+});
+
+workload('prepared statement 1 row', function () {
+  return statement.bind([1]).then(function () {
+    return statement.execute();
+  });
+});
+
+workload('execute 32 params', function (db) {
+  var params = [];
+  var placeholders = [];
+  for (var i = 0; i < 32; i++) {
+    params.push(i % 2 === 0 ? i : 'param ' + i);
+    placeholders.push('?');
+  }
+  return db.execute('SELECT ' + placeholders.join(', '), params);
+});
+
+workload('execute 64KB ArrayBuffer param', function (db) {
+  return db.execute('SELECT length(?) AS size', [new ArrayBuffer(65536)]);
+});
+
+workload('executeBatch 100 upserts', function (db) {
+  var commands = [];
+  for (var i = 0; i < 100; i++) {
+    commands.push([
+      'INSERT OR REPLACE INTO bench_write (id, name, age, score) VALUES (?, ?, ?, ?)',
+      [i, 'name ' + i, i % 90, i / 7],
+    ]);
+  }
+  return db.executeBatch(commands);
+});
+
+var IDS = [];
+for (var id = 1; id <= ROWS; id++) {
+  IDS.push(id);
+}
+var IN_LIST_SQL =
+  'SELECT id FROM bench WHERE id IN (' +
+  IDS.map(function () {
+    return '?';
+  }).join(', ') +
+  ')';
+
+workload('execute IN list of 1000 params', function (db) {
+  return db.execute(IN_LIST_SQL, IDS);
+});
+
+workload('execute 1000 ids with op_array', function (db) {
+  return db.execute('SELECT id FROM bench WHERE id IN op_array(?)', [
+    { __opSqliteArray: new Int32Array(IDS) },
+  ]);
+});
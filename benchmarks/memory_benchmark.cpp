@@ -0,0 +1,248 @@
+// Native memory used by every result mode of the bridge: execute, executeRaw,
+// executeWithHostObjects and prepared statements. Each measurement runs in a
+// forked process so peak RSS is not hidden by an earlier, larger one
+//
+// Usage: op-sqlite-memory-benchmark [--rows 1,100,10000,100000,1000000]
+//                                   [--width 8] [--csv]
+
+#include "allocations.h"
+#include "bridge.h"
+#include "common.h"
+#include <functional>
+#include <iostream>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace opsqlite;
+using namespace opsqlite::benchmarks;
+
+struct Options {
+    std::vector<size_t> rows = {1, 100, 10000, 100000, 1000000};
+    size_t width = 8;
+    bool csv = false;
+};
+
+struct Measurement {
+    uint64_t rows;
+    uint64_t allocations;
+    uint64_t allocated_bytes;
+    int64_t peak_heap_bytes;
+    int64_t peak_rss_bytes;
+};
+
+struct Mode {
+    const char *name;
+    // Runs the query and returns the number of rows. Only peaks are reported
+    // so the results can be freed before it returns
+    std::function<size_t(sqlite3 *)> run;
+};
+
+static const std::string select_sql = "SELECT * FROM bench";
+
+/// Same values as the bridge benchmark, columns cycle through integer, real
+/// and text. Generated by sqlite so creating 1M rows stays cheap
+static std::string populate_sql(size_t width, size_t rows) {
+    std::string columns;
+    std::string values;
+
+    for (size_t i = 0; i < width; i++) {
+        auto column = std::to_string(i);
+        columns += (i == 0 ? "c" : ", c") + column;
+        values += i == 0 ? "" : ", ";
+        switch (i % 3) {
+        case 0:
+            values += "n * 31 + " + column;
+            break;
+        case 1:
+            values += "n / " + std::to_string(i + 1) + ".0";
+            break;
+        default:
+            values += "'value ' || n || '-" + column + "'";
+        }
+    }
+
+    return "WITH RECURSIVE seq(n) AS (SELECT 0 UNION ALL SELECT n + 1 FROM "
+           "seq WHERE n < " +
+           std::to_string(rows) + " - 1) INSERT INTO bench (" + columns +
+           ") SELECT " + values + " FROM seq";
+}
+
+static std::string create_sql(size_t width) {
+    std::string sql = "CREATE TABLE bench (id INTEGER PRIMARY KEY";
+    for (size_t i = 0; i < width; i++) {
+        sql += ", c" + std::to_string(i);
+    }
+    return sql + ")";
+}
+
+/// ru_maxrss is in kilobytes on Linux and bytes on Apple platforms
+static int64_t max_rss_bytes() {
+    struct rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    return usage.ru_maxrss * 1024;
+#endif
+}
+
+static std::vector<Mode> modes() {
+    return {
+        {"execute",
+         [](sqlite3 *db) {
+             return opsqlite_execute(db, select_sql, nullptr).rows.size();
+         }},
+        {"execute_raw",
+         [](sqlite3 *db) {
+             std::vector<std::vector<JSVariant>> results;
+             opsqlite_execute_raw(db, select_sql, nullptr, &results);
+             return results.size();
+         }},
+        {"execute_host_objects",
+         [](sqlite3 *db) {
+             std::vector<DumbHostObject> results;
+             auto metadata = std::make_shared<std::vector<SmartHostObject>>();
+             opsqlite_execute_host_objects(db, select_sql, nullptr, &results,
+                                           metadata);
+             return results.size();
+         }},
+        {"prepared_statement",
+         [](sqlite3 *db) {
+             auto statement = opsqlite_prepare_statement(db, select_sql);
+             std::vector<DumbHostObject> results;
+             auto metadata = std::make_shared<std::vector<SmartHostObject>>();
+             opsqlite_execute_prepared_statement(db, statement, &results,
+                                                 metadata);
+             sqlite3_finalize(statement);
+             return results.size();
+         }},
+    };
+}
+
+/// Runs the mode in a child process and reads its counters through a pipe
+static Measurement measure(const Mode &mode, const std::string &name,
+                           const std::string &path) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        throw std::runtime_error("Could not create pipe");
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        throw std::runtime_error("Could not fork");
+    }
+
+    if (pid == 0) {
+        close(fds[0]);
+        Measurement measurement{};
+        try {
+            sqlite3 *db = opsqlite_open(name, path, "", "", "");
+            // Statement caches and the schema are loaded by the first query
+            opsqlite_execute(db, "SELECT * FROM bench LIMIT 1", nullptr);
+
+            reset_peak_allocated_bytes();
+            auto before = allocation_stats();
+            auto rss_before = max_rss_bytes();
+
+            measurement.rows = mode.run(db);
+
+            auto after = allocation_stats();
+            measurement.allocations = after.allocations - before.allocations;
+            measurement.allocated_bytes = after.bytes - before.bytes;
+            measurement.peak_heap_bytes =
+                after.peak_live_bytes - before.live_bytes;
+            measurement.peak_rss_bytes = max_rss_bytes() - rss_before;
+        } catch (std::exception &exc) {
+            std::cerr << "[op-sqlite] " << exc.what() << "\n";
+            _exit(1);
+        }
+
+        auto written = write(fds[1], &measurement, sizeof(measurement));
+        _exit(written == sizeof(measurement) ? 0 : 1);
+    }
+
+    close(fds[1]);
+    Measurement measurement{};
+    auto bytes = read(fds[0], &measurement, sizeof(measurement));
+    close(fds[0]);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (bytes != sizeof(measurement) || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0) {
+        throw std::runtime_error(std::string(mode.name) + " failed");
+    }
+
+    return measurement;
+}
+
+static std::string megabytes(int64_t bytes) {
+    return format_number(static_cast<double>(bytes) / (1024 * 1024), 2);
+}
+
+int main(int argc, char **argv) {
+    Options options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--csv") {
+            options.csv = true;
+        } else if (arg == "--rows" && i + 1 < argc) {
+            options.rows = parse_list(argv[++i]);
+        } else if (arg == "--width" && i + 1 < argc) {
+            options.width = std::stoull(argv[++i]);
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--rows 1,100,10000,100000,1000000] [--width 8]"
+                         " [--csv]\n";
+            return 1;
+        }
+    }
+
+    Table table({"mode", "rows", "peak heap MB", "peak RSS MB", "allocations",
+                 "allocs/row", "bytes/row"},
+                options.csv);
+    table.print_header();
+
+    try {
+        TempDir dir;
+
+        for (auto rows : options.rows) {
+            std::string name = "memory-" + std::to_string(rows) + ".sqlite";
+            sqlite3 *db = opsqlite_open(name, dir.path(), "", "", "");
+            opsqlite_execute(db, create_sql(options.width), nullptr);
+            opsqlite_execute(db, populate_sql(options.width, rows), nullptr);
+            opsqlite_close(db);
+
+            for (const auto &mode : modes()) {
+                auto measurement = measure(mode, name, dir.path());
+                if (measurement.rows != rows) {
+                    throw std::runtime_error(
+                        std::string(mode.name) + " returned " +
+                        std::to_string(measurement.rows) + " rows, expected " +
+                        std::to_string(rows));
+                }
+
+                auto per_row = static_cast<double>(rows);
+                table.print_row(
+                    {mode.name, std::to_string(rows),
+                     megabytes(measurement.peak_heap_bytes),
+                     megabytes(measurement.peak_rss_bytes),
+                     std::to_string(measurement.allocations),
+                     format_number(
+                         static_cast<double>(measurement.allocations) / per_row,
+                         1),
+                     format_number(static_cast<double>(
+                                       measurement.allocated_bytes) /
+                                       per_row,
+                                   0)});
+            }
+        }
+    } catch (std::exception &exc) {
+        std::cerr << "[op-sqlite] " << exc.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
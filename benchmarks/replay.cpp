@@ -0,0 +1,278 @@
+// Replays a workload recorded with db.startRecording() against a copy of the
+// database, through the same bridge functions and thread pool the app uses,
+// and reports the latency of every API and of the most expensive statements
+// next to the latencies seen on the device
+//
+// Usage: op-sqlite-replay <recording> <database> [--timed] [--top 10] [--csv]
+//
+// Calls are queued one after the other by default. --timed queues them at
+// the offsets they had in the recording, so queue wait caused by bursts is
+// reproduced as well
+
+#include "OPThreadPool.h"
+#include "QueryStats.h"
+#include "WorkloadRecorder.h"
+#include "bridge.h"
+#include "common.h"
+#include <iostream>
+#include <map>
+#include <thread>
+
+using namespace opsqlite;
+using namespace opsqlite::benchmarks;
+
+struct Options {
+    std::string recording;
+    std::string database;
+    bool timed = false;
+    size_t top = 10;
+    bool csv = false;
+};
+
+struct ReplayedCall {
+    uint64_t queue_ns = 0;
+    uint64_t duration_ns = 0;
+    bool failed = false;
+};
+
+struct Stats {
+    Samples recorded;
+    Samples queue;
+    Samples duration;
+    double total_ms = 0;
+    size_t errors = 0;
+};
+
+static const char *api_name(RecordedApi api) {
+    switch (api) {
+    case RecordedApi::Execute:
+        return "execute";
+    case RecordedApi::ExecuteRaw:
+        return "executeRaw";
+    case RecordedApi::ExecuteWithHostObjects:
+        return "executeWithHostObjects";
+    case RecordedApi::ExecuteBatch:
+        return "executeBatch";
+    case RecordedApi::ExecuteSync:
+        return "executeSync";
+    }
+    return "unknown";
+}
+
+static double to_ms(uint64_t ns) { return static_cast<double>(ns) / 1e6; }
+
+static std::string statement_label(const std::string &sql, bool csv) {
+    if (csv) {
+        std::string quoted = "\"";
+        for (char c : sql) {
+            quoted += c == '"' ? "\"\"" : std::string(1, c);
+        }
+        return quoted + "\"";
+    }
+    // Long statements would break the alignment of the table
+    return sql.size() <= 60 ? sql : sql.substr(0, 57) + "...";
+}
+
+/// Same bridge call the DBHostObject function makes, results are discarded
+static void replay_call(sqlite3 *db, const RecordedCall &call) {
+    const auto &command = call.commands.front();
+
+    switch (call.api) {
+    case RecordedApi::Execute:
+    case RecordedApi::ExecuteSync:
+        opsqlite_execute(db, command.sql, &command.params);
+        break;
+    case RecordedApi::ExecuteRaw: {
+        std::vector<std::vector<JSVariant>> results;
+        opsqlite_execute_raw(db, command.sql, &command.params, &results);
+        break;
+    }
+    case RecordedApi::ExecuteWithHostObjects: {
+        std::vector<DumbHostObject> results;
+        auto metadata = std::make_shared<std::vector<SmartHostObject>>();
+        opsqlite_execute_host_objects(db, command.sql, &command.params,
+                                      &results, metadata);
+        break;
+    }
+    case RecordedApi::ExecuteBatch:
+        opsqlite_execute_batch(db, &call.commands);
+        break;
+    }
+}
+
+static ReplayedCall run_call(sqlite3 *db, const RecordedCall &call,
+                             uint64_t queued_at) {
+    ReplayedCall replayed;
+    auto started_at = now_ns();
+    replayed.queue_ns = started_at - queued_at;
+
+    try {
+        replay_call(db, call);
+    } catch (std::exception &) {
+        // Failures are part of the workload, e.g. constraint violations
+        replayed.failed = true;
+    }
+
+    replayed.duration_ns = now_ns() - started_at;
+    return replayed;
+}
+
+static std::vector<ReplayedCall> replay(sqlite3 *db,
+                                        const std::vector<RecordedCall> &calls,
+                                        bool timed) {
+    std::vector<ReplayedCall> replayed(calls.size());
+    ThreadPool pool;
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < calls.size(); i++) {
+        const auto &call = calls[i];
+        if (call.commands.empty()) {
+            continue;
+        }
+
+        if (timed) {
+            std::this_thread::sleep_until(
+                start + std::chrono::nanoseconds(call.queued_at_ns));
+        }
+
+        // Sync calls run on the JS thread in the app, next to the pool
+        if (call.api == RecordedApi::ExecuteSync) {
+            replayed[i] = run_call(db, call, now_ns());
+            continue;
+        }
+
+        pool.queueWork([db, &call, &replayed, i, queued_at = now_ns()]() {
+            replayed[i] = run_call(db, call, queued_at);
+        });
+
+        if (!timed) {
+            pool.waitFinished();
+        }
+    }
+
+    pool.waitFinished();
+    return replayed;
+}
+
+static void print_stats(const Table &table, const std::string &name,
+                        const Stats &stats) {
+    table.print_row({name, std::to_string(stats.duration.values.size()),
+                     std::to_string(stats.errors),
+                     format_number(stats.recorded.percentile(0.5)),
+                     format_number(stats.duration.percentile(0.5)),
+                     format_number(stats.duration.percentile(0.95)),
+                     format_number(stats.duration.percentile(0.99)),
+                     format_number(stats.queue.percentile(0.95)),
+                     format_number(stats.total_ms)});
+}
+
+/// Copies the database and its WAL so the replay does not modify them
+static std::string copy_database(const std::string &database,
+                                 const std::string &dir) {
+    namespace fs = std::filesystem;
+    std::string name = fs::path(database).filename().string();
+
+    fs::copy_file(database, fs::path(dir) / name);
+    if (fs::exists(database + "-wal")) {
+        fs::copy_file(database + "-wal", fs::path(dir) / (name + "-wal"));
+    }
+
+    return name;
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    std::vector<std::string> positional;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--csv") {
+            options.csv = true;
+        } else if (arg == "--timed") {
+            options.timed = true;
+        } else if (arg == "--top" && i + 1 < argc) {
+            options.top = std::stoull(argv[++i]);
+        } else if (arg.rfind("--", 0) != 0) {
+            positional.push_back(arg);
+        } else {
+            positional.clear();
+            break;
+        }
+    }
+
+    if (positional.size() != 2) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <recording> <database> [--timed] [--top 10] [--csv]\n";
+        return 1;
+    }
+    options.recording = positional[0];
+    options.database = positional[1];
+
+    try {
+        auto calls = read_workload(options.recording);
+
+        TempDir dir;
+        auto name = copy_database(options.database, dir.path());
+        sqlite3 *db = opsqlite_open(name, dir.path(), "", "", "");
+
+        auto replayed = replay(db, calls, options.timed);
+        opsqlite_close(db);
+
+        std::map<std::string, Stats> by_api;
+        std::map<std::string, Stats> by_sql;
+
+        for (size_t i = 0; i < calls.size(); i++) {
+            const auto &call = calls[i];
+            if (call.commands.empty()) {
+                continue;
+            }
+
+            std::vector<Stats *> groups = {&by_api[api_name(call.api)]};
+            // Batches are grouped by API only, their statements vary
+            if (call.commands.size() == 1) {
+                groups.push_back(&by_sql[call.commands.front().sql]);
+            }
+
+            for (auto *stats : groups) {
+                stats->recorded.add(to_ms(call.duration_ns));
+                stats->queue.add(to_ms(replayed[i].queue_ns));
+                stats->duration.add(to_ms(replayed[i].duration_ns));
+                stats->total_ms += to_ms(replayed[i].duration_ns);
+                stats->errors += replayed[i].failed ? 1 : 0;
+            }
+        }
+
+        Table table({"api", "calls", "errors", "recorded p50", "p50 ms",
+                     "p95 ms", "p99 ms", "queue p95", "total ms"},
+                    options.csv);
+        table.print_header();
+        for (const auto &[api, stats] : by_api) {
+            print_stats(table, api, stats);
+        }
+
+        std::vector<std::pair<std::string, const Stats *>> statements;
+        for (const auto &[sql, stats] : by_sql) {
+            statements.emplace_back(sql, &stats);
+        }
+        std::sort(statements.begin(), statements.end(),
+                  [](const auto &a, const auto &b) {
+                      return a.second->total_ms > b.second->total_ms;
+                  });
+        statements.resize(std::min(statements.size(), options.top));
+
+        printf("\n");
+        Table sql_table({"statement", "calls", "errors", "recorded p50",
+                         "p50 ms", "p95 ms", "p99 ms", "queue p95",
+                         "total ms"},
+                        options.csv);
+        sql_table.print_header();
+        for (const auto &[sql, stats] : statements) {
+            print_stats(sql_table, statement_label(sql, options.csv), *stats);
+        }
+    } catch (std::exception &exc) {
+        std::cerr << "[op-sqlite] " << exc.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,228 @@
+// Stress test of ThreadPool. Several producer threads queue inserts on one
+// connection with mixed priorities while another thread keeps calling
+// waitFinished, then the pool is restarted with work still queued like
+// DBHostObject::invalidate does. Every task must run exactly once. Reports
+// throughput and the queue latency tail per priority. Build with
+// -DOP_SQLITE_SANITIZER=thread to run it under ThreadSanitizer
+//
+// Usage: op-sqlite-stress-benchmark [--producers 8] [--tasks 5000] [--csv]
+
+#include "OPThreadPool.h"
+#include "QueryStats.h"
+#include "bridge.h"
+#include "common.h"
+#include <array>
+#include <atomic>
+#include <iostream>
+#include <thread>
+
+using namespace opsqlite;
+using namespace opsqlite::benchmarks;
+
+struct Options {
+    size_t producers = 8;
+    // Per producer
+    size_t tasks = 5000;
+    bool csv = false;
+};
+
+static constexpr size_t priority_count = static_cast<size_t>(Priority::Count);
+
+static const char *priority_name(size_t priority) {
+    switch (static_cast<Priority>(priority)) {
+    case Priority::Interactive:
+        return "interactive";
+    case Priority::Normal:
+        return "normal";
+    default:
+        return "background";
+    }
+}
+
+/// Queue latencies are only written by the pool's worker, and read once
+/// waitFinished returned
+struct Latencies {
+    std::array<Samples, priority_count> queue_ms;
+};
+
+/// Roughly what an app sends: mostly normal queries, some interactive
+/// lookups and background sync work
+static Priority pick_priority(size_t i) {
+    switch (i % 8) {
+    case 0:
+        return Priority::Interactive;
+    case 1:
+    case 2:
+        return Priority::Background;
+    default:
+        return Priority::Normal;
+    }
+}
+
+static void queue_insert(ThreadPool &pool, sqlite3 *db, Latencies &latencies,
+                         size_t producer, size_t i) {
+    auto priority = pick_priority(i);
+
+    pool.queueWork(
+        [db, &latencies, producer, i, priority, queued_at = now_ns()]() {
+            auto started_at = now_ns();
+            latencies.queue_ms[static_cast<size_t>(priority)].add(
+                static_cast<double>(started_at - queued_at) / 1e6);
+
+            std::vector<JSVariant> params = {static_cast<long long>(producer),
+                                             static_cast<long long>(i)};
+            opsqlite_execute(
+                db, "INSERT INTO stress (producer, task) VALUES (?, ?)",
+                &params);
+        },
+        priority);
+}
+
+static void print_latencies(const Table &table, const char *name,
+                            const Samples &samples,
+                            const std::string &throughput) {
+    table.print_row({name, std::to_string(samples.values.size()), throughput,
+                     format_number(samples.percentile(0.5)),
+                     format_number(samples.percentile(0.99)),
+                     format_number(samples.percentile(0.999)),
+                     format_number(samples.percentile(1))});
+}
+
+static long long count_rows(sqlite3 *db) {
+    auto result = opsqlite_execute(db, "SELECT count(*) FROM stress", nullptr);
+    // Integers come back as doubles, like they are handed to JS
+    return static_cast<long long>(std::get<double>(result.rows[0][0]));
+}
+
+static void expect_rows(sqlite3 *db, long long expected, const char *phase) {
+    auto rows = count_rows(db);
+    if (rows != expected) {
+        throw std::runtime_error(std::string(phase) + ": " +
+                                 std::to_string(rows) + " tasks ran, expected " +
+                                 std::to_string(expected));
+    }
+}
+
+/// Producers race each other and a thread blocked in waitFinished
+static double run_contended(ThreadPool &pool, sqlite3 *db,
+                            Latencies &latencies, const Options &options,
+                            size_t &waits) {
+    std::atomic<bool> producing{true};
+    std::thread waiter([&] {
+        while (producing) {
+            pool.waitFinished();
+            waits++;
+        }
+    });
+
+    double ms = time_ms([&] {
+        std::vector<std::thread> producers;
+        for (size_t p = 0; p < options.producers; p++) {
+            producers.emplace_back([&, p] {
+                for (size_t i = 0; i < options.tasks; i++) {
+                    queue_insert(pool, db, latencies, p, i);
+                }
+            });
+        }
+        for (auto &producer : producers) {
+            producer.join();
+        }
+        pool.waitFinished();
+    });
+
+    producing = false;
+    waiter.join();
+    return ms;
+}
+
+/// Restarts the pool while producers are still queueing, queued tasks must
+/// survive the restart
+static void run_restarts(ThreadPool &pool, sqlite3 *db, Latencies &latencies,
+                         const Options &options) {
+    std::atomic<bool> producing{true};
+    std::thread producer([&] {
+        for (size_t i = 0; i < options.tasks; i++) {
+            queue_insert(pool, db, latencies, options.producers, i);
+        }
+        producing = false;
+    });
+
+    size_t restarts = 0;
+    while (producing || restarts == 0) {
+        pool.restartPool();
+        restarts++;
+        std::this_thread::yield();
+    }
+
+    producer.join();
+    pool.waitFinished();
+}
+
+int main(int argc, char **argv) {
+    Options options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--csv") {
+            options.csv = true;
+        } else if (arg == "--producers" && i + 1 < argc) {
+            options.producers = std::stoull(argv[++i]);
+        } else if (arg == "--tasks" && i + 1 < argc) {
+            options.tasks = std::stoull(argv[++i]);
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--producers 8] [--tasks 5000] [--csv]\n";
+            return 1;
+        }
+    }
+
+    try {
+        TempDir dir;
+        sqlite3 *db = opsqlite_open("stress.sqlite", dir.path(), "", "", "");
+        opsqlite_execute(db, "PRAGMA journal_mode = WAL", nullptr);
+        opsqlite_execute(db, "PRAGMA synchronous = NORMAL", nullptr);
+        opsqlite_execute(db,
+                         "CREATE TABLE stress (id INTEGER PRIMARY KEY, "
+                         "producer INTEGER, task INTEGER)",
+                         nullptr);
+
+        Latencies latencies;
+        size_t waits = 0;
+        auto total = static_cast<long long>(options.producers * options.tasks);
+
+        {
+            ThreadPool pool;
+            double ms = run_contended(pool, db, latencies, options, waits);
+            expect_rows(db, total, "contended");
+
+            Table table({"priority", "tasks", "tasks/s", "p50 ms", "p99 ms",
+                         "p99.9 ms", "max ms"},
+                        options.csv);
+            table.print_header();
+
+            Samples all;
+            for (size_t p = 0; p < priority_count; p++) {
+                const auto &samples = latencies.queue_ms[p];
+                all.values.insert(all.values.end(), samples.values.begin(),
+                                  samples.values.end());
+                print_latencies(table, priority_name(p), samples, "-");
+            }
+            print_latencies(
+                table, "all", all,
+                format_number(static_cast<double>(total) / ms * 1000, 0));
+
+            run_restarts(pool, db, latencies, options);
+            expect_rows(db, total + static_cast<long long>(options.tasks),
+                        "restarts");
+        }
+
+        std::cerr << "[op-sqlite] " << waits
+                  << " waitFinished calls returned during the run\n";
+        opsqlite_close(db);
+    } catch (std::exception &exc) {
+        std::cerr << "[op-sqlite] " << exc.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
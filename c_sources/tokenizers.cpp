@@ -46,7 +46,9 @@ int wordTokenizerTokenize(Fts5Tokenizer *pTokenizer, void *pCtx, int flags,
   int i = 0;
 
   while (i <= nText) {
-    if (i == nText || !std::isalnum(static_cast<unsigned char>(pText[i]))) {
+    // Bytes from 0x80 belong to UTF-8 encoded characters, kept in the word
+    unsigned char c = i < nText ? static_cast<unsigned char>(pText[i]) : 0;
+    if (i == nText || (c < 0x80 && !std::isalnum(c))) {
       if (start < i) { // Found a token
         int rc = xToken(pCtx, 0, pText + start, i - start, start, i);
         if (rc != SQLITE_OK)
@@ -72,17 +74,4 @@ int opsqlite_wordtokenizer_init(sqlite3 *db, char **error,
                                   NULL);
 }
 
-int opsqlite_porter_init(sqlite3 *db, char **error,
-                         sqlite3_api_routines const *api) {
-  fts5_tokenizer porter_tokenizer = {wordTokenizerCreate, wordTokenizerDelete,
-                                     wordTokenizerTokenize};
-
-  fts5_api *ftsApi = (fts5_api *)fts5_api_from_db(db);
-  if (ftsApi == nullptr)
-    return SQLITE_ERROR;
-
-  return ftsApi->xCreateTokenizer(ftsApi, "portertokenizer", NULL,
-                                  &porter_tokenizer, NULL);
-}
-
 } // namespace opsqlite
@@ -0,0 +1,192 @@
+#ifndef OP_SQLITE_USE_LIBSQL
+
+#include "ArrayParam.h"
+#include <new>
+
+namespace opsqlite {
+
+namespace {
+
+/// Pointer type of the bound values, sqlite3_value_pointer returns null for
+/// any other
+constexpr const char *pointer_type = "op-sqlite-array-param";
+
+enum Column { value_column, list_column };
+
+struct Cursor : sqlite3_vtab_cursor {
+    /// Kept alive while the cursor reads it, the statement can be rebound
+    std::shared_ptr<const ArrayParam::Values> values;
+    size_t row = 0;
+    size_t size = 0;
+};
+
+int connect(sqlite3 *db, void *, int, const char *const *,
+            sqlite3_vtab **out, char **) {
+    int status =
+        sqlite3_declare_vtab(db, "CREATE TABLE x(value, list HIDDEN)");
+    if (status != SQLITE_OK) {
+        return status;
+    }
+
+    auto *table = static_cast<sqlite3_vtab *>(sqlite3_malloc(sizeof(**out)));
+    if (table == nullptr) {
+        return SQLITE_NOMEM;
+    }
+    *table = {};
+    *out = table;
+#ifdef SQLITE_VTAB_INNOCUOUS
+    sqlite3_vtab_config(db, SQLITE_VTAB_INNOCUOUS);
+#endif
+    return SQLITE_OK;
+}
+
+int disconnect(sqlite3_vtab *table) {
+    sqlite3_free(table);
+    return SQLITE_OK;
+}
+
+int open(sqlite3_vtab *, sqlite3_vtab_cursor **out) {
+    auto *cursor = new (std::nothrow) Cursor();
+    if (cursor == nullptr) {
+        return SQLITE_NOMEM;
+    }
+    *out = cursor;
+    return SQLITE_OK;
+}
+
+int close(sqlite3_vtab_cursor *cursor) {
+    delete static_cast<Cursor *>(cursor);
+    return SQLITE_OK;
+}
+
+/// Only a plan with the list as argument returns rows, the others cost so
+/// much the planner never picks them when the argument is there
+int best_index(sqlite3_vtab *, sqlite3_index_info *info) {
+    for (int i = 0; i < info->nConstraint; i++) {
+        auto &constraint = info->aConstraint[i];
+        if (constraint.iColumn == list_column && constraint.usable &&
+            constraint.op == SQLITE_INDEX_CONSTRAINT_EQ) {
+            info->aConstraintUsage[i].argvIndex = 1;
+            info->aConstraintUsage[i].omit = 1;
+            info->idxNum = 1;
+            info->estimatedCost = 1;
+            info->estimatedRows = 100;
+            return SQLITE_OK;
+        }
+    }
+
+    info->idxNum = 0;
+    info->estimatedCost = 2147483647;
+    info->estimatedRows = 2147483647;
+    return SQLITE_OK;
+}
+
+int filter(sqlite3_vtab_cursor *base, int idx_num, const char *, int,
+           sqlite3_value **argv) {
+    auto *cursor = static_cast<Cursor *>(base);
+    cursor->values.reset();
+    cursor->row = 0;
+    cursor->size = 0;
+
+    if (idx_num == 0) {
+        return SQLITE_OK;
+    }
+
+    // Bound pointers have the NULL type, a real NULL gives no rows
+    auto *param = static_cast<const ArrayParam *>(
+        sqlite3_value_pointer(argv[0], pointer_type));
+    if (param == nullptr && sqlite3_value_type(argv[0]) == SQLITE_NULL) {
+        return SQLITE_OK;
+    }
+    if (param == nullptr) {
+        sqlite3_free(base->pVtab->zErrMsg);
+        base->pVtab->zErrMsg =
+            sqlite3_mprintf("op_array takes an array bound with arrayParam");
+        return SQLITE_ERROR;
+    }
+
+    cursor->values = param->values;
+    cursor->size = std::visit([](auto &values) { return values.size(); },
+                              *cursor->values);
+    return SQLITE_OK;
+}
+
+int next(sqlite3_vtab_cursor *base) {
+    static_cast<Cursor *>(base)->row++;
+    return SQLITE_OK;
+}
+
+int eof(sqlite3_vtab_cursor *base) {
+    auto *cursor = static_cast<Cursor *>(base);
+    return cursor->row >= cursor->size;
+}
+
+int column(sqlite3_vtab_cursor *base, sqlite3_context *context, int index) {
+    auto *cursor = static_cast<Cursor *>(base);
+    if (index != value_column) {
+        sqlite3_result_null(context);
+        return SQLITE_OK;
+    }
+
+    std::visit(
+        [&](auto &values) {
+            using T = typename std::decay_t<decltype(values)>::value_type;
+            const auto &value = values[cursor->row];
+
+            if constexpr (std::is_same_v<T, int32_t>) {
+                sqlite3_result_int(context, value);
+            } else if constexpr (std::is_same_v<T, int64_t>) {
+                sqlite3_result_int64(context, value);
+            } else if constexpr (std::is_same_v<T, double>) {
+                sqlite3_result_double(context, value);
+            } else {
+                sqlite3_result_text(context, value.data(),
+                                    static_cast<int>(value.size()),
+                                    SQLITE_TRANSIENT);
+            }
+        },
+        *cursor->values);
+    return SQLITE_OK;
+}
+
+int rowid(sqlite3_vtab_cursor *base, sqlite3_int64 *out) {
+    *out = static_cast<sqlite3_int64>(static_cast<Cursor *>(base)->row + 1);
+    return SQLITE_OK;
+}
+
+/// Eponymous only, there is no xCreate so it cannot back a CREATE VIRTUAL
+/// TABLE
+sqlite3_module create_module() {
+    sqlite3_module module = {};
+    module.xConnect = connect;
+    module.xBestIndex = best_index;
+    module.xDisconnect = disconnect;
+    module.xOpen = open;
+    module.xClose = close;
+    module.xFilter = filter;
+    module.xNext = next;
+    module.xEof = eof;
+    module.xColumn = column;
+    module.xRowid = rowid;
+    return module;
+}
+
+} // namespace
+
+int bind_array_param(sqlite3_stmt *statement, int index,
+                     const ArrayParam &param) {
+    // sqlite calls the destructor when binding fails too
+    return sqlite3_bind_pointer(statement, index, new ArrayParam(param),
+                                pointer_type, [](void *pointer) {
+                                    delete static_cast<ArrayParam *>(pointer);
+                                });
+}
+
+int register_array_param_module(sqlite3 *db) {
+    static const sqlite3_module module = create_module();
+    return sqlite3_create_module(db, "op_array", &module, nullptr);
+}
+
+} // namespace opsqlite
+
+#endif
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "types.h"
+#include <sqlite3.h>
+
+namespace opsqlite {
+
+/// Binds the values as a pointer only op_array can read, a plain SQL value
+/// is never exposed
+int bind_array_param(sqlite3_stmt *statement, int index,
+                     const ArrayParam &param);
+
+/// Registers op_array(list), a table valued function returning one row per
+/// value of an ArrayParam with the value in its value column
+int register_array_param_module(sqlite3 *db);
+
+} // namespace opsqlite
@@ -0,0 +1,377 @@
+#include "ArrowIpc.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace opsqlite {
+
+namespace {
+
+// Values from the Arrow flatbuffers schemas, Schema.fbs and Message.fbs
+constexpr int16_t metadata_version_v5 = 4;
+constexpr uint8_t header_schema = 1;
+constexpr uint8_t header_record_batch = 3;
+constexpr uint8_t type_int = 2;
+constexpr uint8_t type_floating_point = 3;
+constexpr uint8_t type_binary = 4;
+constexpr uint8_t type_utf8 = 5;
+constexpr int16_t precision_double = 2;
+
+const char magic[] = "ARROW1";
+
+size_t padding(size_t size, size_t alignment) {
+    return (alignment - size % alignment) % alignment;
+}
+
+/// Just enough of a flatbuffers builder for the Arrow metadata. Like the real
+/// one it fills the buffer back to front, so children are written before the
+/// tables that point to them and every offset points forward. Positions are
+/// counted from the end of the buffer
+class FlatBuilder {
+  public:
+    uint32_t size() const { return static_cast<uint32_t>(bytes.size()); }
+
+    template <typename T> void push(T value) {
+        prep(sizeof(T), 0);
+        uint8_t raw[sizeof(T)];
+        memcpy(raw, &value, sizeof(T));
+        bytes.insert(bytes.begin(), raw, raw + sizeof(T));
+    }
+
+    void push_offset(uint32_t target) {
+        prep(4, 0);
+        push<uint32_t>(size() + 4 - target);
+    }
+
+    uint32_t string(const std::string &value) {
+        prep(4, value.size() + 1);
+        bytes.insert(bytes.begin(), 0);
+        bytes.insert(bytes.begin(), value.begin(), value.end());
+        push<uint32_t>(static_cast<uint32_t>(value.size()));
+        return size();
+    }
+
+    /// Elements are pushed last to first between start and end
+    void start_vector(size_t element_size, size_t count, size_t alignment) {
+        prep(4, element_size * count);
+        prep(alignment, element_size * count);
+    }
+
+    uint32_t end_vector(size_t count) {
+        push<uint32_t>(static_cast<uint32_t>(count));
+        return size();
+    }
+
+    uint32_t offset_vector(const std::vector<uint32_t> &targets) {
+        start_vector(4, targets.size(), 4);
+        for (auto it = targets.rbegin(); it != targets.rend(); ++it) {
+            push_offset(*it);
+        }
+        return end_vector(targets.size());
+    }
+
+    void start_table() {
+        fields.clear();
+        table_start = size();
+    }
+
+    template <typename T> void add(int id, T value) {
+        push(value);
+        fields.emplace_back(id, size());
+    }
+
+    void add_offset(int id, uint32_t target) {
+        push_offset(target);
+        fields.emplace_back(id, size());
+    }
+
+    uint32_t end_table() {
+        // Offset to the vtable, written once the vtable is
+        push<int32_t>(0);
+        uint32_t table = size();
+
+        int slot_count = 0;
+        for (const auto &[id, _] : fields) {
+            slot_count = std::max(slot_count, id + 1);
+        }
+        std::vector<uint16_t> slots(slot_count, 0);
+        for (const auto &[id, position] : fields) {
+            slots[id] = static_cast<uint16_t>(table - position);
+        }
+
+        for (auto it = slots.rbegin(); it != slots.rend(); ++it) {
+            push<uint16_t>(*it);
+        }
+        push<uint16_t>(static_cast<uint16_t>(table - table_start));
+        push<uint16_t>(static_cast<uint16_t>(4 + 2 * slots.size()));
+
+        auto vtable = static_cast<int32_t>(size() - table);
+        memcpy(&bytes[size() - table], &vtable, sizeof(vtable));
+        return table;
+    }
+
+    std::vector<uint8_t> finish(uint32_t root) {
+        prep(max_alignment, 4);
+        push_offset(root);
+        return std::move(bytes);
+    }
+
+  private:
+    std::vector<uint8_t> bytes;
+    std::vector<std::pair<int, uint32_t>> fields;
+    uint32_t table_start = 0;
+    size_t max_alignment = 1;
+
+    /// Pads so that additional bytes written next end aligned
+    void prep(size_t alignment, size_t additional) {
+        max_alignment = std::max(max_alignment, alignment);
+        bytes.insert(bytes.begin(), padding(size() + additional, alignment),
+                     0);
+    }
+};
+
+uint32_t build_field(FlatBuilder &builder, const std::string &name,
+                     ArrowType type) {
+    auto name_offset = builder.string(name);
+    auto children = builder.offset_vector({});
+
+    uint8_t type_id = type_utf8;
+    builder.start_table();
+    switch (type) {
+    case ArrowType::Int64:
+        type_id = type_int;
+        builder.add<int32_t>(0, 64);
+        builder.add<uint8_t>(1, 1);
+        break;
+    case ArrowType::Float64:
+        type_id = type_floating_point;
+        builder.add<int16_t>(0, precision_double);
+        break;
+    case ArrowType::Binary:
+        type_id = type_binary;
+        break;
+    case ArrowType::Utf8:
+        break;
+    }
+    auto type_offset = builder.end_table();
+
+    builder.start_table();
+    builder.add_offset(0, name_offset);
+    builder.add_offset(3, type_offset);
+    builder.add_offset(5, children);
+    builder.add<uint8_t>(1, 1);
+    builder.add<uint8_t>(2, type_id);
+    return builder.end_table();
+}
+
+uint32_t build_schema(FlatBuilder &builder,
+                      const std::vector<std::string> &names,
+                      const std::vector<ArrowType> &types) {
+    std::vector<uint32_t> fields;
+    for (size_t i = 0; i < names.size(); i++) {
+        fields.push_back(build_field(builder, names[i], types[i]));
+    }
+    auto fields_offset = builder.offset_vector(fields);
+
+    builder.start_table();
+    builder.add_offset(1, fields_offset);
+    // Little endian
+    builder.add<int16_t>(0, 0);
+    return builder.end_table();
+}
+
+std::vector<uint8_t> build_message(FlatBuilder &builder, uint8_t header_type,
+                                   uint32_t header, int64_t body_length) {
+    builder.start_table();
+    builder.add<int64_t>(3, body_length);
+    builder.add_offset(2, header);
+    builder.add<int16_t>(0, metadata_version_v5);
+    builder.add<uint8_t>(1, header_type);
+    return builder.finish(builder.end_table());
+}
+
+} // namespace
+
+void ArrowColumn::append_null() {
+    if (length % 8 == 0) {
+        validity.push_back(0);
+    }
+    null_count++;
+    length++;
+
+    if (type == ArrowType::Int64 || type == ArrowType::Float64) {
+        data.insert(data.end(), 8, 0);
+    } else {
+        offsets.push_back(offsets.back());
+    }
+}
+
+void ArrowColumn::append_int64(int64_t value) {
+    if (length % 8 == 0) {
+        validity.push_back(0);
+    }
+    validity.back() |= static_cast<uint8_t>(1 << (length % 8));
+    length++;
+
+    auto raw = reinterpret_cast<const uint8_t *>(&value);
+    data.insert(data.end(), raw, raw + sizeof(value));
+}
+
+void ArrowColumn::append_double(double value) {
+    int64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    append_int64(bits);
+}
+
+void ArrowColumn::append_bytes(const void *bytes, size_t size) {
+    if (length % 8 == 0) {
+        validity.push_back(0);
+    }
+    validity.back() |= static_cast<uint8_t>(1 << (length % 8));
+    length++;
+
+    auto raw = static_cast<const uint8_t *>(bytes);
+    data.insert(data.end(), raw, raw + size);
+    offsets.push_back(static_cast<int32_t>(data.size()));
+}
+
+void ArrowColumn::clear() {
+    length = 0;
+    null_count = 0;
+    validity.clear();
+    data.clear();
+    offsets.assign(1, 0);
+}
+
+ArrowFileWriter::ArrowFileWriter(Sink sink, std::vector<std::string> names,
+                                 std::vector<ArrowType> types)
+    : sink(std::move(sink)), names(std::move(names)),
+      types(std::move(types)) {
+    write(magic, 6);
+    write("\0\0", 2);
+
+    FlatBuilder builder;
+    auto schema = build_schema(builder, this->names, this->types);
+    write_message(build_message(builder, header_schema, schema, 0), {});
+}
+
+void ArrowFileWriter::write(const void *data, size_t size) {
+    sink(data, size);
+    offset += static_cast<int64_t>(size);
+}
+
+ArrowFileWriter::Block
+ArrowFileWriter::write_message(const std::vector<uint8_t> &metadata,
+                               const std::vector<uint8_t> &body) {
+    // The body has to start 8 byte aligned, after the continuation marker
+    // and the length
+    auto length = static_cast<int32_t>(metadata.size() +
+                                       padding(metadata.size(), 8));
+    Block block{offset, length + 8, static_cast<int64_t>(body.size())};
+    uint32_t continuation = 0xFFFFFFFF;
+    uint64_t zeros = 0;
+
+    write(&continuation, 4);
+    write(&length, 4);
+    write(metadata.data(), metadata.size());
+    write(&zeros, padding(metadata.size(), 8));
+    if (!body.empty()) {
+        write(body.data(), body.size());
+    }
+    return block;
+}
+
+void ArrowFileWriter::write_batch(std::vector<ArrowColumn> &columns) {
+    if (columns.size() != types.size()) {
+        throw std::runtime_error("[op-sqlite] Arrow batch does not match "
+                                 "the schema");
+    }
+
+    struct Buffer {
+        int64_t offset;
+        int64_t length;
+    };
+    std::vector<uint8_t> body;
+    std::vector<Buffer> buffers;
+    auto add_buffer = [&](const void *data, size_t size) {
+        buffers.push_back({static_cast<int64_t>(body.size()),
+                           static_cast<int64_t>(size)});
+        auto raw = static_cast<const uint8_t *>(data);
+        body.insert(body.end(), raw, raw + size);
+        body.insert(body.end(), padding(size, 8), 0);
+    };
+
+    for (const auto &column : columns) {
+        // The validity bitmap can be left out when there are no nulls
+        add_buffer(column.validity.data(),
+                   column.null_count > 0 ? column.validity.size() : 0);
+        if (column.type == ArrowType::Utf8 ||
+            column.type == ArrowType::Binary) {
+            add_buffer(column.offsets.data(),
+                       column.offsets.size() * sizeof(int32_t));
+        }
+        add_buffer(column.data.data(), column.data.size());
+    }
+
+    FlatBuilder builder;
+    builder.start_vector(16, buffers.size(), 8);
+    for (auto it = buffers.rbegin(); it != buffers.rend(); ++it) {
+        builder.push<int64_t>(it->length);
+        builder.push<int64_t>(it->offset);
+    }
+    auto buffers_offset = builder.end_vector(buffers.size());
+
+    builder.start_vector(16, columns.size(), 8);
+    for (auto it = columns.rbegin(); it != columns.rend(); ++it) {
+        builder.push<int64_t>(static_cast<int64_t>(it->null_count));
+        builder.push<int64_t>(static_cast<int64_t>(it->length));
+    }
+    auto nodes_offset = builder.end_vector(columns.size());
+
+    builder.start_table();
+    builder.add<int64_t>(
+        0, static_cast<int64_t>(columns.empty() ? 0 : columns[0].length));
+    builder.add_offset(1, nodes_offset);
+    builder.add_offset(2, buffers_offset);
+    auto batch = builder.end_table();
+
+    blocks.push_back(write_message(
+        build_message(builder, header_record_batch, batch,
+                      static_cast<int64_t>(body.size())),
+        body));
+
+    for (auto &column : columns) {
+        column.clear();
+    }
+}
+
+void ArrowFileWriter::finish() {
+    // End of stream marker, then the footer pointing at every batch
+    uint32_t end_of_stream[] = {0xFFFFFFFF, 0};
+    write(end_of_stream, sizeof(end_of_stream));
+
+    FlatBuilder builder;
+    auto schema = build_schema(builder, names, types);
+
+    builder.start_vector(24, blocks.size(), 8);
+    for (auto it = blocks.rbegin(); it != blocks.rend(); ++it) {
+        builder.push<int64_t>(it->body_length);
+        builder.push<int32_t>(0);
+        builder.push<int32_t>(it->metadata_length);
+        builder.push<int64_t>(it->offset);
+    }
+    auto blocks_offset = builder.end_vector(blocks.size());
+
+    builder.start_table();
+    builder.add_offset(1, schema);
+    builder.add_offset(3, blocks_offset);
+    builder.add<int16_t>(0, metadata_version_v5);
+    auto footer = builder.finish(builder.end_table());
+
+    auto footer_length = static_cast<int32_t>(footer.size());
+    write(footer.data(), footer.size());
+    write(&footer_length, 4);
+    write(magic, 6);
+}
+
+} // namespace opsqlite
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace opsqlite {
+
+enum class ArrowType { Int64, Float64, Utf8, Binary };
+
+/// Values of one column of the record batch being built
+struct ArrowColumn {
+    ArrowType type;
+    size_t length = 0;
+    size_t null_count = 0;
+    std::vector<uint8_t> validity;
+    /// int64 or double values, or the bytes of Utf8 and Binary values
+    std::vector<uint8_t> data;
+    /// Utf8 and Binary only
+    std::vector<int32_t> offsets{0};
+
+    explicit ArrowColumn(ArrowType type) : type(type) {}
+
+    void append_null();
+    void append_int64(int64_t value);
+    void append_double(double value);
+    void append_bytes(const void *bytes, size_t size);
+    void clear();
+};
+
+/// Writes the Arrow IPC file format, readable by pyarrow, DuckDB, Polars and
+/// the other Arrow implementations. Only the flat types above are supported,
+/// every field is nullable. Assumes a little endian host, which all the
+/// platforms op-sqlite runs on are
+class ArrowFileWriter {
+  public:
+    using Sink = std::function<void(const void *data, size_t size)>;
+
+    /// Writes the magic and the schema
+    ArrowFileWriter(Sink sink, std::vector<std::string> names,
+                    std::vector<ArrowType> types);
+
+    /// Writes the columns as a record batch and clears them
+    void write_batch(std::vector<ArrowColumn> &columns);
+
+    /// Writes the footer, nothing can be written after it
+    void finish();
+
+  private:
+    struct Block {
+        int64_t offset;
+        int32_t metadata_length;
+        int64_t body_length;
+    };
+
+    Sink sink;
+    std::vector<std::string> names;
+    std::vector<ArrowType> types;
+    std::vector<Block> blocks;
+    int64_t offset = 0;
+
+    void write(const void *data, size_t size);
+    Block write_message(const std::vector<uint8_t> &metadata,
+                        const std::vector<uint8_t> &body);
+};
+
+} // namespace opsqlite
@@ -0,0 +1,169 @@
+#ifndef OP_SQLITE_USE_LIBSQL
+
+#include "Backup.h"
+#include "QueryStats.h"
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+#include <thread>
+
+namespace opsqlite {
+
+namespace {
+
+/// How long restore_database waits before retrying a locked database, and
+/// for how long in total before giving up
+constexpr std::chrono::milliseconds busy_retry{10};
+constexpr std::chrono::milliseconds busy_timeout{5000};
+
+/// A journal left next to a file from an earlier database would be applied
+/// to the one moved there
+void remove_journals(const std::string &path) {
+    for (const char *suffix : {"-journal", "-wal", "-shm"}) {
+        std::remove((path + suffix).c_str());
+    }
+}
+
+} // namespace
+
+OnlineBackup::OnlineBackup(sqlite3 *db, const std::string &path,
+                           Direction direction, BackupOptions options)
+    : db(db), path(path), direction(direction), options(std::move(options)),
+      reported_at(now_ns()) {
+    const char *db_path = sqlite3_db_filename(db, "main");
+    std::error_code error;
+    if (db_path != nullptr && db_path[0] != '\0' &&
+        std::filesystem::equivalent(db_path, path, error)) {
+        throw std::runtime_error(
+            "[op-sqlite] Cannot copy a database onto itself: " + path);
+    }
+
+    int flags = SQLITE_OPEN_READONLY;
+    std::string file_path = path;
+    if (direction == Direction::ToFile) {
+        temp_path = path + ".tmp";
+        file_path = temp_path;
+        flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+        std::remove(temp_path.c_str());
+        remove_journals(temp_path);
+    }
+
+    if (sqlite3_open_v2(file_path.c_str(), &file_db, flags, nullptr) !=
+        SQLITE_OK) {
+        std::string message = sqlite3_errmsg(file_db);
+        release();
+        throw std::runtime_error("[op-sqlite] Could not open " + path + ": " +
+                                 message);
+    }
+
+    if (direction == Direction::ToFile) {
+        // The copy is thrown away unless it completes, so it needs no
+        // journal. With a small cache the pages are written out by the
+        // steps instead of all at once by the last one
+        sqlite3_exec(file_db, "PRAGMA journal_mode = OFF; PRAGMA cache_size "
+                              "= 64",
+                     nullptr, nullptr, nullptr);
+    }
+
+    sqlite3 *destination = direction == Direction::ToFile ? file_db : db;
+    sqlite3 *source = direction == Direction::ToFile ? db : file_db;
+    backup = sqlite3_backup_init(destination, "main", source, "main");
+    if (backup == nullptr) {
+        std::string message = sqlite3_errmsg(destination);
+        release();
+        throw std::runtime_error("[op-sqlite] Could not start the backup: " +
+                                 message);
+    }
+}
+
+OnlineBackup::~OnlineBackup() { release(); }
+
+void OnlineBackup::release() {
+    if (backup != nullptr) {
+        sqlite3_backup_finish(backup);
+        backup = nullptr;
+    }
+    if (file_db != nullptr) {
+        sqlite3_close(file_db);
+        file_db = nullptr;
+    }
+    if (!temp_path.empty()) {
+        std::remove(temp_path.c_str());
+        remove_journals(temp_path);
+    }
+}
+
+int OnlineBackup::step() {
+    int status = sqlite3_backup_step(backup, options.pages_per_step);
+    if (status != SQLITE_OK && status != SQLITE_DONE &&
+        status != SQLITE_BUSY && status != SQLITE_LOCKED) {
+        throw std::runtime_error("[op-sqlite] Backup error: " +
+                                 std::string(sqlite3_errstr(status)));
+    }
+
+    progress.remaining = sqlite3_backup_remaining(backup);
+    progress.page_count = sqlite3_backup_pagecount(backup);
+    if (options.on_progress && status != SQLITE_DONE &&
+        now_ns() - reported_at >= options.progress_interval_ns) {
+        options.on_progress(progress);
+        reported_at = now_ns();
+    }
+    return status;
+}
+
+BackupProgress OnlineBackup::finish() {
+    int status = sqlite3_backup_finish(backup);
+    backup = nullptr;
+    if (status != SQLITE_OK) {
+        release();
+        throw std::runtime_error("[op-sqlite] Backup error: " +
+                                 std::string(sqlite3_errstr(status)));
+    }
+
+    // Closing the copy first checkpoints and removes its journal
+    sqlite3_close(file_db);
+    file_db = nullptr;
+
+    if (direction == Direction::ToFile) {
+        remove_journals(path);
+        std::error_code error;
+        std::filesystem::rename(temp_path, path, error);
+        if (error) {
+            release();
+            throw std::runtime_error(
+                "[op-sqlite] Could not move the backup to " + path + ": " +
+                error.message());
+        }
+        temp_path.clear();
+    }
+
+    if (options.on_progress) {
+        options.on_progress(progress);
+    }
+    return progress;
+}
+
+BackupProgress restore_database(sqlite3 *db, const std::string &path,
+                                const BackupOptions &options) {
+    OnlineBackup restore(db, path, OnlineBackup::Direction::FromFile,
+                         options);
+
+    std::chrono::milliseconds waited{0};
+    int status;
+    while ((status = restore.step()) != SQLITE_DONE) {
+        if (status == SQLITE_OK) {
+            continue;
+        }
+        if (waited >= busy_timeout) {
+            throw std::runtime_error("[op-sqlite] Backup error: " +
+                                     std::string(sqlite3_errstr(status)));
+        }
+        std::this_thread::sleep_for(busy_retry);
+        waited += busy_retry;
+    }
+    return restore.finish();
+}
+
+} // namespace opsqlite
+
+#endif
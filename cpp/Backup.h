@@ -0,0 +1,75 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <sqlite3.h>
+#include <string>
+
+namespace opsqlite {
+
+struct BackupProgress {
+    int remaining;
+    int page_count;
+};
+
+struct BackupOptions {
+    /// Pages copied per step, -1 copies the whole database in one step
+    int pages_per_step = 100;
+    /// Pause between two steps, queries on the connection still run in
+    /// between when it is 0
+    std::chrono::milliseconds sleep{0};
+    /// Called on the copying thread every progress_interval_ns at most, and
+    /// once more when the copy finished
+    std::function<void(const BackupProgress &)> on_progress;
+    uint64_t progress_interval_ns = 100'000'000;
+};
+
+/// Copies the main database of a connection to a file, or a file into it,
+/// a few pages at a time with the sqlite3_backup API. Other queries on the
+/// source connection can run between the steps, writes they make are copied
+/// too. A backup is written next to path and renamed once complete, so
+/// destroying it early leaves no file behind
+class OnlineBackup {
+  public:
+    enum class Direction { ToFile, FromFile };
+
+    OnlineBackup(sqlite3 *db, const std::string &path, Direction direction,
+                 BackupOptions options);
+    OnlineBackup(const OnlineBackup &) = delete;
+    OnlineBackup &operator=(const OnlineBackup &) = delete;
+    ~OnlineBackup();
+
+    /// Copies the next pages. Returns SQLITE_DONE once every page is copied,
+    /// SQLITE_OK when there are more and SQLITE_BUSY or SQLITE_LOCKED when
+    /// another connection holds a lock and the step has to be retried.
+    /// Throws on any other error
+    int step();
+
+    /// Releases the databases, moves a backup into place and reports the
+    /// final progress
+    BackupProgress finish();
+
+    const BackupOptions &get_options() const { return options; }
+
+  private:
+    sqlite3 *db;
+    sqlite3 *file_db = nullptr;
+    sqlite3_backup *backup = nullptr;
+    std::string path;
+    std::string temp_path;
+    Direction direction;
+    BackupOptions options;
+    BackupProgress progress{0, 0};
+    uint64_t reported_at;
+
+    void release();
+};
+
+/// Replaces the main database of db with the database at path. The
+/// connection cannot be used while the pages are copied, so it runs every
+/// step in a row and only sleeps when another connection holds a lock
+BackupProgress restore_database(sqlite3 *db, const std::string &path,
+                                const BackupOptions &options);
+
+} // namespace opsqlite
@@ -0,0 +1,233 @@
+#ifndef OP_SQLITE_USE_LIBSQL
+
+#include "BlobHostObject.h"
+#include "macros.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace opsqlite {
+
+namespace jsi = facebook::jsi;
+
+namespace {
+
+/// Bytes read on the worker, handed to JS as the ArrayBuffer's memory
+/// instead of being copied into a new one
+class ReadBuffer : public jsi::MutableBuffer {
+  public:
+    explicit ReadBuffer(size_t size)
+        : bytes(new uint8_t[size > 0 ? size : 1]), length(size) {}
+
+    size_t size() const override { return length; }
+    uint8_t *data() override { return bytes.get(); }
+
+  private:
+    std::unique_ptr<uint8_t[]> bytes;
+    size_t length;
+};
+
+sqlite3_blob *open_handle(sqlite3_blob *blob) {
+    if (blob == nullptr) {
+        throw std::runtime_error("[op-sqlite] Blob is closed");
+    }
+    return blob;
+}
+
+void check(int status) {
+    if (status != SQLITE_OK) {
+        throw std::runtime_error("[op-sqlite] Blob error: " +
+                                 std::string(sqlite3_errstr(status)));
+    }
+}
+
+/// Offsets are checked here, sqlite only reports a generic error
+void check_range(double offset, double length, int size) {
+    if (offset < 0 || length < 0 || offset + length > size) {
+        throw std::runtime_error("[op-sqlite] Blob range " +
+                                 std::to_string(static_cast<int64_t>(offset)) +
+                                 "+" +
+                                 std::to_string(static_cast<int64_t>(length)) +
+                                 " is outside of its " + std::to_string(size) +
+                                 " bytes");
+    }
+}
+
+/// Copy of an ArrayBuffer or of the bytes a typed array views, JS memory
+/// cannot be read from the worker
+std::shared_ptr<std::vector<uint8_t>> copy_bytes(jsi::Runtime &rt,
+                                                 const jsi::Value &value) {
+    if (!value.isObject()) {
+        throw std::runtime_error(
+            "[op-sqlite] Blob data must be an ArrayBuffer or a typed array");
+    }
+
+    auto object = value.asObject(rt);
+    size_t offset = 0;
+    size_t length = 0;
+    bool view = !object.isArrayBuffer(rt);
+    if (view) {
+        auto buffer = object.getProperty(rt, "buffer");
+        if (!buffer.isObject() || !buffer.asObject(rt).isArrayBuffer(rt)) {
+            throw std::runtime_error("[op-sqlite] Blob data must be an "
+                                     "ArrayBuffer or a typed array");
+        }
+        offset = static_cast<size_t>(
+            object.getProperty(rt, "byteOffset").asNumber());
+        length = static_cast<size_t>(
+            object.getProperty(rt, "byteLength").asNumber());
+        object = buffer.asObject(rt);
+    }
+
+    auto array_buffer = object.getArrayBuffer(rt);
+    if (!view) {
+        length = array_buffer.size(rt);
+    }
+    auto data = array_buffer.data(rt) + offset;
+    return std::make_shared<std::vector<uint8_t>>(data, data + length);
+}
+
+} // namespace
+
+BlobHostObject::Handle::~Handle() {
+    if (blob != nullptr) {
+        sqlite3_blob_close(blob);
+    }
+}
+
+BlobHostObject::BlobHostObject(
+    sqlite3_blob *blob, std::shared_ptr<react::CallInvoker> js_call_invoker,
+    std::shared_ptr<ThreadPool> thread_pool)
+    : _handle(std::make_shared<Handle>(blob)),
+      _js_call_invoker(std::move(js_call_invoker)),
+      _thread_pool(std::move(thread_pool)) {}
+
+std::vector<jsi::PropNameID>
+BlobHostObject::getPropertyNames(jsi::Runtime &rt) {
+    std::vector<jsi::PropNameID> keys;
+    for (const char *key : {"size", "read", "write", "reopen", "close"}) {
+        keys.push_back(jsi::PropNameID::forAscii(rt, key));
+    }
+    return keys;
+}
+
+jsi::Value BlobHostObject::queue(jsi::Runtime &rt,
+                                 std::function<Resolver(Handle &)> task) {
+    auto promiseCtr = rt.global().getPropertyAsFunction(rt, "Promise");
+    return promiseCtr.callAsConstructor(rt, HOSTFN("executor") {
+        auto resolve = std::make_shared<jsi::Value>(rt, args[0]);
+        auto reject = std::make_shared<jsi::Value>(rt, args[1]);
+
+        auto work = [&rt, handle = _handle, invoker = _js_call_invoker, task,
+                     resolve, reject]() {
+            try {
+                auto resolver = task(*handle);
+                invoker->invokeAsync([&rt, resolver, resolve] {
+                    resolve->asObject(rt).asFunction(rt).call(rt,
+                                                              resolver(rt));
+                });
+            } catch (std::exception &exc) {
+                invoker->invokeAsync(
+                    [&rt, what = std::string(exc.what()), reject] {
+                        auto errorCtr =
+                            rt.global().getPropertyAsFunction(rt, "Error");
+                        auto error = errorCtr.callAsConstructor(
+                            rt, jsi::String::createFromUtf8(rt, what));
+                        reject->asObject(rt).asFunction(rt).call(rt, error);
+                    });
+            }
+        };
+        _thread_pool->queueWork(work);
+        return {};
+    }));
+}
+
+jsi::Value BlobHostObject::get(jsi::Runtime &rt,
+                               const jsi::PropNameID &propNameID) {
+    auto name = propNameID.utf8(rt);
+
+    if (name == "size") {
+        return jsi::Value(_handle->size.load());
+    }
+
+    if (name == "read") {
+        return HOSTFN("read") {
+            double offset = count > 0 && args[0].isNumber() ? args[0].asNumber()
+                                                            : 0;
+            double length = count > 1 && args[1].isNumber()
+                                ? args[1].asNumber()
+                                : _handle->size - offset;
+
+            return queue(rt, [offset, length](Handle &handle) -> Resolver {
+                auto blob = open_handle(handle.blob);
+                check_range(offset, length, handle.size);
+
+                auto buffer = std::make_shared<ReadBuffer>(
+                    static_cast<size_t>(length));
+                check(sqlite3_blob_read(blob, buffer->data(),
+                                        static_cast<int>(length),
+                                        static_cast<int>(offset)));
+                return [buffer](jsi::Runtime &rt) -> jsi::Value {
+                    return jsi::ArrayBuffer(rt, buffer);
+                };
+            });
+        });
+    }
+
+    if (name == "write") {
+        return HOSTFN("write") {
+            if (count < 2 || !args[0].isNumber()) {
+                throw std::runtime_error(
+                    "[op-sqlite][write] offset and data are required");
+            }
+            double offset = args[0].asNumber();
+            auto bytes = copy_bytes(rt, args[1]);
+
+            return queue(rt, [offset, bytes](Handle &handle) -> Resolver {
+                auto blob = open_handle(handle.blob);
+                check_range(offset, static_cast<double>(bytes->size()),
+                            handle.size);
+
+                check(sqlite3_blob_write(blob, bytes->data(),
+                                         static_cast<int>(bytes->size()),
+                                         static_cast<int>(offset)));
+                return [](jsi::Runtime &) { return jsi::Value::undefined(); };
+            });
+        });
+    }
+
+    if (name == "reopen") {
+        return HOSTFN("reopen") {
+            if (count < 1 || !args[0].isNumber()) {
+                throw std::runtime_error("[op-sqlite][reopen] rowid needed");
+            }
+            auto rowid = static_cast<sqlite3_int64>(args[0].asNumber());
+
+            return queue(rt, [rowid](Handle &handle) -> Resolver {
+                check(sqlite3_blob_reopen(open_handle(handle.blob), rowid));
+                handle.size = sqlite3_blob_bytes(handle.blob);
+                return [](jsi::Runtime &) { return jsi::Value::undefined(); };
+            });
+        });
+    }
+
+    if (name == "close") {
+        return HOSTFN("close") {
+            // Queued behind the pending reads and writes
+            return queue(rt, [](Handle &handle) -> Resolver {
+                auto blob = handle.blob;
+                handle.blob = nullptr;
+                // Commits the writes when no transaction is open
+                if (blob != nullptr) {
+                    check(sqlite3_blob_close(blob));
+                }
+                return [](jsi::Runtime &) { return jsi::Value::undefined(); };
+            });
+        });
+    }
+
+    return {};
+}
+
+} // namespace opsqlite
+
+#endif
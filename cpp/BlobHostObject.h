@@ -0,0 +1,54 @@
+#pragma once
+
+#include "OPThreadPool.h"
+#include <ReactCommon/CallInvoker.h>
+#include <atomic>
+#include <jsi/jsi.h>
+#include <memory>
+#include <sqlite3.h>
+
+namespace opsqlite {
+namespace jsi = facebook::jsi;
+namespace react = facebook::react;
+
+/// Incremental access to a single blob, reads and writes run on the worker
+/// with sqlite3_blob_read and sqlite3_blob_write so a large value is never
+/// loaded whole. Writes cannot change the size of the blob, it is set when
+/// the row is written, e.g. with zeroblob(n)
+class BlobHostObject : public jsi::HostObject {
+  public:
+    BlobHostObject(sqlite3_blob *blob,
+                   std::shared_ptr<react::CallInvoker> js_call_invoker,
+                   std::shared_ptr<ThreadPool> thread_pool);
+
+    std::vector<jsi::PropNameID> getPropertyNames(jsi::Runtime &rt) override;
+
+    jsi::Value get(jsi::Runtime &rt,
+                   const jsi::PropNameID &propNameID) override;
+
+  private:
+    /// Shared with the queued tasks, the blob is closed once the last of
+    /// them and the host object are gone
+    struct Handle {
+        explicit Handle(sqlite3_blob *blob)
+            : blob(blob), size(sqlite3_blob_bytes(blob)) {}
+        ~Handle();
+
+        sqlite3_blob *blob;
+        /// Changes with reopen, read on the JS thread
+        std::atomic<int> size;
+    };
+
+    std::shared_ptr<Handle> _handle;
+    std::shared_ptr<react::CallInvoker> _js_call_invoker;
+    std::shared_ptr<ThreadPool> _thread_pool;
+
+    /// Builds the value the promise resolves with, on the JS thread
+    using Resolver = std::function<jsi::Value(jsi::Runtime &)>;
+
+    /// Runs task on the worker and resolves with its resolver, or rejects
+    /// with what it threw
+    jsi::Value queue(jsi::Runtime &rt, std::function<Resolver(Handle &)> task);
+};
+
+} // namespace opsqlite
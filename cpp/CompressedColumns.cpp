@@ -0,0 +1,307 @@
+#ifdef OP_SQLITE_USE_ZSTD
+
+#include "CompressedColumns.h"
+#include "utils.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace opsqlite {
+
+namespace {
+
+struct Column {
+    std::string name;
+    /// SQL of the DEFAULT clause, empty without one
+    std::string default_sql;
+    bool primary_key;
+    bool generated;
+};
+
+void exec(sqlite3 *db, const std::string &sql) {
+    char *error = nullptr;
+    if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &error) != SQLITE_OK) {
+        std::string message = error != nullptr ? error : sqlite3_errmsg(db);
+        sqlite3_free(error);
+        throw std::runtime_error("[op-sqlite] " + message);
+    }
+}
+
+/// Runs sql with text params and returns the first column of every row
+std::vector<std::string> query(sqlite3 *db, const std::string &sql,
+                               const std::vector<std::string> &params) {
+    sqlite3_stmt *statement = nullptr;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &statement, nullptr) !=
+        SQLITE_OK) {
+        throw std::runtime_error("[op-sqlite] " +
+                                 std::string(sqlite3_errmsg(db)));
+    }
+    for (size_t i = 0; i < params.size(); i++) {
+        sqlite3_bind_text(statement, static_cast<int>(i + 1),
+                          params[i].c_str(), -1, SQLITE_TRANSIENT);
+    }
+
+    std::vector<std::string> rows;
+    int status;
+    while ((status = sqlite3_step(statement)) == SQLITE_ROW) {
+        auto text = sqlite3_column_text(statement, 0);
+        rows.emplace_back(text != nullptr ? reinterpret_cast<const char *>(text)
+                                          : "");
+    }
+    sqlite3_finalize(statement);
+    if (status != SQLITE_DONE) {
+        throw std::runtime_error("[op-sqlite] " +
+                                 std::string(sqlite3_errmsg(db)));
+    }
+    return rows;
+}
+
+std::vector<Column> columns_of(sqlite3 *db, const std::string &table) {
+    sqlite3_stmt *statement = nullptr;
+    auto sql = "PRAGMA table_xinfo(" + quote_identifier(table) + ")";
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &statement, nullptr) !=
+        SQLITE_OK) {
+        throw std::runtime_error("[op-sqlite] " +
+                                 std::string(sqlite3_errmsg(db)));
+    }
+
+    std::vector<Column> columns;
+    while (sqlite3_step(statement) == SQLITE_ROW) {
+        auto default_sql = sqlite3_column_text(statement, 4);
+        columns.push_back(
+            {reinterpret_cast<const char *>(sqlite3_column_text(statement, 1)),
+             default_sql != nullptr
+                 ? reinterpret_cast<const char *>(default_sql)
+                 : "",
+             sqlite3_column_int(statement, 5) > 0,
+             // 2 and 3 are virtual and stored generated columns
+             sqlite3_column_int(statement, 6) >= 2});
+    }
+    sqlite3_finalize(statement);
+    return columns;
+}
+
+/// With legacy_alter_table the views and triggers that use the old name are
+/// not rewritten, they keep reading through the view that takes it over
+void rename_table(sqlite3 *db, const std::string &from,
+                  const std::string &to) {
+    auto legacy = query(db, "PRAGMA legacy_alter_table", {});
+    exec(db, "PRAGMA legacy_alter_table = ON");
+    try {
+        exec(db, "ALTER TABLE " + quote_identifier(from) + " RENAME TO " +
+                     quote_identifier(to));
+    } catch (...) {
+        exec(db, "PRAGMA legacy_alter_table = " + legacy.at(0));
+        throw;
+    }
+    exec(db, "PRAGMA legacy_alter_table = " + legacy.at(0));
+}
+
+bool contains(const std::vector<std::string> &names, const std::string &name) {
+    return std::find(names.begin(), names.end(), name) != names.end();
+}
+
+/// SQL compressing value the way the options ask
+std::string encode(const std::string &value,
+                   const CompressedColumnOptions &options) {
+    return "zstd_column_encode(" + value + ", " +
+           std::to_string(options.threshold) + ", " +
+           std::to_string(options.dictionary_id) + ", " +
+           std::to_string(options.level) + ")";
+}
+
+std::string join(const std::vector<std::string> &parts,
+                 const std::string &separator) {
+    std::string joined;
+    for (size_t i = 0; i < parts.size(); i++) {
+        joined += (i > 0 ? separator : "") + parts[i];
+    }
+    return joined;
+}
+
+void create_view(sqlite3 *db, const std::string &table,
+                 const std::string &storage,
+                 const std::vector<Column> &columns,
+                 const std::vector<std::string> &compressed,
+                 const CompressedColumnOptions &options) {
+    std::vector<std::string> selected;
+    std::vector<std::string> names;
+    std::vector<std::string> values;
+    std::vector<std::string> assignments;
+    std::vector<std::string> keys;
+    for (const auto &column : columns) {
+        auto name = quote_identifier(column.name);
+        bool is_compressed = contains(compressed, column.name);
+        selected.push_back(is_compressed
+                               ? "zstd_column_decode(" + name + ") AS " + name
+                               : name);
+        if (column.primary_key) {
+            keys.push_back(name + " IS OLD." + name);
+        }
+        if (column.generated) {
+            continue;
+        }
+
+        // A view has no defaults, columns left out of an INSERT are NULL
+        auto value = column.default_sql.empty()
+                         ? "NEW." + name
+                         : "coalesce(NEW." + name + ", " +
+                               column.default_sql + ")";
+        names.push_back(name);
+        values.push_back(is_compressed ? encode(value, options) : value);
+        // Unchanged values are not compressed again
+        assignments.push_back(
+            name + " = " +
+            (is_compressed ? "CASE WHEN NEW." + name + " IS OLD." + name +
+                                 " THEN " + name + " ELSE " +
+                                 encode("NEW." + name, options) + " END"
+                           : "NEW." + name));
+    }
+
+    auto view = quote_identifier(table);
+    auto target = quote_identifier(storage);
+    auto where = " WHERE " + join(keys, " AND ") + "; END";
+    exec(db, "CREATE VIEW " + view + " AS SELECT " + join(selected, ", ") +
+                 " FROM " + target);
+    exec(db, "CREATE TRIGGER " + quote_identifier(storage + "_insert") +
+                 " INSTEAD OF INSERT ON " + view + " BEGIN INSERT INTO " +
+                 target + " (" + join(names, ", ") + ") VALUES (" +
+                 join(values, ", ") + "); END");
+    exec(db, "CREATE TRIGGER " + quote_identifier(storage + "_update") +
+                 " INSTEAD OF UPDATE ON " + view + " BEGIN UPDATE " + target +
+                 " SET " + join(assignments, ", ") + where);
+    exec(db, "CREATE TRIGGER " + quote_identifier(storage + "_delete") +
+                 " INSTEAD OF DELETE ON " + view + " BEGIN DELETE FROM " +
+                 target + where);
+}
+
+void apply(sqlite3 *db, const std::string &table,
+           const std::vector<std::string> &columns,
+           const CompressedColumnOptions &options) {
+    auto storage = table + "_zstd";
+    exec(db, "CREATE TABLE IF NOT EXISTS zstd_columns (table_name TEXT NOT "
+             "NULL, column_name TEXT NOT NULL, PRIMARY KEY (table_name, "
+             "column_name)) WITHOUT ROWID");
+    auto previous = query(
+        db, "SELECT column_name FROM zstd_columns WHERE table_name = ?",
+        {table});
+
+    if (previous.empty()) {
+        if (query(db,
+                  "SELECT name FROM sqlite_master WHERE type = 'table' AND "
+                  "name = ?",
+                  {table})
+                .empty()) {
+            throw std::runtime_error("[op-sqlite] compressColumns: no table "
+                                     "named " +
+                                     table);
+        }
+        // legacy_alter_table leaves REFERENCES alone, they would name the view
+        // and writes with foreign_keys on fail with a foreign key mismatch
+        auto children = query(
+            db,
+            "SELECT DISTINCT m.name FROM sqlite_master AS m, "
+            "pragma_foreign_key_list(m.name) AS f WHERE m.type = 'table' AND "
+            "f.\"table\" = ? COLLATE NOCASE",
+            {table});
+        if (!children.empty()) {
+            throw std::runtime_error("[op-sqlite] compressColumns: " + table +
+                                     " is referenced by a foreign key of " +
+                                     join(children, ", ") +
+                                     ", only tables without children can be "
+                                     "compressed");
+        }
+        if (columns.empty()) {
+            return;
+        }
+        rename_table(db, table, storage);
+    } else {
+        exec(db, "DROP VIEW " + quote_identifier(table));
+    }
+
+    auto all_columns = columns_of(db, storage);
+    if (std::none_of(all_columns.begin(), all_columns.end(),
+                     [](const Column &column) { return column.primary_key; })) {
+        throw std::runtime_error("[op-sqlite] compressColumns: " + table +
+                                 " needs a primary key, the triggers find "
+                                 "rows with it");
+    }
+    for (const auto &name : columns) {
+        auto column = std::find_if(
+            all_columns.begin(), all_columns.end(),
+            [&](const Column &column) { return column.name == name; });
+        if (column == all_columns.end() || column->generated ||
+            column->primary_key) {
+            throw std::runtime_error(
+                "[op-sqlite] compressColumns: " + name +
+                " is not a column of " + table +
+                " that can be compressed, keys and generated columns cannot");
+        }
+    }
+
+    // Rows written before are decoded first, then encoded with the options
+    std::vector<std::string> assignments;
+    for (const auto &column : all_columns) {
+        bool was_compressed = contains(previous, column.name);
+        bool is_compressed = contains(columns, column.name);
+        if (!was_compressed && !is_compressed) {
+            continue;
+        }
+
+        auto name = quote_identifier(column.name);
+        auto value =
+            was_compressed ? "zstd_column_decode(" + name + ")" : name;
+        if (is_compressed) {
+            value = encode(value, options);
+        }
+        assignments.push_back(name + " = " + value);
+    }
+    exec(db, "UPDATE " + quote_identifier(storage) + " SET " +
+                 join(assignments, ", "));
+
+    query(db, "DELETE FROM zstd_columns WHERE table_name = ?", {table});
+    if (columns.empty()) {
+        rename_table(db, storage, table);
+        return;
+    }
+
+    create_view(db, table, storage, all_columns, columns, options);
+    for (const auto &name : columns) {
+        query(db,
+              "INSERT INTO zstd_columns (table_name, column_name) VALUES "
+              "(?, ?)",
+              {table, name});
+    }
+}
+
+} // namespace
+
+void compress_columns(sqlite3 *db, const std::string &table,
+                      const std::vector<std::string> &columns,
+                      const CompressedColumnOptions &options) {
+    exec(db, "SAVEPOINT compress_columns");
+    try {
+        apply(db, table, columns, options);
+    } catch (...) {
+        sqlite3_exec(db,
+                     "ROLLBACK TO compress_columns; "
+                     "RELEASE compress_columns",
+                     nullptr, nullptr, nullptr);
+        throw;
+    }
+    exec(db, "RELEASE compress_columns");
+}
+
+std::vector<std::string> compressed_tables(sqlite3 *db) {
+    if (query(db,
+              "SELECT name FROM sqlite_master WHERE type = 'table' AND name = "
+              "'zstd_columns'",
+              {})
+            .empty()) {
+        return {};
+    }
+    return query(db, "SELECT DISTINCT table_name FROM zstd_columns", {});
+}
+
+} // namespace opsqlite
+
+#endif
@@ -0,0 +1,35 @@
+#pragma once
+
+#ifdef OP_SQLITE_USE_ZSTD
+
+#include <cstdint>
+#include <sqlite3.h>
+#include <string>
+#include <vector>
+
+namespace opsqlite {
+
+struct CompressedColumnOptions {
+    /// Values shorter than this many bytes are stored as they are
+    int64_t threshold = 64;
+    /// Registered zstd dictionary, 0 compresses without one
+    unsigned dictionary_id = 0;
+    int level = 1;
+};
+
+/// Stores the columns of a table compressed with zstd. The table is renamed
+/// to <table>_zstd and a view with its name decompresses the columns, so
+/// only the columns a query reads are decompressed. INSTEAD OF triggers on
+/// the view compress what is written. Calling it again changes the columns
+/// and re-encodes the rows, no columns turns the view back into the table
+void compress_columns(sqlite3 *db, const std::string &table,
+                      const std::vector<std::string> &columns,
+                      const CompressedColumnOptions &options);
+
+/// Tables that have compressed columns. Writes through their views reach
+/// <table>_zstd, which is the name the update hook reports
+std::vector<std::string> compressed_tables(sqlite3 *db);
+
+} // namespace opsqlite
+
+#endif
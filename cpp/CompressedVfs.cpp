@@ -0,0 +1,1010 @@
+#ifdef OP_SQLITE_USE_ZSTD
+
+#include "CompressedVfs.h"
+#include "zstd.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace opsqlite {
+
+namespace {
+
+// A compressed file is a header followed by records, one per block of the
+// database file. A block is rewritten to free space instead of in place,
+// the space it used is reused after the next sync. So a crash leaves each
+// block with its new or its old record, the journal or the WAL of sqlite
+// fixes the blocks that were being written. There is no on-disk map, the
+// record with the highest generation of a block is the current one
+
+constexpr const char *vfs_name = "op-sqlite-zstd";
+
+/// Records start on a unit boundary. The first two units hold two copies of
+/// the file header, written in turns so a torn write leaves the other one
+constexpr uint64_t unit_size = 256;
+constexpr uint64_t header_units = 2;
+constexpr uint64_t file_magic = 0x4454535a51534f50; // "OPSQZSTD"
+constexpr uint32_t record_magic = 0x525a504f;       // "OPZR"
+constexpr uint32_t format_version = 1;
+constexpr uint32_t compressed_flag = 1;
+constexpr int compression_level = 1;
+/// Decompressed blocks kept in memory, sqlite reads the first page at the
+/// start of every transaction
+constexpr size_t cache_blocks = 64;
+/// Freed space waiting for a sync past which the file is synced anyway, in
+/// case sqlite never syncs, e.g. with synchronous = OFF
+constexpr uint64_t max_pending_units = 1024;
+/// Records are moved to the free space before them once a quarter of the
+/// file and at least this many units are free
+constexpr uint64_t min_compact_units = 256;
+/// Records moved at most per sync, to bound the time a commit takes
+constexpr size_t max_moved_records = 1024;
+constexpr size_t scan_chunk = 1 << 20;
+
+struct FileHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t block_size;
+    /// Size of the database file sqlite sees
+    uint64_t size;
+    uint64_t generation;
+    /// Random per file, record checksums depend on it so data stored in
+    /// uncompressed records cannot pass for a record header
+    uint64_t salt;
+    uint32_t checksum;
+    uint32_t padding;
+};
+
+struct RecordHeader {
+    uint32_t magic;
+    uint32_t block;
+    uint32_t length;
+    uint32_t flags;
+    uint64_t generation;
+    uint32_t checksum;
+    uint32_t padding;
+};
+
+static_assert(sizeof(FileHeader) <= unit_size, "header must fit a unit");
+static_assert(sizeof(RecordHeader) == 32, "records headers are packed");
+
+struct Record {
+    uint64_t unit;
+    uint32_t length;
+    bool compressed;
+};
+
+/// State of one compressed file, shared by all its connections
+struct FileState {
+    std::mutex mutex;
+    std::string path;
+    int references = 0;
+
+    /// 0 until the first write to a new file
+    uint32_t block_size = 0;
+    uint64_t size = 0;
+    uint64_t salt = 0;
+    uint64_t generation = 1;
+    uint64_t header_slot = 0;
+    bool header_dirty = false;
+
+    /// Unit past the last allocated one
+    uint64_t end_unit = header_units;
+    std::unordered_map<uint32_t, Record> blocks;
+    /// Runs of free units by their first unit
+    std::map<uint64_t, uint64_t> free_units;
+    uint64_t free_count = 0;
+    /// Runs freed since the last sync, still the current copy on disk
+    std::vector<std::pair<uint64_t, uint64_t>> pending_units;
+    uint64_t pending_count = 0;
+
+    std::list<std::pair<uint32_t, std::vector<char>>> cache;
+    std::unordered_map<uint32_t, decltype(cache)::iterator> cached;
+    std::vector<char> zeros;
+    std::vector<char> scratch;
+    std::vector<char> buffer;
+    ZSTD_CCtx *cctx = ZSTD_createCCtx();
+    ZSTD_DCtx *dctx = ZSTD_createDCtx();
+
+    ~FileState() {
+        ZSTD_freeCCtx(cctx);
+        ZSTD_freeDCtx(dctx);
+    }
+};
+
+struct CompressedFile {
+    sqlite3_file base;
+    /// The file of the default VFS, right after this struct
+    sqlite3_file *inner;
+    /// Null for files that are not compressed
+    FileState *state;
+};
+
+std::mutex registry_mutex;
+std::map<std::string, FileState *> registry;
+
+sqlite3_vfs *root_vfs(sqlite3_vfs *vfs) {
+    return static_cast<sqlite3_vfs *>(vfs->pAppData);
+}
+
+CompressedFile *compressed(sqlite3_file *file) {
+    return reinterpret_cast<CompressedFile *>(file);
+}
+
+/// FNV-1a, only has to tell headers from other bytes
+uint32_t checksum(uint64_t salt, const void *data, size_t size) {
+    uint32_t hash = 2166136261u;
+    auto mix = [&hash](const void *bytes, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            hash = (hash ^ static_cast<const unsigned char *>(bytes)[i]) *
+                   16777619u;
+        }
+    };
+    mix(&salt, sizeof(salt));
+    mix(data, size);
+    return hash;
+}
+
+uint64_t units_for(uint32_t length) {
+    return (sizeof(RecordHeader) + length + unit_size - 1) / unit_size;
+}
+
+int read_inner(sqlite3_file *inner, void *data, size_t size,
+               uint64_t offset) {
+    return inner->pMethods->xRead(inner, data, static_cast<int>(size),
+                                  static_cast<sqlite3_int64>(offset));
+}
+
+int write_inner(sqlite3_file *inner, const void *data, size_t size,
+                uint64_t offset) {
+    return inner->pMethods->xWrite(inner, data, static_cast<int>(size),
+                                   static_cast<sqlite3_int64>(offset));
+}
+
+/// Adds a run to the free runs, merged with its neighbours
+void release(FileState &state, uint64_t unit, uint64_t count) {
+    state.free_count += count;
+    auto next = state.free_units.lower_bound(unit);
+    if (next != state.free_units.begin()) {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == unit) {
+            unit = previous->first;
+            count += previous->second;
+            state.free_units.erase(previous);
+        }
+    }
+    if (next != state.free_units.end() && unit + count == next->first) {
+        count += next->second;
+        state.free_units.erase(next);
+    }
+    state.free_units[unit] = count;
+}
+
+/// First fit in the runs that start before limit, 0 when none does
+uint64_t allocate_before(FileState &state, uint64_t count, uint64_t limit) {
+    for (auto run = state.free_units.begin();
+         run != state.free_units.end() && run->first < limit; ++run) {
+        if (run->second >= count) {
+            auto unit = run->first;
+            auto remaining = run->second - count;
+            state.free_units.erase(run);
+            if (remaining > 0) {
+                state.free_units[unit + count] = remaining;
+            }
+            state.free_count -= count;
+            return unit;
+        }
+    }
+    return 0;
+}
+
+uint64_t allocate(FileState &state, uint64_t count) {
+    auto unit = allocate_before(state, count, state.end_unit);
+    if (unit != 0) {
+        return unit;
+    }
+
+    unit = state.end_unit;
+    state.end_unit += count;
+    return unit;
+}
+
+void forget(FileState &state, uint32_t block) {
+    auto entry = state.cached.find(block);
+    if (entry != state.cached.end()) {
+        state.cache.erase(entry->second);
+        state.cached.erase(entry);
+    }
+}
+
+void remember(FileState &state, uint32_t block, const char *data) {
+    forget(state, block);
+    state.cache.emplace_front(block,
+                              std::vector<char>(data, data + state.block_size));
+    state.cached[block] = state.cache.begin();
+    if (state.cache.size() > cache_blocks) {
+        state.cached.erase(state.cache.back().first);
+        state.cache.pop_back();
+    }
+}
+
+int write_header(FileState &state, sqlite3_file *inner) {
+    FileHeader header = {file_magic, format_version, state.block_size,
+                         state.size, state.generation++, state.salt, 0, 0};
+    header.checksum = checksum(0, &header, offsetof(FileHeader, checksum));
+
+    int status = write_inner(inner, &header, sizeof(header),
+                             state.header_slot * unit_size);
+    if (status == SQLITE_OK) {
+        state.header_slot = (state.header_slot + 1) % header_units;
+        state.header_dirty = false;
+    }
+    return status;
+}
+
+/// Makes the freed space reusable once the records that replaced it are on
+/// disk, and gives free space at the end back to the file system
+int sync_state(FileState &state, sqlite3_file *inner, int flags) {
+    int status = SQLITE_OK;
+    if (state.header_dirty) {
+        status = write_header(state, inner);
+    }
+    if (status == SQLITE_OK) {
+        status = inner->pMethods->xSync(inner, flags);
+    }
+    if (status != SQLITE_OK) {
+        return status;
+    }
+
+    for (auto &[unit, count] : state.pending_units) {
+        release(state, unit, count);
+    }
+    state.pending_units.clear();
+    state.pending_count = 0;
+
+    if (!state.free_units.empty()) {
+        auto last = std::prev(state.free_units.end());
+        if (last->first + last->second >= state.end_unit) {
+            state.end_unit = last->first;
+            state.free_count -= last->second;
+            state.free_units.erase(last);
+            inner->pMethods->xTruncate(
+                inner, static_cast<sqlite3_int64>(state.end_unit * unit_size));
+        }
+    }
+    return SQLITE_OK;
+}
+
+/// Rewritten blocks leave holes where sqlite does not write again. The
+/// records at the end are copied into them, as they are, and the end of the
+/// file is cut at the next sync
+int compact(FileState &state, sqlite3_file *inner, int flags) {
+    if (state.free_count < min_compact_units ||
+        state.free_count * 4 < state.end_unit - header_units) {
+        return SQLITE_OK;
+    }
+
+    std::vector<std::pair<uint64_t, uint32_t>> records;
+    for (auto &[block, record] : state.blocks) {
+        records.emplace_back(record.unit, block);
+    }
+    std::sort(records.rbegin(), records.rend());
+
+    size_t moved = 0;
+    for (auto &[unit, block] : records) {
+        if (moved == max_moved_records || state.free_units.empty() ||
+            state.free_units.begin()->first > unit) {
+            break;
+        }
+
+        auto &record = state.blocks[block];
+        auto units = units_for(record.length);
+        auto target = allocate_before(state, units, unit);
+        if (target == 0) {
+            continue;
+        }
+
+        auto size = sizeof(RecordHeader) + record.length;
+        state.buffer.resize(size);
+        int status = read_inner(inner, state.buffer.data(), size,
+                                unit * unit_size);
+        if (status == SQLITE_OK) {
+            status = write_inner(inner, state.buffer.data(), size,
+                                 target * unit_size);
+        }
+        if (status != SQLITE_OK) {
+            release(state, target, units);
+            return status;
+        }
+
+        state.pending_units.emplace_back(unit, units);
+        state.pending_count += units;
+        record.unit = target;
+        moved++;
+    }
+
+    return moved > 0 ? sync_state(state, inner, flags) : SQLITE_OK;
+}
+
+int sync_file(FileState &state, sqlite3_file *inner, int flags) {
+    int status = sync_state(state, inner, flags);
+    if (status == SQLITE_OK) {
+        status = compact(state, inner, flags);
+    }
+    return status;
+}
+
+/// Points data at the content of a block, valid until the cache changes
+int load_block(FileState &state, sqlite3_file *inner, uint32_t block,
+               const char **data) {
+    auto entry = state.cached.find(block);
+    if (entry != state.cached.end()) {
+        state.cache.splice(state.cache.begin(), state.cache, entry->second);
+        *data = entry->second->second.data();
+        return SQLITE_OK;
+    }
+
+    auto record = state.blocks.find(block);
+    if (record == state.blocks.end()) {
+        *data = state.zeros.data();
+        return SQLITE_OK;
+    }
+
+    auto length = record->second.length;
+    state.buffer.resize(sizeof(RecordHeader) + length);
+    int status = read_inner(inner, state.buffer.data(), state.buffer.size(),
+                            record->second.unit * unit_size);
+    if (status != SQLITE_OK) {
+        return status == SQLITE_IOERR_SHORT_READ ? SQLITE_CORRUPT : status;
+    }
+
+    RecordHeader header;
+    memcpy(&header, state.buffer.data(), sizeof(header));
+    if (header.magic != record_magic || header.block != block ||
+        header.length != length) {
+        return SQLITE_CORRUPT;
+    }
+
+    std::vector<char> content(state.block_size);
+    const char *payload = state.buffer.data() + sizeof(RecordHeader);
+    if (record->second.compressed) {
+        auto size = ZSTD_decompressDCtx(state.dctx, content.data(),
+                                        content.size(), payload, length);
+        if (ZSTD_isError(size) || size != content.size()) {
+            return SQLITE_CORRUPT;
+        }
+    } else if (length == content.size()) {
+        memcpy(content.data(), payload, length);
+    } else {
+        return SQLITE_CORRUPT;
+    }
+
+    remember(state, block, content.data());
+    *data = state.cache.front().second.data();
+    return SQLITE_OK;
+}
+
+/// Writes a whole block to a new record, stored uncompressed when zstd
+/// does not make it smaller
+int store_block(FileState &state, sqlite3_file *inner, uint32_t block,
+                const char *data) {
+    auto bound = ZSTD_compressBound(state.block_size);
+    state.buffer.resize(sizeof(RecordHeader) + bound);
+    char *payload = state.buffer.data() + sizeof(RecordHeader);
+
+    auto size = ZSTD_compressCCtx(state.cctx, payload, bound, data,
+                                  state.block_size, compression_level);
+    bool is_compressed = !ZSTD_isError(size) && size < state.block_size;
+    auto length =
+        static_cast<uint32_t>(is_compressed ? size : state.block_size);
+    if (!is_compressed) {
+        memcpy(payload, data, length);
+    }
+
+    RecordHeader header = {record_magic,
+                           block,
+                           length,
+                           is_compressed ? compressed_flag : 0,
+                           state.generation++,
+                           0,
+                           0};
+    header.checksum =
+        checksum(state.salt, &header, offsetof(RecordHeader, checksum));
+    memcpy(state.buffer.data(), &header, sizeof(header));
+
+    auto units = units_for(length);
+    auto unit = allocate(state, units);
+    int status = write_inner(inner, state.buffer.data(),
+                             sizeof(header) + length, unit * unit_size);
+    if (status != SQLITE_OK) {
+        release(state, unit, units);
+        return status;
+    }
+
+    auto previous = state.blocks.find(block);
+    if (previous != state.blocks.end()) {
+        auto previous_units = units_for(previous->second.length);
+        state.pending_units.emplace_back(previous->second.unit, previous_units);
+        state.pending_count += previous_units;
+    }
+    state.blocks[block] = {unit, length, is_compressed};
+    remember(state, block, data);
+
+    if (state.pending_count > max_pending_units) {
+        return sync_file(state, inner, SQLITE_SYNC_NORMAL);
+    }
+    return SQLITE_OK;
+}
+
+void set_block_size(FileState &state, uint32_t block_size) {
+    state.block_size = block_size;
+    state.zeros.assign(block_size, 0);
+    state.scratch.resize(block_size);
+}
+
+/// Rebuilds the page map from the records of the file. Sets plain for files
+/// that are regular sqlite databases
+int load_state(FileState &state, sqlite3_file *inner, bool *plain) {
+    sqlite3_int64 file_size = 0;
+    int status = inner->pMethods->xFileSize(inner, &file_size);
+    if (status != SQLITE_OK) {
+        return status;
+    }
+    auto physical = static_cast<uint64_t>(file_size);
+    if (physical == 0) {
+        sqlite3_randomness(sizeof(state.salt), &state.salt);
+        return SQLITE_OK;
+    }
+
+    char start[16] = {};
+    status = read_inner(inner, start, std::min<uint64_t>(physical, 16), 0);
+    if (status != SQLITE_OK) {
+        return status;
+    }
+    if (memcmp(start, "SQLite format 3", 16) == 0) {
+        *plain = true;
+        return SQLITE_OK;
+    }
+
+    FileHeader header = {};
+    bool found = false;
+    for (uint64_t slot = 0; slot < header_units; slot++) {
+        FileHeader candidate = {};
+        if (physical < slot * unit_size + sizeof(candidate) ||
+            read_inner(inner, &candidate, sizeof(candidate),
+                       slot * unit_size) != SQLITE_OK) {
+            continue;
+        }
+        if (candidate.magic != file_magic ||
+            candidate.checksum !=
+                checksum(0, &candidate, offsetof(FileHeader, checksum))) {
+            continue;
+        }
+        if (!found || candidate.generation > header.generation) {
+            header = candidate;
+            state.header_slot = (slot + 1) % header_units;
+            found = true;
+        }
+    }
+    if (!found || header.version != format_version ||
+        header.block_size == 0) {
+        return SQLITE_CANTOPEN;
+    }
+
+    set_block_size(state, header.block_size);
+    state.size = header.size;
+    state.salt = header.salt;
+    state.generation = header.generation + 1;
+    state.end_unit = (physical + unit_size - 1) / unit_size;
+
+    // Every unit is checked, a record that is no longer current can hide
+    // the header of one that is
+    std::unordered_map<uint32_t, uint64_t> generations;
+    auto max_length = ZSTD_compressBound(state.block_size);
+    std::vector<char> chunk(scan_chunk);
+    for (uint64_t offset = header_units * unit_size; offset < physical;
+         offset += scan_chunk) {
+        auto count = std::min<uint64_t>(scan_chunk, physical - offset);
+        status = read_inner(inner, chunk.data(), count, offset);
+        if (status != SQLITE_OK) {
+            return status;
+        }
+
+        for (uint64_t at = 0; at + sizeof(RecordHeader) <= count;
+             at += unit_size) {
+            RecordHeader record;
+            memcpy(&record, chunk.data() + at, sizeof(record));
+            if (record.magic != record_magic ||
+                record.checksum !=
+                    checksum(state.salt, &record,
+                             offsetof(RecordHeader, checksum))) {
+                continue;
+            }
+
+            auto unit = (offset + at) / unit_size;
+            state.generation =
+                std::max(state.generation, record.generation + 1);
+            // Blocks past the size were cut by a truncation or were written
+            // by a transaction that did not complete
+            if (static_cast<uint64_t>(record.block) * state.block_size >=
+                    state.size ||
+                record.length > max_length ||
+                unit + units_for(record.length) > state.end_unit) {
+                continue;
+            }
+            auto current = generations.find(record.block);
+            if (current == generations.end() ||
+                current->second < record.generation) {
+                generations[record.block] = record.generation;
+                state.blocks[record.block] = {
+                    unit, record.length,
+                    (record.flags & compressed_flag) != 0};
+            }
+        }
+    }
+
+    // Whatever the current records do not use is free
+    std::map<uint64_t, uint64_t> used;
+    for (auto &[block, record] : state.blocks) {
+        used[record.unit] = units_for(record.length);
+    }
+    uint64_t unit = header_units;
+    for (auto &[start, count] : used) {
+        if (start > unit) {
+            release(state, unit, start - unit);
+        }
+        unit = std::max(unit, start + count);
+    }
+    if (state.end_unit > unit) {
+        release(state, unit, state.end_unit - unit);
+    }
+    return SQLITE_OK;
+}
+
+int file_close(sqlite3_file *file) {
+    auto *self = compressed(file);
+    if (self->state != nullptr) {
+        std::lock_guard<std::mutex> registry_lock(registry_mutex);
+        auto *state = self->state;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (state->header_dirty) {
+                write_header(*state, self->inner);
+            }
+            state->references--;
+        }
+        if (state->references == 0) {
+            registry.erase(state->path);
+            delete state;
+        }
+        self->state = nullptr;
+    }
+    return self->inner->pMethods->xClose(self->inner);
+}
+
+int file_read(sqlite3_file *file, void *data, int amount,
+              sqlite3_int64 offset) {
+    auto *self = compressed(file);
+    if (self->state == nullptr) {
+        return self->inner->pMethods->xRead(self->inner, data, amount, offset);
+    }
+
+    auto &state = *self->state;
+    std::lock_guard<std::mutex> lock(state.mutex);
+    auto *out = static_cast<char *>(data);
+    auto start = static_cast<uint64_t>(offset);
+    auto end = std::max(start, std::min(start + amount, state.size));
+    memset(out + (end - start), 0, amount - (end - start));
+
+    for (auto position = start; position < end;) {
+        auto block = static_cast<uint32_t>(position / state.block_size);
+        auto within = position % state.block_size;
+        auto count = std::min(state.block_size - within, end - position);
+
+        const char *content = nullptr;
+        int status = load_block(state, self->inner, block, &content);
+        if (status != SQLITE_OK) {
+            return status;
+        }
+        memcpy(out + (position - start), content + within, count);
+        position += count;
+    }
+
+    return end - start < static_cast<uint64_t>(amount)
+               ? SQLITE_IOERR_SHORT_READ
+               : SQLITE_OK;
+}
+
+int file_write(sqlite3_file *file, const void *data, int amount,
+               sqlite3_int64 offset) {
+    auto *self = compressed(file);
+    if (self->state == nullptr) {
+        return self->inner->pMethods->xWrite(self->inner, data, amount,
+                                             offset);
+    }
+
+    auto &state = *self->state;
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (state.block_size == 0) {
+        // Blocks match the pages sqlite writes, which are whole pages
+        bool is_page_size = amount >= 512 && amount <= 65536 &&
+                            (amount & (amount - 1)) == 0;
+        set_block_size(state, is_page_size ? amount : 4096);
+        int status = write_header(state, self->inner);
+        if (status != SQLITE_OK) {
+            return status;
+        }
+    }
+
+    auto *in = static_cast<const char *>(data);
+    auto start = static_cast<uint64_t>(offset);
+    auto end = start + amount;
+    for (auto position = start; position < end;) {
+        auto block = static_cast<uint32_t>(position / state.block_size);
+        auto within = position % state.block_size;
+        auto count = std::min(state.block_size - within, end - position);
+
+        int status;
+        if (count == state.block_size) {
+            status = store_block(state, self->inner, block,
+                                 in + (position - start));
+        } else {
+            const char *content = nullptr;
+            status = load_block(state, self->inner, block, &content);
+            if (status == SQLITE_OK) {
+                memcpy(state.scratch.data(), content, state.block_size);
+                memcpy(state.scratch.data() + within, in + (position - start),
+                       count);
+                status = store_block(state, self->inner, block,
+                                     state.scratch.data());
+            }
+        }
+        if (status != SQLITE_OK) {
+            return status;
+        }
+        position += count;
+    }
+
+    if (end > state.size) {
+        state.size = end;
+        state.header_dirty = true;
+    }
+    return SQLITE_OK;
+}
+
+int file_truncate(sqlite3_file *file, sqlite3_int64 size) {
+    auto *self = compressed(file);
+    if (self->state == nullptr) {
+        return self->inner->pMethods->xTruncate(self->inner, size);
+    }
+
+    auto &state = *self->state;
+    std::lock_guard<std::mutex> lock(state.mutex);
+    auto new_size = static_cast<uint64_t>(size);
+    if (state.block_size != 0) {
+        auto kept = (new_size + state.block_size - 1) / state.block_size;
+        for (auto record = state.blocks.begin();
+             record != state.blocks.end();) {
+            if (record->first < kept) {
+                ++record;
+                continue;
+            }
+            auto units = units_for(record->second.length);
+            state.pending_units.emplace_back(record->second.unit, units);
+            state.pending_count += units;
+            forget(state, record->first);
+            record = state.blocks.erase(record);
+        }
+
+        // The cut part of the last block reads as zeros if the file grows
+        auto within = new_size % state.block_size;
+        auto last = static_cast<uint32_t>(new_size / state.block_size);
+        if (within != 0 && state.blocks.count(last) != 0) {
+            const char *content = nullptr;
+            int status = load_block(state, self->inner, last, &content);
+            if (status != SQLITE_OK) {
+                return status;
+            }
+            memcpy(state.scratch.data(), content, within);
+            memset(state.scratch.data() + within, 0,
+                   state.block_size - within);
+            status = store_block(state, self->inner, last,
+                                 state.scratch.data());
+            if (status != SQLITE_OK) {
+                return status;
+            }
+        }
+    }
+
+    if (new_size != state.size) {
+        state.size = new_size;
+        state.header_dirty = true;
+    }
+    return SQLITE_OK;
+}
+
+int file_sync(sqlite3_file *file, int flags) {
+    auto *self = compressed(file);
+    if (self->state == nullptr) {
+        return self->inner->pMethods->xSync(self->inner, flags);
+    }
+
+    std::lock_guard<std::mutex> lock(self->state->mutex);
+    return sync_file(*self->state, self->inner, flags);
+}
+
+int file_size(sqlite3_file *file, sqlite3_int64 *size) {
+    auto *self = compressed(file);
+    if (self->state == nullptr) {
+        return self->inner->pMethods->xFileSize(self->inner, size);
+    }
+
+    std::lock_guard<std::mutex> lock(self->state->mutex);
+    *size = static_cast<sqlite3_int64>(self->state->size);
+    return SQLITE_OK;
+}
+
+int file_lock(sqlite3_file *file, int lock) {
+    auto *inner = compressed(file)->inner;
+    return inner->pMethods->xLock(inner, lock);
+}
+
+int file_unlock(sqlite3_file *file, int lock) {
+    auto *inner = compressed(file)->inner;
+    return inner->pMethods->xUnlock(inner, lock);
+}
+
+int file_check_reserved_lock(sqlite3_file *file, int *out) {
+    auto *inner = compressed(file)->inner;
+    return inner->pMethods->xCheckReservedLock(inner, out);
+}
+
+int file_control(sqlite3_file *file, int op, void *arg) {
+    auto *self = compressed(file);
+    if (self->state != nullptr) {
+        // Hints about the physical file do not apply, and pages cannot be
+        // memory mapped
+        switch (op) {
+        case SQLITE_FCNTL_SIZE_HINT:
+        case SQLITE_FCNTL_CHUNK_SIZE:
+            return SQLITE_OK;
+        case SQLITE_FCNTL_MMAP_SIZE:
+            *static_cast<sqlite3_int64 *>(arg) = 0;
+            return SQLITE_OK;
+        default:
+            break;
+        }
+    }
+    return self->inner->pMethods->xFileControl(self->inner, op, arg);
+}
+
+int file_sector_size(sqlite3_file *file) {
+    auto *inner = compressed(file)->inner;
+    return inner->pMethods->xSectorSize(inner);
+}
+
+int file_device_characteristics(sqlite3_file *file) {
+    auto *self = compressed(file);
+    int characteristics =
+        self->inner->pMethods->xDeviceCharacteristics(self->inner);
+    if (self->state == nullptr) {
+        return characteristics;
+    }
+
+    // Writes are not atomic or sequential once they are split in records
+    return characteristics &
+           (SQLITE_IOCAP_POWERSAFE_OVERWRITE |
+            SQLITE_IOCAP_UNDELETABLE_WHEN_OPEN | SQLITE_IOCAP_IMMUTABLE);
+}
+
+int file_shm_map(sqlite3_file *file, int page, int page_size, int extend,
+                 void volatile **out) {
+    auto *inner = compressed(file)->inner;
+    return inner->pMethods->xShmMap(inner, page, page_size, extend, out);
+}
+
+int file_shm_lock(sqlite3_file *file, int offset, int count, int flags) {
+    auto *inner = compressed(file)->inner;
+    return inner->pMethods->xShmLock(inner, offset, count, flags);
+}
+
+void file_shm_barrier(sqlite3_file *file) {
+    auto *inner = compressed(file)->inner;
+    inner->pMethods->xShmBarrier(inner);
+}
+
+int file_shm_unmap(sqlite3_file *file, int delete_flag) {
+    auto *inner = compressed(file)->inner;
+    return inner->pMethods->xShmUnmap(inner, delete_flag);
+}
+
+int file_fetch(sqlite3_file *file, sqlite3_int64 offset, int amount,
+               void **out) {
+    auto *self = compressed(file);
+    if (self->state != nullptr || self->inner->pMethods->iVersion < 3) {
+        *out = nullptr;
+        return SQLITE_OK;
+    }
+    return self->inner->pMethods->xFetch(self->inner, offset, amount, out);
+}
+
+int file_unfetch(sqlite3_file *file, sqlite3_int64 offset, void *data) {
+    auto *self = compressed(file);
+    if (self->state != nullptr || self->inner->pMethods->iVersion < 3) {
+        return SQLITE_OK;
+    }
+    return self->inner->pMethods->xUnfetch(self->inner, offset, data);
+}
+
+sqlite3_io_methods create_io_methods() {
+    sqlite3_io_methods methods = {};
+    methods.iVersion = 3;
+    methods.xClose = file_close;
+    methods.xRead = file_read;
+    methods.xWrite = file_write;
+    methods.xTruncate = file_truncate;
+    methods.xSync = file_sync;
+    methods.xFileSize = file_size;
+    methods.xLock = file_lock;
+    methods.xUnlock = file_unlock;
+    methods.xCheckReservedLock = file_check_reserved_lock;
+    methods.xFileControl = file_control;
+    methods.xSectorSize = file_sector_size;
+    methods.xDeviceCharacteristics = file_device_characteristics;
+    methods.xShmMap = file_shm_map;
+    methods.xShmLock = file_shm_lock;
+    methods.xShmBarrier = file_shm_barrier;
+    methods.xShmUnmap = file_shm_unmap;
+    methods.xFetch = file_fetch;
+    methods.xUnfetch = file_unfetch;
+    return methods;
+}
+
+/// Finds the state of an open file or reads it from the file
+int attach_state(CompressedFile *self, const char *path) {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    auto existing = registry.find(path);
+    if (existing != registry.end()) {
+        std::lock_guard<std::mutex> state_lock(existing->second->mutex);
+        existing->second->references++;
+        self->state = existing->second;
+        return SQLITE_OK;
+    }
+
+    auto *state = new FileState();
+    bool plain = false;
+    int status = load_state(*state, self->inner, &plain);
+    if (status != SQLITE_OK || plain) {
+        delete state;
+        return status;
+    }
+
+    state->path = path;
+    state->references = 1;
+    registry[path] = state;
+    self->state = state;
+    return SQLITE_OK;
+}
+
+int vfs_open(sqlite3_vfs *vfs, const char *name, sqlite3_file *file,
+             int flags, int *out_flags) {
+    auto *root = root_vfs(vfs);
+    // Journals, WAL and temp files go straight to the default VFS
+    if ((flags & SQLITE_OPEN_MAIN_DB) == 0 || name == nullptr) {
+        return root->xOpen(root, name, file, flags, out_flags);
+    }
+
+    static const sqlite3_io_methods io_methods = create_io_methods();
+    auto *self = compressed(file);
+    self->base.pMethods = nullptr;
+    self->inner = reinterpret_cast<sqlite3_file *>(self + 1);
+    self->state = nullptr;
+
+    int status = root->xOpen(root, name, self->inner, flags, out_flags);
+    if (status == SQLITE_OK) {
+        status = attach_state(self, name);
+    }
+    if (status != SQLITE_OK) {
+        if (self->inner->pMethods != nullptr) {
+            self->inner->pMethods->xClose(self->inner);
+        }
+        return status;
+    }
+
+    self->base.pMethods = &io_methods;
+    return SQLITE_OK;
+}
+
+int vfs_delete(sqlite3_vfs *vfs, const char *name, int sync_dir) {
+    return root_vfs(vfs)->xDelete(root_vfs(vfs), name, sync_dir);
+}
+
+int vfs_access(sqlite3_vfs *vfs, const char *name, int flags, int *out) {
+    return root_vfs(vfs)->xAccess(root_vfs(vfs), name, flags, out);
+}
+
+int vfs_full_pathname(sqlite3_vfs *vfs, const char *name, int size,
+                      char *out) {
+    return root_vfs(vfs)->xFullPathname(root_vfs(vfs), name, size, out);
+}
+
+void *vfs_dl_open(sqlite3_vfs *vfs, const char *name) {
+    return root_vfs(vfs)->xDlOpen(root_vfs(vfs), name);
+}
+
+void vfs_dl_error(sqlite3_vfs *vfs, int size, char *out) {
+    root_vfs(vfs)->xDlError(root_vfs(vfs), size, out);
+}
+
+void (*vfs_dl_sym(sqlite3_vfs *vfs, void *handle, const char *symbol))(void) {
+    return root_vfs(vfs)->xDlSym(root_vfs(vfs), handle, symbol);
+}
+
+void vfs_dl_close(sqlite3_vfs *vfs, void *handle) {
+    root_vfs(vfs)->xDlClose(root_vfs(vfs), handle);
+}
+
+int vfs_randomness(sqlite3_vfs *vfs, int size, char *out) {
+    return root_vfs(vfs)->xRandomness(root_vfs(vfs), size, out);
+}
+
+int vfs_sleep(sqlite3_vfs *vfs, int microseconds) {
+    return root_vfs(vfs)->xSleep(root_vfs(vfs), microseconds);
+}
+
+int vfs_current_time(sqlite3_vfs *vfs, double *out) {
+    return root_vfs(vfs)->xCurrentTime(root_vfs(vfs), out);
+}
+
+int vfs_get_last_error(sqlite3_vfs *vfs, int size, char *out) {
+    return root_vfs(vfs)->xGetLastError(root_vfs(vfs), size, out);
+}
+
+int vfs_current_time_int64(sqlite3_vfs *vfs, sqlite3_int64 *out) {
+    return root_vfs(vfs)->xCurrentTimeInt64(root_vfs(vfs), out);
+}
+
+sqlite3_vfs create_vfs(sqlite3_vfs *root) {
+    sqlite3_vfs vfs = {};
+    // System calls are only overridden on the default VFS
+    vfs.iVersion = 2;
+    vfs.szOsFile =
+        static_cast<int>(sizeof(CompressedFile)) + root->szOsFile;
+    vfs.mxPathname = root->mxPathname;
+    vfs.zName = vfs_name;
+    vfs.pAppData = root;
+    vfs.xOpen = vfs_open;
+    vfs.xDelete = vfs_delete;
+    vfs.xAccess = vfs_access;
+    vfs.xFullPathname = vfs_full_pathname;
+    vfs.xDlOpen = vfs_dl_open;
+    vfs.xDlError = vfs_dl_error;
+    vfs.xDlSym = vfs_dl_sym;
+    vfs.xDlClose = vfs_dl_close;
+    vfs.xRandomness = vfs_randomness;
+    vfs.xSleep = vfs_sleep;
+    vfs.xCurrentTime = vfs_current_time;
+    vfs.xGetLastError = vfs_get_last_error;
+    vfs.xCurrentTimeInt64 = vfs_current_time_int64;
+    return vfs;
+}
+
+} // namespace
+
+const char *register_compressed_vfs() {
+    static sqlite3_vfs vfs = create_vfs(sqlite3_vfs_find(nullptr));
+    static int status = sqlite3_vfs_register(&vfs, 0);
+    (void)status;
+    return vfs_name;
+}
+
+} // namespace opsqlite
+
+#endif
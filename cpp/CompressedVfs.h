@@ -0,0 +1,21 @@
+#pragma once
+
+#ifdef OP_SQLITE_USE_ZSTD
+
+#include <sqlite3.h>
+
+namespace opsqlite {
+
+/// Registers, once, a VFS on top of the default one that stores the pages
+/// of main database files compressed with zstd and returns its name.
+/// Journals, WAL files and temp files are passed through untouched, so it
+/// works with WAL: pages are compressed when a checkpoint writes them back.
+/// Existing uncompressed databases are passed through as well. The page map
+/// is kept in memory and rebuilt by reading the file once when it is first
+/// opened, connections of the process share it. Other processes must not
+/// open the file at the same time
+const char *register_compressed_vfs();
+
+} // namespace opsqlite
+
+#endif
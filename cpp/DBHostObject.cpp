@@ -1,16 +1,22 @@
 #include "DBHostObject.h"
 #include "PreparedStatementHostObject.h"
+#include "QueryStats.h"
 #if OP_SQLITE_USE_LIBSQL
 #include "libsql/bridge.h"
 #else
+#include "BlobHostObject.h"
+#include "QueryExport.h"
+#include "TableImport.h"
 #include "bridge.h"
 #endif
 #include "logs.h"
 #include "macros.h"
 #include "utils.h"
 #ifdef OP_SQLITE_USE_ZSTD
-#include "zstd.h"
+#include "CompressedColumns.h"
+#include "Zstd.h"
 #endif
+#include <algorithm>
 #include <iostream>
 #include <utility>
 
@@ -27,31 +33,118 @@ void DBHostObject::flush_pending_reactive_queries(
     });
 }
 #else
+struct ReactiveQueryResult {
+    BridgeResult status;
+    std::shared_ptr<std::vector<DumbHostObject>> results;
+    std::shared_ptr<std::vector<SmartHostObject>> metadata;
+    std::vector<std::shared_ptr<jsi::Value>> callbacks;
+};
+
+ReactiveStatement::~ReactiveStatement() { sqlite3_finalize(stmt); }
+
+static std::string reactive_array_key(const ArrayParam &param) {
+    std::string key(1, static_cast<char>(param.values->index()));
+
+    std::visit(
+        [&](auto &values) {
+            using T = typename std::decay_t<decltype(values)>::value_type;
+
+            key += std::to_string(values.size()) + ":";
+            if constexpr (std::is_same_v<T, std::string>) {
+                for (const auto &value : values) {
+                    key += std::to_string(value.size()) + ":" + value;
+                }
+            } else {
+                key.append(reinterpret_cast<const char *>(values.data()),
+                           values.size() * sizeof(T));
+            }
+        },
+        *param.values);
+
+    return key;
+}
+
+/// Identifies a reactive query by its SQL and bound arguments, subscriptions
+/// with the same key share a single prepared statement
+static std::string reactive_query_key(const std::string &query,
+                                      const std::vector<JSVariant> &params) {
+    std::string key = query;
+
+    for (const auto &param : params) {
+        key.push_back('\0');
+        key.push_back(static_cast<char>(param.index()));
+
+        std::visit(
+            [&](auto &&v) {
+                using T = std::decay_t<decltype(v)>;
+
+                if constexpr (std::is_same_v<T, std::string>) {
+                    key += std::to_string(v.size()) + ":" + v;
+                } else if constexpr (std::is_same_v<T, ArrayBuffer>) {
+                    key += std::to_string(v.size) + ":";
+                    key.append(reinterpret_cast<const char *>(v.data.get()),
+                               v.size);
+                } else if constexpr (std::is_same_v<T, ArrayParam>) {
+                    key += reactive_array_key(v);
+                } else if constexpr (!std::is_same_v<T, std::nullptr_t>) {
+                    key.append(reinterpret_cast<const char *>(&v), sizeof(v));
+                }
+            },
+            param);
+    }
+
+    return key;
+}
+
 void DBHostObject::flush_pending_reactive_queries(
     const std::shared_ptr<jsi::Value> &resolve) {
-    for (const auto &query_ptr : pending_reactive_queries) {
-        auto query = query_ptr.get();
+    auto query_results = std::make_shared<std::vector<ReactiveQueryResult>>();
+    std::unordered_map<ReactiveStatement *, size_t> executed_statements;
+
+    // Statements run without the lock, on_update can fire meanwhile
+    std::set<std::shared_ptr<ReactiveQuery>> pending_queries;
+    {
+        std::lock_guard<std::mutex> lock(reactive_mutex);
+        pending_queries.swap(pending_reactive_queries);
+    }
+
+    for (const auto &query_ptr : pending_queries) {
+        auto statement = query_ptr->statement.get();
+
+        // Another pending subscription already ran this statement, just
+        // attach the callback to its result
+        auto executed = executed_statements.find(statement);
+        if (executed != executed_statements.end()) {
+            query_results->at(executed->second)
+                .callbacks.push_back(query_ptr->callback);
+            continue;
+        }
 
-        std::vector<DumbHostObject> results;
+        auto results = std::make_shared<std::vector<DumbHostObject>>();
         std::shared_ptr<std::vector<SmartHostObject>> metadata =
             std::make_shared<std::vector<SmartHostObject>>();
 
-        auto status = opsqlite_execute_prepared_statement(db, query->stmt,
-                                                          &results, metadata);
+        auto status = opsqlite_execute_prepared_statement(
+            db, statement->stmt, results.get(), metadata);
 
-        invoker->invokeAsync(
-            [this,
-             results = std::make_shared<std::vector<DumbHostObject>>(results),
-             callback = query->callback, metadata, status = std::move(status)] {
-                auto jsiResult =
-                    create_result(rt, status, results.get(), metadata);
-                callback->asObject(rt).asFunction(rt).call(rt, jsiResult);
-            });
+        executed_statements[statement] = query_results->size();
+        query_results->push_back({std::move(status), results, metadata,
+                                  {query_ptr->callback}});
     }
 
-    pending_reactive_queries.clear();
+    // A single hop to the JS thread delivers every result and then resolves
+    invoker->invokeAsync([this, query_results, resolve]() {
+        for (const auto &query_result : *query_results) {
+            auto jsiResult =
+                create_result(rt, query_result.status,
+                              query_result.results.get(),
+                              query_result.metadata);
+
+            for (const auto &callback : query_result.callbacks) {
+                callback->asObject(rt).asFunction(rt).call(rt, jsiResult);
+            }
+        }
 
-    invoker->invokeAsync([this, resolve]() {
         resolve->asObject(rt).asFunction(rt).call(rt, {});
     });
 }
@@ -67,8 +160,39 @@ void DBHostObject::on_rollback() {
     });
 }
 
-void DBHostObject::on_update(const std::string &table,
+#ifdef OP_SQLITE_USE_ZSTD
+// Runs on the worker, a schema that cannot be read leaves the storage names
+void DBHostObject::load_compressed_storage() {
+    std::vector<std::string> tables;
+    try {
+        tables = compressed_tables(db);
+    } catch (std::exception &) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(reactive_mutex);
+    compressed_storage.clear();
+    for (const auto &table : tables) {
+        compressed_storage[table + "_zstd"] = table;
+    }
+}
+#endif
+
+void DBHostObject::on_update(const std::string &storage_table,
                              const std::string &operation, long long row_id) {
+    std::lock_guard<std::mutex> lock(reactive_mutex);
+
+#ifdef OP_SQLITE_USE_ZSTD
+    // The triggers of a compressed table's view write to its storage table,
+    // listeners only know the table
+    auto compressed = compressed_storage.find(storage_table);
+    const std::string &table = compressed != compressed_storage.end()
+                                   ? compressed->second
+                                   : storage_table;
+#else
+    const std::string &table = storage_table;
+#endif
+
     if (update_hook_callback != nullptr) {
         invoker->invokeAsync(
             [this, callback = update_hook_callback, table, operation, row_id] {
@@ -119,6 +243,8 @@ void DBHostObject::on_update(const std::string &table,
     }
 }
 
+// Called on the JS thread without reactive_mutex. Registering takes the
+// connection mutex, which the worker holds while on_update waits for ours
 void DBHostObject::auto_register_update_hook() {
     if (update_hook_callback == nullptr && reactive_queries.empty() &&
         is_update_hook_registered) {
@@ -136,100 +262,302 @@ void DBHostObject::auto_register_update_hook() {
 }
 #endif
 
-#ifdef OP_SQLITE_USE_ZSTD
-static void zstd_compress_sql(sqlite3_context *ctx, int argc,
-                              sqlite3_value **argv) {
-    if (argc == 0) {
-        sqlite3_result_null(ctx);
-        return;
+
+/// Reads the optional priority of a call, queued on the normal lane when the
+/// caller did not pass one
+static Priority to_priority(jsi::Runtime &rt, const jsi::Value &options) {
+    if (!options.isObject()) {
+        return Priority::Normal;
     }
 
-    int input_type = sqlite3_value_type(argv[0]);
-    const void *input_data;
-    int input_size;
+    auto priority = options.asObject(rt).getProperty(rt, "priority");
+    if (!priority.isString()) {
+        return Priority::Normal;
+    }
 
-    if (input_type == SQLITE_BLOB) {
-        input_data = sqlite3_value_blob(argv[0]);
-        input_size = sqlite3_value_bytes(argv[0]);
-    } else if (input_type == SQLITE_TEXT) {
-        input_data = sqlite3_value_text(argv[0]);
-        input_size = sqlite3_value_bytes(argv[0]);
-    } else {
-        sqlite3_result_null(ctx);
-        return;
+    auto name = priority.asString(rt).utf8(rt);
+    if (name == "interactive") {
+        return Priority::Interactive;
+    }
+    if (name == "background") {
+        return Priority::Background;
     }
+    return Priority::Normal;
+}
 
-    if (input_data == NULL) {
-        sqlite3_result_null(ctx);
-        return;
+/// AbortError and TimeoutError follow the names used by AbortSignal so callers
+/// can tell them apart from SQL errors
+static jsi::Value create_cancellation_error(jsi::Runtime &rt,
+                                            const std::string &name) {
+    auto message = name == "TimeoutError" ? "[op-sqlite] Query timed out"
+                                          : "[op-sqlite] Query was cancelled";
+    auto errorCtr = rt.global().getPropertyAsFunction(rt, "Error");
+    auto error = errorCtr.callAsConstructor(
+        rt, jsi::String::createFromAscii(rt, message));
+    error.asObject(rt).setProperty(rt, "name",
+                                   jsi::String::createFromAscii(rt, name));
+    return error;
+}
+
+/// Called on the worker right before the query runs, anything but Running
+/// means the query must not run. Queries cancelled while queued were already
+/// rejected, TimedOut ones still have to be
+CancellableQuery::State
+DBHostObject::begin_cancellable_query(CancellableQuery &query) {
+    std::lock_guard<std::mutex> lock(cancellation_mutex);
+
+    if (query.state != CancellableQuery::State::Queued) {
+        return CancellableQuery::State::Cancelled;
     }
 
-    size_t const cBuffSize = ZSTD_compressBound(input_size);
-    void *const cBuffer = malloc(cBuffSize);
+    if (query.deadline_ns != 0 && now_ns() > query.deadline_ns) {
+        query.state = CancellableQuery::State::TimedOut;
+        return query.state;
+    }
 
-    if (cBuffer == NULL) {
-        sqlite3_result_error_nomem(ctx);
-        return;
+    query.state = CancellableQuery::State::Running;
+#ifndef OP_SQLITE_USE_LIBSQL
+    if (query.deadline_ns != 0) {
+        opsqlite_register_deadline(db, &query.deadline_ns);
     }
+#endif
+    return query.state;
+}
 
-    size_t const cSize = ZSTD_compress(cBuffer, cBuffSize, input_data, input_size, 1);
+/// Returns the name of the error the query has to be rejected with, empty
+/// when it was neither cancelled nor timed out
+std::string DBHostObject::finish_cancellable_query(CancellableQuery *query,
+                                                   bool failed) {
+    if (query == nullptr) {
+        return "";
+    }
 
-    if (ZSTD_isError(cSize)) {
-        sqlite3_result_error(ctx, "zstd compression failed", -1);
-        free(cBuffer);
-        return;
+    std::lock_guard<std::mutex> lock(cancellation_mutex);
+
+#ifndef OP_SQLITE_USE_LIBSQL
+    if (query->deadline_ns != 0) {
+        opsqlite_deregister_deadline(db);
+    }
+#endif
+
+    if (query->state == CancellableQuery::State::Cancelled) {
+        return "AbortError";
+    }
+
+    // A query that made it before the deadline keeps its result
+    if (query->state == CancellableQuery::State::TimedOut ||
+        (failed && query->deadline_ns != 0 && now_ns() > query->deadline_ns)) {
+        query->state = CancellableQuery::State::TimedOut;
+        return "TimeoutError";
     }
 
-    sqlite3_result_blob(ctx, cBuffer, cSize, free);
+    query->state = CancellableQuery::State::Finished;
+    return "";
 }
 
-static void zstd_decompress_sql(sqlite3_context *ctx, int argc,
-                                sqlite3_value **argv) {
-    if (argc == 0) {
-        sqlite3_result_null(ctx);
-        return;
+#ifndef OP_SQLITE_USE_LIBSQL
+/// Target of importCsv and importNdjson, the table is required
+static TableImportOptions to_table_import_options(jsi::Runtime &rt,
+                                                  const jsi::Value &value,
+                                                  const char *name) {
+    if (!value.isObject() ||
+        !value.asObject(rt).getProperty(rt, "table").isString()) {
+        throw std::runtime_error(std::string("[op-sqlite][") + name +
+                                 "] options.table is required");
+    }
+
+    TableImportOptions options;
+    auto js_options = value.asObject(rt);
+    options.table = js_options.getProperty(rt, "table").asString(rt).utf8(rt);
+
+    auto columns = js_options.getProperty(rt, "columns");
+    if (columns.isObject() && columns.asObject(rt).isArray(rt)) {
+        auto array = columns.asObject(rt).asArray(rt);
+        for (size_t i = 0; i < array.length(rt); i++) {
+            options.columns.push_back(
+                array.getValueAtIndex(rt, i).asString(rt).utf8(rt));
+        }
+    }
+
+    auto header = js_options.getProperty(rt, "header");
+    if (header.isBool()) {
+        options.header = header.getBool();
     }
 
-    if (sqlite3_value_type(argv[0]) != SQLITE_BLOB) {
-        sqlite3_result_error(ctx, "zstd_decompress expects a blob", -1);
+    auto delimiter = js_options.getProperty(rt, "delimiter");
+    if (delimiter.isString()) {
+        auto text = delimiter.asString(rt).utf8(rt);
+        if (text.size() != 1 || text[0] == '"' || text[0] == '\n' ||
+            text[0] == '\r') {
+            throw std::runtime_error(std::string("[op-sqlite][") + name +
+                                     "] delimiter must be a single character");
+        }
+        options.delimiter = text[0];
+    }
+
+    return options;
+}
+
+void DBHostObject::read_import_options(const jsi::Value &value,
+                                       ImportOptions &options) {
+    if (!value.isObject()) {
         return;
     }
 
-    const void *cBuffer = sqlite3_value_blob(argv[0]);
-    int cSize = sqlite3_value_bytes(argv[0]);
+    auto js_options = value.asObject(rt);
+    auto chunk_size = js_options.getProperty(rt, "chunkSize");
+    auto callback = js_options.getProperty(rt, "onProgress");
 
-    if (cBuffer == NULL) {
-        sqlite3_result_null(ctx);
+    if (chunk_size.isNumber()) {
+        options.chunk_size = static_cast<size_t>(chunk_size.asNumber());
+    }
+    if (!callback.isObject()) {
         return;
     }
 
-    unsigned long long const rSize = ZSTD_getFrameContentSize(cBuffer, cSize);
+    auto on_progress = std::make_shared<jsi::Value>(rt, callback);
+    options.on_progress = [this, on_progress](const ImportProgress &progress) {
+        invoker->invokeAsync([this, on_progress, progress] {
+            auto res = jsi::Object(rt);
+            res.setProperty(rt, "bytesRead",
+                            static_cast<double>(progress.bytes_read));
+            res.setProperty(rt, "totalBytes",
+                            static_cast<double>(progress.total_bytes));
+            res.setProperty(rt, "commands", progress.commands);
+            res.setProperty(rt, "rowsAffected", progress.affected_rows);
+            on_progress->asObject(rt).asFunction(rt).call(rt, res);
+        });
+    };
+}
+
+jsi::Value DBHostObject::queue_import(std::function<BatchResult()> import) {
+    auto promiseCtr = rt.global().getPropertyAsFunction(rt, "Promise");
+    return promiseCtr.callAsConstructor(rt, HOSTFN("executor") {
+        auto resolve = std::make_shared<jsi::Value>(rt, args[0]);
+        auto reject = std::make_shared<jsi::Value>(rt, args[1]);
+
+        auto task = [&rt, this, import, resolve, reject]() {
+            try {
+                const auto result = import();
+
+                invoker->invokeAsync([&rt, result, resolve] {
+                    auto res = jsi::Object(rt);
+                    res.setProperty(rt, "rowsAffected",
+                                    jsi::Value(result.affectedRows));
+                    res.setProperty(rt, "commands",
+                                    jsi::Value(result.commands));
+                    resolve->asObject(rt).asFunction(rt).call(
+                        rt, std::move(res));
+                });
+            } catch (std::exception &exc) {
+                invoker->invokeAsync(
+                    [&rt, what = std::string(exc.what()), reject] {
+                        auto errorCtr =
+                            rt.global().getPropertyAsFunction(rt, "Error");
+                        auto error = errorCtr.callAsConstructor(
+                            rt, jsi::String::createFromUtf8(rt, what));
+                        reject->asObject(rt).asFunction(rt).call(rt, error);
+                    });
+            }
+        };
+        _thread_pool->queueWork(task);
+        return {};
+    }));
+}
 
-    if (rSize == ZSTD_CONTENTSIZE_ERROR || rSize == ZSTD_CONTENTSIZE_UNKNOWN) {
-        sqlite3_result_error(ctx, "invalid compressed data", -1);
+void DBHostObject::read_backup_options(const jsi::Value &value,
+                                       BackupOptions &options) {
+    if (!value.isObject()) {
         return;
     }
 
-    void *rBuff = malloc(rSize);
-    if (rBuff == NULL) {
-        sqlite3_result_error_nomem(ctx);
+    auto js_options = value.asObject(rt);
+    auto pages_per_step = js_options.getProperty(rt, "pagesPerStep");
+    auto sleep_ms = js_options.getProperty(rt, "sleepMs");
+    auto callback = js_options.getProperty(rt, "onProgress");
+
+    if (pages_per_step.isNumber()) {
+        options.pages_per_step = static_cast<int>(pages_per_step.asNumber());
+    }
+    if (sleep_ms.isNumber() && sleep_ms.asNumber() > 0) {
+        options.sleep = std::chrono::milliseconds(
+            static_cast<int64_t>(sleep_ms.asNumber()));
+    }
+    if (!callback.isObject()) {
         return;
     }
 
-    size_t const dSize = ZSTD_decompress(rBuff, rSize, cBuffer, cSize);
+    auto on_progress = std::make_shared<jsi::Value>(rt, callback);
+    options.on_progress = [this, on_progress](const BackupProgress &progress) {
+        invoker->invokeAsync([this, on_progress, progress] {
+            auto res = jsi::Object(rt);
+            res.setProperty(rt, "remaining", progress.remaining);
+            res.setProperty(rt, "pageCount", progress.page_count);
+            on_progress->asObject(rt).asFunction(rt).call(rt, res);
+        });
+    };
+}
 
-    if (dSize != rSize) {
-        sqlite3_result_error(ctx, "zstd decompression failed", -1);
-        free(rBuff);
+void DBHostObject::step_backup(std::shared_ptr<OnlineBackup> backup,
+                               std::shared_ptr<jsi::Value> resolve,
+                               std::shared_ptr<jsi::Value> reject) {
+    // Dropping the backup removes the unfinished file
+    if (invalidated) {
         return;
     }
 
-    if (argc == 2 && sqlite3_value_type(argv[1]) == SQLITE_INTEGER && sqlite3_value_int(argv[1]) == 1) {
-        sqlite3_result_text(ctx, static_cast<const char*>(rBuff), dSize, free);
-    } else {
-        sqlite3_result_blob(ctx, rBuff, dSize, free);
+    try {
+        int status = backup->step();
+        if (status != SQLITE_DONE) {
+            // A locked source is retried after the pause as well, it is
+            // only locked by other connections
+            auto delay = backup->get_options().sleep;
+            if (status != SQLITE_OK) {
+                delay = std::max(delay, std::chrono::milliseconds(10));
+            }
+            auto next = [this, backup, resolve, reject] {
+                step_backup(backup, resolve, reject);
+            };
+            if (delay.count() > 0) {
+                _thread_pool->queue_delayed_work(next, delay,
+                                                 Priority::Background);
+            } else {
+                _thread_pool->queueWork(next, Priority::Background);
+            }
+            return;
+        }
+
+        auto result = backup->finish();
+        invoker->invokeAsync([this, result, resolve] {
+            auto res = jsi::Object(rt);
+            res.setProperty(rt, "pageCount", result.page_count);
+            resolve->asObject(rt).asFunction(rt).call(rt, std::move(res));
+        });
+    } catch (std::exception &exc) {
+        invoker->invokeAsync([this, what = std::string(exc.what()), reject] {
+            auto errorCtr = rt.global().getPropertyAsFunction(rt, "Error");
+            auto error = errorCtr.callAsConstructor(
+                rt, jsi::String::createFromUtf8(rt, what));
+            reject->asObject(rt).asFunction(rt).call(rt, error);
+        });
     }
 }
+
+/// Ticks do not use the host object, which can be collected while one is
+/// queued. The pool is alive while its threads run them and every way the
+/// connection is closed sets stopped first
+static void schedule_maintenance(ThreadPool *pool, sqlite3 *db,
+                                 std::shared_ptr<Maintenance> maintenance) {
+    auto idle = maintenance->options.idle;
+    auto tick = [pool, db, maintenance] {
+        if (maintenance->stopped) {
+            return;
+        }
+        maintenance->tick(db, pool->queued_task_count());
+        schedule_maintenance(pool, db, maintenance);
+    };
+    pool->queue_delayed_work(tick, idle, Priority::Background);
+}
 #endif
 
 //    _____                _                   _
@@ -244,6 +572,7 @@ DBHostObject::DBHostObject(jsi::Runtime &rt, std::string &url,
                            std::shared_ptr<react::CallInvoker> invoker)
     : db_name(url), invoker(std::move(invoker)), rt(rt) {
     _thread_pool = std::make_shared<ThreadPool>();
+    stats = std::make_shared<QueryStats>();
     db = opsqlite_libsql_open_remote(url, auth_token);
 
     create_jsi_functions();
@@ -255,6 +584,7 @@ DBHostObject::DBHostObject(jsi::Runtime &rt,
                            std::string &crsqlite_path, int sync_interval, bool offline)
     : base_path(path), invoker(std::move(invoker)), db_name(db_name), rt(rt) {
     _thread_pool = std::make_shared<ThreadPool>();
+    stats = std::make_shared<QueryStats>();
     db = opsqlite_libsql_open_sync(db_name, path, crsqlite_path, "", sync_interval, offline);
 
     create_jsi_functions();
@@ -267,28 +597,76 @@ DBHostObject::DBHostObject(jsi::Runtime &rt, std::string &base_path,
                            std::string &db_name, std::string &path,
                            std::string &crsqlite_path,
                            std::string &sqlite_vec_path, std::string &zstd_path,
-                           std::string &encryption_key)
+                           EncryptionOptions &encryption, bool read_only,
+                           bool compressed)
+    : DBHostObject(rt, base_path, std::move(invoker), db_name,
+                   open_connection(db_name, path, crsqlite_path,
+                                   sqlite_vec_path, zstd_path, encryption,
+                                   read_only, compressed)) {}
+
+#ifdef OP_SQLITE_USE_LIBSQL
+DBHostObject::DBHostObject(jsi::Runtime &rt, std::string &base_path,
+                           std::shared_ptr<react::CallInvoker> invoker,
+                           std::string &db_name, DB db)
+#else
+DBHostObject::DBHostObject(jsi::Runtime &rt, std::string &base_path,
+                           std::shared_ptr<react::CallInvoker> invoker,
+                           std::string &db_name, sqlite3 *db)
+#endif
     : base_path(base_path), invoker(std::move(invoker)), db_name(db_name),
-      rt(rt) {
+      rt(rt), db(db) {
     _thread_pool = std::make_shared<ThreadPool>();
+    stats = std::make_shared<QueryStats>();
+
+    create_jsi_functions();
+#ifdef OP_SQLITE_USE_ZSTD
+    // Ahead of anything JS queues, so the first writes are reported right
+    _thread_pool->queueWork([this] { load_compressed_storage(); },
+                            Priority::Interactive);
+#endif
+}
 
+#ifdef OP_SQLITE_USE_LIBSQL
+DB DBHostObject::open_connection(std::string const &db_name,
+                                 std::string const &path,
+                                 std::string const &crsqlite_path,
+                                 std::string const &sqlite_vec_path,
+                                 std::string const &zstd_path,
+                                 EncryptionOptions const &encryption,
+                                 bool read_only, bool compressed) {
+    if (read_only) {
+        throw std::runtime_error(
+            "[op-sqlite] Read only databases are not supported on libsql");
+    }
+    if (compressed) {
+        throw std::runtime_error(
+            "[op-sqlite] Compressed databases are not supported on libsql");
+    }
+    return opsqlite_libsql_open(db_name, path, crsqlite_path);
+}
+#else
+sqlite3 *DBHostObject::open_connection(std::string const &db_name,
+                                       std::string const &path,
+                                       std::string const &crsqlite_path,
+                                       std::string const &sqlite_vec_path,
+                                       std::string const &zstd_path,
+                                       EncryptionOptions const &encryption,
+                                       bool read_only, bool compressed) {
 #ifdef OP_SQLITE_USE_SQLCIPHER
-    db = opsqlite_open(db_name, path, crsqlite_path, sqlite_vec_path, zstd_path,
-                       encryption_key);
-#elif OP_SQLITE_USE_LIBSQL
-    db = opsqlite_libsql_open(db_name, path, crsqlite_path);
+    sqlite3 *db = opsqlite_open(db_name, path, crsqlite_path, sqlite_vec_path,
+                                zstd_path, encryption, read_only, compressed);
 #else
-    db = opsqlite_open(db_name, path, crsqlite_path, sqlite_vec_path,
-                       zstd_path);
+    sqlite3 *db = opsqlite_open(db_name, path, crsqlite_path, sqlite_vec_path,
+                                zstd_path, read_only, compressed);
 #endif
 
 #ifdef OP_SQLITE_USE_ZSTD
-    sqlite3_create_function_v2(db, "zstd_compress", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, NULL, zstd_compress_sql, NULL, NULL, NULL);
-    sqlite3_create_function_v2(db, "zstd_decompress", 2, SQLITE_UTF8 | SQLITE_DETERMINISTIC, NULL, zstd_decompress_sql, NULL, NULL, NULL);
+    register_zstd_functions(db);
 #endif
 
-    create_jsi_functions();
-};
+    return db;
+}
+#endif
 
 void DBHostObject::create_jsi_functions() {
     function_map["attach"] = HOSTFN("attach") {
@@ -340,7 +718,20 @@ void DBHostObject::create_jsi_functions() {
 #ifdef OP_SQLITE_USE_LIBSQL
         opsqlite_libsql_close(db);
 #else
-        opsqlite_close(db);
+        if (maintenance) {
+            maintenance->stopped = true;
+            // PRAGMA optimize can take a while, the worker runs it after the
+            // queued work. The task owns the connection, which is closed
+            // when it is done or dropped with the pool
+            auto connection = std::shared_ptr<sqlite3>(db, opsqlite_close);
+            _thread_pool->queueWork(
+                [connection, maintenance = maintenance] {
+                    maintenance->before_close(connection.get());
+                },
+                Priority::Background);
+        } else {
+            opsqlite_close(db);
+        }
 #endif
 
         return {};
@@ -348,6 +739,11 @@ void DBHostObject::create_jsi_functions() {
 
     function_map["delete"] = HOSTFN("delete") {
         invalidated = true;
+#ifndef OP_SQLITE_USE_LIBSQL
+        if (maintenance) {
+            maintenance->stopped = true;
+        }
+#endif
 
         std::string path = std::string(base_path);
 
@@ -381,19 +777,23 @@ void DBHostObject::create_jsi_functions() {
 
     function_map["executeRaw"] = HOSTFN("executeRaw") {
         const std::string query = args[0].asString(rt).utf8(rt);
-        std::vector<JSVariant> params = count == 2 && args[1].isObject()
+        std::vector<JSVariant> params = count >= 2 && args[1].isObject()
                                             ? to_variant_vec(rt, args[1])
                                             : std::vector<JSVariant>();
+        auto priority =
+            count == 3 ? to_priority(rt, args[2]) : Priority::Normal;
 
         auto promiseCtr = rt.global().getPropertyAsFunction(rt, "Promise");
     auto promise = promiseCtr.callAsConstructor(rt, HOSTFN("executor") {
             auto resolve = std::make_shared<jsi::Value>(rt, args[0]);
             auto reject = std::make_shared<jsi::Value>(rt, args[1]);
 
-            auto task = [this, &rt, query, params, resolve, reject]() {
+            auto task = [this, &rt, query, params, resolve, reject,
+                         queued_at = now_ns()]() {
                 try {
                     std::vector<std::vector<JSVariant>> results;
 
+                    auto started_at = now_ns();
 #ifdef OP_SQLITE_USE_LIBSQL
                     auto status = opsqlite_libsql_execute_raw(
                         db, query, &params, &results);
@@ -401,6 +801,9 @@ void DBHostObject::create_jsi_functions() {
                     auto status =
                         opsqlite_execute_raw(db, query, &params, &results);
 #endif
+                    status.timings.queue_ns = started_at - queued_at;
+                    workload_recorder.record(RecordedApi::ExecuteRaw, query,
+                                             params, queued_at, started_at);
 
                     if (invalidated) {
                         return;
@@ -408,9 +811,13 @@ void DBHostObject::create_jsi_functions() {
 
                     invoker->invokeAsync([&rt, results = std::move(results),
                                           status = std::move(status), resolve,
-                                          reject] {
+                                          reject, query, queued_at,
+                                          stats = stats] {
+                        auto materialization_start = now_ns();
                         auto jsiResult =
                             create_raw_result(rt, status, &results);
+                        stats->record(query, status.timings, queued_at,
+                                      materialization_start);
                         resolve->asObject(rt).asFunction(rt).call(
                             rt, std::move(jsiResult));
                     });
@@ -435,7 +842,7 @@ void DBHostObject::create_jsi_functions() {
                 }
             };
 
-            _thread_pool->queueWork(task);
+            _thread_pool->queueWork(task, priority);
 
             return {};
      }));
@@ -450,41 +857,116 @@ void DBHostObject::create_jsi_functions() {
         if (count == 2) {
             params = to_variant_vec(rt, args[1]);
         }
+
+        auto started_at = now_ns();
 #ifdef OP_SQLITE_USE_LIBSQL
         auto status = opsqlite_libsql_execute(db, query, &params);
 #else
         auto status = opsqlite_execute(db, query, &params);
 #endif
+        workload_recorder.record(RecordedApi::ExecuteSync, query, params,
+                                 started_at, started_at);
 
-        return create_js_rows(rt, status);
+        auto materialization_start = now_ns();
+        auto jsiResult = create_js_rows(rt, status);
+        stats->record(query, status.timings, started_at,
+                      materialization_start);
+
+        return jsiResult;
     });
 
     function_map["execute"] = HOSTFN("execute") {
         const std::string query = args[0].asString(rt).utf8(rt);
-        std::vector<JSVariant> params = count == 2 && args[1].isObject()
+        std::vector<JSVariant> params = count >= 2 && args[1].isObject()
                                             ? to_variant_vec(rt, args[1])
                                             : std::vector<JSVariant>();
 
+        auto priority =
+            count == 3 ? to_priority(rt, args[2]) : Priority::Normal;
+
+        // The JS side assigns an id when the caller gave an AbortSignal or a
+        // timeout
+        std::shared_ptr<CancellableQuery> cancellable;
+        if (count == 3 && args[2].isObject() &&
+            args[2].asObject(rt).getProperty(rt, "id").isNumber()) {
+            auto options = args[2].asObject(rt);
+            cancellable = std::make_shared<CancellableQuery>();
+
+            auto timeout = options.getProperty(rt, "timeout");
+            if (timeout.isNumber() && timeout.asNumber() > 0) {
+                cancellable->deadline_ns =
+                    now_ns() + static_cast<uint64_t>(timeout.asNumber() * 1e6);
+            }
+
+            for (auto it = cancellable_queries.begin();
+                 it != cancellable_queries.end();) {
+                it = it->second.expired() ? cancellable_queries.erase(it)
+                                          : std::next(it);
+            }
+            cancellable_queries[static_cast<int>(
+                options.getProperty(rt, "id").asNumber())] = cancellable;
+        }
+
         auto promiseCtr = rt.global().getPropertyAsFunction(rt, "Promise");
             auto promise = promiseCtr.callAsConstructor(rt,
  HOSTFN("executor") {
-            auto task = [this, &rt, query, params,
-                         resolve = std::make_shared<jsi::Value>(rt, args[0]),
-                         reject = std::make_shared<jsi::Value>(rt, args[1])]() {
+            auto resolve = std::make_shared<jsi::Value>(rt, args[0]);
+            auto reject = std::make_shared<jsi::Value>(rt, args[1]);
+
+            if (cancellable != nullptr) {
+                cancellable->reject = reject;
+            }
+
+            auto task = [this, &rt, query, params, cancellable, resolve,
+                         reject, queued_at = now_ns()]() {
+                auto state = cancellable != nullptr
+                                 ? begin_cancellable_query(*cancellable)
+                                 : CancellableQuery::State::Running;
+
+                if (state == CancellableQuery::State::TimedOut) {
+                    invoker->invokeAsync([&rt, reject] {
+                        reject->asObject(rt).asFunction(rt).call(
+                            rt, create_cancellation_error(rt, "TimeoutError"));
+                    });
+                }
+
+                if (state != CancellableQuery::State::Running) {
+                    return;
+                }
+
                 try {
+                    auto started_at = now_ns();
 #ifdef OP_SQLITE_USE_LIBSQL
                     auto status = opsqlite_libsql_execute(db, query, &params);
 #else
                     auto status = opsqlite_execute(db, query, &params);
 #endif
+                    status.timings.queue_ns = started_at - queued_at;
+                    workload_recorder.record(RecordedApi::Execute, query,
+                                             params, queued_at, started_at);
+
+                    auto error_name =
+                        finish_cancellable_query(cancellable.get(), false);
 
                     if (invalidated) {
                         return;
                     }
 
+                    if (!error_name.empty()) {
+                        invoker->invokeAsync([&rt, reject, error_name] {
+                            reject->asObject(rt).asFunction(rt).call(
+                                rt, create_cancellation_error(rt, error_name));
+                        });
+                        return;
+                    }
+
                     invoker->invokeAsync(
-                        [&rt, status = std::move(status), resolve, reject] {
+                        [&rt, status = std::move(status), resolve, reject,
+                         query, queued_at, stats = stats] {
+                            auto materialization_start = now_ns();
                             auto jsiResult = create_js_rows(rt, status);
+                            stats->record(query, status.timings, queued_at,
+                                          materialization_start);
                             resolve->asObject(rt).asFunction(rt).call(
                                 rt, std::move(jsiResult));
                         });
@@ -494,8 +976,16 @@ void DBHostObject::create_jsi_functions() {
                     // https://github.com/facebook/react-native/issues/48027
                 } catch (std::runtime_error &e) {
                     auto what = e.what();
+                    auto error_name =
+                        finish_cancellable_query(cancellable.get(), true);
                     invoker->invokeAsync(
-                        [&rt, what = std::string(what), reject] {
+                        [&rt, what = std::string(what), error_name, reject] {
+                            if (!error_name.empty()) {
+                                reject->asObject(rt).asFunction(rt).call(
+                                    rt,
+                                    create_cancellation_error(rt, error_name));
+                                return;
+                            }
                             auto errorCtr =
                                 rt.global().getPropertyAsFunction(rt, "Error");
                             auto error = errorCtr.callAsConstructor(
@@ -504,8 +994,16 @@ void DBHostObject::create_jsi_functions() {
                         });
                 } catch (std::exception &exc) {
                     auto what = exc.what();
+                    auto error_name =
+                        finish_cancellable_query(cancellable.get(), true);
                     invoker->invokeAsync(
-                        [&rt, what = std::string(what), reject] {
+                        [&rt, what = std::string(what), error_name, reject] {
+                            if (!error_name.empty()) {
+                                reject->asObject(rt).asFunction(rt).call(
+                                    rt,
+                                    create_cancellation_error(rt, error_name));
+                                return;
+                            }
                             auto errorCtr =
                                 rt.global().getPropertyAsFunction(rt, "Error");
                             auto error = errorCtr.callAsConstructor(
@@ -515,7 +1013,7 @@ void DBHostObject::create_jsi_functions() {
                 }
             };
 
-            _thread_pool->queueWork(task);
+            _thread_pool->queueWork(task, priority);
 
             return {};
     }));
@@ -523,25 +1021,76 @@ void DBHostObject::create_jsi_functions() {
             return promise;
     });
 
+    function_map["cancel"] = HOSTFN("cancel") {
+        auto it = cancellable_queries.find(
+            static_cast<int>(args[0].asNumber()));
+        if (it == cancellable_queries.end()) {
+            return {};
+        }
+
+        auto query = it->second.lock();
+        cancellable_queries.erase(it);
+        if (query == nullptr) {
+            return {};
+        }
+
+        // The JS side enforces timeouts with a timer as well, the progress
+        // handler is compiled out in performance mode
+        bool timed_out = count == 2 && args[1].isString() &&
+                         args[1].asString(rt).utf8(rt) == "TimeoutError";
+        bool was_queued = false;
+        {
+            std::lock_guard<std::mutex> lock(cancellation_mutex);
+
+            if (query->state == CancellableQuery::State::Queued) {
+                // The worker skips it once it gets dequeued
+                was_queued = true;
+                query->state = CancellableQuery::State::Cancelled;
+            } else if (query->state == CancellableQuery::State::Running) {
+#ifndef OP_SQLITE_USE_LIBSQL
+                // Holding the lock guarantees the worker has not moved on to
+                // another statement, sqlite clears a stale interrupt anyway
+                // once no statement is running
+                opsqlite_interrupt(db);
+#endif
+                query->state = timed_out ? CancellableQuery::State::TimedOut
+                                         : CancellableQuery::State::Cancelled;
+            }
+        }
+
+        if (was_queued) {
+            query->reject->asObject(rt).asFunction(rt).call(
+                rt, create_cancellation_error(
+                        rt, timed_out ? "TimeoutError" : "AbortError"));
+        }
+
+        return {};
+    });
+
     function_map["executeWithHostObjects"] = HOSTFN("executeWithHostObjects") {
         const std::string query = args[0].asString(rt).utf8(rt);
         std::vector<JSVariant> params;
 
-        if (count == 2) {
+        if (count >= 2 && args[1].isObject()) {
             const jsi::Value &originalParams = args[1];
             params = to_variant_vec(rt, originalParams);
         }
 
+        auto priority =
+            count == 3 ? to_priority(rt, args[2]) : Priority::Normal;
+
         auto promiseCtr = rt.global().getPropertyAsFunction(rt, "Promise");
     auto promise = promiseCtr.callAsConstructor(rt, HOSTFN("executor") {
             auto resolve = std::make_shared<jsi::Value>(rt, args[0]);
             auto reject = std::make_shared<jsi::Value>(rt, args[1]);
 
-            auto task = [&rt, this, query, params, resolve, reject]() {
+            auto task = [&rt, this, query, params, resolve, reject,
+                         queued_at = now_ns()]() {
                 try {
                     std::vector<DumbHostObject> results;
                     std::shared_ptr<std::vector<SmartHostObject>> metadata =
                         std::make_shared<std::vector<SmartHostObject>>();
+                    auto started_at = now_ns();
 #ifdef OP_SQLITE_USE_LIBSQL
                     auto status = opsqlite_libsql_execute_with_host_objects(
                         db, query, &params, &results, metadata);
@@ -549,6 +1098,10 @@ void DBHostObject::create_jsi_functions() {
                     auto status = opsqlite_execute_host_objects(
                         db, query, &params, &results, metadata);
 #endif
+                    status.timings.queue_ns = started_at - queued_at;
+                    workload_recorder.record(
+                        RecordedApi::ExecuteWithHostObjects, query, params,
+                        queued_at, started_at);
 
                     if (invalidated) {
                         return;
@@ -560,9 +1113,12 @@ void DBHostObject::create_jsi_functions() {
                              std::make_shared<std::vector<DumbHostObject>>(
                                  results),
                          metadata, status = std::move(status), resolve,
-                         reject] {
+                         reject, query, queued_at, stats = stats] {
+                            auto materialization_start = now_ns();
                             auto jsiResult = create_result(
                                 rt, status, results.get(), metadata);
+                            stats->record(query, status.timings, queued_at,
+                                          materialization_start);
                             resolve->asObject(rt).asFunction(rt).call(
                                 rt, std::move(jsiResult));
                         });
@@ -588,7 +1144,7 @@ void DBHostObject::create_jsi_functions() {
                 }
             };
 
-            _thread_pool->queueWork(task);
+            _thread_pool->queueWork(task, priority);
 
             return {};
       }));
@@ -615,19 +1171,26 @@ void DBHostObject::create_jsi_functions() {
         std::vector<BatchArguments> commands;
         to_batch_arguments(rt, batchParams, &commands);
 
+        auto priority =
+            count == 2 ? to_priority(rt, args[1]) : Priority::Normal;
+
         auto promiseCtr = rt.global().getPropertyAsFunction(rt, "Promise");
             auto promise = promiseCtr.callAsConstructor(rt, HOSTFN("executor") {
             auto resolve = std::make_shared<jsi::Value>(rt, args[0]);
             auto reject = std::make_shared<jsi::Value>(rt, args[1]);
 
-            auto task = [this, &rt, commands, resolve, reject]() {
+            auto task = [this, &rt, commands, resolve, reject,
+                         queued_at = now_ns()]() {
                 try {
+                    auto started_at = now_ns();
 #ifdef OP_SQLITE_USE_LIBSQL
                     auto batchResult =
                         opsqlite_libsql_execute_batch(db, &commands);
 #else
                     auto batchResult = opsqlite_execute_batch(db, &commands);
 #endif
+                    workload_recorder.record(RecordedApi::ExecuteBatch,
+                                             commands, queued_at, started_at);
 
                     if (invalidated) {
                         return;
@@ -662,7 +1225,7 @@ void DBHostObject::create_jsi_functions() {
                     });
                 }
             };
-            _thread_pool->queueWork(task);
+            _thread_pool->queueWork(task, priority);
 
             return {};
     }));
@@ -684,61 +1247,502 @@ void DBHostObject::create_jsi_functions() {
         }
 
         const std::string sqlFileName = args[0].asString(rt).utf8(rt);
+        ImportOptions options;
+        if (count > 1) {
+            read_import_options(args[1], options);
+        }
+
+        return queue_import([this, sqlFileName, options]() {
+            return import_sql_file(db, sqlFileName, options);
+        });
+    });
+
+    function_map["importCsv"] = HOSTFN("importCsv") {
+        if (count < 2) {
+            throw std::runtime_error(
+                "[op-sqlite][importCsv] Incorrect parameter count");
+        }
+
+        const std::string path = args[0].asString(rt).utf8(rt);
+        auto options = to_table_import_options(rt, args[1], "importCsv");
+        read_import_options(args[1], options);
+
+        return queue_import([this, path, options]() {
+            return import_csv_file(db, path, options);
+        });
+    });
+
+    function_map["importNdjson"] = HOSTFN("importNdjson") {
+        if (count < 2) {
+            throw std::runtime_error(
+                "[op-sqlite][importNdjson] Incorrect parameter count");
+        }
+
+        const std::string path = args[0].asString(rt).utf8(rt);
+        auto options = to_table_import_options(rt, args[1], "importNdjson");
+        read_import_options(args[1], options);
+
+        return queue_import([this, path, options]() {
+            return import_ndjson_file(db, path, options);
+        });
+    });
+
+    function_map["exportQuery"] = HOSTFN("exportQuery") {
+        if (count < 3 || !args[2].isObject()) {
+            throw std::runtime_error(
+                "[op-sqlite][exportQuery] Incorrect parameter count");
+        }
+
+        const std::string query = args[0].asString(rt).utf8(rt);
+        auto params = args[1].isObject() ? to_variant_vec(rt, args[1])
+                                         : std::vector<JSVariant>();
+        auto js_options = args[2].asObject(rt);
+        if (!js_options.getProperty(rt, "path").isString()) {
+            throw std::runtime_error(
+                "[op-sqlite][exportQuery] options.path is required");
+        }
+        const std::string path =
+            js_options.getProperty(rt, "path").asString(rt).utf8(rt);
+
+        ExportOptions options;
+        auto format = js_options.getProperty(rt, "format");
+        std::string format_name =
+            format.isString() ? format.asString(rt).utf8(rt) : "csv";
+        if (format_name == "csv") {
+            options.format = ExportFormat::Csv;
+        } else if (format_name == "ndjson") {
+            options.format = ExportFormat::Ndjson;
+        } else if (format_name == "arrow") {
+            options.format = ExportFormat::Arrow;
+        } else {
+            throw std::runtime_error(
+                "[op-sqlite][exportQuery] Unknown format " + format_name);
+        }
+
+        auto header = js_options.getProperty(rt, "header");
+        if (header.isBool()) {
+            options.header = header.getBool();
+        }
+        auto batch_size = js_options.getProperty(rt, "batchSize");
+        if (batch_size.isNumber() && batch_size.asNumber() >= 1) {
+            options.batch_size = static_cast<size_t>(batch_size.asNumber());
+        }
+
+        auto callback = js_options.getProperty(rt, "onProgress");
+        if (callback.isObject()) {
+            auto on_progress = std::make_shared<jsi::Value>(rt, callback);
+            options.on_progress = [&rt, this, on_progress](
+                                      const ExportProgress &progress) {
+                invoker->invokeAsync([&rt, on_progress, progress] {
+                    auto res = jsi::Object(rt);
+                    res.setProperty(rt, "rows",
+                                    static_cast<double>(progress.rows));
+                    res.setProperty(
+                        rt, "bytesWritten",
+                        static_cast<double>(progress.bytes_written));
+                    on_progress->asObject(rt).asFunction(rt).call(rt, res);
+                });
+            };
+        }
 
         auto promiseCtr = rt.global().getPropertyAsFunction(rt, "Promise");
-    auto promise = promiseCtr.callAsConstructor(rt, HOSTFN("executor") {
+        auto promise = promiseCtr.callAsConstructor(rt, HOSTFN("executor") {
             auto resolve = std::make_shared<jsi::Value>(rt, args[0]);
             auto reject = std::make_shared<jsi::Value>(rt, args[1]);
 
-            auto task = [&rt, this, sqlFileName, resolve, reject]() {
+            auto task = [&rt, this, query, params, path, options, resolve,
+                         reject]() {
                 try {
-                    const auto result = import_sql_file(db, sqlFileName);
+                    auto result =
+                        export_query(db, query, &params, path, options);
 
                     invoker->invokeAsync([&rt, result, resolve] {
                         auto res = jsi::Object(rt);
-                        res.setProperty(rt, "rowsAffected",
-                                        jsi::Value(result.affectedRows));
-                        res.setProperty(rt, "commands",
-                                        jsi::Value(result.commands));
+                        res.setProperty(rt, "rows",
+                                        static_cast<double>(result.rows));
+                        res.setProperty(
+                            rt, "bytesWritten",
+                            static_cast<double>(result.bytes_written));
+                        resolve->asObject(rt).asFunction(rt).call(rt, res);
+                    });
+                } catch (std::exception &exc) {
+                    invoker->invokeAsync(
+                        [&rt, what = std::string(exc.what()), reject] {
+                            auto errorCtr =
+                                rt.global().getPropertyAsFunction(rt, "Error");
+                            auto error = errorCtr.callAsConstructor(
+                                rt, jsi::String::createFromUtf8(rt, what));
+                            reject->asObject(rt).asFunction(rt).call(rt, error);
+                        });
+                }
+            };
+            _thread_pool->queueWork(task);
+            return {};
+        }));
+
+        return promise;
+    });
+
+    function_map["backup"] = HOSTFN("backup") {
+        if (count < 1 || !args[0].isString()) {
+            throw std::runtime_error(
+                "[op-sqlite][backup] destination path must be a string");
+        }
+
+        const std::string path = args[0].asString(rt).utf8(rt);
+        BackupOptions options;
+        if (count > 1) {
+            read_backup_options(args[1], options);
+        }
+
+        auto promiseCtr = rt.global().getPropertyAsFunction(rt, "Promise");
+        auto promise = promiseCtr.callAsConstructor(rt, HOSTFN("executor") {
+            auto resolve = std::make_shared<jsi::Value>(rt, args[0]);
+            auto reject = std::make_shared<jsi::Value>(rt, args[1]);
+
+            auto task = [&rt, this, path, options, resolve, reject]() {
+                std::shared_ptr<OnlineBackup> backup;
+                try {
+                    backup = std::make_shared<OnlineBackup>(
+                        db, path, OnlineBackup::Direction::ToFile, options);
+                } catch (std::exception &exc) {
+                    invoker->invokeAsync(
+                        [&rt, what = std::string(exc.what()), reject] {
+                            auto errorCtr =
+                                rt.global().getPropertyAsFunction(rt, "Error");
+                            auto error = errorCtr.callAsConstructor(
+                                rt, jsi::String::createFromUtf8(rt, what));
+                            reject->asObject(rt).asFunction(rt).call(rt, error);
+                        });
+                    return;
+                }
+                step_backup(backup, resolve, reject);
+            };
+
+            _thread_pool->queueWork(task, Priority::Background);
+            return {};
+        }));
+
+        return promise;
+    });
+
+    function_map["restore"] = HOSTFN("restore") {
+        if (count < 1 || !args[0].isString()) {
+            throw std::runtime_error(
+                "[op-sqlite][restore] source path must be a string");
+        }
+
+        const std::string path = args[0].asString(rt).utf8(rt);
+        BackupOptions options;
+        if (count > 1) {
+            read_backup_options(args[1], options);
+        }
+
+        auto promiseCtr = rt.global().getPropertyAsFunction(rt, "Promise");
+        auto promise = promiseCtr.callAsConstructor(rt, HOSTFN("executor") {
+            auto resolve = std::make_shared<jsi::Value>(rt, args[0]);
+            auto reject = std::make_shared<jsi::Value>(rt, args[1]);
+
+            auto task = [&rt, this, path, options, resolve, reject]() {
+                try {
+                    auto result = restore_database(db, path, options);
+
+                    invoker->invokeAsync([&rt, result, resolve] {
+                        auto res = jsi::Object(rt);
+                        res.setProperty(rt, "pageCount", result.page_count);
                         resolve->asObject(rt).asFunction(rt).call(
                             rt, std::move(res));
                     });
-                } catch (std::runtime_error &e) {
-                    auto what = e.what();
+                } catch (std::exception &exc) {
                     invoker->invokeAsync(
-                        [&rt, what = std::string(what), reject] {
+                        [&rt, what = std::string(exc.what()), reject] {
                             auto errorCtr =
                                 rt.global().getPropertyAsFunction(rt, "Error");
                             auto error = errorCtr.callAsConstructor(
-                                rt, jsi::String::createFromAscii(rt, what));
+                                rt, jsi::String::createFromUtf8(rt, what));
                             reject->asObject(rt).asFunction(rt).call(rt, error);
                         });
+                }
+            };
+
+            _thread_pool->queueWork(task);
+            return {};
+        }));
+
+        return promise;
+    });
+
+    function_map["openBlob"] = HOSTFN("openBlob") {
+        if (count < 3 || !args[0].isString() || !args[1].isString() ||
+            !args[2].isNumber()) {
+            throw std::runtime_error(
+                "[op-sqlite][openBlob] table, column and rowid are required");
+        }
+
+        const std::string table = args[0].asString(rt).utf8(rt);
+        const std::string column = args[1].asString(rt).utf8(rt);
+        auto rowid = static_cast<sqlite3_int64>(args[2].asNumber());
+        std::string database = "main";
+        bool write = false;
+        double size = -1;
+        if (count > 3 && args[3].isObject()) {
+            auto js_options = args[3].asObject(rt);
+            auto js_write = js_options.getProperty(rt, "write");
+            auto js_size = js_options.getProperty(rt, "size");
+            auto js_database = js_options.getProperty(rt, "database");
+            write = js_write.isBool() && js_write.getBool();
+            if (js_size.isNumber()) {
+                size = js_size.asNumber();
+                write = true;
+            }
+            if (js_database.isString()) {
+                database = js_database.asString(rt).utf8(rt);
+            }
+        }
+
+        auto promiseCtr = rt.global().getPropertyAsFunction(rt, "Promise");
+        auto promise = promiseCtr.callAsConstructor(rt, HOSTFN("executor") {
+            auto resolve = std::make_shared<jsi::Value>(rt, args[0]);
+            auto reject = std::make_shared<jsi::Value>(rt, args[1]);
+
+            auto task = [&rt, this, table, column, rowid, database, write,
+                         size, resolve, reject]() {
+                try {
+                    if (size >= 0) {
+                        // Blob handles cannot resize, the value is set to
+                        // zeros of the final size first
+                        std::vector<JSVariant> params = {
+                            static_cast<long long>(size),
+                            static_cast<long long>(rowid)};
+                        opsqlite_execute(
+                            db,
+                            "UPDATE " + quote_identifier(database) + "." +
+                                quote_identifier(table) + " SET " +
+                                quote_identifier(column) +
+                                " = zeroblob(?) WHERE rowid = ?",
+                            &params);
+                    }
+
+                    sqlite3_blob *blob = nullptr;
+                    if (sqlite3_blob_open(db, database.c_str(), table.c_str(),
+                                          column.c_str(), rowid, write ? 1 : 0,
+                                          &blob) != SQLITE_OK) {
+                        std::string message = sqlite3_errmsg(db);
+                        sqlite3_blob_close(blob);
+                        throw std::runtime_error(
+                            "[op-sqlite] Could not open blob: " + message);
+                    }
+
+                    // Owns the blob before the hop, it is closed if the
+                    // callback never runs or the database is gone
+                    auto handle = std::make_shared<BlobHostObject>(
+                        blob, invoker, _thread_pool);
+                    if (invalidated) {
+                        return;
+                    }
+
+                    invoker->invokeAsync([&rt, handle, resolve] {
+                        resolve->asObject(rt).asFunction(rt).call(
+                            rt, jsi::Object::createFromHostObject(rt, handle));
+                    });
                 } catch (std::exception &exc) {
-                    auto what = exc.what();
                     invoker->invokeAsync(
-                        [&rt, what = std::string(what), reject] {
+                        [&rt, what = std::string(exc.what()), reject] {
                             auto errorCtr =
                                 rt.global().getPropertyAsFunction(rt, "Error");
                             auto error = errorCtr.callAsConstructor(
-                                rt, jsi::String::createFromAscii(rt, what));
+                                rt, jsi::String::createFromUtf8(rt, what));
                             reject->asObject(rt).asFunction(rt).call(rt, error);
                         });
                 }
             };
+
             _thread_pool->queueWork(task);
             return {};
-    }));
+        }));
 
-    return promise;
+        return promise;
+    });
+
+    function_map["compressColumns"] = HOSTFN("compressColumns") {
+#ifdef OP_SQLITE_USE_ZSTD
+        if (count < 2 || !args[0].isString() || !args[1].isObject() ||
+            !args[1].asObject(rt).isArray(rt)) {
+            throw std::runtime_error("[op-sqlite][compressColumns] table and "
+                                     "an array of columns are required");
+        }
+
+        const std::string table = args[0].asString(rt).utf8(rt);
+        auto js_columns = args[1].asObject(rt).asArray(rt);
+        std::vector<std::string> columns;
+        for (size_t i = 0; i < js_columns.size(rt); i++) {
+            columns.push_back(
+                js_columns.getValueAtIndex(rt, i).asString(rt).utf8(rt));
+        }
+        CompressedColumnOptions options;
+        if (count > 2 && args[2].isObject()) {
+            auto js_options = args[2].asObject(rt);
+            auto js_threshold = js_options.getProperty(rt, "threshold");
+            auto js_dictionary = js_options.getProperty(rt, "dictionaryId");
+            auto js_level = js_options.getProperty(rt, "level");
+            if (js_threshold.isNumber()) {
+                options.threshold =
+                    static_cast<int64_t>(js_threshold.asNumber());
+            }
+            if (js_dictionary.isNumber()) {
+                options.dictionary_id =
+                    static_cast<unsigned>(js_dictionary.asNumber());
+            }
+            if (js_level.isNumber()) {
+                options.level = static_cast<int>(js_level.asNumber());
+            }
+        }
+
+        auto promiseCtr = rt.global().getPropertyAsFunction(rt, "Promise");
+        auto promise = promiseCtr.callAsConstructor(rt, HOSTFN("executor") {
+            auto resolve = std::make_shared<jsi::Value>(rt, args[0]);
+            auto reject = std::make_shared<jsi::Value>(rt, args[1]);
+
+            auto task = [&rt, this, table, columns, options, resolve,
+                         reject]() {
+                try {
+                    compress_columns(db, table, columns, options);
+                    load_compressed_storage();
+                    invoker->invokeAsync([&rt, resolve] {
+                        resolve->asObject(rt).asFunction(rt).call(rt, {});
+                    });
+                } catch (std::exception &exc) {
+                    invoker->invokeAsync(
+                        [&rt, what = std::string(exc.what()), reject] {
+                            auto errorCtr =
+                                rt.global().getPropertyAsFunction(rt, "Error");
+                            auto error = errorCtr.callAsConstructor(
+                                rt, jsi::String::createFromUtf8(rt, what));
+                            reject->asObject(rt).asFunction(rt).call(rt, error);
+                        });
+                }
+            };
+
+            _thread_pool->queueWork(task);
+            return {};
+        }));
+
+        return promise;
+#else
+        throw std::runtime_error("[op-sqlite] compressColumns needs zstd, "
+                                 "enable it in the op-sqlite config");
+#endif
+    });
+
+    function_map["setMaintenance"] = HOSTFN("setMaintenance") {
+        if (maintenance) {
+            maintenance->stopped = true;
+            maintenance = nullptr;
+        }
+        if (count < 1 || !args[0].isObject()) {
+            return {};
+        }
+
+        auto js_options = args[0].asObject(rt);
+        MaintenanceOptions options;
+        auto read_ms = [&](const char *name, std::chrono::milliseconds &ms) {
+            auto value = js_options.getProperty(rt, name);
+            if (value.isNumber() && value.asNumber() > 0) {
+                ms = std::chrono::milliseconds(
+                    static_cast<int64_t>(value.asNumber()));
+            }
+        };
+        auto read_bool = [&](const char *name, bool &flag) {
+            auto value = js_options.getProperty(rt, name);
+            if (value.isBool()) {
+                flag = value.getBool();
+            }
+        };
+        auto read_share = [&](const char *name, double &share) {
+            auto value = js_options.getProperty(rt, name);
+            if (value.isNumber()) {
+                share = value.asNumber();
+            }
+        };
+        read_ms("idleMs", options.idle);
+        read_ms("intervalMs", options.interval);
+        read_bool("checkpoint", options.checkpoint);
+        read_bool("optimize", options.optimize);
+        read_share("vacuumThreshold", options.vacuum_threshold);
+        read_share("compactThreshold", options.compact_threshold);
+
+        auto callback = js_options.getProperty(rt, "onMaintenance");
+        if (callback.isObject()) {
+            auto on_event = std::make_shared<jsi::Value>(rt, callback);
+            options.on_event = [&rt, this,
+                                on_event](const MaintenanceEvent &event) {
+                invoker->invokeAsync([&rt, on_event, event] {
+                    auto res = jsi::Object(rt);
+                    res.setProperty(
+                        rt, "task",
+                        jsi::String::createFromAscii(rt, event.task));
+                    res.setProperty(
+                        rt, "durationMs",
+                        static_cast<double>(event.duration_ns) / 1e6);
+                    res.setProperty(rt, "pages", event.pages);
+                    if (!event.error.empty()) {
+                        res.setProperty(
+                            rt, "error",
+                            jsi::String::createFromUtf8(rt, event.error));
+                    }
+                    on_event->asObject(rt).asFunction(rt).call(rt, res);
+                });
+            };
+        }
+
+        maintenance = std::make_shared<Maintenance>(std::move(options));
+        schedule_maintenance(_thread_pool.get(), db, maintenance);
+        return {};
+    });
+
+    function_map["serialize"] = HOSTFN("serialize") {
+        auto promiseCtr = rt.global().getPropertyAsFunction(rt, "Promise");
+        auto promise = promiseCtr.callAsConstructor(rt, HOSTFN("executor") {
+            auto resolve = std::make_shared<jsi::Value>(rt, args[0]);
+            auto reject = std::make_shared<jsi::Value>(rt, args[1]);
+
+            auto task = [&rt, this, resolve, reject]() {
+                try {
+                    auto buffer = opsqlite_serialize(db);
+
+                    invoker->invokeAsync([&rt, buffer, resolve] {
+                        resolve->asObject(rt).asFunction(rt).call(
+                            rt, to_jsi(rt, JSVariant(buffer)));
+                    });
+                } catch (std::exception &exc) {
+                    invoker->invokeAsync(
+                        [&rt, what = std::string(exc.what()), reject] {
+                            auto errorCtr =
+                                rt.global().getPropertyAsFunction(rt, "Error");
+                            auto error = errorCtr.callAsConstructor(
+                                rt, jsi::String::createFromUtf8(rt, what));
+                            reject->asObject(rt).asFunction(rt).call(rt, error);
+                        });
+                }
+            };
+
+            _thread_pool->queueWork(task);
+            return {};
+        }));
+
+        return promise;
     });
 
     function_map["updateHook"] = HOSTFN("updateHook") {
         auto callback = std::make_shared<jsi::Value>(rt, args[0]);
 
-        if (callback->isUndefined() || callback->isNull()) {
-            update_hook_callback = nullptr;
-        } else {
-            update_hook_callback = callback;
+        {
+            std::lock_guard<std::mutex> lock(reactive_mutex);
+            if (callback->isUndefined() || callback->isNull()) {
+                update_hook_callback = nullptr;
+            } else {
+                update_hook_callback = callback;
+            }
         }
 
         auto_register_update_hook();
@@ -790,6 +1794,94 @@ void DBHostObject::create_jsi_functions() {
         return {};
     });
 
+    function_map["setSlowQueryThreshold"] = HOSTFN("setSlowQueryThreshold") {
+        if (count < 1 || !args[0].isNumber()) {
+            throw std::runtime_error(
+                "[op-sqlite][setSlowQueryThreshold] threshold in ms needed");
+        }
+
+        double threshold_ms = args[0].asNumber();
+        size_t capacity = count > 1 && args[1].isNumber()
+                              ? static_cast<size_t>(args[1].asNumber())
+                              : SlowQueryLog::default_capacity;
+
+        if (threshold_ms <= 0) {
+            slow_query_log.configure(0, capacity);
+            opsqlite_deregister_profile_hook(db);
+            return {};
+        }
+
+        slow_query_log.configure(static_cast<uint64_t>(threshold_ms * 1e6),
+                                 capacity);
+        opsqlite_register_profile_hook(db, &slow_query_log);
+        return {};
+    });
+
+    function_map["getSlowQueries"] = HOSTFN("getSlowQueries") {
+        auto promiseCtr = rt.global().getPropertyAsFunction(rt, "Promise");
+    auto promise = promiseCtr.callAsConstructor(rt, HOSTFN("executor") {
+            auto resolve = std::make_shared<jsi::Value>(rt, args[0]);
+
+            auto task = [&rt, this, resolve]() {
+                // Plans are computed outside of the log lock, explaining is
+                // itself traced and would otherwise dead lock
+                for (const auto &query : slow_query_log.entries()) {
+                    if (query.has_query_plan) {
+                        continue;
+                    }
+
+                    std::string plan;
+                    try {
+                        plan = opsqlite_explain_query_plan(db, query.sql);
+                    } catch (std::exception &exc) {
+                        plan = exc.what();
+                    }
+                    slow_query_log.set_query_plan(query.id, plan);
+                }
+
+                auto queries = slow_query_log.entries();
+
+                invoker->invokeAsync([&rt, queries = std::move(queries),
+                                      resolve] {
+                    auto res = jsi::Array(rt, queries.size());
+                    for (size_t i = 0; i < queries.size(); i++) {
+                        const auto &query = queries[i];
+                        auto js_query = jsi::Object(rt);
+                        js_query.setProperty(
+                            rt, "sql",
+                            jsi::String::createFromUtf8(rt, query.sql));
+                        js_query.setProperty(rt, "timestamp", query.timestamp);
+                        js_query.setProperty(rt, "durationMs",
+                                             query.duration_ms);
+                        js_query.setProperty(rt, "fullscanSteps",
+                                             query.fullscan_steps);
+                        js_query.setProperty(rt, "sorts", query.sorts);
+                        js_query.setProperty(rt, "autoindexes",
+                                             query.autoindexes);
+                        js_query.setProperty(rt, "vmSteps", query.vm_steps);
+                        js_query.setProperty(
+                            rt, "queryPlan",
+                            jsi::String::createFromUtf8(rt, query.query_plan));
+                        res.setValueAtIndex(rt, i, std::move(js_query));
+                    }
+                    resolve->asObject(rt).asFunction(rt).call(rt,
+                                                              std::move(res));
+                });
+            };
+
+            _thread_pool->queueWork(task);
+
+            return {};
+    }));
+
+    return promise;
+    });
+
+    function_map["clearSlowQueries"] = HOSTFN("clearSlowQueries") {
+        slow_query_log.clear();
+        return {};
+    });
+
     function_map["reactiveExecute"] = HOSTFN("reactiveExecute") {
         auto query = args[0].asObject(rt);
 
@@ -800,8 +1892,16 @@ void DBHostObject::create_jsi_functions() {
             query.getProperty(rt, "fireOn").asObject(rt).asArray(rt);
         auto variant_args = to_variant_vec(rt, js_args);
 
-        sqlite3_stmt *stmt = opsqlite_prepare_statement(db, query_str);
-        opsqlite_bind_statement(stmt, &variant_args);
+        auto key = reactive_query_key(query_str, variant_args);
+        std::shared_ptr<ReactiveStatement> statement =
+            reactive_statements[key].lock();
+
+        if (statement == nullptr) {
+            sqlite3_stmt *stmt = opsqlite_prepare_statement(db, query_str);
+            opsqlite_bind_statement(stmt, &variant_args);
+            statement = std::make_shared<ReactiveStatement>(stmt);
+            reactive_statements[key] = statement;
+        }
 
         auto callback =
             std::make_shared<jsi::Value>(query.getProperty(rt, "callback"));
@@ -828,18 +1928,35 @@ void DBHostObject::create_jsi_functions() {
 
         std::shared_ptr<ReactiveQuery> reactiveQuery =
             std::make_shared<ReactiveQuery>(
-                ReactiveQuery{stmt, discriminators, callback});
+                ReactiveQuery{statement, discriminators, callback});
 
-        reactive_queries.push_back(reactiveQuery);
+        {
+            std::lock_guard<std::mutex> lock(reactive_mutex);
+            reactive_queries.push_back(reactiveQuery);
+        }
 
         auto_register_update_hook();
 
         auto unsubscribe = HOSTFN("unsubscribe") {
-            auto it = std::find(reactive_queries.begin(),
-                                reactive_queries.end(), reactiveQuery);
-            if (it != reactive_queries.end()) {
-                reactive_queries.erase(it);
+            {
+                std::lock_guard<std::mutex> lock(reactive_mutex);
+                auto it = std::find(reactive_queries.begin(),
+                                    reactive_queries.end(), reactiveQuery);
+                if (it != reactive_queries.end()) {
+                    reactive_queries.erase(it);
+                }
             }
+
+            bool is_statement_shared =
+                std::any_of(reactive_queries.begin(), reactive_queries.end(),
+                            [&](const auto &query) {
+                                return query->statement ==
+                                       reactiveQuery->statement;
+                            });
+            if (!is_statement_shared) {
+                reactive_statements.erase(key);
+            }
+
             auto_register_update_hook();
             return {};
         });
@@ -863,6 +1980,40 @@ void DBHostObject::create_jsi_functions() {
                                                  preparedStatementHostObject);
     });
 
+    function_map["getStats"] = HOSTFN("getStats") {
+        return create_stats_result(rt, stats->snapshot());
+    });
+
+    function_map["resetStats"] = HOSTFN("resetStats") {
+        stats->reset();
+        return {};
+    });
+
+    function_map["startRecording"] = HOSTFN("startRecording") {
+        auto path = args[0].asString(rt).utf8(rt);
+        bool include_values = false;
+
+        if (count == 2 && args[1].isObject()) {
+            auto values =
+                args[1].asObject(rt).getProperty(rt, "includeValues");
+            include_values = values.isBool() && values.getBool();
+        }
+
+        workload_recorder.start(path, include_values);
+        return {};
+    });
+
+    function_map["stopRecording"] = HOSTFN("stopRecording") {
+        workload_recorder.stop();
+        return {};
+    });
+
+    function_map["setLowerBackgroundPriority"] =
+        HOSTFN("setLowerBackgroundPriority") {
+        _thread_pool->set_lower_background_priority(args[0].asBool());
+        return {};
+    });
+
     function_map["getDbPath"] = HOSTFN("getDbPath") {
         std::string path = std::string(base_path);
 
@@ -935,11 +2086,16 @@ void DBHostObject::set(jsi::Runtime &_rt, const jsi::PropNameID &name,
 }
 
 void DBHostObject::invalidate() {
-    if (invalidated) {
+#ifndef OP_SQLITE_USE_LIBSQL
+    // Ticks only check stopped, they can run after the host object is gone
+    if (maintenance) {
+        maintenance->stopped = true;
+    }
+#endif
+    if (invalidated.exchange(true)) {
         return;
     }
 
-    invalidated = true;
     _thread_pool->restartPool();
 #ifdef OP_SQLITE_USE_LIBSQL
     opsqlite_libsql_close(db);
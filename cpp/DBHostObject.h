@@ -1,13 +1,21 @@
 #pragma once
 
 #include "OPThreadPool.h"
+#include "QueryStats.h"
+#include "SlowQueryLog.h"
+#include "WorkloadRecorder.h"
 #include "types.h"
 #include <ReactCommon/CallInvoker.h>
+#include <atomic>
 #include <jsi/jsi.h>
+#include <mutex>
 #include <set>
 #ifdef OP_SQLITE_USE_LIBSQL
 #include "libsql/bridge.h"
 #else
+#include "Backup.h"
+#include "Maintenance.h"
+#include "SqlImport.h"
 #include <sqlite3.h>
 #endif
 #include <unordered_map>
@@ -29,14 +37,36 @@ struct TableRowDiscriminator {
     std::vector<int> ids;
 };
 
-struct ReactiveQuery {
+// Prepared statement shared by every reactive query subscribed with the same
+// SQL and arguments, finalized once the last subscription is gone
+struct ReactiveStatement {
 #ifndef OP_SQLITE_USE_LIBSQL
+    explicit ReactiveStatement(sqlite3_stmt *stmt) : stmt(stmt) {}
+    ReactiveStatement(const ReactiveStatement &) = delete;
+    ReactiveStatement &operator=(const ReactiveStatement &) = delete;
+    ~ReactiveStatement();
+
     sqlite3_stmt *stmt;
 #endif
+};
+
+struct ReactiveQuery {
+    std::shared_ptr<ReactiveStatement> statement;
     std::vector<TableRowDiscriminator> discriminators;
     std::shared_ptr<jsi::Value> callback;
 };
 
+// Query started with an AbortSignal or a timeout. The state is shared between
+// the JS thread, which cancels, and the worker, which runs the query
+struct CancellableQuery {
+    enum class State { Queued, Running, Finished, Cancelled, TimedOut };
+
+    State state = State::Queued;
+    // now_ns() after which the query is interrupted, 0 when there is none
+    uint64_t deadline_ns = 0;
+    std::shared_ptr<jsi::Value> reject;
+};
+
 class JSI_EXPORT DBHostObject : public jsi::HostObject {
   public:
     // Normal constructor shared between all backends
@@ -44,7 +74,8 @@ class JSI_EXPORT DBHostObject : public jsi::HostObject {
                  std::shared_ptr<react::CallInvoker> invoker,
                  std::string &db_name, std::string &path,
                  std::string &crsqlite_path, std::string &sqlite_vec_path,
-                 std::string &zstd_path, std::string &encryption_key);
+                 std::string &zstd_path, EncryptionOptions &encryption,
+                 bool read_only = false, bool compressed = false);
 
 #ifdef OP_SQLITE_USE_LIBSQL
     // Constructor for remoteOpen, purely for remote databases
@@ -57,6 +88,42 @@ class JSI_EXPORT DBHostObject : public jsi::HostObject {
                  std::string &auth_token, int sync_interval, bool offline);
 #endif
 
+    // Wraps a connection returned by open_connection, which openAsync runs
+    // on a worker
+#ifdef OP_SQLITE_USE_LIBSQL
+    DBHostObject(jsi::Runtime &rt, std::string &base_path,
+                 std::shared_ptr<react::CallInvoker> invoker,
+                 std::string &db_name, DB db);
+#else
+    DBHostObject(jsi::Runtime &rt, std::string &base_path,
+                 std::shared_ptr<react::CallInvoker> invoker,
+                 std::string &db_name, sqlite3 *db);
+#endif
+
+    /// Opens the database, loads the extensions and registers the functions
+    /// and tokenizers. Does not touch the JS runtime, throws on failure.
+    /// Read only databases are opened immutable and memory mapped, compressed
+    /// ones through the zstd VFS
+#ifdef OP_SQLITE_USE_LIBSQL
+    static DB open_connection(std::string const &db_name,
+                              std::string const &path,
+                              std::string const &crsqlite_path,
+                              std::string const &sqlite_vec_path,
+                              std::string const &zstd_path,
+                              EncryptionOptions const &encryption,
+                              bool read_only = false,
+                              bool compressed = false);
+#else
+    static sqlite3 *open_connection(std::string const &db_name,
+                                    std::string const &path,
+                                    std::string const &crsqlite_path,
+                                    std::string const &sqlite_vec_path,
+                                    std::string const &zstd_path,
+                                    EncryptionOptions const &encryption,
+                                    bool read_only = false,
+                                    bool compressed = false);
+#endif
+
     std::vector<jsi::PropNameID> getPropertyNames(jsi::Runtime &rt) override;
     jsi::Value get(jsi::Runtime &rt,
                    const jsi::PropNameID &propNameID) override;
@@ -70,29 +137,65 @@ class JSI_EXPORT DBHostObject : public jsi::HostObject {
     ~DBHostObject() override;
 
   private:
+    // Filled by on_update on the worker thread, guarded by reactive_mutex
     std::set<std::shared_ptr<ReactiveQuery>> pending_reactive_queries;
     void auto_register_update_hook();
     void create_jsi_functions();
     void
     flush_pending_reactive_queries(const std::shared_ptr<jsi::Value> &resolve);
+    CancellableQuery::State begin_cancellable_query(CancellableQuery &query);
+    std::string finish_cancellable_query(CancellableQuery *query, bool failed);
+#ifndef OP_SQLITE_USE_LIBSQL
+    /// Reads chunkSize and onProgress, shared by the file imports
+    void read_import_options(const jsi::Value &value, ImportOptions &options);
+    /// Runs an import on the worker, resolves with rowsAffected and commands
+    jsi::Value queue_import(std::function<BatchResult()> import);
+    /// Reads pagesPerStep, sleepMs and onProgress of backup and restore
+    void read_backup_options(const jsi::Value &value, BackupOptions &options);
+    /// Copies the next pages and queues the following step in the background
+    /// lane, so queries on the connection run between the steps
+    void step_backup(std::shared_ptr<OnlineBackup> backup,
+                     std::shared_ptr<jsi::Value> resolve,
+                     std::shared_ptr<jsi::Value> reject);
+#endif
+#ifdef OP_SQLITE_USE_ZSTD
+    /// Reads zstd_columns into compressed_storage
+    void load_compressed_storage();
+    // <table>_zstd to <table>, guarded by reactive_mutex like on_update
+    std::unordered_map<std::string, std::string> compressed_storage;
+#endif
 
     std::unordered_map<std::string, jsi::Value> function_map;
     std::string base_path;
     std::shared_ptr<react::CallInvoker> invoker;
     std::shared_ptr<ThreadPool> _thread_pool;
+    std::shared_ptr<QueryStats> stats;
+    SlowQueryLog slow_query_log;
+    WorkloadRecorder workload_recorder;
     std::string db_name;
+    // Read by on_update on the worker thread, only written on the JS thread
+    // with reactive_mutex held, like reactive_queries
     std::shared_ptr<jsi::Value> update_hook_callback;
     std::shared_ptr<jsi::Value> commit_hook_callback;
     std::shared_ptr<jsi::Value> rollback_hook_callback;
     jsi::Runtime &rt;
     std::vector<std::shared_ptr<ReactiveQuery>> reactive_queries;
+    std::mutex reactive_mutex;
+    std::unordered_map<std::string, std::weak_ptr<ReactiveStatement>>
+        reactive_statements;
     std::vector<PendingReactiveInvocation> pending_reactive_invocations;
+    // Only touched from the JS thread, keyed by the id the JS side assigns
+    std::unordered_map<int, std::weak_ptr<CancellableQuery>>
+        cancellable_queries;
+    std::mutex cancellation_mutex;
     bool is_update_hook_registered = false;
-    bool invalidated = false;
+    std::atomic<bool> invalidated{false};
 #ifdef OP_SQLITE_USE_LIBSQL
     DB db;
 #else
     sqlite3 *db;
+    // Replaced on the JS thread, ticks hold their own reference
+    std::shared_ptr<Maintenance> maintenance;
 #endif
 };
 
@@ -0,0 +1,943 @@
+#ifndef OP_SQLITE_USE_LIBSQL
+
+#include "Fts5Tokenizers.h"
+#include "Fts5UnicodeTables.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <string>
+#include <vector>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define OP_SQLITE_TOKENIZER_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define OP_SQLITE_TOKENIZER_SSE2
+#endif
+
+namespace opsqlite {
+
+namespace {
+
+using namespace fts5_unicode;
+
+using TokenCallback = int (*)(void *, int, const char *, int, int, int);
+
+enum class TokenizerKind { unicode, porter, trigram, cjk };
+
+/// Passed as user data when registering, one per kind
+TokenizerKind unicode_kind = TokenizerKind::unicode;
+TokenizerKind porter_kind = TokenizerKind::porter;
+TokenizerKind trigram_kind = TokenizerKind::trigram;
+TokenizerKind cjk_kind = TokenizerKind::cjk;
+
+struct Tokenizer {
+    TokenizerKind kind;
+    bool remove_diacritics = true;
+};
+
+constexpr uint32_t replacement_character = 0xFFFD;
+
+constexpr bool is_ascii_word(uint32_t c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+           (c >= 'A' && c <= 'Z');
+}
+
+constexpr char ascii_lower(unsigned char c) {
+    return static_cast<char>(c >= 'A' && c <= 'Z' ? c + 32 : c);
+}
+
+/// Length of the run of ASCII letters and digits text starts with, checked
+/// 16 bytes at a time on CPUs with vector instructions
+size_t ascii_word_run(const unsigned char *text, size_t size) {
+    size_t i = 0;
+#if defined(OP_SQLITE_TOKENIZER_NEON)
+    for (; i + 16 <= size; i += 16) {
+        uint8x16_t chunk = vld1q_u8(text + i);
+        uint8x16_t digit =
+            vcleq_u8(vsubq_u8(chunk, vdupq_n_u8('0')), vdupq_n_u8(9));
+        uint8x16_t folded = vorrq_u8(chunk, vdupq_n_u8(0x20));
+        uint8x16_t letter =
+            vcleq_u8(vsubq_u8(folded, vdupq_n_u8('a')), vdupq_n_u8(25));
+        // Narrows the byte mask to one nibble per byte
+        uint8x8_t narrowed =
+            vshrn_n_u16(vreinterpretq_u16_u8(vorrq_u8(digit, letter)), 4);
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+        if (mask != ~uint64_t(0)) {
+            return i + __builtin_ctzll(~mask) / 4;
+        }
+    }
+#elif defined(OP_SQLITE_TOKENIZER_SSE2)
+    // Bytes from 0x80 are negative for the signed comparisons, so they are
+    // neither digits nor letters
+    const __m128i before_0 = _mm_set1_epi8('0' - 1);
+    const __m128i after_9 = _mm_set1_epi8('9' + 1);
+    const __m128i before_a = _mm_set1_epi8('a' - 1);
+    const __m128i after_z = _mm_set1_epi8('z' + 1);
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    for (; i + 16 <= size; i += 16) {
+        __m128i chunk =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + i));
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(chunk, before_0),
+                                      _mm_cmplt_epi8(chunk, after_9));
+        __m128i folded = _mm_or_si128(chunk, case_bit);
+        __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(folded, before_a),
+                                       _mm_cmplt_epi8(folded, after_z));
+        int mask = _mm_movemask_epi8(_mm_or_si128(digit, letter));
+        if (mask != 0xFFFF) {
+            return i + __builtin_ctz(~mask);
+        }
+    }
+#endif
+    while (i < size && is_ascii_word(text[i])) {
+        i++;
+    }
+    return i;
+}
+
+/// Appends the first size bytes of ASCII text lowercased, 16 bytes at a
+/// time on CPUs with vector instructions. Up to readable bytes of text are
+/// read, so that words shorter than 16 bytes take one step as well
+void append_ascii_lower(std::string &out, const unsigned char *text,
+                        size_t size, size_t readable) {
+    size_t offset = out.size();
+    out.resize(offset + size + 16);
+    auto *dest = reinterpret_cast<unsigned char *>(&out[offset]);
+    size_t i = 0;
+#if defined(OP_SQLITE_TOKENIZER_NEON)
+    for (; i < size && i + 16 <= readable; i += 16) {
+        uint8x16_t chunk = vld1q_u8(text + i);
+        uint8x16_t upper =
+            vcleq_u8(vsubq_u8(chunk, vdupq_n_u8('A')), vdupq_n_u8(25));
+        chunk = vorrq_u8(chunk, vandq_u8(upper, vdupq_n_u8(0x20)));
+        vst1q_u8(dest + i, chunk);
+    }
+#elif defined(OP_SQLITE_TOKENIZER_SSE2)
+    const __m128i before_a = _mm_set1_epi8('A' - 1);
+    const __m128i after_z = _mm_set1_epi8('Z' + 1);
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    for (; i < size && i + 16 <= readable; i += 16) {
+        __m128i chunk =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + i));
+        __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(chunk, before_a),
+                                      _mm_cmplt_epi8(chunk, after_z));
+        chunk = _mm_or_si128(chunk, _mm_and_si128(upper, case_bit));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i), chunk);
+    }
+#endif
+    for (; i < size; i++) {
+        dest[i] = ascii_lower(text[i]);
+    }
+    out.resize(offset + size);
+}
+
+/// Decodes the code point at text[i] and moves i past it. Malformed
+/// sequences decode to U+FFFD one byte at a time
+uint32_t decode_utf8(const unsigned char *text, size_t size, size_t &i) {
+    uint32_t c = text[i++];
+    if (c < 0x80) {
+        return c;
+    }
+    size_t extra;
+    uint32_t min;
+    if ((c & 0xE0) == 0xC0) {
+        extra = 1;
+        min = 0x80;
+        c &= 0x1F;
+    } else if ((c & 0xF0) == 0xE0) {
+        extra = 2;
+        min = 0x800;
+        c &= 0x0F;
+    } else if ((c & 0xF8) == 0xF0) {
+        extra = 3;
+        min = 0x10000;
+        c &= 0x07;
+    } else {
+        return replacement_character;
+    }
+    if (size - i < extra) {
+        return replacement_character;
+    }
+    for (size_t n = 0; n < extra; n++) {
+        if ((text[i + n] & 0xC0) != 0x80) {
+            return replacement_character;
+        }
+        c = (c << 6) | (text[i + n] & 0x3F);
+    }
+    if (c < min || c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF)) {
+        return replacement_character;
+    }
+    i += extra;
+    return c;
+}
+
+/// Writes c to out, which has room for 4 bytes, and returns its length
+size_t encode_utf8(uint32_t c, char *out) {
+    if (c < 0x80) {
+        out[0] = static_cast<char>(c);
+        return 1;
+    }
+    if (c < 0x800) {
+        out[0] = static_cast<char>(0xC0 | (c >> 6));
+        out[1] = static_cast<char>(0x80 | (c & 0x3F));
+        return 2;
+    }
+    if (c < 0x10000) {
+        out[0] = static_cast<char>(0xE0 | (c >> 12));
+        out[1] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+        out[2] = static_cast<char>(0x80 | (c & 0x3F));
+        return 3;
+    }
+    out[0] = static_cast<char>(0xF0 | (c >> 18));
+    out[1] = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+    out[2] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+    out[3] = static_cast<char>(0x80 | (c & 0x3F));
+    return 4;
+}
+
+void append_utf8(std::string &out, uint32_t c) {
+    char bytes[4];
+    out.append(bytes, encode_utf8(c, bytes));
+}
+
+/// Last entry of a table sorted by first code point that starts at or
+/// before c, nullptr when there is none
+template <typename T, size_t N>
+const T *find_entry(const T (&table)[N], uint32_t c) {
+    auto it = std::upper_bound(
+        std::begin(table), std::end(table), c,
+        [](uint32_t value, const T &entry) { return value < entry.first; });
+    return it == std::begin(table) ? nullptr : std::prev(it);
+}
+
+/// Letters, numbers and marks are part of tokens, everything else separates
+/// them
+bool lookup_token_char(uint32_t c) {
+    if (c < 0x80) {
+        return is_ascii_word(c);
+    }
+    const CodepointRange *range = find_entry(token_ranges, c);
+    return range != nullptr && c <= range->last;
+}
+
+/// Chinese, Japanese and Korean scripts, which do not separate words with
+/// spaces. Only asked about token characters
+bool is_cjk(uint32_t c) {
+    return (c >= 0x1100 && c <= 0x11FF) || (c >= 0x2E80 && c <= 0x2FDF) ||
+           (c >= 0x3005 && c <= 0x303C) || (c >= 0x3040 && c <= 0x318F) ||
+           (c >= 0x31A0 && c <= 0x31FF) || (c >= 0x3400 && c <= 0x4DBF) ||
+           (c >= 0x4E00 && c <= 0x9FFF) || (c >= 0xA960 && c <= 0xA97F) ||
+           (c >= 0xAC00 && c <= 0xD7FF) || (c >= 0xF900 && c <= 0xFAFF) ||
+           (c >= 0xFF66 && c <= 0xFF9F) || (c >= 0x1B000 && c <= 0x1B16F) ||
+           (c >= 0x20000 && c <= 0x3FFFF);
+}
+
+/// Combining marks removed with diacritics: the generic combining blocks,
+/// Cyrillic titlos, Hebrew points and Arabic vowel marks. Marks that are
+/// part of letters, e.g. the vowel signs of Indic scripts, are kept
+bool is_diacritic_mark(uint32_t c) {
+    return (c >= 0x300 && c <= 0x36F) || (c >= 0x483 && c <= 0x489) ||
+           (c >= 0x591 && c <= 0x5C7) || (c >= 0x64B && c <= 0x65F) ||
+           c == 0x670 || (c >= 0x1AB0 && c <= 0x1AFF) ||
+           (c >= 0x1DC0 && c <= 0x1DFF) || (c >= 0x20D0 && c <= 0x20FF) ||
+           (c >= 0xFE20 && c <= 0xFE2F);
+}
+
+bool is_variation_selector(uint32_t c) {
+    return (c >= 0xFE00 && c <= 0xFE0F) || (c >= 0xE0100 && c <= 0xE01EF);
+}
+
+uint32_t to_lower(uint32_t c) {
+    if (c < 0x80) {
+        return c >= 'A' && c <= 'Z' ? c + 32 : c;
+    }
+    const LowerRun *run = find_entry(lower_runs, c);
+    if (run != nullptr && c <= run->last &&
+        (c - run->first) % run->stride == 0) {
+        return static_cast<uint32_t>(static_cast<int32_t>(c) + run->delta);
+    }
+    return c;
+}
+
+uint32_t remove_diacritic(uint32_t c) {
+    auto it = std::lower_bound(std::begin(diacritic_bases),
+                               std::end(diacritic_bases), c,
+                               [](const DiacriticBase &entry, uint32_t value) {
+                                   return entry.codepoint < value;
+                               });
+    return it != std::end(diacritic_bases) && it->codepoint == c ? it->base
+                                                                   : c;
+}
+
+/// The code point a character is indexed as, 0 when it is dropped
+uint32_t lookup_fold(uint32_t c, bool remove_diacritics) {
+    if (c < 0x80) {
+        return c >= 'A' && c <= 'Z' ? c + 32 : c;
+    }
+    if (is_variation_selector(c)) {
+        return 0;
+    }
+    c = to_lower(c);
+    // Fullwidth digits and letters, already lowercased
+    if (c >= 0xFF10 && c <= 0xFF19) {
+        return c - 0xFF10 + '0';
+    }
+    if (c >= 0xFF41 && c <= 0xFF5A) {
+        return c - 0xFF41 + 'a';
+    }
+    if (remove_diacritics) {
+        if (is_diacritic_mark(c)) {
+            return 0;
+        }
+        c = remove_diacritic(c);
+    }
+    return c;
+}
+
+/// The scripts below U+0800 (Latin, Greek, Cyrillic, Armenian, Hebrew,
+/// Arabic) are looked up in a table instead of the sorted ones
+constexpr uint32_t table_limit = 0x800;
+
+struct TableEntry {
+    uint16_t folded;
+    uint16_t without_diacritics;
+    bool token;
+};
+
+const std::array<TableEntry, table_limit> &character_table() {
+    static const auto table = [] {
+        std::array<TableEntry, table_limit> entries{};
+        for (uint32_t c = 0; c < table_limit; c++) {
+            entries[c] = {static_cast<uint16_t>(lookup_fold(c, false)),
+                          static_cast<uint16_t>(lookup_fold(c, true)),
+                          lookup_token_char(c)};
+        }
+        return entries;
+    }();
+    return table;
+}
+
+bool is_token_char(uint32_t c) {
+    return c < table_limit ? character_table()[c].token
+                           : lookup_token_char(c);
+}
+
+uint32_t fold(uint32_t c, bool remove_diacritics) {
+    if (c < table_limit) {
+        const TableEntry &entry = character_table()[c];
+        return remove_diacritics ? entry.without_diacritics : entry.folded;
+    }
+    return lookup_fold(c, remove_diacritics);
+}
+
+/// The Porter stemming algorithm, as in the reference implementation
+/// published by Martin Porter, on a lowercase ASCII word
+class PorterStemmer {
+  public:
+    explicit PorterStemmer(std::string &word)
+        : b(word), k(static_cast<int>(word.size()) - 1) {}
+
+    void stem() {
+        // Words of one or two letters are left alone
+        if (k <= 1) {
+            return;
+        }
+        step1ab();
+        if (k > 0) {
+            step1c();
+            step2();
+            step3();
+            step4();
+            step5();
+        }
+        b.resize(k + 1);
+    }
+
+  private:
+    std::string &b;
+    /// b[0..k] is the word being stemmed, b[0..j] the stem of the suffix
+    /// ends() matched
+    int k;
+    int j = 0;
+
+    bool cons(int i) const {
+        switch (b[i]) {
+        case 'a':
+        case 'e':
+        case 'i':
+        case 'o':
+        case 'u':
+            return false;
+        case 'y':
+            return i == 0 || !cons(i - 1);
+        default:
+            return true;
+        }
+    }
+
+    /// Number of vowel-consonant sequences in b[0..j]
+    int m() const {
+        int n = 0;
+        int i = 0;
+        while (true) {
+            if (i > j) {
+                return n;
+            }
+            if (!cons(i)) {
+                break;
+            }
+            i++;
+        }
+        i++;
+        while (true) {
+            while (true) {
+                if (i > j) {
+                    return n;
+                }
+                if (cons(i)) {
+                    break;
+                }
+                i++;
+            }
+            i++;
+            n++;
+            while (true) {
+                if (i > j) {
+                    return n;
+                }
+                if (!cons(i)) {
+                    break;
+                }
+                i++;
+            }
+            i++;
+        }
+    }
+
+    bool vowel_in_stem() const {
+        for (int i = 0; i <= j; i++) {
+            if (!cons(i)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool double_consonant(int i) const {
+        return i >= 1 && b[i] == b[i - 1] && cons(i);
+    }
+
+    /// Whether b[i - 2..i] is consonant-vowel-consonant and the last one is
+    /// not w, x or y, e.g. hop but not snow
+    bool cvc(int i) const {
+        if (i < 2 || !cons(i) || cons(i - 1) || !cons(i - 2)) {
+            return false;
+        }
+        return b[i] != 'w' && b[i] != 'x' && b[i] != 'y';
+    }
+
+    template <size_t N> bool ends(const char (&suffix)[N]) {
+        constexpr int length = N - 1;
+        if (length > k + 1 || b[k] != suffix[length - 1] ||
+            memcmp(&b[k - length + 1], suffix, length) != 0) {
+            return false;
+        }
+        j = k - length;
+        return true;
+    }
+
+    template <size_t N> void set_to(const char (&suffix)[N]) {
+        constexpr int length = N - 1;
+        if (j + length >= static_cast<int>(b.size())) {
+            b.resize(j + length + 1);
+        }
+        memcpy(&b[j + 1], suffix, length);
+        k = j + length;
+    }
+
+    template <size_t N> void replace(const char (&suffix)[N]) {
+        if (m() > 0) {
+            set_to(suffix);
+        }
+    }
+
+    /// Plurals and -ed or -ing
+    void step1ab() {
+        if (b[k] == 's') {
+            if (ends("sses")) {
+                k -= 2;
+            } else if (ends("ies")) {
+                set_to("i");
+            } else if (b[k - 1] != 's') {
+                k--;
+            }
+        }
+        if (ends("eed")) {
+            if (m() > 0) {
+                k--;
+            }
+        } else if ((ends("ed") || ends("ing")) && vowel_in_stem()) {
+            k = j;
+            if (ends("at")) {
+                set_to("ate");
+            } else if (ends("bl")) {
+                set_to("ble");
+            } else if (ends("iz")) {
+                set_to("ize");
+            } else if (double_consonant(k)) {
+                if (b[k] != 'l' && b[k] != 's' && b[k] != 'z') {
+                    k--;
+                }
+            } else if (m() == 1 && cvc(k)) {
+                set_to("e");
+            }
+        }
+    }
+
+    /// Terminal y to i when there is another vowel in the stem
+    void step1c() {
+        if (ends("y") && vowel_in_stem()) {
+            b[k] = 'i';
+        }
+    }
+
+    /// Double suffixes to single ones, e.g. -ization to -ize
+    void step2() {
+        switch (b[k - 1]) {
+        case 'a':
+            if (ends("ational")) {
+                replace("ate");
+            } else if (ends("tional")) {
+                replace("tion");
+            }
+            break;
+        case 'c':
+            if (ends("enci")) {
+                replace("ence");
+            } else if (ends("anci")) {
+                replace("ance");
+            }
+            break;
+        case 'e':
+            if (ends("izer")) {
+                replace("ize");
+            }
+            break;
+        case 'l':
+            if (ends("bli")) {
+                replace("ble");
+            } else if (ends("alli")) {
+                replace("al");
+            } else if (ends("entli")) {
+                replace("ent");
+            } else if (ends("eli")) {
+                replace("e");
+            } else if (ends("ousli")) {
+                replace("ous");
+            }
+            break;
+        case 'o':
+            if (ends("ization")) {
+                replace("ize");
+            } else if (ends("ation") || ends("ator")) {
+                replace("ate");
+            }
+            break;
+        case 's':
+            if (ends("alism")) {
+                replace("al");
+            } else if (ends("iveness")) {
+                replace("ive");
+            } else if (ends("fulness")) {
+                replace("ful");
+            } else if (ends("ousness")) {
+                replace("ous");
+            }
+            break;
+        case 't':
+            if (ends("aliti")) {
+                replace("al");
+            } else if (ends("iviti")) {
+                replace("ive");
+            } else if (ends("biliti")) {
+                replace("ble");
+            }
+            break;
+        case 'g':
+            if (ends("logi")) {
+                replace("log");
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    /// -ic-, -full, -ness and the like
+    void step3() {
+        switch (b[k]) {
+        case 'e':
+            if (ends("icate")) {
+                replace("ic");
+            } else if (ends("ative")) {
+                replace("");
+            } else if (ends("alize")) {
+                replace("al");
+            }
+            break;
+        case 'i':
+            if (ends("iciti")) {
+                replace("ic");
+            }
+            break;
+        case 'l':
+            if (ends("ical")) {
+                replace("ic");
+            } else if (ends("ful")) {
+                replace("");
+            }
+            break;
+        case 's':
+            if (ends("ness")) {
+                replace("");
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    /// -ant, -ence and the like when the stem is long enough
+    void step4() {
+        bool matched = false;
+        switch (b[k - 1]) {
+        case 'a':
+            matched = ends("al");
+            break;
+        case 'c':
+            matched = ends("ance") || ends("ence");
+            break;
+        case 'e':
+            matched = ends("er");
+            break;
+        case 'i':
+            matched = ends("ic");
+            break;
+        case 'l':
+            matched = ends("able") || ends("ible");
+            break;
+        case 'n':
+            matched = ends("ant") || ends("ement") || ends("ment") ||
+                      ends("ent");
+            break;
+        case 'o':
+            matched = (ends("ion") && j >= 0 && (b[j] == 's' || b[j] == 't')) ||
+                      ends("ou");
+            break;
+        case 's':
+            matched = ends("ism");
+            break;
+        case 't':
+            matched = ends("ate") || ends("iti");
+            break;
+        case 'u':
+            matched = ends("ous");
+            break;
+        case 'v':
+            matched = ends("ive");
+            break;
+        case 'z':
+            matched = ends("ize");
+            break;
+        default:
+            break;
+        }
+        if (matched && m() > 1) {
+            k = j;
+        }
+    }
+
+    /// Final -e and -ll
+    void step5() {
+        j = k;
+        if (b[k] == 'e') {
+            int measure = m();
+            if (measure > 1 || (measure == 1 && !cvc(k - 1))) {
+                k--;
+            }
+        }
+        if (b[k] == 'l' && double_consonant(k) && m() > 1) {
+            k--;
+        }
+    }
+};
+
+bool is_ascii_lowercase_word(const std::string &token) {
+    return std::all_of(token.begin(), token.end(),
+                       [](char c) { return c >= 'a' && c <= 'z'; });
+}
+
+struct Character {
+    size_t start;
+    size_t end;
+    uint32_t folded;
+};
+
+/// Emits overlapping bigrams of a run of CJK characters, a character alone
+/// is emitted as is. In documents every character is also emitted at the
+/// position of a bigram it is part of, so single character queries match
+int emit_cjk_run(const std::vector<Character> &run, int flags, void *context,
+                 TokenCallback callback) {
+    std::string token;
+    bool document = (flags & FTS5_TOKENIZE_DOCUMENT) != 0;
+    for (size_t i = 0; i < run.size(); i++) {
+        int rc = SQLITE_OK;
+        if (i + 1 < run.size()) {
+            token.clear();
+            append_utf8(token, run[i].folded);
+            append_utf8(token, run[i + 1].folded);
+            rc = callback(context, 0, token.data(),
+                          static_cast<int>(token.size()),
+                          static_cast<int>(run[i].start),
+                          static_cast<int>(run[i + 1].end));
+        }
+        if (rc == SQLITE_OK && (run.size() == 1 || document)) {
+            token.clear();
+            append_utf8(token, run[i].folded);
+            int colocated = run.size() > 1 ? FTS5_TOKEN_COLOCATED : 0;
+            rc = callback(context, colocated, token.data(),
+                          static_cast<int>(token.size()),
+                          static_cast<int>(run[i].start),
+                          static_cast<int>(run[i].end));
+        }
+        if (rc != SQLITE_OK) {
+            return rc;
+        }
+    }
+    return SQLITE_OK;
+}
+
+int tokenize_words(const Tokenizer &tokenizer, void *context, int flags,
+                   const unsigned char *text, size_t size,
+                   TokenCallback callback) {
+    bool split_cjk = tokenizer.kind == TokenizerKind::cjk;
+    std::string token;
+    std::vector<Character> cjk_run;
+    size_t i = 0;
+    while (i < size) {
+        size_t start = i;
+        if (text[i] < 0x80) {
+            if (!is_ascii_word(text[i])) {
+                i++;
+                continue;
+            }
+        } else {
+            size_t next = i;
+            uint32_t c = decode_utf8(text, size, next);
+            if (!is_token_char(c)) {
+                i = next;
+                continue;
+            }
+            if (split_cjk && is_cjk(c)) {
+                cjk_run.clear();
+                while (i < size) {
+                    next = i;
+                    c = decode_utf8(text, size, next);
+                    if (!is_token_char(c) || !is_cjk(c)) {
+                        break;
+                    }
+                    uint32_t folded = fold(c, tokenizer.remove_diacritics);
+                    if (folded != 0) {
+                        cjk_run.push_back({i, next, folded});
+                    } else if (!cjk_run.empty()) {
+                        cjk_run.back().end = next;
+                    }
+                    i = next;
+                }
+                int rc = emit_cjk_run(cjk_run, flags, context, callback);
+                if (rc != SQLITE_OK) {
+                    return rc;
+                }
+                continue;
+            }
+        }
+
+        token.clear();
+        while (i < size) {
+            if (text[i] < 0x80) {
+                size_t run = ascii_word_run(text + i, size - i);
+                if (run == 0) {
+                    break;
+                }
+                append_ascii_lower(token, text + i, run, size - i);
+                i += run;
+                continue;
+            }
+            size_t next = i;
+            uint32_t c = decode_utf8(text, size, next);
+            if (!is_token_char(c) || (split_cjk && is_cjk(c))) {
+                break;
+            }
+            uint32_t folded = fold(c, tokenizer.remove_diacritics);
+            if (folded != 0) {
+                append_utf8(token, folded);
+            }
+            i = next;
+        }
+        if (token.empty()) {
+            continue;
+        }
+        if (tokenizer.kind == TokenizerKind::porter &&
+            is_ascii_lowercase_word(token)) {
+            PorterStemmer(token).stem();
+        }
+        int rc = callback(context, 0, token.data(),
+                          static_cast<int>(token.size()),
+                          static_cast<int>(start), static_cast<int>(i));
+        if (rc != SQLITE_OK) {
+            return rc;
+        }
+    }
+    return SQLITE_OK;
+}
+
+/// Every sequence of three characters, separators included, like the
+/// trigram tokenizer of FTS5 but with Unicode case folding
+int tokenize_trigrams(const Tokenizer &tokenizer, void *context,
+                      const unsigned char *text, size_t size,
+                      TokenCallback callback) {
+    std::array<Character, 3> window{};
+    size_t count = 0;
+    char token[12];
+    size_t i = 0;
+    while (i < size) {
+        size_t start = i;
+        uint32_t folded;
+        if (text[i] < 0x80) {
+            folded = static_cast<unsigned char>(ascii_lower(text[i]));
+            i++;
+        } else {
+            folded = fold(decode_utf8(text, size, i),
+                          tokenizer.remove_diacritics);
+        }
+        if (folded == 0) {
+            if (count > 0) {
+                window[std::min<size_t>(count, 3) - 1].end = i;
+            }
+            continue;
+        }
+        if (count >= 3) {
+            window[0] = window[1];
+            window[1] = window[2];
+        }
+        window[std::min<size_t>(count, 2)] = {start, i, folded};
+        count++;
+        if (count < 3) {
+            continue;
+        }
+        size_t length = 0;
+        for (const Character &character : window) {
+            length += encode_utf8(character.folded, token + length);
+        }
+        int rc = callback(context, 0, token, static_cast<int>(length),
+                          static_cast<int>(window[0].start),
+                          static_cast<int>(window[2].end));
+        if (rc != SQLITE_OK) {
+            return rc;
+        }
+    }
+    return SQLITE_OK;
+}
+
+int create_tokenizer(void *user_data, const char **args, int count,
+                     Fts5Tokenizer **out) {
+    auto *tokenizer = new (std::nothrow)
+        Tokenizer{*static_cast<TokenizerKind *>(user_data)};
+    if (tokenizer == nullptr) {
+        return SQLITE_NOMEM;
+    }
+    for (int i = 0; i < count; i += 2) {
+        if (i + 1 < count && strcmp(args[i], "remove_diacritics") == 0 &&
+            (strcmp(args[i + 1], "0") == 0 || strcmp(args[i + 1], "1") == 0)) {
+            tokenizer->remove_diacritics = args[i + 1][0] == '1';
+        } else {
+            delete tokenizer;
+            return SQLITE_ERROR;
+        }
+    }
+    *out = reinterpret_cast<Fts5Tokenizer *>(tokenizer);
+    return SQLITE_OK;
+}
+
+void delete_tokenizer(Fts5Tokenizer *tokenizer) {
+    delete reinterpret_cast<Tokenizer *>(tokenizer);
+}
+
+int tokenize(Fts5Tokenizer *fts5_tokenizer, void *context, int flags,
+             const char *text, int size, TokenCallback callback) {
+    if (text == nullptr || size <= 0) {
+        return SQLITE_OK;
+    }
+    const auto &tokenizer = *reinterpret_cast<Tokenizer *>(fts5_tokenizer);
+    const auto *bytes = reinterpret_cast<const unsigned char *>(text);
+    try {
+        if (tokenizer.kind == TokenizerKind::trigram) {
+            return tokenize_trigrams(tokenizer, context, bytes, size,
+                                     callback);
+        }
+        return tokenize_words(tokenizer, context, flags, bytes, size,
+                              callback);
+    } catch (const std::bad_alloc &) {
+        return SQLITE_NOMEM;
+    }
+}
+
+fts5_api *fts5_api_from_db(sqlite3 *db) {
+    fts5_api *api = nullptr;
+    sqlite3_stmt *statement = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT fts5(?1)", -1, &statement, nullptr) ==
+        SQLITE_OK) {
+        sqlite3_bind_pointer(statement, 1, &api, "fts5_api_ptr", nullptr);
+        sqlite3_step(statement);
+    }
+    sqlite3_finalize(statement);
+    return api;
+}
+
+int register_tokenizer(sqlite3 *db, const char *name, TokenizerKind *kind) {
+    fts5_api *api = fts5_api_from_db(db);
+    if (api == nullptr) {
+        return SQLITE_ERROR;
+    }
+    fts5_tokenizer tokenizer = {create_tokenizer, delete_tokenizer, tokenize};
+    return api->xCreateTokenizer(api, name, kind, &tokenizer, nullptr);
+}
+
+} // namespace
+
+int opsqlite_op_unicode_init(sqlite3 *db, [[maybe_unused]] char **error,
+                             [[maybe_unused]] sqlite3_api_routines const *api) {
+    return register_tokenizer(db, "op_unicode", &unicode_kind);
+}
+
+int opsqlite_op_porter_init(sqlite3 *db, [[maybe_unused]] char **error,
+                            [[maybe_unused]] sqlite3_api_routines const *api) {
+    return register_tokenizer(db, "op_porter", &porter_kind);
+}
+
+int opsqlite_op_trigram_init(sqlite3 *db, [[maybe_unused]] char **error,
+                             [[maybe_unused]] sqlite3_api_routines const *api) {
+    return register_tokenizer(db, "op_trigram", &trigram_kind);
+}
+
+int opsqlite_op_cjk_init(sqlite3 *db, [[maybe_unused]] char **error,
+                         [[maybe_unused]] sqlite3_api_routines const *api) {
+    return register_tokenizer(db, "op_cjk", &cjk_kind);
+}
+
+} // namespace opsqlite
+
+#endif
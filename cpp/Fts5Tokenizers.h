@@ -0,0 +1,30 @@
+#pragma once
+
+#ifndef OP_SQLITE_USE_LIBSQL
+
+#include <sqlite3.h>
+
+namespace opsqlite {
+
+/// FTS5 tokenizers shipped with op-sqlite. They are registered like user
+/// tokenizers, by listing their names (op_unicode, op_porter, op_trigram,
+/// op_cjk) in the tokenizers of the op-sqlite config.
+///
+/// op_unicode splits on Unicode punctuation, symbols and spaces, folds case
+/// and, unless created with `remove_diacritics 0`, removes diacritics.
+/// op_porter does the same and stems English words with the Porter
+/// algorithm. op_trigram indexes every sequence of three characters for
+/// substring search. op_cjk indexes runs of Chinese, Japanese and Korean
+/// characters as overlapping bigrams and everything else as op_unicode
+int opsqlite_op_unicode_init(sqlite3 *db, char **error,
+                             sqlite3_api_routines const *api);
+int opsqlite_op_porter_init(sqlite3 *db, char **error,
+                            sqlite3_api_routines const *api);
+int opsqlite_op_trigram_init(sqlite3 *db, char **error,
+                             sqlite3_api_routines const *api);
+int opsqlite_op_cjk_init(sqlite3 *db, char **error,
+                         sqlite3_api_routines const *api);
+
+} // namespace opsqlite
+
+#endif
@@ -0,0 +1,281 @@
+#pragma once
+
+// Character tables for the built-in FTS5 tokenizers, generated from the
+// Unicode 14 character database:
+// - token_ranges: non-ASCII letters, numbers and marks (categories L, N, M),
+//   gaps of unassigned code points are merged into the surrounding ranges
+// - lower_runs: simple lowercase mappings, plus final sigma, long s and
+//   dotted capital I, as runs of code points sharing the same offset
+// - diacritic_bases: the base letter of lowercase Latin and Greek letters
+//   whose canonical decomposition only adds combining marks, plus a few
+//   letters with strokes and the Cyrillic yo
+
+#include <cstdint>
+
+namespace opsqlite::fts5_unicode {
+
+struct CodepointRange {
+    uint32_t first;
+    uint32_t last;
+};
+
+struct LowerRun {
+    uint32_t first;
+    uint32_t last;
+    int32_t delta;
+    uint32_t stride;
+};
+
+struct DiacriticBase {
+    uint32_t codepoint;
+    uint32_t base;
+};
+
+constexpr CodepointRange token_ranges[] = {
+    {0xAA, 0xAA}, {0xB2, 0xB3}, {0xB5, 0xB5}, {0xB9, 0xBA}, {0xBC, 0xBE},
+    {0xC0, 0xD6}, {0xD8, 0xF6}, {0xF8, 0x2C1}, {0x2C6, 0x2D1}, {0x2E0, 0x2E4},
+    {0x2EC, 0x2EC}, {0x2EE, 0x2EE}, {0x300, 0x374}, {0x376, 0x37D},
+    {0x37F, 0x37F}, {0x386, 0x386}, {0x388, 0x3F5}, {0x3F7, 0x481},
+    {0x483, 0x559}, {0x560, 0x588}, {0x591, 0x5BD}, {0x5BF, 0x5BF},
+    {0x5C1, 0x5C2}, {0x5C4, 0x5C5}, {0x5C7, 0x5F2}, {0x610, 0x61A},
+    {0x620, 0x669}, {0x66E, 0x6D3}, {0x6D5, 0x6DC}, {0x6DF, 0x6E8},
+    {0x6EA, 0x6FC}, {0x6FF, 0x6FF}, {0x710, 0x7F5}, {0x7FA, 0x7FD},
+    {0x800, 0x82D}, {0x840, 0x85B}, {0x860, 0x887}, {0x889, 0x88E},
+    {0x898, 0x8E1}, {0x8E3, 0x963}, {0x966, 0x96F}, {0x971, 0x9F1},
+    {0x9F4, 0x9F9}, {0x9FC, 0x9FC}, {0x9FE, 0xA75}, {0xA81, 0xAEF},
+    {0xAF9, 0xB6F}, {0xB71, 0xBF2}, {0xC00, 0xC6F}, {0xC78, 0xC7E},
+    {0xC80, 0xC83}, {0xC85, 0xD4E}, {0xD54, 0xD78}, {0xD7A, 0xDF3},
+    {0xE01, 0xE3A}, {0xE40, 0xE4E}, {0xE50, 0xE59}, {0xE81, 0xF00},
+    {0xF18, 0xF19}, {0xF20, 0xF33}, {0xF35, 0xF35}, {0xF37, 0xF37},
+    {0xF39, 0xF39}, {0xF3E, 0xF84}, {0xF86, 0xFBC}, {0xFC6, 0xFC6},
+    {0x1000, 0x1049}, {0x1050, 0x109D}, {0x10A0, 0x10FA}, {0x10FC, 0x135F},
+    {0x1369, 0x138F}, {0x13A0, 0x13FD}, {0x1401, 0x166C}, {0x166F, 0x167F},
+    {0x1681, 0x169A}, {0x16A0, 0x16EA}, {0x16EE, 0x1734}, {0x1740, 0x17D3},
+    {0x17D7, 0x17D7}, {0x17DC, 0x17F9}, {0x180B, 0x180D}, {0x180F, 0x193B},
+    {0x1946, 0x19DA}, {0x1A00, 0x1A1B}, {0x1A20, 0x1A99}, {0x1AA7, 0x1AA7},
+    {0x1AB0, 0x1B59}, {0x1B6B, 0x1B73}, {0x1B80, 0x1BF3}, {0x1C00, 0x1C37},
+    {0x1C40, 0x1C7D}, {0x1C80, 0x1CBF}, {0x1CD0, 0x1CD2}, {0x1CD4, 0x1FBC},
+    {0x1FBE, 0x1FBE}, {0x1FC2, 0x1FCC}, {0x1FD0, 0x1FDB}, {0x1FE0, 0x1FEC},
+    {0x1FF2, 0x1FFC}, {0x2070, 0x2079}, {0x207F, 0x2089}, {0x2090, 0x209C},
+    {0x20D0, 0x20F0}, {0x2102, 0x2102}, {0x2107, 0x2107}, {0x210A, 0x2113},
+    {0x2115, 0x2115}, {0x2119, 0x211D}, {0x2124, 0x2124}, {0x2126, 0x2126},
+    {0x2128, 0x2128}, {0x212A, 0x212D}, {0x212F, 0x2139}, {0x213C, 0x213F},
+    {0x2145, 0x2149}, {0x214E, 0x214E}, {0x2150, 0x2189}, {0x2460, 0x249B},
+    {0x24EA, 0x24FF}, {0x2776, 0x2793}, {0x2C00, 0x2CE4}, {0x2CEB, 0x2CF3},
+    {0x2CFD, 0x2CFD}, {0x2D00, 0x2D6F}, {0x2D7F, 0x2DFF}, {0x2E2F, 0x2E2F},
+    {0x3005, 0x3007}, {0x3021, 0x302F}, {0x3031, 0x3035}, {0x3038, 0x303C},
+    {0x3041, 0x309A}, {0x309D, 0x309F}, {0x30A1, 0x30FA}, {0x30FC, 0x318E},
+    {0x3192, 0x3195}, {0x31A0, 0x31BF}, {0x31F0, 0x31FF}, {0x3220, 0x3229},
+    {0x3248, 0x324F}, {0x3251, 0x325F}, {0x3280, 0x3289}, {0x32B1, 0x32BF},
+    {0x3400, 0x4DBF}, {0x4E00, 0xA48C}, {0xA4D0, 0xA4FD}, {0xA500, 0xA60C},
+    {0xA610, 0xA672}, {0xA674, 0xA67D}, {0xA67F, 0xA6F1}, {0xA717, 0xA71F},
+    {0xA722, 0xA788}, {0xA78B, 0xA827}, {0xA82C, 0xA835}, {0xA840, 0xA873},
+    {0xA880, 0xA8C5}, {0xA8D0, 0xA8F7}, {0xA8FB, 0xA8FB}, {0xA8FD, 0xA92D},
+    {0xA930, 0xA953}, {0xA960, 0xA9C0}, {0xA9CF, 0xA9D9}, {0xA9E0, 0xAA59},
+    {0xAA60, 0xAA76}, {0xAA7A, 0xAADD}, {0xAAE0, 0xAAEF}, {0xAAF2, 0xAB5A},
+    {0xAB5C, 0xAB69}, {0xAB70, 0xABEA}, {0xABEC, 0xD7FB}, {0xF900, 0xFB28},
+    {0xFB2A, 0xFBB1}, {0xFBD3, 0xFD3D}, {0xFD50, 0xFDC7}, {0xFDF0, 0xFDFB},
+    {0xFE00, 0xFE0F}, {0xFE20, 0xFE2F}, {0xFE70, 0xFEFC}, {0xFF10, 0xFF19},
+    {0xFF21, 0xFF3A}, {0xFF41, 0xFF5A}, {0xFF66, 0xFFDC}, {0x10000, 0x100FA},
+    {0x10107, 0x10133}, {0x10140, 0x10178}, {0x1018A, 0x1018B},
+    {0x101FD, 0x1039D}, {0x103A0, 0x103CF}, {0x103D1, 0x10563},
+    {0x10570, 0x10855}, {0x10858, 0x10876}, {0x10879, 0x1091B},
+    {0x10920, 0x10939}, {0x10980, 0x10A48}, {0x10A60, 0x10A7E},
+    {0x10A80, 0x10AC7}, {0x10AC9, 0x10AEF}, {0x10B00, 0x10B35},
+    {0x10B40, 0x10B91}, {0x10BA9, 0x10EAC}, {0x10EB0, 0x10F54},
+    {0x10F70, 0x10F85}, {0x10FB0, 0x11046}, {0x11052, 0x110BA},
+    {0x110C2, 0x110C2}, {0x110D0, 0x1113F}, {0x11144, 0x11173},
+    {0x11176, 0x111C4}, {0x111C9, 0x111CC}, {0x111CE, 0x111DA},
+    {0x111DC, 0x111DC}, {0x111E1, 0x11237}, {0x1123E, 0x112A8},
+    {0x112B0, 0x1144A}, {0x11450, 0x11459}, {0x1145E, 0x114C5},
+    {0x114C7, 0x115C0}, {0x115D8, 0x11640}, {0x11644, 0x11659},
+    {0x11680, 0x116B8}, {0x116C0, 0x1173B}, {0x11740, 0x1183A},
+    {0x118A0, 0x11943}, {0x11950, 0x119E1}, {0x119E3, 0x11A3E},
+    {0x11A47, 0x11A99}, {0x11A9D, 0x11A9D}, {0x11AB0, 0x11C40},
+    {0x11C50, 0x11C6C}, {0x11C72, 0x11EF6}, {0x11FB0, 0x11FD4},
+    {0x12000, 0x1246E}, {0x12480, 0x12FF0}, {0x13000, 0x1342E},
+    {0x14400, 0x16A69}, {0x16A70, 0x16AF4}, {0x16B00, 0x16B36},
+    {0x16B40, 0x16B43}, {0x16B50, 0x16E96}, {0x16F00, 0x16FE1},
+    {0x16FE3, 0x1BC99}, {0x1BC9D, 0x1BC9E}, {0x1CF00, 0x1CF46},
+    {0x1D165, 0x1D169}, {0x1D16D, 0x1D172}, {0x1D17B, 0x1D182},
+    {0x1D185, 0x1D18B}, {0x1D1AA, 0x1D1AD}, {0x1D242, 0x1D244},
+    {0x1D2E0, 0x1D2F3}, {0x1D360, 0x1D6C0}, {0x1D6C2, 0x1D6DA},
+    {0x1D6DC, 0x1D6FA}, {0x1D6FC, 0x1D714}, {0x1D716, 0x1D734},
+    {0x1D736, 0x1D74E}, {0x1D750, 0x1D76E}, {0x1D770, 0x1D788},
+    {0x1D78A, 0x1D7A8}, {0x1D7AA, 0x1D7C2}, {0x1D7C4, 0x1D7FF},
+    {0x1DA00, 0x1DA36}, {0x1DA3B, 0x1DA6C}, {0x1DA75, 0x1DA75},
+    {0x1DA84, 0x1DA84}, {0x1DA9B, 0x1E14E}, {0x1E290, 0x1E2F9},
+    {0x1E7E0, 0x1E959}, {0x1EC71, 0x1ECAB}, {0x1ECAD, 0x1ECAF},
+    {0x1ECB1, 0x1ED2D}, {0x1ED2F, 0x1EEBB}, {0x1F100, 0x1F10C},
+    {0x1FBF0, 0x3134A},
+};
+
+constexpr LowerRun lower_runs[] = {
+    {0xC0, 0xD6, 32, 1}, {0xD8, 0xDE, 32, 1}, {0x100, 0x12E, 1, 2},
+    {0x130, 0x130, -199, 1}, {0x132, 0x136, 1, 2}, {0x139, 0x147, 1, 2},
+    {0x14A, 0x176, 1, 2}, {0x178, 0x178, -121, 1}, {0x179, 0x17D, 1, 2},
+    {0x17F, 0x17F, -268, 1}, {0x181, 0x181, 210, 1}, {0x182, 0x184, 1, 2},
+    {0x186, 0x186, 206, 1}, {0x187, 0x187, 1, 1}, {0x189, 0x18A, 205, 1},
+    {0x18B, 0x18B, 1, 1}, {0x18E, 0x18E, 79, 1}, {0x18F, 0x18F, 202, 1},
+    {0x190, 0x190, 203, 1}, {0x191, 0x191, 1, 1}, {0x193, 0x193, 205, 1},
+    {0x194, 0x194, 207, 1}, {0x196, 0x196, 211, 1}, {0x197, 0x197, 209, 1},
+    {0x198, 0x198, 1, 1}, {0x19C, 0x19C, 211, 1}, {0x19D, 0x19D, 213, 1},
+    {0x19F, 0x19F, 214, 1}, {0x1A0, 0x1A4, 1, 2}, {0x1A6, 0x1A6, 218, 1},
+    {0x1A7, 0x1A7, 1, 1}, {0x1A9, 0x1A9, 218, 1}, {0x1AC, 0x1AC, 1, 1},
+    {0x1AE, 0x1AE, 218, 1}, {0x1AF, 0x1AF, 1, 1}, {0x1B1, 0x1B2, 217, 1},
+    {0x1B3, 0x1B5, 1, 2}, {0x1B7, 0x1B7, 219, 1}, {0x1B8, 0x1B8, 1, 1},
+    {0x1BC, 0x1BC, 1, 1}, {0x1C4, 0x1C4, 2, 1}, {0x1C5, 0x1C5, 1, 1},
+    {0x1C7, 0x1C7, 2, 1}, {0x1C8, 0x1C8, 1, 1}, {0x1CA, 0x1CA, 2, 1},
+    {0x1CB, 0x1DB, 1, 2}, {0x1DE, 0x1EE, 1, 2}, {0x1F1, 0x1F1, 2, 1},
+    {0x1F2, 0x1F4, 1, 2}, {0x1F6, 0x1F6, -97, 1}, {0x1F7, 0x1F7, -56, 1},
+    {0x1F8, 0x21E, 1, 2}, {0x220, 0x220, -130, 1}, {0x222, 0x232, 1, 2},
+    {0x23A, 0x23A, 10795, 1}, {0x23B, 0x23B, 1, 1}, {0x23D, 0x23D, -163, 1},
+    {0x23E, 0x23E, 10792, 1}, {0x241, 0x241, 1, 1}, {0x243, 0x243, -195, 1},
+    {0x244, 0x244, 69, 1}, {0x245, 0x245, 71, 1}, {0x246, 0x24E, 1, 2},
+    {0x370, 0x372, 1, 2}, {0x376, 0x376, 1, 1}, {0x37F, 0x37F, 116, 1},
+    {0x386, 0x386, 38, 1}, {0x388, 0x38A, 37, 1}, {0x38C, 0x38C, 64, 1},
+    {0x38E, 0x38F, 63, 1}, {0x391, 0x3A1, 32, 1}, {0x3A3, 0x3AB, 32, 1},
+    {0x3C2, 0x3C2, 1, 1}, {0x3CF, 0x3CF, 8, 1}, {0x3D8, 0x3EE, 1, 2},
+    {0x3F4, 0x3F4, -60, 1}, {0x3F7, 0x3F7, 1, 1}, {0x3F9, 0x3F9, -7, 1},
+    {0x3FA, 0x3FA, 1, 1}, {0x3FD, 0x3FF, -130, 1}, {0x400, 0x40F, 80, 1},
+    {0x410, 0x42F, 32, 1}, {0x460, 0x480, 1, 2}, {0x48A, 0x4BE, 1, 2},
+    {0x4C0, 0x4C0, 15, 1}, {0x4C1, 0x4CD, 1, 2}, {0x4D0, 0x52E, 1, 2},
+    {0x531, 0x556, 48, 1}, {0x10A0, 0x10C5, 7264, 1}, {0x10C7, 0x10C7, 7264, 1},
+    {0x10CD, 0x10CD, 7264, 1}, {0x13A0, 0x13EF, 38864, 1},
+    {0x13F0, 0x13F5, 8, 1}, {0x1C90, 0x1CBA, -3008, 1},
+    {0x1CBD, 0x1CBF, -3008, 1}, {0x1E00, 0x1E94, 1, 2},
+    {0x1E9E, 0x1E9E, -7615, 1}, {0x1EA0, 0x1EFE, 1, 2}, {0x1F08, 0x1F0F, -8, 1},
+    {0x1F18, 0x1F1D, -8, 1}, {0x1F28, 0x1F2F, -8, 1}, {0x1F38, 0x1F3F, -8, 1},
+    {0x1F48, 0x1F4D, -8, 1}, {0x1F59, 0x1F5F, -8, 2}, {0x1F68, 0x1F6F, -8, 1},
+    {0x1F88, 0x1F8F, -8, 1}, {0x1F98, 0x1F9F, -8, 1}, {0x1FA8, 0x1FAF, -8, 1},
+    {0x1FB8, 0x1FB9, -8, 1}, {0x1FBA, 0x1FBB, -74, 1}, {0x1FBC, 0x1FBC, -9, 1},
+    {0x1FC8, 0x1FCB, -86, 1}, {0x1FCC, 0x1FCC, -9, 1}, {0x1FD8, 0x1FD9, -8, 1},
+    {0x1FDA, 0x1FDB, -100, 1}, {0x1FE8, 0x1FE9, -8, 1},
+    {0x1FEA, 0x1FEB, -112, 1}, {0x1FEC, 0x1FEC, -7, 1},
+    {0x1FF8, 0x1FF9, -128, 1}, {0x1FFA, 0x1FFB, -126, 1},
+    {0x1FFC, 0x1FFC, -9, 1}, {0x2126, 0x2126, -7517, 1},
+    {0x212A, 0x212A, -8383, 1}, {0x212B, 0x212B, -8262, 1},
+    {0x2132, 0x2132, 28, 1}, {0x2160, 0x216F, 16, 1}, {0x2183, 0x2183, 1, 1},
+    {0x24B6, 0x24CF, 26, 1}, {0x2C00, 0x2C2F, 48, 1}, {0x2C60, 0x2C60, 1, 1},
+    {0x2C62, 0x2C62, -10743, 1}, {0x2C63, 0x2C63, -3814, 1},
+    {0x2C64, 0x2C64, -10727, 1}, {0x2C67, 0x2C6B, 1, 2},
+    {0x2C6D, 0x2C6D, -10780, 1}, {0x2C6E, 0x2C6E, -10749, 1},
+    {0x2C6F, 0x2C6F, -10783, 1}, {0x2C70, 0x2C70, -10782, 1},
+    {0x2C72, 0x2C72, 1, 1}, {0x2C75, 0x2C75, 1, 1}, {0x2C7E, 0x2C7F, -10815, 1},
+    {0x2C80, 0x2CE2, 1, 2}, {0x2CEB, 0x2CED, 1, 2}, {0x2CF2, 0x2CF2, 1, 1},
+    {0xA640, 0xA66C, 1, 2}, {0xA680, 0xA69A, 1, 2}, {0xA722, 0xA72E, 1, 2},
+    {0xA732, 0xA76E, 1, 2}, {0xA779, 0xA77B, 1, 2}, {0xA77D, 0xA77D, -35332, 1},
+    {0xA77E, 0xA786, 1, 2}, {0xA78B, 0xA78B, 1, 1}, {0xA78D, 0xA78D, -42280, 1},
+    {0xA790, 0xA792, 1, 2}, {0xA796, 0xA7A8, 1, 2}, {0xA7AA, 0xA7AA, -42308, 1},
+    {0xA7AB, 0xA7AB, -42319, 1}, {0xA7AC, 0xA7AC, -42315, 1},
+    {0xA7AD, 0xA7AD, -42305, 1}, {0xA7AE, 0xA7AE, -42308, 1},
+    {0xA7B0, 0xA7B0, -42258, 1}, {0xA7B1, 0xA7B1, -42282, 1},
+    {0xA7B2, 0xA7B2, -42261, 1}, {0xA7B3, 0xA7B3, 928, 1},
+    {0xA7B4, 0xA7C2, 1, 2}, {0xA7C4, 0xA7C4, -48, 1},
+    {0xA7C5, 0xA7C5, -42307, 1}, {0xA7C6, 0xA7C6, -35384, 1},
+    {0xA7C7, 0xA7C9, 1, 2}, {0xA7D0, 0xA7D0, 1, 1}, {0xA7D6, 0xA7D8, 1, 2},
+    {0xA7F5, 0xA7F5, 1, 1}, {0xFF21, 0xFF3A, 32, 1}, {0x10400, 0x10427, 40, 1},
+    {0x104B0, 0x104D3, 40, 1}, {0x10570, 0x1057A, 39, 1},
+    {0x1057C, 0x1058A, 39, 1}, {0x1058C, 0x10592, 39, 1},
+    {0x10594, 0x10595, 39, 1}, {0x10C80, 0x10CB2, 64, 1},
+    {0x118A0, 0x118BF, 32, 1}, {0x16E40, 0x16E5F, 32, 1},
+    {0x1E900, 0x1E921, 34, 1},
+};
+
+constexpr DiacriticBase diacritic_bases[] = {
+    {0xE0, 0x61}, {0xE1, 0x61}, {0xE2, 0x61}, {0xE3, 0x61}, {0xE4, 0x61},
+    {0xE5, 0x61}, {0xE7, 0x63}, {0xE8, 0x65}, {0xE9, 0x65}, {0xEA, 0x65},
+    {0xEB, 0x65}, {0xEC, 0x69}, {0xED, 0x69}, {0xEE, 0x69}, {0xEF, 0x69},
+    {0xF1, 0x6E}, {0xF2, 0x6F}, {0xF3, 0x6F}, {0xF4, 0x6F}, {0xF5, 0x6F},
+    {0xF6, 0x6F}, {0xF8, 0x6F}, {0xF9, 0x75}, {0xFA, 0x75}, {0xFB, 0x75},
+    {0xFC, 0x75}, {0xFD, 0x79}, {0xFF, 0x79}, {0x101, 0x61}, {0x103, 0x61},
+    {0x105, 0x61}, {0x107, 0x63}, {0x109, 0x63}, {0x10B, 0x63}, {0x10D, 0x63},
+    {0x10F, 0x64}, {0x111, 0x64}, {0x113, 0x65}, {0x115, 0x65}, {0x117, 0x65},
+    {0x119, 0x65}, {0x11B, 0x65}, {0x11D, 0x67}, {0x11F, 0x67}, {0x121, 0x67},
+    {0x123, 0x67}, {0x125, 0x68}, {0x127, 0x68}, {0x129, 0x69}, {0x12B, 0x69},
+    {0x12D, 0x69}, {0x12F, 0x69}, {0x131, 0x69}, {0x135, 0x6A}, {0x137, 0x6B},
+    {0x13A, 0x6C}, {0x13C, 0x6C}, {0x13E, 0x6C}, {0x140, 0x6C}, {0x142, 0x6C},
+    {0x144, 0x6E}, {0x146, 0x6E}, {0x148, 0x6E}, {0x14D, 0x6F}, {0x14F, 0x6F},
+    {0x151, 0x6F}, {0x155, 0x72}, {0x157, 0x72}, {0x159, 0x72}, {0x15B, 0x73},
+    {0x15D, 0x73}, {0x15F, 0x73}, {0x161, 0x73}, {0x163, 0x74}, {0x165, 0x74},
+    {0x167, 0x74}, {0x169, 0x75}, {0x16B, 0x75}, {0x16D, 0x75}, {0x16F, 0x75},
+    {0x171, 0x75}, {0x173, 0x75}, {0x175, 0x77}, {0x177, 0x79}, {0x17A, 0x7A},
+    {0x17C, 0x7A}, {0x17E, 0x7A}, {0x180, 0x62}, {0x1A1, 0x6F}, {0x1B0, 0x75},
+    {0x1B4, 0x79}, {0x1B6, 0x7A}, {0x1CE, 0x61}, {0x1D0, 0x69}, {0x1D2, 0x6F},
+    {0x1D4, 0x75}, {0x1D6, 0x75}, {0x1D8, 0x75}, {0x1DA, 0x75}, {0x1DC, 0x75},
+    {0x1DF, 0x61}, {0x1E1, 0x61}, {0x1E3, 0xE6}, {0x1E7, 0x67}, {0x1E9, 0x6B},
+    {0x1EB, 0x6F}, {0x1ED, 0x6F}, {0x1EF, 0x292}, {0x1F0, 0x6A}, {0x1F5, 0x67},
+    {0x1F9, 0x6E}, {0x1FB, 0x61}, {0x1FD, 0xE6}, {0x1FF, 0xF8}, {0x201, 0x61},
+    {0x203, 0x61}, {0x205, 0x65}, {0x207, 0x65}, {0x209, 0x69}, {0x20B, 0x69},
+    {0x20D, 0x6F}, {0x20F, 0x6F}, {0x211, 0x72}, {0x213, 0x72}, {0x215, 0x75},
+    {0x217, 0x75}, {0x219, 0x73}, {0x21B, 0x74}, {0x21F, 0x68}, {0x227, 0x61},
+    {0x229, 0x65}, {0x22B, 0x6F}, {0x22D, 0x6F}, {0x22F, 0x6F}, {0x231, 0x6F},
+    {0x233, 0x79}, {0x390, 0x3B9}, {0x3AC, 0x3B1}, {0x3AD, 0x3B5},
+    {0x3AE, 0x3B7}, {0x3AF, 0x3B9}, {0x3B0, 0x3C5}, {0x3CA, 0x3B9},
+    {0x3CB, 0x3C5}, {0x3CC, 0x3BF}, {0x3CD, 0x3C5}, {0x3CE, 0x3C9},
+    {0x3D3, 0x3D2}, {0x3D4, 0x3D2}, {0x451, 0x435}, {0x1E01, 0x61},
+    {0x1E03, 0x62}, {0x1E05, 0x62}, {0x1E07, 0x62}, {0x1E09, 0x63},
+    {0x1E0B, 0x64}, {0x1E0D, 0x64}, {0x1E0F, 0x64}, {0x1E11, 0x64},
+    {0x1E13, 0x64}, {0x1E15, 0x65}, {0x1E17, 0x65}, {0x1E19, 0x65},
+    {0x1E1B, 0x65}, {0x1E1D, 0x65}, {0x1E1F, 0x66}, {0x1E21, 0x67},
+    {0x1E23, 0x68}, {0x1E25, 0x68}, {0x1E27, 0x68}, {0x1E29, 0x68},
+    {0x1E2B, 0x68}, {0x1E2D, 0x69}, {0x1E2F, 0x69}, {0x1E31, 0x6B},
+    {0x1E33, 0x6B}, {0x1E35, 0x6B}, {0x1E37, 0x6C}, {0x1E39, 0x6C},
+    {0x1E3B, 0x6C}, {0x1E3D, 0x6C}, {0x1E3F, 0x6D}, {0x1E41, 0x6D},
+    {0x1E43, 0x6D}, {0x1E45, 0x6E}, {0x1E47, 0x6E}, {0x1E49, 0x6E},
+    {0x1E4B, 0x6E}, {0x1E4D, 0x6F}, {0x1E4F, 0x6F}, {0x1E51, 0x6F},
+    {0x1E53, 0x6F}, {0x1E55, 0x70}, {0x1E57, 0x70}, {0x1E59, 0x72},
+    {0x1E5B, 0x72}, {0x1E5D, 0x72}, {0x1E5F, 0x72}, {0x1E61, 0x73},
+    {0x1E63, 0x73}, {0x1E65, 0x73}, {0x1E67, 0x73}, {0x1E69, 0x73},
+    {0x1E6B, 0x74}, {0x1E6D, 0x74}, {0x1E6F, 0x74}, {0x1E71, 0x74},
+    {0x1E73, 0x75}, {0x1E75, 0x75}, {0x1E77, 0x75}, {0x1E79, 0x75},
+    {0x1E7B, 0x75}, {0x1E7D, 0x76}, {0x1E7F, 0x76}, {0x1E81, 0x77},
+    {0x1E83, 0x77}, {0x1E85, 0x77}, {0x1E87, 0x77}, {0x1E89, 0x77},
+    {0x1E8B, 0x78}, {0x1E8D, 0x78}, {0x1E8F, 0x79}, {0x1E91, 0x7A},
+    {0x1E93, 0x7A}, {0x1E95, 0x7A}, {0x1E96, 0x68}, {0x1E97, 0x74},
+    {0x1E98, 0x77}, {0x1E99, 0x79}, {0x1E9B, 0x73}, {0x1EA1, 0x61},
+    {0x1EA3, 0x61}, {0x1EA5, 0x61}, {0x1EA7, 0x61}, {0x1EA9, 0x61},
+    {0x1EAB, 0x61}, {0x1EAD, 0x61}, {0x1EAF, 0x61}, {0x1EB1, 0x61},
+    {0x1EB3, 0x61}, {0x1EB5, 0x61}, {0x1EB7, 0x61}, {0x1EB9, 0x65},
+    {0x1EBB, 0x65}, {0x1EBD, 0x65}, {0x1EBF, 0x65}, {0x1EC1, 0x65},
+    {0x1EC3, 0x65}, {0x1EC5, 0x65}, {0x1EC7, 0x65}, {0x1EC9, 0x69},
+    {0x1ECB, 0x69}, {0x1ECD, 0x6F}, {0x1ECF, 0x6F}, {0x1ED1, 0x6F},
+    {0x1ED3, 0x6F}, {0x1ED5, 0x6F}, {0x1ED7, 0x6F}, {0x1ED9, 0x6F},
+    {0x1EDB, 0x6F}, {0x1EDD, 0x6F}, {0x1EDF, 0x6F}, {0x1EE1, 0x6F},
+    {0x1EE3, 0x6F}, {0x1EE5, 0x75}, {0x1EE7, 0x75}, {0x1EE9, 0x75},
+    {0x1EEB, 0x75}, {0x1EED, 0x75}, {0x1EEF, 0x75}, {0x1EF1, 0x75},
+    {0x1EF3, 0x79}, {0x1EF5, 0x79}, {0x1EF7, 0x79}, {0x1EF9, 0x79},
+    {0x1F00, 0x3B1}, {0x1F01, 0x3B1}, {0x1F02, 0x3B1}, {0x1F03, 0x3B1},
+    {0x1F04, 0x3B1}, {0x1F05, 0x3B1}, {0x1F06, 0x3B1}, {0x1F07, 0x3B1},
+    {0x1F10, 0x3B5}, {0x1F11, 0x3B5}, {0x1F12, 0x3B5}, {0x1F13, 0x3B5},
+    {0x1F14, 0x3B5}, {0x1F15, 0x3B5}, {0x1F20, 0x3B7}, {0x1F21, 0x3B7},
+    {0x1F22, 0x3B7}, {0x1F23, 0x3B7}, {0x1F24, 0x3B7}, {0x1F25, 0x3B7},
+    {0x1F26, 0x3B7}, {0x1F27, 0x3B7}, {0x1F30, 0x3B9}, {0x1F31, 0x3B9},
+    {0x1F32, 0x3B9}, {0x1F33, 0x3B9}, {0x1F34, 0x3B9}, {0x1F35, 0x3B9},
+    {0x1F36, 0x3B9}, {0x1F37, 0x3B9}, {0x1F40, 0x3BF}, {0x1F41, 0x3BF},
+    {0x1F42, 0x3BF}, {0x1F43, 0x3BF}, {0x1F44, 0x3BF}, {0x1F45, 0x3BF},
+    {0x1F50, 0x3C5}, {0x1F51, 0x3C5}, {0x1F52, 0x3C5}, {0x1F53, 0x3C5},
+    {0x1F54, 0x3C5}, {0x1F55, 0x3C5}, {0x1F56, 0x3C5}, {0x1F57, 0x3C5},
+    {0x1F60, 0x3C9}, {0x1F61, 0x3C9}, {0x1F62, 0x3C9}, {0x1F63, 0x3C9},
+    {0x1F64, 0x3C9}, {0x1F65, 0x3C9}, {0x1F66, 0x3C9}, {0x1F67, 0x3C9},
+    {0x1F70, 0x3B1}, {0x1F71, 0x3B1}, {0x1F72, 0x3B5}, {0x1F73, 0x3B5},
+    {0x1F74, 0x3B7}, {0x1F75, 0x3B7}, {0x1F76, 0x3B9}, {0x1F77, 0x3B9},
+    {0x1F78, 0x3BF}, {0x1F79, 0x3BF}, {0x1F7A, 0x3C5}, {0x1F7B, 0x3C5},
+    {0x1F7C, 0x3C9}, {0x1F7D, 0x3C9}, {0x1F80, 0x3B1}, {0x1F81, 0x3B1},
+    {0x1F82, 0x3B1}, {0x1F83, 0x3B1}, {0x1F84, 0x3B1}, {0x1F85, 0x3B1},
+    {0x1F86, 0x3B1}, {0x1F87, 0x3B1}, {0x1F90, 0x3B7}, {0x1F91, 0x3B7},
+    {0x1F92, 0x3B7}, {0x1F93, 0x3B7}, {0x1F94, 0x3B7}, {0x1F95, 0x3B7},
+    {0x1F96, 0x3B7}, {0x1F97, 0x3B7}, {0x1FA0, 0x3C9}, {0x1FA1, 0x3C9},
+    {0x1FA2, 0x3C9}, {0x1FA3, 0x3C9}, {0x1FA4, 0x3C9}, {0x1FA5, 0x3C9},
+    {0x1FA6, 0x3C9}, {0x1FA7, 0x3C9}, {0x1FB0, 0x3B1}, {0x1FB1, 0x3B1},
+    {0x1FB2, 0x3B1}, {0x1FB3, 0x3B1}, {0x1FB4, 0x3B1}, {0x1FB6, 0x3B1},
+    {0x1FB7, 0x3B1}, {0x1FC2, 0x3B7}, {0x1FC3, 0x3B7}, {0x1FC4, 0x3B7},
+    {0x1FC6, 0x3B7}, {0x1FC7, 0x3B7}, {0x1FD0, 0x3B9}, {0x1FD1, 0x3B9},
+    {0x1FD2, 0x3B9}, {0x1FD3, 0x3B9}, {0x1FD6, 0x3B9}, {0x1FD7, 0x3B9},
+    {0x1FE0, 0x3C5}, {0x1FE1, 0x3C5}, {0x1FE2, 0x3C5}, {0x1FE3, 0x3C5},
+    {0x1FE4, 0x3C1}, {0x1FE5, 0x3C1}, {0x1FE6, 0x3C5}, {0x1FE7, 0x3C5},
+    {0x1FF2, 0x3C9}, {0x1FF3, 0x3C9}, {0x1FF4, 0x3C9}, {0x1FF6, 0x3C9},
+    {0x1FF7, 0x3C9},
+};
+
+} // namespace opsqlite::fts5_unicode
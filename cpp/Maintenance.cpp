@@ -0,0 +1,184 @@
+#ifndef OP_SQLITE_USE_LIBSQL
+
+#include "Maintenance.h"
+#include "Backup.h"
+#include "QueryStats.h"
+#include <cstdio>
+#include <stdexcept>
+
+namespace opsqlite {
+
+namespace {
+
+/// Pages incremental_vacuum frees per tick, so a tick stays short and the
+/// queries queued behind it are not held up
+constexpr int vacuum_pages_per_tick = 256;
+
+void exec(sqlite3 *db, const std::string &sql) {
+    char *error = nullptr;
+    if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &error) != SQLITE_OK) {
+        std::string message = error != nullptr ? error : sqlite3_errmsg(db);
+        sqlite3_free(error);
+        throw std::runtime_error(message);
+    }
+}
+
+int pragma_int(sqlite3 *db, const char *pragma) {
+    sqlite3_stmt *statement = nullptr;
+    std::string sql = std::string("PRAGMA ") + pragma;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &statement, nullptr) !=
+        SQLITE_OK) {
+        throw std::runtime_error(sqlite3_errmsg(db));
+    }
+    int value = sqlite3_step(statement) == SQLITE_ROW
+                    ? sqlite3_column_int(statement, 0)
+                    : 0;
+    sqlite3_finalize(statement);
+    return value;
+}
+
+/// Rebuilds the database into a new file and copies it back in a single
+/// transaction. Renaming the new file over the old one would break the open
+/// connection and its WAL, the copy gives the same result atomically
+int compact(sqlite3 *db) {
+    const char *path = sqlite3_db_filename(db, "main");
+    if (path == nullptr || path[0] == '\0') {
+        return -1;
+    }
+
+    int free_pages = pragma_int(db, "freelist_count");
+    std::string temp_path = std::string(path) + ".compact";
+    std::remove(temp_path.c_str());
+
+    try {
+        char *sql = sqlite3_mprintf("VACUUM INTO %Q", temp_path.c_str());
+        std::string vacuum = sql;
+        sqlite3_free(sql);
+        exec(db, vacuum);
+
+        BackupOptions options;
+        options.pages_per_step = -1;
+        restore_database(db, temp_path, options);
+    } catch (...) {
+        std::remove(temp_path.c_str());
+        throw;
+    }
+    std::remove(temp_path.c_str());
+    return free_pages - pragma_int(db, "freelist_count");
+}
+
+} // namespace
+
+void Maintenance::run(const char *task, const std::function<int()> &fn) {
+    MaintenanceEvent event{task, 0, 0, ""};
+    auto started_at = now_ns();
+    try {
+        event.pages = fn();
+    } catch (std::exception &exc) {
+        event.error = exc.what();
+    }
+    event.duration_ns = now_ns() - started_at;
+
+    // -1 means there was nothing to do
+    if (options.on_event && (event.pages >= 0 || !event.error.empty())) {
+        options.on_event(event);
+    }
+}
+
+void Maintenance::tick(sqlite3 *db, uint64_t queued_tasks) {
+    bool idle = queued_tasks == seen_tasks;
+    // Counts the next tick, queued right after this one
+    seen_tasks = queued_tasks + 1;
+
+    if (!idle) {
+        needs_checkpoint = true;
+        return;
+    }
+    // JS transactions span several tasks, the lane can be idle in the middle
+    if (!sqlite3_get_autocommit(db) || sqlite3_db_readonly(db, "main") != 0) {
+        return;
+    }
+
+    if (options.checkpoint && needs_checkpoint) {
+        needs_checkpoint = false;
+        run("checkpoint", [db] {
+            int frames = 0;
+            int checkpointed = 0;
+            if (sqlite3_wal_checkpoint_v2(db, "main",
+                                          SQLITE_CHECKPOINT_PASSIVE, &frames,
+                                          &checkpointed) != SQLITE_OK) {
+                throw std::runtime_error(sqlite3_errmsg(db));
+            }
+            // Both are -1 when the database is not in WAL mode
+            return frames > 0 ? checkpointed : -1;
+        });
+    }
+
+    auto now = now_ns();
+    if (now >= next_round_ns) {
+        next_round_ns =
+            now + static_cast<uint64_t>(
+                      std::chrono::nanoseconds(options.interval).count());
+
+        if (options.optimize) {
+            run("optimize", [this, db] {
+                // The first round also analyzes tables that never were, as
+                // recommended for long lived connections
+                exec(db, optimized ? "PRAGMA optimize"
+                                   : "PRAGMA optimize = 0x10002");
+                optimized = true;
+                return 0;
+            });
+        }
+        check_freelist(db);
+    }
+
+    if (vacuuming) {
+        run("incrementalVacuum", [this, db] {
+            int before = pragma_int(db, "freelist_count");
+            exec(db, "PRAGMA incremental_vacuum(" +
+                         std::to_string(vacuum_pages_per_tick) + ")");
+            int after = pragma_int(db, "freelist_count");
+            vacuuming = after > 0;
+            return before - after;
+        });
+    }
+}
+
+void Maintenance::check_freelist(sqlite3 *db) {
+    int page_count;
+    int free_pages;
+    int auto_vacuum;
+    try {
+        page_count = pragma_int(db, "page_count");
+        free_pages = pragma_int(db, "freelist_count");
+        auto_vacuum = pragma_int(db, "auto_vacuum");
+    } catch (std::exception &) {
+        return;
+    }
+    if (page_count == 0 || free_pages == 0) {
+        return;
+    }
+
+    double share = static_cast<double>(free_pages) / page_count;
+    // 2 is INCREMENTAL, 0 NONE. FULL databases never keep free pages
+    if (auto_vacuum == 2 && options.vacuum_threshold > 0 &&
+        share >= options.vacuum_threshold) {
+        vacuuming = true;
+    } else if (auto_vacuum == 0 && options.compact_threshold > 0 &&
+               share >= options.compact_threshold) {
+        run("compact", [db] { return compact(db); });
+    }
+}
+
+void Maintenance::before_close(sqlite3 *db) {
+    if (!options.optimize || !sqlite3_get_autocommit(db) ||
+        sqlite3_db_readonly(db, "main") != 0) {
+        return;
+    }
+    sqlite3_exec(db, "PRAGMA optimize", nullptr, nullptr, nullptr);
+}
+
+} // namespace opsqlite
+
+#endif
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <sqlite3.h>
+#include <string>
+
+namespace opsqlite {
+
+struct MaintenanceEvent {
+    /// checkpoint, optimize, incrementalVacuum or compact
+    std::string task;
+    uint64_t duration_ns;
+    /// WAL frames checkpointed or pages given back to the file system
+    int pages;
+    /// Empty unless the task failed, maintenance carries on either way
+    std::string error;
+};
+
+struct MaintenanceOptions {
+    /// A tick runs every idle period and only does work when no other task
+    /// was queued on the connection since the previous one
+    std::chrono::milliseconds idle{1000};
+    /// Time between two rounds of PRAGMA optimize and freelist checks
+    std::chrono::milliseconds interval{3'600'000};
+    /// Passive WAL checkpoint once the connection is idle after writes
+    bool checkpoint = true;
+    /// PRAGMA optimize every interval and when the connection is closed
+    bool optimize = true;
+    /// Share of free pages above which a database with auto_vacuum set to
+    /// INCREMENTAL gives them back, 0 disables it
+    double vacuum_threshold = 0.1;
+    /// Share of free pages above which a database without auto_vacuum is
+    /// rebuilt with VACUUM INTO and copied back, 0 disables it
+    double compact_threshold = 0;
+    /// Called on the worker after each task
+    std::function<void(const MaintenanceEvent &)> on_event;
+};
+
+/// Opt-in upkeep of a long lived connection, driven by ticks queued in the
+/// background lane of its thread pool. Nothing runs while a transaction is
+/// open or on read only databases
+class Maintenance {
+  public:
+    explicit Maintenance(MaintenanceOptions options)
+        : options(std::move(options)) {}
+
+    /// Runs on the worker. queued_tasks is the pool's count when the tick
+    /// started, the tick is expected to queue the next one right after
+    void tick(sqlite3 *db, uint64_t queued_tasks);
+
+    /// PRAGMA optimize, run on the worker right before the connection closes
+    void before_close(sqlite3 *db);
+
+    const MaintenanceOptions options;
+    /// Set on the JS thread when the schedule is replaced or turned off and
+    /// before the connection is closed
+    std::atomic<bool> stopped{false};
+
+  private:
+    // Only touched by ticks, which run one at a time on the worker
+    uint64_t seen_tasks = UINT64_MAX;
+    bool needs_checkpoint = true;
+    bool vacuuming = false;
+    bool optimized = false;
+    uint64_t next_round_ns = 0;
+
+    void run(const char *task, const std::function<int()> &fn);
+    void check_freelist(sqlite3 *db);
+};
+
+} // namespace opsqlite
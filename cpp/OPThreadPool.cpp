@@ -1,8 +1,58 @@
 #include "OPThreadPool.h"
+#ifdef __APPLE__
+#include <pthread/qos.h>
+#elif defined(__ANDROID__)
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
 
 namespace opsqlite {
 
-ThreadPool::ThreadPool() : done(false) {
+// Once the oldest task of a lane has waited this long it is served before
+// higher priority lanes, so a steady stream of interactive queries cannot
+// starve the rest
+static constexpr std::chrono::milliseconds
+    max_wait[static_cast<size_t>(Priority::Count)] = {
+        std::chrono::milliseconds(0), std::chrono::milliseconds(250),
+        std::chrono::milliseconds(1000)};
+
+#ifdef __APPLE__
+using ThreadPriority = qos_class_t;
+
+static ThreadPriority lower_thread_priority() {
+    qos_class_t previous = qos_class_self();
+    pthread_set_qos_class_self_np(QOS_CLASS_UTILITY, 0);
+    return previous;
+}
+
+static void restore_thread_priority(ThreadPriority previous) {
+    pthread_set_qos_class_self_np(previous == QOS_CLASS_UNSPECIFIED
+                                      ? QOS_CLASS_DEFAULT
+                                      : previous,
+                                  0);
+}
+#elif defined(__ANDROID__)
+using ThreadPriority = int;
+
+// Niceness is per thread on Linux, 10 matches THREAD_PRIORITY_BACKGROUND
+static ThreadPriority lower_thread_priority() {
+    int previous = getpriority(PRIO_PROCESS, gettid());
+    setpriority(PRIO_PROCESS, gettid(), 10);
+    return previous;
+}
+
+static void restore_thread_priority(ThreadPriority previous) {
+    setpriority(PRIO_PROCESS, gettid(), previous);
+}
+#else
+using ThreadPriority = int;
+
+static ThreadPriority lower_thread_priority() { return 0; }
+
+static void restore_thread_priority(ThreadPriority) {}
+#endif
+
+ThreadPool::ThreadPool() {
     // This returns the number of threads supported by the system. If the
     // function can't figure out this information, it returns 0. 0 is not good,
     // so we create at least 1
@@ -24,8 +74,12 @@ ThreadPool::ThreadPool() : done(false) {
 // The destructor joins all the threads so the program can exit gracefully.
 // This will be executed if there is any exception (e.g. creating the threads)
 ThreadPool::~ThreadPool() {
-    // So threads know it's time to shut down
-    done = true;
+    // So threads know it's time to shut down. Set under the mutex, otherwise
+    // a worker between checking its predicate and waiting misses the wakeup
+    {
+        std::lock_guard<std::mutex> g(workQueueMutex);
+        done = true;
+    }
 
     // Wake up all the threads, so they can finish and be joined
     workQueueConditionVariable.notify_all();
@@ -41,55 +95,144 @@ ThreadPool::~ThreadPool() {
 
 // This function will be called by the server every time there is a request
 // that needs to be processed by the thread pool
-void ThreadPool::queueWork(const std::function<void(void)> &task) {
+void ThreadPool::queueWork(const std::function<void(void)> &task,
+                           Priority priority) {
     // Grab the mutex
     std::lock_guard<std::mutex> g(workQueueMutex);
 
-    // Push the request to the queue
-    workQueue.push(task);
+    // Push the request to the queue of its lane
+    workQueues[static_cast<size_t>(priority)].push(
+        {task, std::chrono::steady_clock::now()});
+    queued_tasks++;
 
     // Notify one thread that there are requests to process
     workQueueConditionVariable.notify_one();
 }
 
+void ThreadPool::queue_delayed_work(const std::function<void(void)> &task,
+                                    std::chrono::milliseconds delay,
+                                    Priority priority) {
+    std::lock_guard<std::mutex> g(workQueueMutex);
+
+    delayedTasks.push(
+        {task, std::chrono::steady_clock::now() + delay, priority});
+    queued_tasks++;
+
+    // The worker may be sleeping until a later delayed task
+    workQueueConditionVariable.notify_one();
+}
+
+void ThreadPool::queueReadyDelayedWork() {
+    auto now = std::chrono::steady_clock::now();
+
+    while (!delayedTasks.empty() && delayedTasks.top().ready_at <= now) {
+        const auto &delayed = delayedTasks.top();
+        // Aged from when it became ready, not from when it was queued
+        workQueues[static_cast<size_t>(delayed.priority)].push(
+            {delayed.task, delayed.ready_at});
+        delayedTasks.pop();
+    }
+}
+
+void ThreadPool::set_lower_background_priority(bool lower) {
+    lower_background_priority = lower;
+}
+
+bool ThreadPool::hasWork() const {
+    for (const auto &queue : workQueues) {
+        if (!queue.empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+Priority ThreadPool::nextPriority() const {
+    auto now = std::chrono::steady_clock::now();
+
+    // Starved lanes first, the lowest priority one has waited the longest
+    for (size_t i = priority_count; i-- > 1;) {
+        if (!workQueues[i].empty() &&
+            now - workQueues[i].front().queued_at >= max_wait[i]) {
+            return static_cast<Priority>(i);
+        }
+    }
+
+    for (size_t i = 0; i < priority_count; i++) {
+        if (!workQueues[i].empty()) {
+            return static_cast<Priority>(i);
+        }
+    }
+
+    return Priority::Normal;
+}
+
 // Function used by the threads to grab work from the queue
 void ThreadPool::doWork() {
     // Loop while the queue is not destructing
     while (!done) {
         std::function<void(void)> task;
+        Priority priority;
 
         // Create a scope, so we don't lock the queue for longer than necessary
         {
             std::unique_lock<std::mutex> g(workQueueMutex);
-            workQueueConditionVariable.wait(g, [&] {
-                // Only wake up if there are elements in the queue or the
-                // program is shutting down
-                return !workQueue.empty() || done;
-            });
+            // Only wake up if there are elements in the queue or the program
+            // is shutting down, or to move a delayed task once it is ready
+            while (true) {
+                queueReadyDelayedWork();
+                if (hasWork() || done) {
+                    break;
+                }
+                if (delayedTasks.empty()) {
+                    workQueueConditionVariable.wait(g);
+                } else {
+                    workQueueConditionVariable.wait_until(
+                        g, delayedTasks.top().ready_at);
+                }
+            }
 
             // If we are shutting down exit without trying to process more work
             if (done) {
                 break;
             }
 
-            task = workQueue.front();
-            workQueue.pop();
+            priority = nextPriority();
+            auto &queue = workQueues[static_cast<size_t>(priority)];
+            task = std::move(queue.front().task);
+            queue.pop();
+            ++busy;
+        }
+
+        if (priority == Priority::Background && lower_background_priority) {
+            auto previous = lower_thread_priority();
+            task();
+            restore_thread_priority(previous);
+        } else {
+            task();
+        }
+
+        {
+            std::lock_guard<std::mutex> g(workQueueMutex);
+            --busy;
         }
-        ++busy;
-        task();
-        --busy;
+        // Wakes up waitFinished
+        workQueueConditionVariable.notify_all();
     }
 }
 
 void ThreadPool::waitFinished() {
     std::unique_lock<std::mutex> g(workQueueMutex);
-    workQueueConditionVariable.wait(
-        g, [&] { return workQueue.empty() && (busy == 0); });
+    workQueueConditionVariable.wait(g,
+                                    [&] { return !hasWork() && (busy == 0); });
 }
 
 void ThreadPool::restartPool() {
     // So threads know it's time to shut down
-    done = true;
+    {
+        std::lock_guard<std::mutex> g(workQueueMutex);
+        done = true;
+    }
 
     // Wake up all the threads, so they can finish and be joined
     workQueueConditionVariable.notify_all();
@@ -102,11 +245,12 @@ void ThreadPool::restartPool() {
 
     threads.clear();
 
-    auto numberOfThreads = std::thread::hardware_concurrency();
-    if (numberOfThreads == 0) {
-        numberOfThreads = 1;
-    }
+    // Reset before starting the threads, they exit right away otherwise
+    done = false;
 
+    // Same as the constructor, the tasks of a connection must run one at a
+    // time
+    auto numberOfThreads = 1;
     for (unsigned i = 0; i < numberOfThreads; ++i) {
         // The threads will execute the private member `doWork`. Note that we
         // need to pass a reference to the function (namespaced with the class
@@ -114,7 +258,5 @@ void ThreadPool::restartPool() {
         // argument
         threads.emplace_back(&ThreadPool::doWork, this);
     }
-
-    done = false;
 }
 } // namespace opsqlite
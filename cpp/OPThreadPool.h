@@ -1,7 +1,12 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
 #include <exception>
+#include <functional>
 #include <mutex>
 #include <queue>
 #include <stdio.h>
@@ -10,15 +15,49 @@
 
 namespace opsqlite {
 
+/// Lanes of the work queue, lower values are dequeued first
+enum class Priority : size_t { Interactive = 0, Normal, Background, Count };
+
 class ThreadPool {
   public:
     ThreadPool();
     ~ThreadPool();
-    void queueWork(const std::function<void(void)> &task);
+    void queueWork(const std::function<void(void)> &task,
+                   Priority priority = Priority::Normal);
+    /// Queues the task in its lane once delay has passed. The worker keeps
+    /// running other tasks meanwhile, waitFinished does not wait for it
+    void queue_delayed_work(const std::function<void(void)> &task,
+                            std::chrono::milliseconds delay,
+                            Priority priority = Priority::Normal);
     void waitFinished();
     void restartPool();
+    /// Runs background tasks with a lower OS thread priority (QoS on iOS,
+    /// niceness on Android). Off by default, a lowered background task can
+    /// delay an interactive one queued behind it
+    void set_lower_background_priority(bool lower);
+    /// Tasks queued since the pool was created, delayed ones included. A
+    /// task that sees the same count twice knows nothing ran in between
+    uint64_t queued_task_count() const { return queued_tasks; }
 
   private:
+    static constexpr size_t priority_count =
+        static_cast<size_t>(Priority::Count);
+
+    struct QueuedTask {
+        std::function<void(void)> task;
+        std::chrono::steady_clock::time_point queued_at;
+    };
+
+    struct DelayedTask {
+        std::function<void(void)> task;
+        std::chrono::steady_clock::time_point ready_at;
+        Priority priority;
+
+        bool operator>(const DelayedTask &other) const {
+            return ready_at > other.ready_at;
+        }
+    };
+
     unsigned int busy{};
     // This condition variable is used for the threads to wait until there is
     // work to do
@@ -27,18 +66,35 @@ class ThreadPool {
     // We store the threads in a vector, so we can later stop them gracefully
     std::vector<std::thread> threads;
 
-    // Mutex to protect workQueue
+    // Mutex to protect workQueues
     std::mutex workQueueMutex;
 
-    // Queue of requests waiting to be processed
-    std::queue<std::function<void(void)>> workQueue;
+    // One queue of requests per priority, waiting to be processed
+    std::array<std::queue<QueuedTask>, priority_count> workQueues;
+
+    // Tasks waiting for their delay, the earliest on top
+    std::priority_queue<DelayedTask, std::vector<DelayedTask>,
+                        std::greater<DelayedTask>>
+        delayedTasks;
 
     // This will be set to true when the thread pool is shutting down. This
-    // tells the threads to stop looping and finish
-    bool done;
+    // tells the threads to stop looping and finish. Written under the mutex,
+    // atomic because doWork also reads it outside of it
+    std::atomic<bool> done{false};
+
+    std::atomic<bool> lower_background_priority{false};
+
+    std::atomic<uint64_t> queued_tasks{0};
+
+    bool hasWork() const;
+    // Moves the delayed tasks that are ready to their lane, must be called
+    // with the mutex held
+    void queueReadyDelayedWork();
+    // Picks the lane to dequeue from, must be called with the mutex held
+    Priority nextPriority() const;
 
     // Function used by the threads to grab work from the queue
     void doWork();
 };
 
-} // namespace opsqlite
\ No newline at end of file
+} // namespace opsqlite
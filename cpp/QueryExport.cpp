@@ -0,0 +1,594 @@
+#ifndef OP_SQLITE_USE_LIBSQL
+
+#include "QueryExport.h"
+#include "ArrowIpc.h"
+#include "QueryStats.h"
+#include "bridge.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+
+namespace opsqlite {
+
+namespace {
+
+/// Record batches are flushed early before Utf8 and Binary offsets, which
+/// are 32 bit, could overflow
+constexpr size_t max_batch_bytes = 1 << 30;
+
+class BufferedFile {
+  public:
+    explicit BufferedFile(const std::string &path) : path(path) {
+        file = fopen(path.c_str(), "wb");
+        if (file == nullptr) {
+            fail("Could not open " + path + " for writing");
+        }
+        buffer.reserve(capacity);
+    }
+
+    ~BufferedFile() {
+        if (file != nullptr) {
+            fclose(file);
+        }
+    }
+
+    size_t written() const { return total; }
+
+    void write(const void *data, size_t size) {
+        total += size;
+        if (buffer.size() + size > capacity) {
+            flush();
+        }
+        if (size > capacity) {
+            write_through(data, size);
+            return;
+        }
+        auto bytes = static_cast<const char *>(data);
+        buffer.insert(buffer.end(), bytes, bytes + size);
+    }
+
+    void write(std::string_view text) { write(text.data(), text.size()); }
+
+    void close() {
+        flush();
+        auto status = fclose(file);
+        file = nullptr;
+        if (status != 0) {
+            fail("Could not write " + path);
+        }
+    }
+
+  private:
+    static constexpr size_t capacity = 256 * 1024;
+    std::string path;
+    FILE *file;
+    std::vector<char> buffer;
+    size_t total = 0;
+
+    [[noreturn]] void fail(const std::string &message) {
+        throw std::runtime_error("[op-sqlite] " + message + ": " +
+                                 strerror(errno));
+    }
+
+    void write_through(const void *data, size_t size) {
+        if (fwrite(data, 1, size, file) != size) {
+            fail("Could not write " + path);
+        }
+    }
+
+    void flush() {
+        write_through(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+};
+
+void append_integer(std::string &out, sqlite3_int64 value) {
+    char digits[24];
+    int length = snprintf(digits, sizeof(digits), "%lld",
+                          static_cast<long long>(value));
+    out.append(digits, length);
+}
+
+/// Shortest of %.15g and %.17g that reads back as the same double, with a
+/// .0 on integral values like sqlite prints them so they stay reals
+void append_real(std::string &out, double value) {
+    char digits[32];
+    int length = snprintf(digits, sizeof(digits), "%.15g", value);
+    if (std::isfinite(value) && std::strtod(digits, nullptr) != value) {
+        length = snprintf(digits, sizeof(digits), "%.17g", value);
+    }
+    out.append(digits, length);
+    if (std::isfinite(value) && strpbrk(digits, ".e") == nullptr) {
+        out += ".0";
+    }
+}
+
+void append_hex(std::string &out, const void *data, size_t size) {
+    static const char hex[] = "0123456789abcdef";
+    auto bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; i++) {
+        out += hex[bytes[i] >> 4];
+        out += hex[bytes[i] & 0x0F];
+    }
+}
+
+std::string_view column_text(sqlite3_stmt *statement, int i) {
+    auto text =
+        reinterpret_cast<const char *>(sqlite3_column_text(statement, i));
+    return {text, static_cast<size_t>(sqlite3_column_bytes(statement, i))};
+}
+
+class RowWriter {
+  public:
+    virtual ~RowWriter() = default;
+    virtual void row(sqlite3_stmt *statement) = 0;
+    virtual void finish() {}
+};
+
+/// RFC 4180 with CRLF line endings. Empty strings are quoted so they can be
+/// told apart from NULL, which is an empty field
+class CsvWriter : public RowWriter {
+  public:
+    CsvWriter(BufferedFile &file, sqlite3_stmt *statement, bool header)
+        : file(file), columns(sqlite3_column_count(statement)) {
+        if (!header) {
+            return;
+        }
+        for (int i = 0; i < columns; i++) {
+            line += i == 0 ? "" : ",";
+            append_field(sqlite3_column_name(statement, i));
+        }
+        line += "\r\n";
+        file.write(line);
+    }
+
+    void row(sqlite3_stmt *statement) override {
+        line.clear();
+        for (int i = 0; i < columns; i++) {
+            line += i == 0 ? "" : ",";
+            switch (sqlite3_column_type(statement, i)) {
+            case SQLITE_INTEGER:
+                append_integer(line, sqlite3_column_int64(statement, i));
+                break;
+            case SQLITE_FLOAT:
+                append_real(line, sqlite3_column_double(statement, i));
+                break;
+            case SQLITE_TEXT:
+                append_field(column_text(statement, i));
+                break;
+            case SQLITE_BLOB:
+                if (sqlite3_column_bytes(statement, i) == 0) {
+                    line += "\"\"";
+                }
+                append_hex(line, sqlite3_column_blob(statement, i),
+                           sqlite3_column_bytes(statement, i));
+                break;
+            default:
+                break;
+            }
+        }
+        line += "\r\n";
+        file.write(line);
+    }
+
+  private:
+    BufferedFile &file;
+    int columns;
+    std::string line;
+
+    void append_field(std::string_view text) {
+        if (!text.empty() &&
+            text.find_first_of(",\"\r\n") == std::string_view::npos) {
+            line += text;
+            return;
+        }
+        line += '"';
+        for (char c : text) {
+            line += c;
+            if (c == '"') {
+                line += '"';
+            }
+        }
+        line += '"';
+    }
+};
+
+void append_json_string(std::string &out, std::string_view text) {
+    out += '"';
+    for (char c : text) {
+        switch (c) {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out += escaped;
+            } else {
+                out += c;
+            }
+        }
+    }
+    out += '"';
+}
+
+/// A JSON object per row, keyed by the column names
+class NdjsonWriter : public RowWriter {
+  public:
+    NdjsonWriter(BufferedFile &file, sqlite3_stmt *statement) : file(file) {
+        for (int i = 0; i < sqlite3_column_count(statement); i++) {
+            std::string key = i == 0 ? "{" : ",";
+            append_json_string(key, sqlite3_column_name(statement, i));
+            keys.push_back(key + ":");
+        }
+    }
+
+    void row(sqlite3_stmt *statement) override {
+        line.clear();
+        for (size_t i = 0; i < keys.size(); i++) {
+            int column = static_cast<int>(i);
+            line += keys[i];
+            switch (sqlite3_column_type(statement, column)) {
+            case SQLITE_INTEGER:
+                append_integer(line, sqlite3_column_int64(statement, column));
+                break;
+            case SQLITE_FLOAT: {
+                double value = sqlite3_column_double(statement, column);
+                if (std::isfinite(value)) {
+                    append_real(line, value);
+                } else {
+                    line += "null";
+                }
+                break;
+            }
+            case SQLITE_TEXT:
+                append_json_string(line, column_text(statement, column));
+                break;
+            case SQLITE_BLOB:
+                line += '"';
+                append_hex(line, sqlite3_column_blob(statement, column),
+                           sqlite3_column_bytes(statement, column));
+                line += '"';
+                break;
+            default:
+                line += "null";
+            }
+        }
+        line += keys.empty() ? "{}\n" : "}\n";
+        file.write(line);
+    }
+
+  private:
+    BufferedFile &file;
+    std::vector<std::string> keys;
+    std::string line;
+};
+
+/// A value of the current row, or of a row of the first batch that was
+/// read before the column types were known
+struct Value {
+    int type = SQLITE_NULL;
+    sqlite3_int64 integer = 0;
+    double real = 0;
+    std::string bytes;
+};
+
+const char *type_name(int type) {
+    switch (type) {
+    case SQLITE_INTEGER:
+        return "an integer";
+    case SQLITE_FLOAT:
+        return "a real";
+    case SQLITE_TEXT:
+        return "text";
+    default:
+        return "a blob";
+    }
+}
+
+/// Arrow columns have one type. Declared types are not trusted since sqlite
+/// does not enforce them, the type comes from the values of the first batch.
+/// The schema is written by then, a later value that does not fit fails the
+/// export instead of being changed
+class ArrowWriter : public RowWriter {
+  public:
+    ArrowWriter(BufferedFile &file, sqlite3_stmt *statement,
+                size_t batch_size)
+        : file(file), batch_size(std::max<size_t>(batch_size, 1)) {
+        for (int i = 0; i < sqlite3_column_count(statement); i++) {
+            names.emplace_back(sqlite3_column_name(statement, i));
+            auto declared = sqlite3_column_decltype(statement, i);
+            declared_types.emplace_back(declared ? declared : "");
+        }
+    }
+
+    void row(sqlite3_stmt *statement) override {
+        rows++;
+        if (writer == nullptr) {
+            auto &row = first_batch.emplace_back(names.size());
+            for (size_t i = 0; i < names.size(); i++) {
+                read(statement, static_cast<int>(i), row[i]);
+            }
+            if (first_batch.size() >= batch_size) {
+                start();
+            }
+            return;
+        }
+
+        size_t bytes = 0;
+        for (size_t i = 0; i < names.size(); i++) {
+            read(statement, static_cast<int>(i), value);
+            check_type(i, value);
+            append(columns[i], value);
+            bytes += columns[i].data.size();
+        }
+        if (columns[0].length >= batch_size || bytes >= max_batch_bytes) {
+            writer->write_batch(columns);
+        }
+    }
+
+    void finish() override {
+        if (writer == nullptr) {
+            start();
+        }
+        if (!columns.empty() && columns[0].length > 0) {
+            writer->write_batch(columns);
+        }
+        writer->finish();
+    }
+
+  private:
+    BufferedFile &file;
+    size_t batch_size;
+    std::vector<std::string> names;
+    std::vector<std::string> declared_types;
+    std::vector<std::vector<Value>> first_batch;
+    std::vector<ArrowColumn> columns;
+    std::unique_ptr<ArrowFileWriter> writer;
+    Value value;
+    std::string text;
+    size_t rows = 0;
+
+    static void read(sqlite3_stmt *statement, int i, Value &value) {
+        value.type = sqlite3_column_type(statement, i);
+        switch (value.type) {
+        case SQLITE_INTEGER:
+            value.integer = sqlite3_column_int64(statement, i);
+            break;
+        case SQLITE_FLOAT:
+            value.real = sqlite3_column_double(statement, i);
+            break;
+        case SQLITE_TEXT:
+        case SQLITE_BLOB: {
+            auto data = static_cast<const char *>(
+                value.type == SQLITE_TEXT
+                    ? sqlite3_column_text(statement, i)
+                    : sqlite3_column_blob(statement, i));
+            value.bytes.assign(data ? data : "",
+                               sqlite3_column_bytes(statement, i));
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    /// Integers only stay Int64, a real makes the column Float64, any text
+    /// Utf8 and any blob Binary. Columns without values use the declared
+    /// type
+    ArrowType infer_type(size_t column) const {
+        bool integer = false, real = false, text = false, blob = false;
+        for (const auto &row : first_batch) {
+            integer |= row[column].type == SQLITE_INTEGER;
+            real |= row[column].type == SQLITE_FLOAT;
+            text |= row[column].type == SQLITE_TEXT;
+            blob |= row[column].type == SQLITE_BLOB;
+        }
+
+        if (blob) {
+            return ArrowType::Binary;
+        }
+        if (text) {
+            return ArrowType::Utf8;
+        }
+        if (real) {
+            return ArrowType::Float64;
+        }
+        if (integer) {
+            return ArrowType::Int64;
+        }
+
+        std::string declared = declared_types[column];
+        for (auto &c : declared) {
+            c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        }
+        if (declared.find("INT") != std::string::npos) {
+            return ArrowType::Int64;
+        }
+        if (declared.find("REAL") != std::string::npos ||
+            declared.find("FLOA") != std::string::npos ||
+            declared.find("DOUB") != std::string::npos) {
+            return ArrowType::Float64;
+        }
+        if (declared.find("BLOB") != std::string::npos) {
+            return ArrowType::Binary;
+        }
+        return ArrowType::Utf8;
+    }
+
+    void start() {
+        std::vector<ArrowType> types;
+        for (size_t i = 0; i < names.size(); i++) {
+            types.push_back(infer_type(i));
+            columns.emplace_back(types.back());
+        }
+        writer = std::make_unique<ArrowFileWriter>(
+            [this](const void *data, size_t size) { file.write(data, size); },
+            names, types);
+
+        for (const auto &row : first_batch) {
+            for (size_t i = 0; i < names.size(); i++) {
+                append(columns[i], row[i]);
+            }
+        }
+        first_batch.clear();
+        first_batch.shrink_to_fit();
+    }
+
+    /// Integers fit real columns, anything fits text and binary ones
+    void check_type(size_t column, const Value &value) const {
+        auto type = columns[column].type;
+        if (value.type == SQLITE_NULL || value.type == SQLITE_INTEGER ||
+            (value.type == SQLITE_FLOAT && type != ArrowType::Int64) ||
+            (type != ArrowType::Int64 && type != ArrowType::Float64)) {
+            return;
+        }
+        throw std::runtime_error(
+            "[op-sqlite] Export error at row " + std::to_string(rows) +
+            ": column " + names[column] + " holds " + type_name(value.type) +
+            " but the first batch made it " +
+            (type == ArrowType::Int64 ? "int64" : "float64") +
+            ", raise batchSize or CAST the column in the query");
+    }
+
+    void append(ArrowColumn &column, const Value &value) {
+        if (value.type == SQLITE_NULL) {
+            column.append_null();
+            return;
+        }
+
+        switch (column.type) {
+        case ArrowType::Int64:
+            column.append_int64(value.integer);
+            break;
+        case ArrowType::Float64:
+            column.append_double(value.type == SQLITE_INTEGER
+                                     ? static_cast<double>(value.integer)
+                                     : value.real);
+            break;
+        case ArrowType::Utf8:
+        case ArrowType::Binary:
+            text.clear();
+            if (value.type == SQLITE_INTEGER) {
+                append_integer(text, value.integer);
+            } else if (value.type == SQLITE_FLOAT) {
+                append_real(text, value.real);
+            } else if (value.type == SQLITE_BLOB &&
+                       column.type == ArrowType::Utf8) {
+                append_hex(text, value.bytes.data(), value.bytes.size());
+            } else {
+                column.append_bytes(value.bytes.data(), value.bytes.size());
+                break;
+            }
+            column.append_bytes(text.data(), text.size());
+            break;
+        }
+    }
+};
+
+} // namespace
+
+ExportProgress export_query(sqlite3 *db, const std::string &query,
+                            const std::vector<JSVariant> *params,
+                            const std::string &path,
+                            const ExportOptions &options) {
+    sqlite3_stmt *statement = nullptr;
+    if (sqlite3_prepare_v2(db, query.c_str(), -1, &statement, nullptr) !=
+        SQLITE_OK) {
+        throw std::runtime_error("[op-sqlite] SQL prepare statement error: " +
+                                 std::string(sqlite3_errmsg(db)));
+    }
+    if (statement == nullptr) {
+        throw std::runtime_error("[op-sqlite] Export query is empty");
+    }
+    if (params != nullptr) {
+        opsqlite_bind_statement(statement, params);
+    }
+
+    auto temp_path = path + ".tmp";
+    ExportProgress progress{0, 0};
+
+    try {
+        BufferedFile file(temp_path);
+        std::unique_ptr<RowWriter> writer;
+        switch (options.format) {
+        case ExportFormat::Csv:
+            writer = std::make_unique<CsvWriter>(file, statement,
+                                                 options.header);
+            break;
+        case ExportFormat::Ndjson:
+            writer = std::make_unique<NdjsonWriter>(file, statement);
+            break;
+        case ExportFormat::Arrow:
+            writer = std::make_unique<ArrowWriter>(file, statement,
+                                                   options.batch_size);
+            break;
+        }
+
+        uint64_t reported_at = now_ns();
+        int status;
+        while ((status = sqlite3_step(statement)) == SQLITE_ROW) {
+            writer->row(statement);
+            progress.rows++;
+
+            if (options.on_progress &&
+                now_ns() - reported_at >= options.progress_interval_ns) {
+                progress.bytes_written = file.written();
+                options.on_progress(progress);
+                reported_at = now_ns();
+            }
+        }
+        if (status != SQLITE_DONE) {
+            throw std::runtime_error("[op-sqlite] Export error at row " +
+                                     std::to_string(progress.rows + 1) +
+                                     ": " + sqlite3_errmsg(db));
+        }
+
+        writer->finish();
+        file.close();
+        progress.bytes_written = file.written();
+    } catch (...) {
+        sqlite3_finalize(statement);
+        std::remove(temp_path.c_str());
+        throw;
+    }
+    sqlite3_finalize(statement);
+
+    std::error_code error;
+    std::filesystem::rename(temp_path, path, error);
+    if (error) {
+        std::remove(temp_path.c_str());
+        throw std::runtime_error("[op-sqlite] Could not move the export to " +
+                                 path + ": " + error.message());
+    }
+
+    if (options.on_progress) {
+        options.on_progress(progress);
+    }
+    return progress;
+}
+
+} // namespace opsqlite
+
+#endif
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "types.h"
+#include <cstdint>
+#include <functional>
+#include <sqlite3.h>
+#include <string>
+#include <vector>
+
+namespace opsqlite {
+
+enum class ExportFormat { Csv, Ndjson, Arrow };
+
+struct ExportProgress {
+    size_t rows;
+    size_t bytes_written;
+};
+
+struct ExportOptions {
+    ExportFormat format = ExportFormat::Csv;
+    /// CSV only, writes the column names first
+    bool header = true;
+    /// Arrow only, rows per record batch. The types of columns without a
+    /// declared type come from the first batch
+    size_t batch_size = 65536;
+    /// Called on the exporting thread every progress_interval_ns at most,
+    /// and once more when the export finished
+    std::function<void(const ExportProgress &)> on_progress;
+    uint64_t progress_interval_ns = 100'000'000;
+};
+
+/// Steps the query and writes every row to the file as it goes, so only one
+/// row, or one record batch for Arrow, is held in memory. The file is written
+/// next to path and renamed once complete, a failed export leaves no file.
+/// Blobs are written as hex in CSV and NDJSON
+ExportProgress export_query(sqlite3 *db, const std::string &query,
+                            const std::vector<JSVariant> *params,
+                            const std::string &path,
+                            const ExportOptions &options);
+
+} // namespace opsqlite
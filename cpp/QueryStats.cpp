@@ -0,0 +1,217 @@
+#include "QueryStats.h"
+
+namespace opsqlite {
+
+static size_t bucket_index(uint64_t ns) {
+    uint64_t us = ns / 1000;
+
+    if (us < 2) {
+        return us;
+    }
+
+    size_t msb = 63 - __builtin_clzll(us);
+    size_t half = (us >> (msb - 1)) & 1;
+    size_t index = msb * 2 + half;
+
+    return index < LatencyHistogram::bucket_count
+               ? index
+               : LatencyHistogram::bucket_count - 1;
+}
+
+/// Middle point of the bucket in microseconds
+static double bucket_value(size_t index) {
+    if (index < 2) {
+        return static_cast<double>(index) + 0.5;
+    }
+
+    size_t msb = index / 2;
+    double width = static_cast<double>(1ULL << (msb - 1));
+    double lower = static_cast<double>(1ULL << msb) + (index % 2) * width;
+
+    return lower + width / 2;
+}
+
+void LatencyHistogram::record(uint64_t ns) {
+    buckets[bucket_index(ns)].fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::count() const {
+    uint64_t total = 0;
+    for (const auto &bucket : buckets) {
+        total += bucket.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+double LatencyHistogram::percentile(double p) const {
+    uint64_t total = count();
+
+    if (total == 0) {
+        return 0;
+    }
+
+    auto target = static_cast<uint64_t>(p * static_cast<double>(total));
+    uint64_t seen = 0;
+
+    for (size_t i = 0; i < bucket_count; i++) {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen > target) {
+            return bucket_value(i) / 1000;
+        }
+    }
+
+    return bucket_value(bucket_count - 1) / 1000;
+}
+
+void LatencyHistogram::reset() {
+    for (auto &bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+// FNV-1a, 0 is reserved for empty entries
+static uint64_t sql_digest(const std::string &sql) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : sql) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash == 0 ? 1 : hash;
+}
+
+QueryStats::Entry *QueryStats::find_entry(uint64_t digest,
+                                          const std::string &sql) {
+    size_t start = digest % max_digests;
+
+    for (size_t i = 0; i < max_digests; i++) {
+        Entry &entry = entries[(start + i) % max_digests];
+        uint64_t current = entry.digest.load(std::memory_order_acquire);
+
+        if (current == digest) {
+            return &entry;
+        }
+
+        if (current != 0) {
+            continue;
+        }
+
+        if (entry.digest.compare_exchange_strong(current, digest,
+                                                 std::memory_order_acq_rel)) {
+            std::lock_guard<std::mutex> lock(sql_mutex);
+            // reset may have cleared the entry while this waited for the lock
+            if (entry.digest.load(std::memory_order_acquire) != digest) {
+                return nullptr;
+            }
+            entry.sql = sql;
+            return &entry;
+        }
+
+        // Lost the race, the entry might have been claimed by the same query
+        if (current == digest) {
+            return &entry;
+        }
+    }
+
+    // Table is full, the sample only counts towards the totals
+    return nullptr;
+}
+
+void QueryStats::record_entry(Entry &entry, const QueryTimings &timings) {
+    const uint64_t stage_ns[query_stage_count] = {
+        timings.queue_ns,           timings.prepare_ns,
+        timings.step_ns,            timings.conversion_ns,
+        timings.materialization_ns, timings.total_ns};
+
+    entry.calls.fetch_add(1, std::memory_order_relaxed);
+    entry.rows.fetch_add(timings.rows, std::memory_order_relaxed);
+    entry.bytes.fetch_add(timings.bytes, std::memory_order_relaxed);
+
+    for (size_t i = 0; i < query_stage_count; i++) {
+        entry.total_ns[i].fetch_add(stage_ns[i], std::memory_order_relaxed);
+        entry.latencies[i].record(stage_ns[i]);
+    }
+}
+
+void QueryStats::record(const std::string &sql, const QueryTimings &timings) {
+    record_entry(totals, timings);
+
+    Entry *entry = find_entry(sql_digest(sql), sql);
+    if (entry != nullptr) {
+        record_entry(*entry, timings);
+    }
+}
+
+void QueryStats::record(const std::string &sql, QueryTimings timings,
+                        uint64_t queued_at, uint64_t materialization_start) {
+    uint64_t now = now_ns();
+    timings.materialization_ns = now - materialization_start;
+    timings.total_ns = now - queued_at;
+    record(sql, timings);
+}
+
+QueryStatsSnapshot QueryStats::snapshot_entry(const Entry &entry) {
+    QueryStatsSnapshot snapshot{
+        .calls = entry.calls.load(std::memory_order_relaxed),
+        .rows = entry.rows.load(std::memory_order_relaxed),
+        .bytes = entry.bytes.load(std::memory_order_relaxed)};
+
+    for (size_t i = 0; i < query_stage_count; i++) {
+        const auto &latency = entry.latencies[i];
+        snapshot.stages[i] = {
+            .count = latency.count(),
+            .total_ms = static_cast<double>(
+                            entry.total_ns[i].load(std::memory_order_relaxed)) /
+                        1e6,
+            .p50_ms = latency.percentile(0.50),
+            .p95_ms = latency.percentile(0.95),
+            .p99_ms = latency.percentile(0.99)};
+    }
+
+    return snapshot;
+}
+
+std::vector<QueryStatsSnapshot> QueryStats::snapshot() {
+    std::vector<QueryStatsSnapshot> snapshots;
+    snapshots.push_back(snapshot_entry(totals));
+
+    std::lock_guard<std::mutex> lock(sql_mutex);
+    for (const auto &entry : entries) {
+        // A digest is claimed before its text is stored under the lock
+        if (entry.digest.load(std::memory_order_acquire) == 0 ||
+            entry.sql.empty()) {
+            continue;
+        }
+
+        auto snapshot = snapshot_entry(entry);
+        snapshot.sql = entry.sql;
+        snapshots.push_back(std::move(snapshot));
+    }
+
+    return snapshots;
+}
+
+void QueryStats::reset_entry(Entry &entry) {
+    entry.calls.store(0, std::memory_order_relaxed);
+    entry.rows.store(0, std::memory_order_relaxed);
+    entry.bytes.store(0, std::memory_order_relaxed);
+
+    for (size_t i = 0; i < query_stage_count; i++) {
+        entry.total_ns[i].store(0, std::memory_order_relaxed);
+        entry.latencies[i].reset();
+    }
+}
+
+// Samples recorded while resetting may be partially kept, which is fine for
+// statistics
+void QueryStats::reset() {
+    reset_entry(totals);
+
+    std::lock_guard<std::mutex> lock(sql_mutex);
+    for (auto &entry : entries) {
+        reset_entry(entry);
+        entry.sql.clear();
+        entry.digest.store(0, std::memory_order_release);
+    }
+}
+
+} // namespace opsqlite
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "types.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace opsqlite {
+
+/// Monotonic clock used to time every query stage
+inline uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+enum class QueryStage : size_t {
+    QueueWait = 0,
+    Prepare,
+    Step,
+    Conversion,
+    Materialization,
+    Total,
+    Count
+};
+
+constexpr size_t query_stage_count = static_cast<size_t>(QueryStage::Count);
+
+/// Log-linear histogram of latencies, two buckets per power of two of
+/// microseconds. Buckets are plain atomics so recording never blocks
+class LatencyHistogram {
+  public:
+    static constexpr size_t bucket_count = 64;
+
+    void record(uint64_t ns);
+    uint64_t count() const;
+    /// Returns the latency in milliseconds at the given percentile (0-1)
+    double percentile(double p) const;
+    void reset();
+
+  private:
+    std::array<std::atomic<uint32_t>, bucket_count> buckets{};
+};
+
+struct StageSnapshot {
+    uint64_t count;
+    double total_ms;
+    double p50_ms;
+    double p95_ms;
+    double p99_ms;
+};
+
+struct QueryStatsSnapshot {
+    std::string sql;
+    uint64_t calls;
+    uint64_t rows;
+    uint64_t bytes;
+    std::array<StageSnapshot, query_stage_count> stages;
+};
+
+/// Per database timing and throughput counters. Samples are aggregated
+/// globally and per SQL digest (a hash of the query text), the digest table
+/// is a fixed size open addressing table claimed with compare and swap
+class QueryStats {
+  public:
+    static constexpr size_t max_digests = 64;
+
+    void record(const std::string &sql, const QueryTimings &timings);
+    /// Fills the JSI materialization and total stages before recording,
+    /// meant to be called right after the JS result has been created
+    void record(const std::string &sql, QueryTimings timings,
+                uint64_t queued_at, uint64_t materialization_start);
+    /// First element contains the totals across every query
+    std::vector<QueryStatsSnapshot> snapshot();
+    void reset();
+
+  private:
+    struct Entry {
+        std::atomic<uint64_t> digest{0};
+        std::string sql;
+        std::atomic<uint64_t> calls{0};
+        std::atomic<uint64_t> rows{0};
+        std::atomic<uint64_t> bytes{0};
+        std::array<std::atomic<uint64_t>, query_stage_count> total_ns{};
+        std::array<LatencyHistogram, query_stage_count> latencies;
+    };
+
+    Entry *find_entry(uint64_t digest, const std::string &sql);
+    static void record_entry(Entry &entry, const QueryTimings &timings);
+    static QueryStatsSnapshot snapshot_entry(const Entry &entry);
+    static void reset_entry(Entry &entry);
+
+    Entry totals;
+    std::array<Entry, max_digests> entries;
+    // Only guards the SQL text, which is written once when a digest claims
+    // an entry
+    std::mutex sql_mutex;
+};
+
+} // namespace opsqlite
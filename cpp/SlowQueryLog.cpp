@@ -0,0 +1,80 @@
+#include "SlowQueryLog.h"
+#include <algorithm>
+
+namespace opsqlite {
+
+void SlowQueryLog::configure(uint64_t threshold_ns, size_t new_capacity) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (new_capacity == 0) {
+        new_capacity = default_capacity;
+    }
+
+    if (new_capacity != capacity) {
+        // Keep the most recent entries that still fit
+        std::vector<SlowQuery> ordered;
+        ordered.reserve(buffer.size());
+        for (size_t i = 0; i < buffer.size(); i++) {
+            ordered.push_back(
+                std::move(buffer[(next + i) % buffer.size()]));
+        }
+
+        size_t keep = std::min(ordered.size(), new_capacity);
+        buffer.assign(std::make_move_iterator(ordered.end() - keep),
+                      std::make_move_iterator(ordered.end()));
+        capacity = new_capacity;
+        next = buffer.size() % capacity;
+    }
+
+    threshold.store(threshold_ns, std::memory_order_relaxed);
+}
+
+void SlowQueryLog::push(SlowQuery query) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    query.id = next_id++;
+
+    if (buffer.size() < capacity) {
+        buffer.push_back(std::move(query));
+        next = buffer.size() % capacity;
+        return;
+    }
+
+    buffer[next] = std::move(query);
+    next = (next + 1) % capacity;
+}
+
+std::vector<SlowQuery> SlowQueryLog::entries() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::vector<SlowQuery> ordered;
+    ordered.reserve(buffer.size());
+
+    // Once the buffer is full next points to the oldest entry
+    size_t start = buffer.size() < capacity ? 0 : next;
+    for (size_t i = 0; i < buffer.size(); i++) {
+        ordered.push_back(buffer[(start + i) % buffer.size()]);
+    }
+
+    return ordered;
+}
+
+void SlowQueryLog::set_query_plan(uint64_t id, const std::string &query_plan) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (auto &query : buffer) {
+        if (query.id == id) {
+            query.query_plan = query_plan;
+            query.has_query_plan = true;
+            return;
+        }
+    }
+}
+
+void SlowQueryLog::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    buffer.clear();
+    next = 0;
+}
+
+} // namespace opsqlite
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace opsqlite {
+
+struct SlowQuery {
+    uint64_t id;
+    // Milliseconds since epoch when the statement finished
+    double timestamp;
+    double duration_ms;
+    // SQL with the bound parameters expanded in place
+    std::string sql;
+    int fullscan_steps;
+    int sorts;
+    int autoindexes;
+    int vm_steps;
+    // Filled lazily when the log is read, running EXPLAIN QUERY PLAN inside
+    // the trace callback is not safe
+    std::string query_plan;
+    bool has_query_plan;
+};
+
+/// Bounded ring buffer of statements that took longer than the threshold.
+/// Written from the sqlite trace callback on whatever thread ran the
+/// statement, so every access is guarded
+class SlowQueryLog {
+  public:
+    static constexpr size_t default_capacity = 50;
+
+    /// A threshold of 0 disables the log
+    void configure(uint64_t threshold_ns, size_t capacity);
+    uint64_t threshold_ns() const {
+        return threshold.load(std::memory_order_relaxed);
+    }
+    void push(SlowQuery query);
+    /// Oldest entry first
+    std::vector<SlowQuery> entries();
+    void set_query_plan(uint64_t id, const std::string &query_plan);
+    void clear();
+
+  private:
+    std::atomic<uint64_t> threshold{0};
+    std::mutex mutex;
+    std::vector<SlowQuery> buffer;
+    size_t capacity = default_capacity;
+    size_t next = 0;
+    uint64_t next_id = 1;
+};
+
+} // namespace opsqlite
@@ -0,0 +1,578 @@
+#ifndef OP_SQLITE_USE_LIBSQL
+
+#include "SqlImport.h"
+#include "QueryStats.h"
+#include "utils.h"
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace opsqlite {
+
+namespace {
+
+/// Dumps have one INSERT shape per table, the cache is cleared when full
+constexpr size_t max_cached_statements = 64;
+/// Lowest SQLITE_MAX_VARIABLE_NUMBER of the supported builds, INSERTs with
+/// more values are executed as they are
+constexpr size_t max_literals = 999;
+
+struct Literal {
+    enum class Type { Null, Integer, Real, Text, Blob } type;
+    sqlite3_int64 integer = 0;
+    double real = 0;
+    std::string bytes;
+};
+
+/// An INSERT with its literal values replaced by parameters. Literals are
+/// reused between statements so their buffers are only allocated once
+struct Shape {
+    std::string sql;
+    std::vector<Literal> literals;
+    size_t count = 0;
+
+    Literal &next() {
+        if (count == literals.size()) {
+            literals.emplace_back();
+        }
+        return literals[count++];
+    }
+};
+
+bool is_identifier_start(char c) {
+    return std::isalpha(static_cast<unsigned char>(c)) || c == '_' ||
+           static_cast<unsigned char>(c) >= 0x80;
+}
+
+bool is_identifier_char(char c) {
+    return is_identifier_start(c) ||
+           std::isdigit(static_cast<unsigned char>(c)) || c == '$';
+}
+
+bool is_digit(char c) { return std::isdigit(static_cast<unsigned char>(c)); }
+
+bool is_keyword(std::string_view word, std::string_view keyword) {
+    if (word.size() != keyword.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < word.size(); i++) {
+        if (std::toupper(static_cast<unsigned char>(word[i])) != keyword[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Index after the closing quote, '' and "" escape the quote
+size_t skip_quoted(std::string_view sql, size_t i, char quote) {
+    for (i++; i < sql.size(); i++) {
+        if (sql[i] == quote) {
+            if (i + 1 < sql.size() && sql[i + 1] == quote) {
+                i++;
+            } else {
+                return i + 1;
+            }
+        }
+    }
+    return std::string_view::npos;
+}
+
+/// Index after the comment starting at i, or i when there is none
+size_t skip_comment(std::string_view sql, size_t i) {
+    if (sql.compare(i, 2, "--") == 0) {
+        auto end = sql.find('\n', i);
+        return end == std::string_view::npos ? sql.size() : end + 1;
+    }
+    if (sql.compare(i, 2, "/*") == 0) {
+        auto end = sql.find("*/", i + 2);
+        return end == std::string_view::npos ? sql.size() : end + 2;
+    }
+    return i;
+}
+
+std::string_view first_keyword(std::string_view sql) {
+    size_t i = 0;
+    while (i < sql.size()) {
+        if (std::isspace(static_cast<unsigned char>(sql[i]))) {
+            i++;
+            continue;
+        }
+        auto next = skip_comment(sql, i);
+        if (next == i) {
+            break;
+        }
+        i = next;
+    }
+
+    size_t start = i;
+    while (i < sql.size() && is_identifier_char(sql[i])) {
+        i++;
+    }
+    return sql.substr(start, i - start);
+}
+
+int hex_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+}
+
+/// Same conversions sqlite applies to numeric literals: integers that do not
+/// fit in 64 bits become reals, hex literals are 64 bit two's complement
+bool parse_number(std::string_view token, bool hex, Literal &literal,
+                  std::string &buffer) {
+    bool negative = token.front() == '-';
+    if (token.front() == '-' || token.front() == '+') {
+        token.remove_prefix(1);
+    }
+    buffer.assign(token);
+    errno = 0;
+
+    if (hex) {
+        auto value = std::strtoull(buffer.c_str() + 2, nullptr, 16);
+        if (errno == ERANGE) {
+            return false;
+        }
+        literal.type = Literal::Type::Integer;
+        literal.integer = static_cast<sqlite3_int64>(value);
+        literal.integer = negative ? -literal.integer : literal.integer;
+        return true;
+    }
+
+    if (buffer.find_first_of(".eE") == std::string::npos) {
+        // The sign is parsed too so INT64_MIN does not overflow
+        buffer.insert(0, negative ? "-" : "");
+        auto value = std::strtoll(buffer.c_str(), nullptr, 10);
+        if (errno != ERANGE) {
+            literal.type = Literal::Type::Integer;
+            literal.integer = value;
+            return true;
+        }
+        buffer.erase(0, negative ? 1 : 0);
+    }
+
+    literal.type = Literal::Type::Real;
+    literal.real = std::strtod(buffer.c_str(), nullptr);
+    literal.real = negative ? -literal.real : literal.real;
+    return true;
+}
+
+/// Replaces the literals after VALUES with parameters and collects them.
+/// Whitespace and comments are collapsed so the same INSERT written
+/// differently maps to one statement. Returns false for anything it does not
+/// understand, that statement is then executed as it is
+bool to_shape(std::string_view sql, Shape &shape, std::string &buffer) {
+    shape.sql.clear();
+    shape.count = 0;
+    bool in_values = false;
+    char last = 0;
+    size_t i = 0;
+    size_t n = sql.size();
+
+    auto append = [&](std::string_view token) {
+        shape.sql.append(token);
+        last = token.back();
+    };
+
+    while (i < n) {
+        char c = sql[i];
+
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            i++;
+            if (!shape.sql.empty() && shape.sql.back() != ' ') {
+                shape.sql += ' ';
+            }
+            continue;
+        }
+
+        auto after_comment = skip_comment(sql, i);
+        if (after_comment != i) {
+            i = after_comment;
+            continue;
+        }
+
+        if (c == '\'' || c == '"' || c == '`') {
+            auto end = skip_quoted(sql, i, c);
+            if (end == std::string_view::npos) {
+                return false;
+            }
+            if (in_values && c == '\'') {
+                auto &literal = shape.next();
+                literal.type = Literal::Type::Text;
+                literal.bytes.clear();
+                for (size_t j = i + 1; j < end - 1; j++) {
+                    literal.bytes += sql[j];
+                    j += sql[j] == '\'' ? 1 : 0;
+                }
+                append("?");
+            } else {
+                append(sql.substr(i, end - i));
+            }
+            i = end;
+            continue;
+        }
+
+        if (c == '[') {
+            auto end = sql.find(']', i);
+            if (end == std::string_view::npos) {
+                return false;
+            }
+            append(sql.substr(i, end + 1 - i));
+            i = end + 1;
+            continue;
+        }
+
+        if ((c == 'x' || c == 'X') && i + 1 < n && sql[i + 1] == '\'') {
+            auto end = skip_quoted(sql, i + 1, '\'');
+            if (end == std::string_view::npos) {
+                return false;
+            }
+            if (in_values) {
+                auto hex = sql.substr(i + 2, end - i - 3);
+                if (hex.size() % 2 != 0) {
+                    return false;
+                }
+                auto &literal = shape.next();
+                literal.type = Literal::Type::Blob;
+                literal.bytes.resize(hex.size() / 2);
+                for (size_t j = 0; j < hex.size(); j += 2) {
+                    int high = hex_value(hex[j]);
+                    int low = hex_value(hex[j + 1]);
+                    if (high < 0 || low < 0) {
+                        return false;
+                    }
+                    literal.bytes[j / 2] = static_cast<char>(high * 16 + low);
+                }
+                append("?");
+            } else {
+                append(sql.substr(i, end - i));
+            }
+            i = end;
+            continue;
+        }
+
+        // A sign right after ( or , belongs to the literal, elsewhere it is
+        // an operator
+        bool sign = (c == '-' || c == '+') && in_values &&
+                    (last == '(' || last == ',') && i + 1 < n &&
+                    (is_digit(sql[i + 1]) || sql[i + 1] == '.');
+
+        if (is_digit(c) || sign ||
+            (c == '.' && i + 1 < n && is_digit(sql[i + 1]))) {
+            size_t start = i;
+            i += sign ? 1 : 0;
+            bool hex = sql.compare(i, 2, "0x") == 0 ||
+                       sql.compare(i, 2, "0X") == 0;
+
+            if (hex) {
+                i += 2;
+                while (i < n && hex_value(sql[i]) >= 0) {
+                    i++;
+                }
+            } else {
+                while (i < n && (is_digit(sql[i]) || sql[i] == '.')) {
+                    i++;
+                }
+                if (i < n && (sql[i] == 'e' || sql[i] == 'E')) {
+                    i++;
+                    if (i < n && (sql[i] == '+' || sql[i] == '-')) {
+                        i++;
+                    }
+                    while (i < n && is_digit(sql[i])) {
+                        i++;
+                    }
+                }
+            }
+
+            // e.g. digit separators, left to sqlite
+            if (i < n && is_identifier_char(sql[i])) {
+                return false;
+            }
+
+            auto token = sql.substr(start, i - start);
+            if (!in_values) {
+                append(token);
+                continue;
+            }
+            if (!parse_number(token, hex, shape.next(), buffer)) {
+                return false;
+            }
+            append("?");
+            continue;
+        }
+
+        if (is_identifier_start(c)) {
+            size_t start = i;
+            while (i < n && is_identifier_char(sql[i])) {
+                i++;
+            }
+            auto word = sql.substr(start, i - start);
+
+            if (in_values && is_keyword(word, "NULL")) {
+                shape.next().type = Literal::Type::Null;
+                append("?");
+                continue;
+            }
+            if (is_keyword(word, "VALUES")) {
+                in_values = true;
+            }
+            append(word);
+            continue;
+        }
+
+        append(sql.substr(i, 1));
+        i++;
+    }
+
+    return in_values && shape.count <= max_literals;
+}
+
+class Importer {
+  public:
+    explicit Importer(sqlite3 *db) : db(db) {}
+
+    ~Importer() { clear_statements(); }
+
+    /// Returns false when the statement was skipped
+    bool run(std::string_view sql, size_t offset, int &changes) {
+        auto keyword = first_keyword(sql);
+        if (is_keyword(keyword, "BEGIN") || is_keyword(keyword, "COMMIT") ||
+            is_keyword(keyword, "END")) {
+            return false;
+        }
+
+        auto total_changes = sqlite3_total_changes(db);
+        bool ran = false;
+
+        if ((is_keyword(keyword, "INSERT") || is_keyword(keyword, "REPLACE")) &&
+            to_shape(sql, shape, buffer)) {
+            ran = run_shape(offset);
+        }
+        if (!ran) {
+            ran = run_text(sql, offset);
+        }
+
+        changes = sqlite3_total_changes(db) - total_changes;
+        return ran;
+    }
+
+  private:
+    sqlite3 *db;
+    std::unordered_map<std::string, sqlite3_stmt *> statements;
+    Shape shape;
+    std::string buffer;
+
+    void clear_statements() {
+        for (auto &[_, statement] : statements) {
+            sqlite3_finalize(statement);
+        }
+        statements.clear();
+    }
+
+    [[noreturn]] void fail(size_t offset) {
+        throw std::runtime_error("[op-sqlite] SQL import error at byte " +
+                                 std::to_string(offset) + ": " +
+                                 sqlite3_errmsg(db));
+    }
+
+    void step(sqlite3_stmt *statement, size_t offset) {
+        int status;
+        while ((status = sqlite3_step(statement)) == SQLITE_ROW) {
+        }
+        if (status != SQLITE_DONE) {
+            fail(offset);
+        }
+    }
+
+    /// Returns false when the shape cannot be prepared, e.g. because it has
+    /// more parameters than this build allows
+    bool run_shape(size_t offset) {
+        auto cached = statements.find(shape.sql);
+        sqlite3_stmt *statement;
+
+        if (cached != statements.end()) {
+            statement = cached->second;
+            sqlite3_reset(statement);
+        } else {
+            if (sqlite3_prepare_v2(db, shape.sql.c_str(),
+                                   static_cast<int>(shape.sql.size()),
+                                   &statement, nullptr) != SQLITE_OK) {
+                return false;
+            }
+            if (statements.size() >= max_cached_statements) {
+                clear_statements();
+            }
+            statements.emplace(shape.sql, statement);
+        }
+
+        for (size_t i = 0; i < shape.count; i++) {
+            const auto &literal = shape.literals[i];
+            int index = static_cast<int>(i) + 1;
+
+            switch (literal.type) {
+            case Literal::Type::Null:
+                sqlite3_bind_null(statement, index);
+                break;
+            case Literal::Type::Integer:
+                sqlite3_bind_int64(statement, index, literal.integer);
+                break;
+            case Literal::Type::Real:
+                sqlite3_bind_double(statement, index, literal.real);
+                break;
+            // The literals are not touched until the statement ran
+            case Literal::Type::Text:
+                sqlite3_bind_text(statement, index, literal.bytes.data(),
+                                  static_cast<int>(literal.bytes.size()),
+                                  SQLITE_STATIC);
+                break;
+            case Literal::Type::Blob:
+                sqlite3_bind_blob(statement, index, literal.bytes.data(),
+                                  static_cast<int>(literal.bytes.size()),
+                                  SQLITE_STATIC);
+                break;
+            }
+        }
+
+        try {
+            step(statement, offset);
+        } catch (...) {
+            sqlite3_reset(statement);
+            throw;
+        }
+        sqlite3_reset(statement);
+        return true;
+    }
+
+    /// Returns false for statements that are only whitespace or comments
+    bool run_text(std::string_view sql, size_t offset) {
+        sqlite3_stmt *statement = nullptr;
+        if (sqlite3_prepare_v2(db, sql.data(), static_cast<int>(sql.size()),
+                               &statement, nullptr) != SQLITE_OK) {
+            fail(offset);
+        }
+        if (statement == nullptr) {
+            return false;
+        }
+
+        try {
+            step(statement, offset);
+        } catch (...) {
+            sqlite3_finalize(statement);
+            throw;
+        }
+        sqlite3_finalize(statement);
+        return true;
+    }
+};
+
+void exec(sqlite3 *db, const char *sql) {
+    if (sqlite3_exec(db, sql, nullptr, nullptr, nullptr) != SQLITE_OK) {
+        throw std::runtime_error(std::string("[op-sqlite] Import error: ") +
+                                 sqlite3_errmsg(db));
+    }
+}
+
+} // namespace
+
+ImportRun::ImportRun(sqlite3 *db, const ImportOptions &options,
+                     size_t total_bytes)
+    : db(db), options(options), progress{0, total_bytes, 0, 0},
+      reported_at(now_ns()) {
+    exec(db, "BEGIN EXCLUSIVE TRANSACTION");
+    in_transaction = true;
+}
+
+ImportRun::~ImportRun() {
+    if (in_transaction) {
+        sqlite3_exec(db, "ROLLBACK", nullptr, nullptr, nullptr);
+    }
+}
+
+void ImportRun::add(size_t bytes_read, int changes) {
+    progress.bytes_read = bytes_read;
+    progress.commands++;
+    progress.affected_rows += changes;
+    chunk_commands++;
+
+    if (options.chunk_size > 0 && chunk_commands >= options.chunk_size) {
+        in_transaction = false;
+        exec(db, "COMMIT");
+        exec(db, "BEGIN EXCLUSIVE TRANSACTION");
+        in_transaction = true;
+        chunk_commands = 0;
+    }
+
+    if (options.on_progress &&
+        now_ns() - reported_at >= options.progress_interval_ns) {
+        options.on_progress(progress);
+        reported_at = now_ns();
+    }
+}
+
+BatchResult ImportRun::finish() {
+    progress.bytes_read = progress.total_bytes;
+    exec(db, "COMMIT");
+    in_transaction = false;
+
+    if (options.on_progress) {
+        options.on_progress(progress);
+    }
+    return {"", progress.affected_rows, progress.commands};
+}
+
+BatchResult import_sql_file(sqlite3 *db, const std::string &path,
+                            const ImportOptions &options) {
+    std::error_code error;
+    auto total = static_cast<size_t>(std::filesystem::file_size(path, error));
+    if (error) {
+        throw std::runtime_error("Could not open file: " + path);
+    }
+    if (total == 0) {
+        return {"", 0, 0};
+    }
+
+    auto file = map_file(path);
+    const char *data = reinterpret_cast<const char *>(file.data.get());
+
+    Importer importer(db);
+    ImportRun run(db, options, total);
+    // sqlite3_complete needs a NUL terminated string
+    std::string statement;
+    size_t start = 0;
+    size_t searched = 0;
+
+    while (start < total) {
+        auto *semicolon = static_cast<const char *>(
+            memchr(data + searched, ';', total - searched));
+        size_t end = semicolon ? semicolon - data + 1 : total;
+        statement.append(data + searched, end - searched);
+        searched = end;
+
+        // The semicolon is inside a string or a trigger body
+        if (semicolon && !sqlite3_complete(statement.c_str())) {
+            continue;
+        }
+
+        int changes = 0;
+        if (importer.run(statement, start, changes)) {
+            run.add(end, changes);
+        }
+
+        statement.clear();
+        start = end;
+    }
+
+    return run.finish();
+}
+
+} // namespace opsqlite
+
+#endif
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "types.h"
+#include <cstdint>
+#include <functional>
+#include <sqlite3.h>
+#include <string>
+
+namespace opsqlite {
+
+struct ImportProgress {
+    size_t bytes_read;
+    size_t total_bytes;
+    int commands;
+    int affected_rows;
+};
+
+struct ImportOptions {
+    /// Statements per transaction, 0 imports the whole file in one
+    size_t chunk_size = 0;
+    /// Called on the importing thread every progress_interval_ns at most,
+    /// and once more when the import finished
+    std::function<void(const ImportProgress &)> on_progress;
+    uint64_t progress_interval_ns = 100'000'000;
+};
+
+/// Transaction and progress bookkeeping shared by the importers. Starts an
+/// exclusive transaction, commits every chunk_size statements and rolls the
+/// current chunk back if it is destroyed before finish
+class ImportRun {
+  public:
+    ImportRun(sqlite3 *db, const ImportOptions &options, size_t total_bytes);
+    ~ImportRun();
+
+    /// Counts one statement, bytes_read is the file offset after it
+    void add(size_t bytes_read, int changes);
+    /// Commits and reports the final progress
+    BatchResult finish();
+
+  private:
+    sqlite3 *db;
+    const ImportOptions &options;
+    ImportProgress progress;
+    size_t chunk_commands = 0;
+    uint64_t reported_at;
+    bool in_transaction = false;
+};
+
+/// Executes the statements of a SQL file, e.g. a dump written by the sqlite3
+/// shell. The file is memory mapped and split into complete statements, which
+/// may span lines. INSERTs that only differ in their values share a prepared
+/// statement. BEGIN and COMMIT in the file are skipped since the import runs
+/// its own transactions. Throws on the first error after rolling back the
+/// current transaction, earlier chunks stay committed
+BatchResult import_sql_file(sqlite3 *db, const std::string &path,
+                            const ImportOptions &options = {});
+
+} // namespace opsqlite
@@ -0,0 +1,729 @@
+#ifndef OP_SQLITE_USE_LIBSQL
+
+#include "TableImport.h"
+#include "utils.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+
+namespace opsqlite {
+
+namespace {
+
+enum class Affinity { Integer, Real, Numeric, Text, Blob };
+
+/// A record that cannot be read or inserted, reported with its position
+struct RowError : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+/// Same rules sqlite uses to derive the affinity of a declared type
+Affinity affinity_of(std::string type) {
+    for (auto &c : type) {
+        c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    }
+    auto has = [&](const char *name) {
+        return type.find(name) != std::string::npos;
+    };
+
+    if (has("INT")) {
+        return Affinity::Integer;
+    }
+    if (has("CHAR") || has("CLOB") || has("TEXT")) {
+        return Affinity::Text;
+    }
+    if (has("BLOB") || type.empty()) {
+        return Affinity::Blob;
+    }
+    if (has("REAL") || has("FLOA") || has("DOUB")) {
+        return Affinity::Real;
+    }
+    return Affinity::Numeric;
+}
+
+/// Parses integers written the canonical way, anything else is bound as
+/// text and left to sqlite
+bool parse_integer(std::string_view text, sqlite3_int64 &value) {
+    size_t i = text.size() > 1 && text[0] == '-' ? 1 : 0;
+    if (text.size() == i || text.size() - i > 19) {
+        return false;
+    }
+
+    uint64_t magnitude = 0;
+    for (size_t j = i; j < text.size(); j++) {
+        if (text[j] < '0' || text[j] > '9') {
+            return false;
+        }
+        magnitude = magnitude * 10 + static_cast<uint64_t>(text[j] - '0');
+    }
+
+    uint64_t limit = static_cast<uint64_t>(INT64_MAX) + (i == 1 ? 1 : 0);
+    if (magnitude > limit) {
+        return false;
+    }
+    value = i == 1 ? static_cast<sqlite3_int64>(0 - magnitude)
+                   : static_cast<sqlite3_int64>(magnitude);
+    return true;
+}
+
+/// One INSERT for the whole import, the column names are checked against the
+/// table up front so a typo fails before any row is read
+class TableInserter {
+  public:
+    std::vector<Affinity> affinities;
+
+    TableInserter(sqlite3 *db, const std::string &table,
+                  std::vector<std::string> &columns)
+        : db(db) {
+        auto table_columns = read_columns(table);
+        if (columns.empty()) {
+            for (const auto &[name, _] : table_columns) {
+                columns.push_back(name);
+            }
+        }
+
+        std::string sql = "INSERT INTO " + quote_identifier(table) + " (";
+        std::string values;
+        for (const auto &column : columns) {
+            auto match = std::find_if(
+                table_columns.begin(), table_columns.end(),
+                [&](const auto &entry) {
+                    return sqlite3_stricmp(entry.first.c_str(),
+                                           column.c_str()) == 0;
+                });
+            if (match == table_columns.end()) {
+                throw std::runtime_error("[op-sqlite] Table " + table +
+                                         " has no column named " + column);
+            }
+
+            sql += (affinities.empty() ? "" : ", ") + quote_identifier(column);
+            values += affinities.empty() ? "?" : ", ?";
+            affinities.push_back(match->second);
+        }
+        sql += ") VALUES (" + values + ")";
+
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &statement, nullptr) !=
+            SQLITE_OK) {
+            throw std::runtime_error("[op-sqlite] " +
+                                     std::string(sqlite3_errmsg(db)));
+        }
+    }
+
+    ~TableInserter() { sqlite3_finalize(statement); }
+
+    void bind_null(int index) { sqlite3_bind_null(statement, index + 1); }
+
+    void bind_integer(int index, sqlite3_int64 value) {
+        sqlite3_bind_int64(statement, index + 1, value);
+    }
+
+    void bind_real(int index, double value) {
+        sqlite3_bind_double(statement, index + 1, value);
+    }
+
+    /// The text has to stay valid until insert returned
+    void bind_text(int index, std::string_view text) {
+        sqlite3_bind_text(statement, index + 1, text.data(),
+                          static_cast<int>(text.size()), SQLITE_STATIC);
+    }
+
+    /// Returns the rows changed
+    int insert() {
+        int status = sqlite3_step(statement);
+        sqlite3_reset(statement);
+        if (status != SQLITE_DONE) {
+            throw RowError(sqlite3_errmsg(db));
+        }
+        return sqlite3_changes(db);
+    }
+
+  private:
+    sqlite3 *db;
+    sqlite3_stmt *statement = nullptr;
+
+    std::vector<std::pair<std::string, Affinity>>
+    read_columns(const std::string &table) {
+        sqlite3_stmt *info;
+        sqlite3_prepare_v2(db, "SELECT name, type FROM pragma_table_info(?)",
+                           -1, &info, nullptr);
+        sqlite3_bind_text(info, 1, table.c_str(), -1, SQLITE_TRANSIENT);
+
+        std::vector<std::pair<std::string, Affinity>> columns;
+        while (sqlite3_step(info) == SQLITE_ROW) {
+            auto name = sqlite3_column_text(info, 0);
+            auto type = sqlite3_column_text(info, 1);
+            columns.emplace_back(
+                reinterpret_cast<const char *>(name),
+                affinity_of(type ? reinterpret_cast<const char *>(type) : ""));
+        }
+        sqlite3_finalize(info);
+
+        if (columns.empty()) {
+            throw std::runtime_error("[op-sqlite] Table " + table +
+                                     " does not exist");
+        }
+        return columns;
+    }
+};
+
+struct MappedFile {
+    ArrayBuffer buffer;
+    const char *data = nullptr;
+    size_t size = 0;
+};
+
+MappedFile open_file(const std::string &path) {
+    std::error_code error;
+    auto size = static_cast<size_t>(std::filesystem::file_size(path, error));
+    if (error) {
+        throw std::runtime_error("Could not open file: " + path);
+    }
+
+    MappedFile file;
+    if (size > 0) {
+        file.buffer = map_file(path);
+        file.data = reinterpret_cast<const char *>(file.buffer.data.get());
+        file.size = size;
+    }
+    return file;
+}
+
+/// Index of the first delimiter, \n or \r at or after i. Compares 8 bytes
+/// at a time with the has-zero-byte trick, which needs no platform
+/// intrinsics and still beats a byte loop on arm64 and x86_64
+size_t find_field_end(const char *data, size_t i, size_t size,
+                      char delimiter) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    constexpr uint64_t ones = 0x0101010101010101ULL;
+    constexpr uint64_t highs = 0x8080808080808080ULL;
+    const uint64_t delimiters = ones * static_cast<unsigned char>(delimiter);
+    auto zero_bytes = [](uint64_t x) { return (x - ones) & ~x & highs; };
+
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        uint64_t found = zero_bytes(word ^ delimiters) |
+                         zero_bytes(word ^ (ones * '\n')) |
+                         zero_bytes(word ^ (ones * '\r'));
+        // Only the lowest flagged byte is exact, which is the one we need
+        if (found != 0) {
+            return i + static_cast<size_t>(__builtin_ctzll(found)) / 8;
+        }
+    }
+#endif
+    while (i < size && data[i] != delimiter && data[i] != '\n' &&
+           data[i] != '\r') {
+        i++;
+    }
+    return i;
+}
+
+struct CsvField {
+    std::string_view value;
+    bool null = false;
+    /// Holds quoted values with "" escapes
+    std::string unescaped;
+};
+
+/// value may point into unescaped, so fields must not move once read. A
+/// deque keeps them in place while the first record adds fields
+using CsvFields = std::deque<CsvField>;
+
+class CsvReader {
+  public:
+    CsvReader(const char *data, size_t size, char delimiter)
+        : data(data), size(size), delimiter(delimiter) {
+        if (size >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0) {
+            offset = 3;
+        }
+    }
+
+    size_t position() const { return offset; }
+
+    /// Reads the next record, false at the end of the file. Empty lines are
+    /// skipped
+    bool next(CsvFields &fields, size_t &count) {
+        while (offset < size &&
+               (data[offset] == '\n' || data[offset] == '\r')) {
+            offset++;
+        }
+        if (offset >= size) {
+            return false;
+        }
+
+        count = 0;
+        while (true) {
+            if (count == fields.size()) {
+                fields.emplace_back();
+            }
+            auto &field = fields[count++];
+
+            if (offset < size && data[offset] == '"') {
+                read_quoted(field);
+            } else {
+                size_t end = find_field_end(data, offset, size, delimiter);
+                field.value = std::string_view(data + offset, end - offset);
+                field.null = field.value.empty();
+                offset = end;
+            }
+
+            if (offset < size && data[offset] == delimiter) {
+                offset++;
+                continue;
+            }
+            if (offset < size && data[offset] == '\r') {
+                offset++;
+            }
+            if (offset < size && data[offset] == '\n') {
+                offset++;
+            }
+            return true;
+        }
+    }
+
+  private:
+    const char *data;
+    size_t size;
+    char delimiter;
+    size_t offset = 0;
+
+    void read_quoted(CsvField &field) {
+        size_t start = ++offset;
+        bool escaped = false;
+        field.unescaped.clear();
+        field.null = false;
+
+        while (true) {
+            auto *quote = static_cast<const char *>(
+                memchr(data + offset, '"', size - offset));
+            if (quote == nullptr) {
+                throw RowError("unterminated quoted field");
+            }
+            size_t end = quote - data;
+
+            if (end + 1 < size && data[end + 1] == '"') {
+                field.unescaped.append(data + offset, end + 1 - offset);
+                escaped = true;
+                offset = end + 2;
+                continue;
+            }
+
+            if (escaped) {
+                field.unescaped.append(data + offset, end - offset);
+                field.value = field.unescaped;
+            } else {
+                field.value = std::string_view(data + start, end - start);
+            }
+            offset = end + 1;
+            break;
+        }
+
+        if (offset < size && data[offset] != delimiter &&
+            data[offset] != '\n' && data[offset] != '\r') {
+            throw RowError("unexpected character after a quoted field");
+        }
+    }
+};
+
+struct JsonValue {
+    enum class Type { Null, Integer, Real, Text } type = Type::Null;
+    sqlite3_int64 integer = 0;
+    double real = 0;
+    std::string_view text;
+    std::string buffer;
+};
+
+void append_utf8(std::string &out, uint32_t code) {
+    if (code < 0x80) {
+        out += static_cast<char>(code);
+    } else if (code < 0x800) {
+        out += static_cast<char>(0xC0 | (code >> 6));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+        out += static_cast<char>(0xE0 | (code >> 12));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (code >> 18));
+        out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    }
+}
+
+/// Parser for the flat objects of a NDJSON line. Values point into the line
+/// unless they had escapes
+class JsonLine {
+  public:
+    JsonLine(const char *begin, const char *end) : p(begin), end(end) {}
+
+    /// Calls on_value(key, value) for every member
+    template <typename F> void parse_object(F &&on_value) {
+        skip_whitespace();
+        expect('{');
+        skip_whitespace();
+        if (peek() == '}') {
+            p++;
+        } else {
+            while (true) {
+                skip_whitespace();
+                parse_string(key);
+                skip_whitespace();
+                expect(':');
+                skip_whitespace();
+                on_value(key.text, [this](JsonValue &value) {
+                    parse_value(value);
+                });
+                skip_whitespace();
+                if (peek() == ',') {
+                    p++;
+                    continue;
+                }
+                expect('}');
+                break;
+            }
+        }
+        skip_whitespace();
+        if (p != end) {
+            throw RowError("unexpected data after the object");
+        }
+    }
+
+  private:
+    const char *p;
+    const char *end;
+    JsonValue key;
+    std::string number;
+
+    char peek() const { return p < end ? *p : '\0'; }
+
+    void expect(char c) {
+        if (peek() != c) {
+            throw RowError(std::string("expected '") + c + "'");
+        }
+        p++;
+    }
+
+    void skip_whitespace() {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+            p++;
+        }
+    }
+
+    bool skip_word(const char *word) {
+        size_t length = strlen(word);
+        if (static_cast<size_t>(end - p) < length ||
+            memcmp(p, word, length) != 0) {
+            return false;
+        }
+        p += length;
+        return true;
+    }
+
+    uint32_t read_hex4() {
+        if (end - p < 4) {
+            throw RowError("invalid \\u escape");
+        }
+        uint32_t code = 0;
+        for (int i = 0; i < 4; i++, p++) {
+            char c = static_cast<char>(
+                std::tolower(static_cast<unsigned char>(*p)));
+            if (c >= '0' && c <= '9') {
+                code = code * 16 + static_cast<uint32_t>(c - '0');
+            } else if (c >= 'a' && c <= 'f') {
+                code = code * 16 + static_cast<uint32_t>(c - 'a' + 10);
+            } else {
+                throw RowError("invalid \\u escape");
+            }
+        }
+        return code;
+    }
+
+    void parse_string(JsonValue &value) {
+        expect('"');
+        const char *start = p;
+        bool escaped = false;
+        value.type = JsonValue::Type::Text;
+        value.buffer.clear();
+
+        while (true) {
+            while (p < end && *p != '"' && *p != '\\') {
+                p++;
+            }
+            if (p == end) {
+                throw RowError("unterminated string");
+            }
+            if (escaped) {
+                value.buffer.append(start, p);
+            }
+            if (*p == '"') {
+                break;
+            }
+
+            if (!escaped) {
+                value.buffer.assign(start, p);
+                escaped = true;
+            }
+            if (++p == end) {
+                throw RowError("unterminated string");
+            }
+            char c = *p++;
+            switch (c) {
+            case 'b':
+                value.buffer += '\b';
+                break;
+            case 'f':
+                value.buffer += '\f';
+                break;
+            case 'n':
+                value.buffer += '\n';
+                break;
+            case 'r':
+                value.buffer += '\r';
+                break;
+            case 't':
+                value.buffer += '\t';
+                break;
+            case 'u': {
+                uint32_t code = read_hex4();
+                if (code >= 0xD800 && code <= 0xDBFF && skip_word("\\u")) {
+                    uint32_t low = read_hex4();
+                    if (low < 0xDC00 || low > 0xDFFF) {
+                        throw RowError("invalid surrogate pair");
+                    }
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                }
+                append_utf8(value.buffer, code);
+                break;
+            }
+            default:
+                value.buffer += c;
+            }
+            start = p;
+        }
+
+        value.text = escaped ? std::string_view(value.buffer)
+                             : std::string_view(start, p - start);
+        p++;
+    }
+
+    /// Nested objects and arrays are kept as their JSON text
+    void parse_nested(JsonValue &value) {
+        const char *start = p;
+        int depth = 0;
+        do {
+            if (p == end) {
+                throw RowError("unterminated object or array");
+            }
+            char c = *p;
+            if (c == '"') {
+                parse_string(key);
+                continue;
+            }
+            depth += c == '{' || c == '[' ? 1 : 0;
+            depth -= c == '}' || c == ']' ? 1 : 0;
+            p++;
+        } while (depth > 0);
+
+        value.type = JsonValue::Type::Text;
+        value.text = std::string_view(start, p - start);
+    }
+
+    void parse_number(JsonValue &value) {
+        const char *start = p;
+        bool integer = true;
+        while (p < end && (std::isdigit(static_cast<unsigned char>(*p)) ||
+                           *p == '-' || *p == '+' || *p == '.' || *p == 'e' ||
+                           *p == 'E')) {
+            integer = integer && *p != '.' && *p != 'e' && *p != 'E';
+            p++;
+        }
+        if (p == start) {
+            throw RowError("invalid value");
+        }
+
+        std::string_view text(start, p - start);
+        if (integer && parse_integer(text, value.integer)) {
+            value.type = JsonValue::Type::Integer;
+            return;
+        }
+        number.assign(text);
+        char *parsed_end = nullptr;
+        value.real = std::strtod(number.c_str(), &parsed_end);
+        if (parsed_end != number.c_str() + number.size()) {
+            throw RowError("invalid number");
+        }
+        value.type = JsonValue::Type::Real;
+    }
+
+    void parse_value(JsonValue &value) {
+        char c = peek();
+        if (c == '"') {
+            parse_string(value);
+        } else if (c == '{' || c == '[') {
+            parse_nested(value);
+        } else if (skip_word("null")) {
+            value.type = JsonValue::Type::Null;
+        } else if (skip_word("true")) {
+            value.type = JsonValue::Type::Integer;
+            value.integer = 1;
+        } else if (skip_word("false")) {
+            value.type = JsonValue::Type::Integer;
+            value.integer = 0;
+        } else {
+            parse_number(value);
+        }
+    }
+};
+
+[[noreturn]] void fail(const std::string &where, const RowError &error) {
+    throw std::runtime_error("[op-sqlite] " + where + ": " + error.what());
+}
+
+} // namespace
+
+BatchResult import_csv_file(sqlite3 *db, const std::string &path,
+                            const TableImportOptions &options) {
+    auto file = open_file(path);
+    CsvReader reader(file.data, file.size, options.delimiter);
+    CsvFields fields;
+    size_t count = 0;
+    std::vector<std::string> columns = options.columns;
+
+    bool has_records = false;
+    try {
+        has_records = reader.next(fields, count);
+    } catch (RowError &error) {
+        fail("CSV import error in the first record", error);
+    }
+    if (has_records && options.header) {
+        if (columns.empty()) {
+            for (size_t i = 0; i < count; i++) {
+                columns.emplace_back(fields[i].value);
+            }
+        }
+        has_records = false;
+    }
+
+    TableInserter inserter(db, options.table, columns);
+    ImportRun run(db, options, file.size);
+    size_t row = 1;
+
+    try {
+        while (has_records || reader.next(fields, count)) {
+            has_records = false;
+            if (count != columns.size()) {
+                throw RowError(std::to_string(count) + " fields, expected " +
+                               std::to_string(columns.size()));
+            }
+
+            for (size_t i = 0; i < count; i++) {
+                const auto &field = fields[i];
+                int index = static_cast<int>(i);
+                auto affinity = inserter.affinities[i];
+                sqlite3_int64 integer;
+
+                if (field.null) {
+                    inserter.bind_null(index);
+                } else if (affinity != Affinity::Text &&
+                           affinity != Affinity::Blob &&
+                           parse_integer(field.value, integer)) {
+                    inserter.bind_integer(index, integer);
+                } else {
+                    inserter.bind_text(index, field.value);
+                }
+            }
+
+            run.add(reader.position(), inserter.insert());
+            row++;
+        }
+    } catch (RowError &error) {
+        fail("CSV import error at row " + std::to_string(row), error);
+    }
+
+    return run.finish();
+}
+
+BatchResult import_ndjson_file(sqlite3 *db, const std::string &path,
+                               const TableImportOptions &options) {
+    auto file = open_file(path);
+    std::vector<std::string> columns = options.columns;
+    TableInserter inserter(db, options.table, columns);
+
+    std::unordered_map<std::string_view, size_t> indexes;
+    for (size_t i = 0; i < columns.size(); i++) {
+        indexes[columns[i]] = i;
+    }
+    std::vector<JsonValue> values(columns.size());
+    JsonValue ignored;
+
+    ImportRun run(db, options, file.size);
+    size_t line = 0;
+    size_t offset = 0;
+
+    try {
+        while (offset < file.size) {
+            line++;
+            auto *newline = static_cast<const char *>(
+                memchr(file.data + offset, '\n', file.size - offset));
+            size_t end = newline ? newline - file.data : file.size;
+            const char *begin = file.data + offset;
+            offset = end + 1;
+
+            size_t start = 0;
+            while (begin + start < file.data + end &&
+                   std::isspace(static_cast<unsigned char>(begin[start]))) {
+                start++;
+            }
+            if (begin + start == file.data + end) {
+                continue;
+            }
+
+            for (auto &value : values) {
+                value.type = JsonValue::Type::Null;
+            }
+            JsonLine(begin, file.data + end)
+                .parse_object([&](std::string_view key, auto &&parse) {
+                    auto index = indexes.find(key);
+                    parse(index == indexes.end() ? ignored
+                                                 : values[index->second]);
+                });
+
+            for (size_t i = 0; i < values.size(); i++) {
+                const auto &value = values[i];
+                int index = static_cast<int>(i);
+                switch (value.type) {
+                case JsonValue::Type::Null:
+                    inserter.bind_null(index);
+                    break;
+                case JsonValue::Type::Integer:
+                    inserter.bind_integer(index, value.integer);
+                    break;
+                case JsonValue::Type::Real:
+                    inserter.bind_real(index, value.real);
+                    break;
+                case JsonValue::Type::Text:
+                    inserter.bind_text(index, value.text);
+                    break;
+                }
+            }
+
+            run.add(std::min(offset, file.size), inserter.insert());
+        }
+    } catch (RowError &error) {
+        fail("NDJSON import error at line " + std::to_string(line), error);
+    }
+
+    return run.finish();
+}
+
+} // namespace opsqlite
+
+#endif
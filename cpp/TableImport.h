@@ -0,0 +1,33 @@
+#pragma once
+
+#include "SqlImport.h"
+#include <string>
+#include <vector>
+
+namespace opsqlite {
+
+struct TableImportOptions : ImportOptions {
+    std::string table;
+    /// Table columns the values go to. For CSV in the order of the fields,
+    /// by default the header or all columns of the table when there is none.
+    /// For NDJSON the keys that are read, by default all columns
+    std::vector<std::string> columns;
+    /// CSV only, the first record names the columns
+    bool header = true;
+    char delimiter = ',';
+};
+
+/// Inserts the records of a RFC 4180 CSV file into a table with one
+/// prepared statement. Unquoted empty fields are NULL, fields of INTEGER,
+/// REAL and NUMERIC columns that are integers are bound as such and the rest
+/// as text, which sqlite converts following the column affinity
+BatchResult import_csv_file(sqlite3 *db, const std::string &path,
+                            const TableImportOptions &options);
+
+/// Inserts a JSON object per line into a table. Strings, numbers, booleans
+/// and null are bound as they are, nested objects and arrays as JSON text.
+/// Missing keys are NULL and keys that are not a column are ignored
+BatchResult import_ndjson_file(sqlite3 *db, const std::string &path,
+                               const TableImportOptions &options);
+
+} // namespace opsqlite
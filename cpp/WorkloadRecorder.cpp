@@ -0,0 +1,300 @@
+#include "WorkloadRecorder.h"
+#include "QueryStats.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace opsqlite {
+
+static constexpr char magic[8] = {'O', 'P', 'S', 'Q', 'L', 'R', 'E', 'C'};
+
+template <typename T> static void write_value(std::ofstream &file, T value) {
+    file.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+static void write_bytes(std::ofstream &file, const void *data, size_t size,
+                        bool include_bytes) {
+    write_value<uint32_t>(file, static_cast<uint32_t>(size));
+    if (include_bytes) {
+        file.write(static_cast<const char *>(data),
+                   static_cast<std::streamsize>(size));
+    }
+}
+
+void WorkloadRecorder::start(const std::string &path, bool values) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (file.is_open()) {
+        file.close();
+    }
+
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        recording = false;
+        throw std::runtime_error("[op-sqlite] Could not create recording " +
+                                 path);
+    }
+
+    include_values = values;
+    started_at_ns = now_ns();
+
+    file.write(magic, sizeof(magic));
+    write_value<uint32_t>(file, version);
+    write_value<uint32_t>(file, include_values ? flag_values : 0);
+
+    recording = true;
+}
+
+void WorkloadRecorder::stop() {
+    std::lock_guard<std::mutex> lock(mutex);
+    recording = false;
+    if (file.is_open()) {
+        file.close();
+    }
+}
+
+void WorkloadRecorder::write_header(RecordedApi api, uint64_t command_count,
+                                   uint64_t queued_at, uint64_t started_at) {
+    uint64_t finished_at = now_ns();
+
+    write_value<uint8_t>(file, static_cast<uint8_t>(api));
+    // Calls queued before the recording started count from its start
+    write_value<uint64_t>(file, queued_at > started_at_ns
+                                    ? queued_at - started_at_ns
+                                    : 0);
+    write_value<uint64_t>(file, started_at - queued_at);
+    write_value<uint64_t>(file, finished_at - started_at);
+    write_value<uint32_t>(file, static_cast<uint32_t>(command_count));
+}
+
+void WorkloadRecorder::write_param(const JSVariant &param) {
+    write_value<uint8_t>(file, static_cast<uint8_t>(param.index()));
+
+    std::visit(
+        [&](auto &&v) {
+            using T = std::decay_t<decltype(v)>;
+
+            if constexpr (std::is_same_v<T, std::string>) {
+                write_bytes(file, v.data(), v.size(), include_values);
+            } else if constexpr (std::is_same_v<T, ArrayBuffer>) {
+                write_bytes(file, v.data.get(), v.size, include_values);
+            } else if constexpr (std::is_same_v<T, ArrayParam>) {
+                write_array_param(v);
+            } else if constexpr (std::is_same_v<T, bool>) {
+                write_value<uint8_t>(file, include_values && v ? 1 : 0);
+            } else if constexpr (!std::is_same_v<T, std::nullptr_t>) {
+                write_value<T>(file, include_values ? v : T{});
+            }
+        },
+        param);
+}
+
+/// The values type, then the numbers as one run of bytes or every string
+void WorkloadRecorder::write_array_param(const ArrayParam &param) {
+    write_value<uint8_t>(file, static_cast<uint8_t>(param.values->index()));
+
+    std::visit(
+        [&](auto &values) {
+            using T = typename std::decay_t<decltype(values)>::value_type;
+
+            if constexpr (std::is_same_v<T, std::string>) {
+                write_value<uint32_t>(file,
+                                      static_cast<uint32_t>(values.size()));
+                for (const auto &value : values) {
+                    write_bytes(file, value.data(), value.size(),
+                                include_values);
+                }
+            } else {
+                write_bytes(file, values.data(), values.size() * sizeof(T),
+                            include_values);
+            }
+        },
+        *param.values);
+}
+
+void WorkloadRecorder::write_command(const std::string &sql,
+                                    const std::vector<JSVariant> &params) {
+    write_bytes(file, sql.data(), sql.size(), true);
+    write_value<uint32_t>(file, static_cast<uint32_t>(params.size()));
+    for (const auto &param : params) {
+        write_param(param);
+    }
+}
+
+void WorkloadRecorder::record(RecordedApi api, const std::string &sql,
+                              const std::vector<JSVariant> &params,
+                              uint64_t queued_at, uint64_t started_at) {
+    if (!is_recording()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!file.is_open()) {
+        return;
+    }
+
+    write_header(api, 1, queued_at, started_at);
+    write_command(sql, params);
+}
+
+void WorkloadRecorder::record(RecordedApi api,
+                              const std::vector<BatchArguments> &commands,
+                              uint64_t queued_at, uint64_t started_at) {
+    if (!is_recording()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!file.is_open()) {
+        return;
+    }
+
+    write_header(api, commands.size(), queued_at, started_at);
+    for (const auto &command : commands) {
+        write_command(command.sql, command.params);
+    }
+}
+
+template <typename T> static T read_value(std::ifstream &file) {
+    T value;
+    if (!file.read(reinterpret_cast<char *>(&value), sizeof(T))) {
+        throw std::runtime_error("[op-sqlite] Truncated recording");
+    }
+    return value;
+}
+
+static std::string read_string(std::ifstream &file) {
+    std::string value(read_value<uint32_t>(file), '\0');
+    if (!file.read(value.data(), static_cast<std::streamsize>(value.size()))) {
+        throw std::runtime_error("[op-sqlite] Truncated recording");
+    }
+    return value;
+}
+
+template <typename T>
+static std::vector<T> read_numbers(std::ifstream &file, bool values) {
+    std::vector<T> numbers(read_value<uint32_t>(file) / sizeof(T));
+    auto size = static_cast<std::streamsize>(numbers.size() * sizeof(T));
+    if (values && !file.read(reinterpret_cast<char *>(numbers.data()), size)) {
+        throw std::runtime_error("[op-sqlite] Truncated recording");
+    }
+    return numbers;
+}
+
+static ArrayParam read_array_param(std::ifstream &file, bool values) {
+    auto result = std::make_shared<ArrayParam::Values>();
+
+    switch (read_value<uint8_t>(file)) {
+    case 0:
+        *result = read_numbers<int32_t>(file, values);
+        break;
+    case 1:
+        *result = read_numbers<int64_t>(file, values);
+        break;
+    case 2:
+        *result = read_numbers<double>(file, values);
+        break;
+    case 3: {
+        std::vector<std::string> strings(read_value<uint32_t>(file));
+        for (auto &value : strings) {
+            value = values ? read_string(file)
+                           : std::string(read_value<uint32_t>(file), 'x');
+        }
+        *result = std::move(strings);
+        break;
+    }
+    default:
+        throw std::runtime_error("[op-sqlite] Unknown array type in recording");
+    }
+
+    return ArrayParam{result};
+}
+
+/// Shape only recordings get zeroed strings and blobs of the original size
+static JSVariant read_param(std::ifstream &file, bool values) {
+    auto index = read_value<uint8_t>(file);
+
+    switch (index) {
+    case 0:
+        return nullptr;
+    case 1:
+        return read_value<uint8_t>(file) != 0;
+    case 2:
+        return read_value<int>(file);
+    case 3:
+        return read_value<double>(file);
+    case 4:
+        return read_value<long>(file);
+    case 5:
+        return read_value<long long>(file);
+    case 6:
+        if (values) {
+            return read_string(file);
+        }
+        return std::string(read_value<uint32_t>(file), 'x');
+    case 7: {
+        auto size = read_value<uint32_t>(file);
+        auto *data = new uint8_t[size];
+        if (values) {
+            if (!file.read(reinterpret_cast<char *>(data), size)) {
+                delete[] data;
+                throw std::runtime_error("[op-sqlite] Truncated recording");
+            }
+        } else {
+            memset(data, 0, size);
+        }
+        return ArrayBuffer{.data = std::shared_ptr<uint8_t>{data},
+                           .size = size};
+    }
+    case 8:
+        return read_array_param(file, values);
+    default:
+        throw std::runtime_error("[op-sqlite] Unknown param type in recording");
+    }
+}
+
+std::vector<RecordedCall> read_workload(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("[op-sqlite] Could not open recording " +
+                                 path);
+    }
+
+    char header[sizeof(magic)];
+    if (!file.read(header, sizeof(header)) ||
+        memcmp(header, magic, sizeof(magic)) != 0) {
+        throw std::runtime_error("[op-sqlite] Not an op-sqlite recording");
+    }
+    if (read_value<uint32_t>(file) != WorkloadRecorder::version) {
+        throw std::runtime_error("[op-sqlite] Unsupported recording version");
+    }
+    bool values =
+        (read_value<uint32_t>(file) & WorkloadRecorder::flag_values) != 0;
+
+    std::vector<RecordedCall> calls;
+    while (file.peek() != std::ifstream::traits_type::eof()) {
+        RecordedCall call;
+        call.api = static_cast<RecordedApi>(read_value<uint8_t>(file));
+        call.queued_at_ns = read_value<uint64_t>(file);
+        call.queue_ns = read_value<uint64_t>(file);
+        call.duration_ns = read_value<uint64_t>(file);
+
+        auto command_count = read_value<uint32_t>(file);
+        call.commands.reserve(command_count);
+        for (uint32_t i = 0; i < command_count; i++) {
+            BatchArguments command;
+            command.sql = read_string(file);
+            auto param_count = read_value<uint32_t>(file);
+            command.params.reserve(param_count);
+            for (uint32_t j = 0; j < param_count; j++) {
+                command.params.push_back(read_param(file, values));
+            }
+            call.commands.push_back(std::move(command));
+        }
+
+        calls.push_back(std::move(call));
+    }
+
+    return calls;
+}
+
+} // namespace opsqlite
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "types.h"
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace opsqlite {
+
+enum class RecordedApi : uint8_t {
+    Execute = 0,
+    ExecuteRaw,
+    ExecuteWithHostObjects,
+    ExecuteBatch,
+    ExecuteSync,
+};
+
+struct RecordedCall {
+    RecordedApi api;
+    // Relative to the start of the recording
+    uint64_t queued_at_ns;
+    uint64_t queue_ns;
+    uint64_t duration_ns;
+    // A single command unless the call was a batch
+    std::vector<BatchArguments> commands;
+};
+
+/// Appends every call made on a database to a compact binary file so the
+/// session can be replayed on a workstation (benchmarks/replay.cpp).
+///
+/// Layout, integers in host byte order:
+///   header: "OPSQLREC" u32 version, u32 flags
+///   call:   u8 api, u64 queued_at_ns, u64 queue_ns, u64 duration_ns,
+///           u32 command count, commands
+///   command: u32 sql length, sql, u32 param count, params
+///   param:  u8 variant index, value. Strings and blobs are prefixed with
+///           their u32 length and their bytes are omitted when the recording
+///           only keeps the shape of the params
+class WorkloadRecorder {
+  public:
+    static constexpr uint32_t version = 1;
+    static constexpr uint32_t flag_values = 1;
+
+    /// Throws if the file cannot be created, an ongoing recording is stopped
+    void start(const std::string &path, bool include_values);
+    void stop();
+    bool is_recording() const {
+        return recording.load(std::memory_order_relaxed);
+    }
+
+    /// Called once the query finished, timestamps come from now_ns()
+    void record(RecordedApi api, const std::string &sql,
+                const std::vector<JSVariant> &params, uint64_t queued_at,
+                uint64_t started_at);
+    void record(RecordedApi api, const std::vector<BatchArguments> &commands,
+                uint64_t queued_at, uint64_t started_at);
+
+  private:
+    void write_command(const std::string &sql,
+                       const std::vector<JSVariant> &params);
+    void write_param(const JSVariant &param);
+    void write_array_param(const ArrayParam &param);
+    void write_header(RecordedApi api, uint64_t command_count,
+                      uint64_t queued_at, uint64_t started_at);
+
+    std::atomic<bool> recording{false};
+    std::mutex mutex;
+    std::ofstream file;
+    bool include_values = false;
+    uint64_t started_at_ns = 0;
+};
+
+/// Reads a file written by WorkloadRecorder, throws if it is not one
+std::vector<RecordedCall> read_workload(const std::string &path);
+
+} // namespace opsqlite
@@ -0,0 +1,544 @@
+#ifdef OP_SQLITE_USE_ZSTD
+
+#include "Zstd.h"
+#include "zstd_errors.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+// From zdict.h, the libzstd builds ship ZDICT but its header is not among
+// the zstd headers in this folder
+extern "C" {
+size_t ZDICT_trainFromBuffer(void *dict_buffer, size_t dict_capacity,
+                             const void *samples, const size_t *sample_sizes,
+                             unsigned sample_count);
+unsigned ZDICT_getDictID(const void *dict, size_t dict_size);
+unsigned ZDICT_isError(size_t code);
+const char *ZDICT_getErrorName(size_t code);
+}
+
+namespace opsqlite {
+
+namespace {
+
+/// Same default as before levels could be passed, fast enough for per row
+/// calls
+constexpr int default_level = 1;
+
+/// zstd --train's default, for rows of a few hundred bytes smaller
+/// dictionaries compress about as well
+constexpr size_t default_dictionary_size = 112640;
+
+size_t check(size_t code) {
+    if (ZSTD_isError(code)) {
+        throw std::runtime_error(std::string("zstd: ") +
+                                 ZSTD_getErrorName(code));
+    }
+    return code;
+}
+
+void exec(sqlite3 *db, const char *sql) {
+    char *error = nullptr;
+    if (sqlite3_exec(db, sql, nullptr, nullptr, &error) != SQLITE_OK) {
+        std::string message = error != nullptr ? error : sqlite3_errmsg(db);
+        sqlite3_free(error);
+        throw std::runtime_error(message);
+    }
+}
+
+} // namespace
+
+ZstdCodec::ZstdCodec(sqlite3 *db)
+    : db(db), cctx(ZSTD_createCCtx()), dctx(ZSTD_createDCtx()) {
+    if (cctx == nullptr || dctx == nullptr) {
+        ZSTD_freeCCtx(cctx);
+        ZSTD_freeDCtx(dctx);
+        throw std::bad_alloc();
+    }
+}
+
+ZstdCodec::~ZstdCodec() {
+    for (auto &entry : cdicts) {
+        ZSTD_freeCDict(entry.second);
+    }
+    for (auto &entry : ddicts) {
+        ZSTD_freeDDict(entry.second);
+    }
+    ZSTD_freeCCtx(cctx);
+    ZSTD_freeDCtx(dctx);
+}
+
+std::string ZstdCodec::load_dictionary(unsigned id) {
+    auto missing = "zstd dictionary " + std::to_string(id) +
+                   " is not in zstd_dictionaries";
+    sqlite3_stmt *statement = nullptr;
+    if (sqlite3_prepare_v2(
+            db, "SELECT dictionary FROM zstd_dictionaries WHERE id = ?", -1,
+            &statement, nullptr) != SQLITE_OK) {
+        throw std::runtime_error(missing);
+    }
+
+    sqlite3_bind_int64(statement, 1, id);
+    bool found = sqlite3_step(statement) == SQLITE_ROW;
+    std::string dictionary;
+    if (found) {
+        auto data =
+            static_cast<const char *>(sqlite3_column_blob(statement, 0));
+        dictionary.assign(data, sqlite3_column_bytes(statement, 0));
+    }
+    sqlite3_finalize(statement);
+
+    if (!found) {
+        throw std::runtime_error(missing);
+    }
+    return dictionary;
+}
+
+ZSTD_CDict *ZstdCodec::cdict(unsigned id, int level) {
+    auto &entry = cdicts[{id, level}];
+    if (entry == nullptr) {
+        auto dictionary = load_dictionary(id);
+        entry = ZSTD_createCDict(dictionary.data(), dictionary.size(), level);
+        if (entry == nullptr) {
+            cdicts.erase({id, level});
+            throw std::runtime_error("zstd: invalid dictionary " +
+                                     std::to_string(id));
+        }
+    }
+    return entry;
+}
+
+ZSTD_DDict *ZstdCodec::ddict(unsigned id) {
+    auto &entry = ddicts[id];
+    if (entry == nullptr) {
+        auto dictionary = load_dictionary(id);
+        entry = ZSTD_createDDict(dictionary.data(), dictionary.size());
+        if (entry == nullptr) {
+            ddicts.erase(id);
+            throw std::runtime_error("zstd: invalid dictionary " +
+                                     std::to_string(id));
+        }
+    }
+    return entry;
+}
+
+void ZstdCodec::forget_dictionary(unsigned id) {
+    for (auto it = cdicts.begin(); it != cdicts.end();) {
+        if (it->first.first == id) {
+            ZSTD_freeCDict(it->second);
+            it = cdicts.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    auto it = ddicts.find(id);
+    if (it != ddicts.end()) {
+        ZSTD_freeDDict(it->second);
+        ddicts.erase(it);
+    }
+}
+
+std::string_view ZstdCodec::compress(const void *data, size_t size, int level,
+                                     unsigned dictionary_id) {
+    level = std::clamp(level, ZSTD_minCLevel(), ZSTD_maxCLevel());
+    // Only grows, so rows of similar sizes never allocate
+    auto bound = ZSTD_compressBound(size);
+    if (buffer.size() < bound) {
+        buffer.resize(bound);
+    }
+
+    size_t written =
+        dictionary_id == 0
+            ? ZSTD_compressCCtx(cctx, buffer.data(), bound, data, size, level)
+            : ZSTD_compress_usingCDict(cctx, buffer.data(), bound, data, size,
+                                       cdict(dictionary_id, level));
+    return {buffer.data(), check(written)};
+}
+
+std::string_view ZstdCodec::decompress(const void *data, size_t size) {
+    auto max_size =
+        static_cast<size_t>(sqlite3_limit(db, SQLITE_LIMIT_LENGTH, -1));
+
+    check(ZSTD_DCtx_reset(dctx, ZSTD_reset_session_and_parameters));
+    unsigned dictionary_id = ZSTD_getDictID_fromFrame(data, size);
+    if (dictionary_id != 0) {
+        check(ZSTD_DCtx_refDDict(dctx, ddict(dictionary_id)));
+    }
+
+    auto content_size = ZSTD_getFrameContentSize(data, size);
+    if (content_size == ZSTD_CONTENTSIZE_ERROR) {
+        throw std::runtime_error("zstd: invalid compressed data");
+    }
+    if (content_size == ZSTD_CONTENTSIZE_UNKNOWN) {
+        return decompress_stream(data, size, max_size);
+    }
+    if (content_size > max_size) {
+        throw std::runtime_error("zstd: decompressed value is too big");
+    }
+
+    // Never empty, a null pointer would be returned to sqlite as NULL
+    if (buffer.size() < content_size || buffer.empty()) {
+        buffer.resize(std::max<size_t>(content_size, 1));
+    }
+    size_t written = ZSTD_decompressDCtx(dctx, buffer.data(), content_size,
+                                         data, size);
+    // The content size only covers the first of concatenated frames
+    if (ZSTD_isError(written) &&
+        ZSTD_getErrorCode(written) == ZSTD_error_dstSize_tooSmall) {
+        check(ZSTD_DCtx_reset(dctx, ZSTD_reset_session_only));
+        return decompress_stream(data, size, max_size);
+    }
+    return {buffer.data(), check(written)};
+}
+
+std::string_view ZstdCodec::decompress_stream(const void *data, size_t size,
+                                              size_t max_size) {
+    ZSTD_inBuffer input{data, size, 0};
+    size_t length = 0;
+
+    while (true) {
+        if (buffer.size() - length < ZSTD_DStreamOutSize()) {
+            buffer.resize(
+                std::max(buffer.size() * 2, length + ZSTD_DStreamOutSize()));
+        }
+
+        ZSTD_outBuffer output{buffer.data() + length, buffer.size() - length,
+                              0};
+        size_t remaining = check(ZSTD_decompressStream(dctx, &output, &input));
+        length += output.pos;
+
+        if (length > max_size) {
+            throw std::runtime_error("zstd: decompressed value is too big");
+        }
+        if (remaining == 0 && input.pos == input.size) {
+            return {buffer.data(), length};
+        }
+        // Everything was read and flushed but the frame did not end
+        if (input.pos == input.size && output.pos < output.size) {
+            throw std::runtime_error("zstd: truncated compressed data");
+        }
+    }
+}
+
+unsigned ZstdCodec::register_dictionary(const void *data, size_t size) {
+    unsigned id = ZDICT_getDictID(data, size);
+    if (id == 0) {
+        throw std::runtime_error("zstd: not a dictionary made by zstd --train "
+                                 "or zstd_train_dict");
+    }
+
+    exec(db, "CREATE TABLE IF NOT EXISTS zstd_dictionaries (id INTEGER "
+             "PRIMARY KEY, dictionary BLOB NOT NULL)");
+
+    sqlite3_stmt *statement = nullptr;
+    int status = sqlite3_prepare_v2(db,
+                                    "INSERT OR REPLACE INTO zstd_dictionaries "
+                                    "(id, dictionary) VALUES (?, ?)",
+                                    -1, &statement, nullptr);
+    if (status == SQLITE_OK) {
+        sqlite3_bind_int64(statement, 1, id);
+        sqlite3_bind_blob64(statement, 2, data, size, SQLITE_STATIC);
+        status = sqlite3_step(statement);
+    }
+    sqlite3_finalize(statement);
+    if (status != SQLITE_DONE) {
+        throw std::runtime_error(sqlite3_errmsg(db));
+    }
+
+    forget_dictionary(id);
+    return id;
+}
+
+unsigned ZstdCodec::train_dictionary(const std::string &samples,
+                                     const std::vector<size_t> &sample_sizes,
+                                     size_t max_size) {
+    std::vector<char> dictionary(max_size);
+    size_t size = ZDICT_trainFromBuffer(
+        dictionary.data(), dictionary.size(), samples.data(),
+        sample_sizes.data(), static_cast<unsigned>(sample_sizes.size()));
+    if (ZDICT_isError(size)) {
+        throw std::runtime_error(std::string("zstd_train_dict: ") +
+                                 ZDICT_getErrorName(size) +
+                                 ", it needs more or larger samples");
+    }
+    return register_dictionary(dictionary.data(), size);
+}
+
+namespace {
+
+ZstdCodec &codec(sqlite3_context *context) {
+    return *static_cast<ZstdCodec *>(sqlite3_user_data(context));
+}
+
+/// Runs fn and turns what it throws into the error of the SQL call
+template <typename Fn> void run(sqlite3_context *context, Fn &&fn) {
+    try {
+        fn();
+    } catch (std::bad_alloc &) {
+        sqlite3_result_error_nomem(context);
+    } catch (std::exception &exc) {
+        sqlite3_result_error(context, exc.what(), -1);
+    }
+}
+
+/// Text and blobs are compressed as their bytes, other values give NULL
+bool bytes_of(sqlite3_value *value, const void **data, size_t *size) {
+    int type = sqlite3_value_type(value);
+    if (type == SQLITE_BLOB) {
+        *data = sqlite3_value_blob(value);
+    } else if (type == SQLITE_TEXT) {
+        *data = sqlite3_value_text(value);
+    } else {
+        return false;
+    }
+    *size = static_cast<size_t>(sqlite3_value_bytes(value));
+    // Empty blobs have no pointer
+    if (*data == nullptr) {
+        *data = "";
+    }
+    return true;
+}
+
+void compress_sql(sqlite3_context *context, int argc, sqlite3_value **argv) {
+    const void *data;
+    size_t size;
+    if (argc < 1 || argc > 3 || !bytes_of(argv[0], &data, &size)) {
+        sqlite3_result_null(context);
+        return;
+    }
+
+    auto dictionary_id =
+        argc > 1 ? static_cast<unsigned>(sqlite3_value_int64(argv[1])) : 0;
+    int level = argc > 2 && sqlite3_value_type(argv[2]) != SQLITE_NULL
+                    ? sqlite3_value_int(argv[2])
+                    : default_level;
+
+    run(context, [&] {
+        auto compressed = codec(context).compress(data, size, level,
+                                                  dictionary_id);
+        sqlite3_result_blob64(context, compressed.data(), compressed.size(),
+                              SQLITE_TRANSIENT);
+    });
+}
+
+void decompress_sql(sqlite3_context *context, int argc,
+                    sqlite3_value **argv) {
+    if (argc < 1 || argc > 2 || sqlite3_value_type(argv[0]) == SQLITE_NULL) {
+        sqlite3_result_null(context);
+        return;
+    }
+    if (sqlite3_value_type(argv[0]) != SQLITE_BLOB) {
+        sqlite3_result_error(context, "zstd_decompress expects a blob", -1);
+        return;
+    }
+
+    const void *data = sqlite3_value_blob(argv[0]);
+    auto size = static_cast<size_t>(sqlite3_value_bytes(argv[0]));
+    bool as_text = argc == 2 && sqlite3_value_int(argv[1]) != 0;
+
+    run(context, [&] {
+        auto value = codec(context).decompress(data, size);
+        if (as_text) {
+            sqlite3_result_text64(context, value.data(), value.size(),
+                                  SQLITE_TRANSIENT, SQLITE_UTF8);
+        } else {
+            sqlite3_result_blob64(context, value.data(), value.size(),
+                                  SQLITE_TRANSIENT);
+        }
+    });
+}
+
+/// First byte of the blobs zstd_column_encode writes
+enum ColumnTag : unsigned char { raw_blob = 0, zstd_text = 1, zstd_blob = 2 };
+
+/// Compresses text and blobs of at least threshold bytes when that makes
+/// them smaller. Compressed values and other blobs get a tag byte so the
+/// original type comes back, uncompressed text is left as is
+void column_encode_sql(sqlite3_context *context, int argc,
+                       sqlite3_value **argv) {
+    const void *data;
+    size_t size;
+    if (argc != 4 || !bytes_of(argv[0], &data, &size)) {
+        sqlite3_result_value(context, argv[0]);
+        return;
+    }
+
+    bool text = sqlite3_value_type(argv[0]) == SQLITE_TEXT;
+    auto threshold = sqlite3_value_int64(argv[1]);
+    auto dictionary_id = static_cast<unsigned>(sqlite3_value_int64(argv[2]));
+    int level = sqlite3_value_type(argv[3]) != SQLITE_NULL
+                    ? sqlite3_value_int(argv[3])
+                    : default_level;
+
+    run(context, [&] {
+        std::string_view compressed;
+        if (static_cast<sqlite3_int64>(size) >= threshold) {
+            compressed =
+                codec(context).compress(data, size, level, dictionary_id);
+        }
+
+        bool smaller = compressed.data() != nullptr && compressed.size() < size;
+        if (!smaller && text) {
+            sqlite3_result_value(context, argv[0]);
+            return;
+        }
+
+        auto payload = smaller ? compressed
+                               : std::string_view(
+                                     static_cast<const char *>(data), size);
+        auto *out = static_cast<char *>(sqlite3_malloc64(payload.size() + 1));
+        if (out == nullptr) {
+            throw std::bad_alloc();
+        }
+        out[0] = static_cast<char>(!smaller ? raw_blob
+                                   : text   ? zstd_text
+                                            : zstd_blob);
+        memcpy(out + 1, payload.data(), payload.size());
+        sqlite3_result_blob64(context, out, payload.size() + 1, sqlite3_free);
+    });
+}
+
+void column_decode_sql(sqlite3_context *context, int argc,
+                       sqlite3_value **argv) {
+    if (argc != 1 || sqlite3_value_type(argv[0]) != SQLITE_BLOB) {
+        sqlite3_result_value(context, argv[0]);
+        return;
+    }
+
+    auto *data =
+        static_cast<const unsigned char *>(sqlite3_value_blob(argv[0]));
+    auto size = static_cast<size_t>(sqlite3_value_bytes(argv[0]));
+    if (size == 0 || data[0] > zstd_blob) {
+        sqlite3_result_error(
+            context, "zstd_column_decode: value not written by a compressed "
+                     "column", -1);
+        return;
+    }
+    if (data[0] == raw_blob) {
+        sqlite3_result_blob64(context, data + 1, size - 1, SQLITE_TRANSIENT);
+        return;
+    }
+
+    run(context, [&] {
+        auto value = codec(context).decompress(data + 1, size - 1);
+        if (data[0] == zstd_text) {
+            sqlite3_result_text64(context, value.data(), value.size(),
+                                  SQLITE_TRANSIENT, SQLITE_UTF8);
+        } else {
+            sqlite3_result_blob64(context, value.data(), value.size(),
+                                  SQLITE_TRANSIENT);
+        }
+    });
+}
+
+struct Samples {
+    std::string bytes;
+    std::vector<size_t> sizes;
+    size_t max_size = default_dictionary_size;
+};
+
+/// The aggregate context only holds a pointer, the samples are freed by
+/// train_final, which sqlite also calls when the query fails
+Samples **samples_of(sqlite3_context *context, bool create) {
+    return static_cast<Samples **>(
+        sqlite3_aggregate_context(context, create ? sizeof(Samples *) : 0));
+}
+
+void train_step(sqlite3_context *context, int argc, sqlite3_value **argv) {
+    const void *data;
+    size_t size;
+    if (argc < 1 || !bytes_of(argv[0], &data, &size)) {
+        return;
+    }
+
+    auto slot = samples_of(context, true);
+    if (slot == nullptr) {
+        sqlite3_result_error_nomem(context);
+        return;
+    }
+
+    run(context, [&] {
+        if (*slot == nullptr) {
+            *slot = new Samples();
+        }
+        if (argc > 1 && sqlite3_value_int64(argv[1]) > 0) {
+            (*slot)->max_size =
+                static_cast<size_t>(sqlite3_value_int64(argv[1]));
+        }
+        (*slot)->bytes.append(static_cast<const char *>(data), size);
+        (*slot)->sizes.push_back(size);
+    });
+}
+
+void train_final(sqlite3_context *context) {
+    auto slot = samples_of(context, false);
+    if (slot == nullptr || *slot == nullptr) {
+        sqlite3_result_error(context, "zstd_train_dict: no samples", -1);
+        return;
+    }
+
+    auto *samples = *slot;
+    *slot = nullptr;
+    run(context, [&] {
+        sqlite3_result_int64(context, codec(context).train_dictionary(
+                                          samples->bytes, samples->sizes,
+                                          samples->max_size));
+    });
+    delete samples;
+}
+
+void register_sql(sqlite3_context *context, int, sqlite3_value **argv) {
+    if (sqlite3_value_type(argv[0]) != SQLITE_BLOB) {
+        sqlite3_result_error(context, "zstd_register_dict expects a blob",
+                             -1);
+        return;
+    }
+
+    run(context, [&] {
+        sqlite3_result_int64(
+            context, codec(context).register_dictionary(
+                         sqlite3_value_blob(argv[0]),
+                         static_cast<size_t>(sqlite3_value_bytes(argv[0]))));
+    });
+}
+
+} // namespace
+
+void register_zstd_functions(sqlite3 *db) {
+    auto *state = new ZstdCodec(db);
+    int deterministic = SQLITE_UTF8 | SQLITE_DETERMINISTIC;
+    // They write zstd_dictionaries, so not from triggers or views
+#ifdef SQLITE_DIRECTONLY
+    int writes = SQLITE_UTF8 | SQLITE_DIRECTONLY;
+#else
+    int writes = SQLITE_UTF8;
+#endif
+
+    // The codec is freed with the first function, when the connection closes
+    sqlite3_create_function_v2(
+        db, "zstd_compress", -1, deterministic, state, compress_sql, nullptr,
+        nullptr, [](void *codec) { delete static_cast<ZstdCodec *>(codec); });
+    sqlite3_create_function_v2(db, "zstd_decompress", -1, deterministic, state,
+                               decompress_sql, nullptr, nullptr, nullptr);
+    // Used by the views and triggers of compressed columns, which also run
+    // with trusted_schema off
+#ifdef SQLITE_INNOCUOUS
+    int column = deterministic | SQLITE_INNOCUOUS;
+#else
+    int column = deterministic;
+#endif
+    sqlite3_create_function_v2(db, "zstd_column_encode", 4, column, state,
+                               column_encode_sql, nullptr, nullptr, nullptr);
+    sqlite3_create_function_v2(db, "zstd_column_decode", 1, column, state,
+                               column_decode_sql, nullptr, nullptr, nullptr);
+    sqlite3_create_function_v2(db, "zstd_train_dict", -1, writes, state,
+                               nullptr, train_step, train_final, nullptr);
+    sqlite3_create_function_v2(db, "zstd_register_dict", 1, writes, state,
+                               register_sql, nullptr, nullptr, nullptr);
+}
+
+} // namespace opsqlite
+
+#endif
@@ -0,0 +1,71 @@
+#pragma once
+
+#ifdef OP_SQLITE_USE_ZSTD
+
+#include "zstd.h"
+#include <map>
+#include <sqlite3.h>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace opsqlite {
+
+/// Compression contexts and dictionaries of one connection, reused across
+/// rows. Not thread safe, sqlite runs the functions of a connection one at a
+/// time. Dictionaries live in the zstd_dictionaries table under their zstd
+/// dictionary id, frames carry that id so decompressing needs no argument
+class ZstdCodec {
+  public:
+    explicit ZstdCodec(sqlite3 *db);
+    ~ZstdCodec();
+
+    ZstdCodec(const ZstdCodec &) = delete;
+    ZstdCodec &operator=(const ZstdCodec &) = delete;
+
+    /// Dictionary id 0 compresses without a dictionary. The result points
+    /// into a buffer reused by the next call
+    std::string_view compress(const void *data, size_t size, int level,
+                              unsigned dictionary_id);
+
+    /// Handles frames without a content size and concatenated frames. The
+    /// result points into a buffer reused by the next call
+    std::string_view decompress(const void *data, size_t size);
+
+    /// Stores a dictionary made by zstd --train or ZDICT, returns its id
+    unsigned register_dictionary(const void *data, size_t size);
+
+    /// Trains a dictionary of at most max_size bytes on the samples, which
+    /// are concatenated in samples, and registers it
+    unsigned train_dictionary(const std::string &samples,
+                              const std::vector<size_t> &sample_sizes,
+                              size_t max_size);
+
+  private:
+    sqlite3 *db;
+    ZSTD_CCtx *cctx;
+    ZSTD_DCtx *dctx;
+    std::vector<char> buffer;
+    /// Compression dictionaries are digested for a level
+    std::map<std::pair<unsigned, int>, ZSTD_CDict *> cdicts;
+    std::map<unsigned, ZSTD_DDict *> ddicts;
+
+    std::string load_dictionary(unsigned id);
+    ZSTD_CDict *cdict(unsigned id, int level);
+    ZSTD_DDict *ddict(unsigned id);
+    std::string_view decompress_stream(const void *data, size_t size,
+                                       size_t max_size);
+    void forget_dictionary(unsigned id);
+};
+
+/// Registers zstd_compress(data[, dictionary_id[, level]]),
+/// zstd_decompress(data[, as_text]), zstd_train_dict(sample[, max_size]),
+/// zstd_register_dict(dictionary) and the zstd_column_encode(value,
+/// threshold, dictionary_id, level) and zstd_column_decode(value) pair used
+/// by compressed columns on the connection
+void register_zstd_functions(sqlite3 *db);
+
+} // namespace opsqlite
+
+#endif
@@ -27,6 +27,133 @@ static std::string _crsqlite_path;
 static std::string _sqlite_vec_path;
 static std::string _zstd_path;
 static std::vector<std::shared_ptr<DBHostObject>> dbs;
+// Runs openAsync, databases get their own pool once they are open
+static std::shared_ptr<ThreadPool> open_pool;
+static AssetReader asset_reader;
+
+struct OpenOptions {
+    std::string name;
+    std::string path;
+    EncryptionOptions encryption;
+    bool read_only = false;
+    bool compressed = false;
+};
+
+/// Connection opened by openAsync on the worker. Closed unless a host object
+/// took it, e.g. when the runtime goes away before the callback runs
+struct PendingConnection {
+#ifdef OP_SQLITE_USE_LIBSQL
+    explicit PendingConnection(DB connection) : connection(connection) {}
+    DB connection;
+#else
+    explicit PendingConnection(sqlite3 *connection) : connection(connection) {}
+    sqlite3 *connection;
+#endif
+    bool taken = false;
+
+    PendingConnection(const PendingConnection &) = delete;
+    PendingConnection &operator=(const PendingConnection &) = delete;
+
+    ~PendingConnection() {
+        if (taken) {
+            return;
+        }
+#ifdef OP_SQLITE_USE_LIBSQL
+        opsqlite_libsql_close(connection);
+#else
+        opsqlite_close(connection);
+#endif
+    }
+};
+
+static OpenOptions parse_open_options(jsi::Runtime &rt,
+                                      const jsi::Value &value) {
+    jsi::Object options = value.asObject(rt);
+    OpenOptions result;
+    result.name = options.getProperty(rt, "name").asString(rt).utf8(rt);
+    result.path = std::string(_base_path);
+    std::string location;
+
+    if (options.hasProperty(rt, "location")) {
+        location = options.getProperty(rt, "location").asString(rt).utf8(rt);
+    }
+
+    if (options.hasProperty(rt, "encryptionKey")) {
+        result.encryption.key =
+            options.getProperty(rt, "encryptionKey").asString(rt).utf8(rt);
+    }
+
+    auto read_only = options.getProperty(rt, "readOnly");
+    result.read_only = read_only.isBool() && read_only.getBool();
+    auto compressed = options.getProperty(rt, "compressed");
+    result.compressed = compressed.isBool() && compressed.getBool();
+
+    if (options.hasProperty(rt, "encryption")) {
+        auto encryption = options.getProperty(rt, "encryption").asObject(rt);
+        auto raw_key = encryption.getProperty(rt, "rawKey");
+        auto kdf_iter = encryption.getProperty(rt, "kdfIter");
+        auto page_size = encryption.getProperty(rt, "cipherPageSize");
+        auto memory_security =
+            encryption.getProperty(rt, "cipherMemorySecurity");
+        auto cache = encryption.getProperty(rt, "cacheDerivedKey");
+
+        result.encryption.raw_key = raw_key.isBool() && raw_key.getBool();
+        if (kdf_iter.isNumber()) {
+            result.encryption.kdf_iter = static_cast<int>(kdf_iter.asNumber());
+        }
+        if (page_size.isNumber()) {
+            result.encryption.cipher_page_size =
+                static_cast<int>(page_size.asNumber());
+        }
+        if (memory_security.isBool()) {
+            result.encryption.cipher_memory_security =
+                memory_security.getBool() ? 1 : 0;
+        }
+        if (cache.isBool()) {
+            result.encryption.cache_derived_key = cache.getBool();
+        }
+    }
+
+#ifdef OP_SQLITE_USE_SQLCIPHER
+    if (result.encryption.key.empty()) {
+        log_to_console(rt, "Encryption key is missing for SQLCipher");
+    }
+#endif
+
+    if (!location.empty()) {
+        if (location == ":memory:") {
+            result.path = ":memory:";
+        } else if (location.rfind('/', 0) == 0) {
+            result.path = location;
+        } else {
+            result.path = result.path + "/" + location;
+        }
+    }
+
+    return result;
+}
+
+#ifndef OP_SQLITE_USE_LIBSQL
+/// The JS buffer is only valid during the call, read only databases need
+/// their own copy while writable ones are copied by sqlite anyway
+static ArrayBuffer read_js_buffer(jsi::Runtime &rt, const jsi::Value &value,
+                                  bool copy) {
+    auto buffer = value.asObject(rt).getArrayBuffer(rt);
+    auto size = buffer.size(rt);
+
+    if (!copy) {
+        return ArrayBuffer{
+            .data = std::shared_ptr<uint8_t>(buffer.data(rt), [](uint8_t *) {}),
+            .size = size};
+    }
+
+    auto *data = new uint8_t[size];
+    memcpy(data, buffer.data(rt), size);
+    return ArrayBuffer{.data = std::shared_ptr<uint8_t>(data), .size = size};
+}
+#endif
+
+void set_asset_reader(AssetReader reader) { asset_reader = std::move(reader); }
 
 // React native will try to clean the module on JS context invalidation
 // (CodePush/Hot Reload) The clearState function is called
@@ -48,47 +175,113 @@ void install(jsi::Runtime &rt,
     _crsqlite_path = std::string(crsqlite_path);
     _sqlite_vec_path = std::string(sqlite_vec_path);
     _zstd_path = std::string(zstd_path);
+    open_pool = std::make_shared<ThreadPool>();
 
     auto open = HOST_STATIC_FN("open") {
+        auto options = parse_open_options(rt, args[0]);
+
+        std::shared_ptr<DBHostObject> db = std::make_shared<DBHostObject>(
+            rt, options.path, invoker, options.name, options.path,
+            _crsqlite_path, _sqlite_vec_path, _zstd_path,
+            options.encryption, options.read_only, options.compressed);
+        dbs.emplace_back(db);
+        return jsi::Object::createFromHostObject(rt, db);
+    });
+
+    // Same as open but sqlite3_open_v2, the key derivation and the extension
+    // loading run on a worker, only the host object is created on the JS
+    // thread
+    auto open_async = HOST_STATIC_FN("openAsync") {
+        auto options = parse_open_options(rt, args[0]);
+
+        auto promiseCtr = rt.global().getPropertyAsFunction(rt, "Promise");
+        auto promise = promiseCtr.callAsConstructor(rt, HOST_STATIC_FN("executor") {
+            auto resolve = std::make_shared<jsi::Value>(rt, args[0]);
+            auto reject = std::make_shared<jsi::Value>(rt, args[1]);
+
+            auto task = [&rt, invoker, options, resolve, reject]() {
+                try {
+                    auto pending = std::make_shared<PendingConnection>(
+                        DBHostObject::open_connection(
+                            options.name, options.path, _crsqlite_path,
+                            _sqlite_vec_path, _zstd_path, options.encryption,
+                            options.read_only, options.compressed));
+
+                    invoker->invokeAsync([&rt, invoker, options, pending,
+                                          resolve]() mutable {
+                        auto db = std::make_shared<DBHostObject>(
+                            rt, options.path, invoker, options.name,
+                            pending->connection);
+                        pending->taken = true;
+                        dbs.emplace_back(db);
+                        resolve->asObject(rt).asFunction(rt).call(
+                            rt, jsi::Object::createFromHostObject(rt, db));
+                    });
+                } catch (std::exception &exc) {
+                    invoker->invokeAsync(
+                        [&rt, what = std::string(exc.what()), reject] {
+                            auto errorCtr =
+                                rt.global().getPropertyAsFunction(rt, "Error");
+                            auto error = errorCtr.callAsConstructor(
+                                rt, jsi::String::createFromUtf8(rt, what));
+                            reject->asObject(rt).asFunction(rt).call(rt,
+                                                                     error);
+                        });
+                }
+            };
+
+            open_pool->queueWork(task);
+
+            return {};
+        }));
+
+        return promise;
+    });
+
+#ifndef OP_SQLITE_USE_LIBSQL
+    // Opens an in-memory database from a serialized one, either a buffer
+    // passed from JS or an asset which is mapped without a copy when the
+    // database is read only
+    auto deserialize = HOST_STATIC_FN("deserialize") {
         jsi::Object options = args[0].asObject(rt);
         std::string name =
             options.getProperty(rt, "name").asString(rt).utf8(rt);
-        std::string path = std::string(_base_path);
-        std::string location;
-        std::string encryption_key;
-
-        if (options.hasProperty(rt, "location")) {
-            location =
-                options.getProperty(rt, "location").asString(rt).utf8(rt);
-        }
-
-        if (options.hasProperty(rt, "encryptionKey")) {
-            encryption_key =
-                options.getProperty(rt, "encryptionKey").asString(rt).utf8(rt);
-        }
+        std::string path = ":memory:";
+        auto read_only_value = options.getProperty(rt, "readOnly");
+        bool read_only = !read_only_value.isBool() || read_only_value.getBool();
+        ArrayBuffer data;
 
-#ifdef OP_SQLITE_USE_SQLCIPHER
-        if (encryption_key.empty()) {
-            log_to_console(rt, "Encryption key is missing for SQLCipher");
+        if (options.hasProperty(rt, "data")) {
+            data = read_js_buffer(rt, options.getProperty(rt, "data"),
+                                  read_only);
+        } else if (options.hasProperty(rt, "asset")) {
+            if (!asset_reader) {
+                throw std::runtime_error(
+                    "[op-sqlite] Assets cannot be read on this platform");
+            }
+            data = asset_reader(
+                options.getProperty(rt, "asset").asString(rt).utf8(rt));
+        } else {
+            throw std::runtime_error(
+                "[op-sqlite] deserialize needs either data or asset");
         }
-#endif
 
-        if (!location.empty()) {
-            if (location == ":memory:") {
-                path = ":memory:";
-            } else if (location.rfind('/', 0) == 0) {
-                path = location;
-            } else {
-                path = path + "/" + location;
-            }
+        auto connection = DBHostObject::open_connection(
+            name, path, _crsqlite_path, _sqlite_vec_path, _zstd_path,
+            EncryptionOptions());
+        try {
+            opsqlite_deserialize(connection, data, read_only);
+        } catch (...) {
+            opsqlite_close(connection);
+            throw;
         }
 
-        std::shared_ptr<DBHostObject> db = std::make_shared<DBHostObject>(
-            rt, path, invoker, name, path, _crsqlite_path, _sqlite_vec_path,
-            _zstd_path, encryption_key);
+        auto db = std::make_shared<DBHostObject>(rt, path, invoker, name,
+                                                 connection);
         dbs.emplace_back(db);
         return jsi::Object::createFromHostObject(rt, db);
     });
+#endif
 
     auto is_sqlcipher = HOST_STATIC_FN("isSQLCipher") {
 #ifdef OP_SQLITE_USE_SQLCIPHER
@@ -116,6 +309,10 @@ void install(jsi::Runtime &rt,
 
     jsi::Object module = jsi::Object(rt);
     module.setProperty(rt, "open", std::move(open));
+    module.setProperty(rt, "openAsync", std::move(open_async));
+#ifndef OP_SQLITE_USE_LIBSQL
+    module.setProperty(rt, "deserialize", std::move(deserialize));
+#endif
     module.setProperty(rt, "isSQLCipher", std::move(is_sqlcipher));
     module.setProperty(rt, "isLibsql", std::move(is_libsql));
     module.setProperty(rt, "isIOSEmbedded", std::move(is_ios_embedded));
@@ -1,6 +1,8 @@
 #pragma once
 
+#include "types.h"
 #include <ReactCommon/CallInvoker.h>
+#include <functional>
 #include <jsi/jsi.h>
 #include <jsi/jsilib.h>
 
@@ -14,6 +16,10 @@ void install(jsi::Runtime &rt,
              const char *base_path, const char *crsqlite_path,
              const char *sqlite_vec_path, const char *zstd_path);
 void invalidate();
+/// Reads a database shipped with the app for deserialize, the platform code
+/// provides it since assets are not regular files on Android
+using AssetReader = std::function<ArrayBuffer(std::string const &name)>;
+void set_asset_reader(AssetReader reader);
 void expoUpdatesWorkaround(const char *base_path);
 
 } // namespace opsqlite
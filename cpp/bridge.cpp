@@ -3,11 +3,17 @@
 // so that threading operations are safe and contained within DBHostObject
 
 #include "bridge.h"
+#include "ArrayParam.h"
 #include "DBHostObject.h"
 #include "DumbHostObject.h"
+#include "QueryStats.h"
 #include "SmartHostObject.h"
 #include "logs.h"
 #include "utils.h"
+#ifdef OP_SQLITE_USE_ZSTD
+#include "CompressedVfs.h"
+#endif
+#include <chrono>
 #include <filesystem>
 #include <iostream>
 #include <sstream>
@@ -15,6 +21,15 @@
 #include <unordered_map>
 #include <variant>
 #include <sqlite3.h>
+#ifdef OP_SQLITE_USE_SQLCIPHER
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <mutex>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <optional>
+#endif
 
 #ifdef TOKENIZERS_HEADER_PATH
 #include TOKENIZERS_HEADER_PATH
@@ -22,12 +37,17 @@
 #define TOKENIZER_LIST
 #endif
 
-namespace opsqlite {
+#if SQLITE_VERSION_NUMBER >= 3044000
+// Weak so that an older system library without it still loads, the address is
+// null then
+extern "C" int sqlite3_set_clientdata(sqlite3 *, const char *, void *,
+                                      void (*)(void *)) __attribute__((weak));
+#endif
 
-std::unordered_map<std::string, const void *> tokenizer_map = {TOKENIZER_LIST};
+namespace opsqlite {
 
-inline void opsqlite_bind_statement(sqlite3_stmt *statement,
-                                    const std::vector<JSVariant> *values) {
+void opsqlite_bind_statement(sqlite3_stmt *statement,
+                             const std::vector<JSVariant> *values) {
     sqlite3_clear_bindings(statement);
 
     size_t size = values->size();
@@ -58,6 +78,8 @@ inline void opsqlite_bind_statement(sqlite3_stmt *statement,
                     sqlite3_bind_blob(statement, stmt_index, v.data.get(),
                                       static_cast<int>(v.size),
                                       SQLITE_TRANSIENT);
+                } else if constexpr (std::is_same_v<T, ArrayParam>) {
+                    bind_array_param(statement, stmt_index, v);
                 } else {
                     sqlite3_bind_null(statement, stmt_index);
                 }
@@ -66,6 +88,20 @@ inline void opsqlite_bind_statement(sqlite3_stmt *statement,
     }
 }
 
+/// Joins the location and the name without touching the file system
+static std::string opsqlite_join_db_path(std::string const &db_name,
+                                         std::string const &location) {
+    if (location == ":memory:") {
+        return location;
+    }
+
+    if (!location.empty() && location.back() != '/') {
+        return location + "/" + db_name;
+    }
+
+    return location + db_name;
+}
+
 /// Returns the completely formed db path, but it also creates any sub-folders
 /// along the way
 std::string opsqlite_get_db_path(std::string const &db_name,
@@ -78,45 +114,287 @@ std::string opsqlite_get_db_path(std::string const &db_name,
     // Will return false if the directory already exists, no need to check
     std::filesystem::create_directories(location);
 
-    if (!location.empty() && location.back() != '/') {
-        return location + "/" + db_name;
-    }
+    return opsqlite_join_db_path(db_name, location);
+}
 
-    return location + db_name;
+/// URI that opens the file without locking it or checking it for changes,
+/// the characters sqlite treats as URI syntax are escaped
+static std::string opsqlite_immutable_uri(std::string const &path) {
+    std::string uri = "file:";
+    for (char c : path) {
+        switch (c) {
+        case '%':
+            uri += "%25";
+            break;
+        case '?':
+            uri += "%3f";
+            break;
+        case '#':
+            uri += "%23";
+            break;
+        default:
+            uri += c;
+        }
+    }
+    return uri + "?mode=ro&immutable=1";
 }
 
 #ifdef OP_SQLITE_USE_SQLCIPHER
+// SQLCipher 4 defaults, derived keys are only cached for its PBKDF2-HMAC-SHA512
+static constexpr int default_kdf_iter = 256000;
+static constexpr size_t cipher_key_size = 32;
+static constexpr size_t cipher_salt_size = 16;
+
+struct DerivedKey {
+    std::string passphrase;
+    int kdf_iter;
+    std::string salt;
+    // x'<key><salt>', SQLCipher uses it without running the KDF
+    std::string keyspec;
+};
+
+static std::mutex derived_keys_mutex;
+// Keyed by database path, lives until the process exits
+static std::unordered_map<std::string, DerivedKey> derived_keys;
+
+static std::string to_hex(const unsigned char *data, size_t size) {
+    static constexpr char digits[] = "0123456789ABCDEF";
+    std::string hex;
+    hex.reserve(size * 2);
+    for (size_t i = 0; i < size; i++) {
+        hex.push_back(digits[data[i] >> 4]);
+        hex.push_back(digits[data[i] & 0x0F]);
+    }
+    return hex;
+}
+
+static bool is_raw_key(std::string const &key) {
+    if (key.size() != cipher_key_size * 2 &&
+        key.size() != (cipher_key_size + cipher_salt_size) * 2) {
+        return false;
+    }
+    return std::all_of(key.begin(), key.end(),
+                       [](unsigned char c) { return std::isxdigit(c); });
+}
+
+/// SQLCipher stores the salt in the first bytes of the file, empty when the
+/// file does not exist yet
+static std::string read_salt(std::string const &path) {
+    std::ifstream file(path, std::ios::binary);
+    std::string salt(cipher_salt_size, '\0');
+    if (!file.read(salt.data(), static_cast<std::streamsize>(salt.size()))) {
+        return {};
+    }
+    return salt;
+}
+
+/// Same derivation SQLCipher runs for a passphrase, done here so the result
+/// can be reused by the next open of the file
+static std::string derive_keyspec(std::string const &passphrase,
+                                  std::string const &salt, int kdf_iter) {
+    unsigned char key[cipher_key_size];
+    auto salt_bytes = reinterpret_cast<const unsigned char *>(salt.data());
+
+    if (PKCS5_PBKDF2_HMAC(passphrase.data(),
+                          static_cast<int>(passphrase.size()), salt_bytes,
+                          static_cast<int>(salt.size()), kdf_iter, EVP_sha512(),
+                          cipher_key_size, key) != 1) {
+        throw std::runtime_error("[op-sqlite] Could not derive the key");
+    }
+
+    auto keyspec = "x'" + to_hex(key, cipher_key_size) +
+                   to_hex(salt_bytes, salt.size()) + "'";
+    OPENSSL_cleanse(key, cipher_key_size);
+    return keyspec;
+}
+
+static std::string quote(std::string const &value) {
+    std::string quoted = "'";
+    for (char c : value) {
+        quoted += c == '\'' ? "''" : std::string(1, c);
+    }
+    return quoted + "'";
+}
+
+/// Returns false when a key derived here did not open the file, the caller
+/// then falls back to SQLCipher's own derivation on a new connection
+static bool opsqlite_key(sqlite3 *db, std::string const &path,
+                         EncryptionOptions const &encryption) {
+    std::string keyspec = encryption.key;
+    std::optional<DerivedKey> derived;
+
+    if (encryption.raw_key) {
+        if (!is_raw_key(encryption.key)) {
+            throw std::runtime_error(
+                "[op-sqlite] Raw keys must be 64 hex characters, optionally "
+                "followed by 32 hex characters of salt");
+        }
+        keyspec = "x'" + encryption.key + "'";
+    } else if (encryption.cache_derived_key) {
+        // New databases get their salt from SQLCipher on the first write
+        auto salt = read_salt(path);
+        int kdf_iter =
+            encryption.kdf_iter > 0 ? encryption.kdf_iter : default_kdf_iter;
+
+        if (!salt.empty()) {
+            std::unique_lock<std::mutex> lock(derived_keys_mutex);
+            auto cached = derived_keys.find(path);
+
+            if (cached != derived_keys.end() &&
+                cached->second.passphrase == encryption.key &&
+                cached->second.kdf_iter == kdf_iter &&
+                cached->second.salt == salt) {
+                derived = cached->second;
+            } else {
+                lock.unlock();
+                derived = DerivedKey{
+                    encryption.key, kdf_iter, salt,
+                    derive_keyspec(encryption.key, salt, kdf_iter)};
+            }
+            keyspec = derived->keyspec;
+        }
+    }
+
+    opsqlite_execute(db, "PRAGMA key = " + quote(keyspec), nullptr);
+
+    // Settings that change how the key is used must follow PRAGMA key
+    if (encryption.kdf_iter > 0) {
+        opsqlite_execute(db,
+                         "PRAGMA kdf_iter = " +
+                             std::to_string(encryption.kdf_iter),
+                         nullptr);
+    }
+    if (encryption.cipher_page_size > 0) {
+        opsqlite_execute(db,
+                         "PRAGMA cipher_page_size = " +
+                             std::to_string(encryption.cipher_page_size),
+                         nullptr);
+    }
+    if (encryption.cipher_memory_security >= 0) {
+        opsqlite_execute(db,
+                         encryption.cipher_memory_security == 1
+                             ? "PRAGMA cipher_memory_security = ON"
+                             : "PRAGMA cipher_memory_security = OFF",
+                         nullptr);
+    }
+
+    if (!derived) {
+        return true;
+    }
+
+    bool opened = sqlite3_exec(db, "SELECT count(*) FROM sqlite_master",
+                               nullptr, nullptr, nullptr) == SQLITE_OK;
+
+    std::lock_guard<std::mutex> lock(derived_keys_mutex);
+    if (opened) {
+        derived_keys[path] = std::move(*derived);
+    } else {
+        derived_keys.erase(path);
+    }
+    return opened;
+}
+
 sqlite3 *opsqlite_open(std::string const &name, std::string const &path,
                        std::string const &crsqlite_path,
                        std::string const &sqlite_vec_path,
-                       std::string const &encryption_key) {
+                       [[maybe_unused]] std::string const &zstd_path,
+                       EncryptionOptions const &encryption, bool read_only,
+                       bool compressed) {
 #else
 sqlite3 *opsqlite_open(std::string const &name, std::string const &path,
                        [[maybe_unused]] std::string const &crsqlite_path,
                        [[maybe_unused]] std::string const &sqlite_vec_path,
-                       [[maybe_unused]] std::string const &zstd_path) {
+                       [[maybe_unused]] std::string const &zstd_path,
+                       bool read_only, bool compressed) {
 #endif
-    std::string final_path = opsqlite_get_db_path(name, path);
-#if defined(OP_SQLITE_USE_CRSQLITE) || defined(OP_SQLITE_USE_SQLITE_VEC) || defined(OP_SQLITE_USE_ZSTD)
+    // Read only databases can live anywhere, e.g. in the app bundle, the
+    // folders are not created
+    std::string final_path = read_only ? opsqlite_join_db_path(name, path)
+                                       : opsqlite_get_db_path(name, path);
+    std::string filename =
+        read_only ? opsqlite_immutable_uri(final_path) : final_path;
+#if defined(OP_SQLITE_USE_CRSQLITE) || defined(OP_SQLITE_USE_SQLITE_VEC) || \
+    defined(OP_SQLITE_USE_ZSTD) || defined(TOKENIZERS_HEADER_PATH)
     char *errMsg = nullptr;
 #endif
     sqlite3 *db;
 
-    int flags =
-        SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_FULLMUTEX;
+    int flags = read_only ? SQLITE_OPEN_READONLY | SQLITE_OPEN_URI |
+                                SQLITE_OPEN_FULLMUTEX
+                          : SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE |
+                                SQLITE_OPEN_FULLMUTEX;
+
+#ifdef OP_SQLITE_USE_ZSTD
+    const char *vfs = compressed ? register_compressed_vfs() : nullptr;
+#else
+    const char *vfs = nullptr;
+    if (compressed) {
+        throw std::runtime_error("[op-sqlite] compressed needs zstd, enable "
+                                 "it in the op-sqlite config");
+    }
+#endif
+#ifdef OP_SQLITE_USE_SQLCIPHER
+    if (compressed && !encryption.key.empty()) {
+        throw std::runtime_error("[op-sqlite] compressed databases cannot be "
+                                 "encrypted, encrypted pages do not compress");
+    }
+#endif
 
-    int status = sqlite3_open_v2(final_path.c_str(), &db, flags, nullptr);
+    int status = sqlite3_open_v2(filename.c_str(), &db, flags, vfs);
 
     if (status != SQLITE_OK) {
-        throw std::runtime_error(sqlite3_errmsg(db));
+        std::string error = sqlite3_errmsg(db);
+        sqlite3_close_v2(db);
+        throw std::runtime_error(error + ": " + final_path);
     }
 
 #ifdef OP_SQLITE_USE_SQLCIPHER
-    if (!encryption_key.empty()) {
-        opsqlite_execute(db, "PRAGMA key = '" + encryption_key + "'", nullptr);
+    bool keyed = true;
+    try {
+        keyed = encryption.key.empty() ||
+                opsqlite_key(db, final_path, encryption);
+    } catch (...) {
+        sqlite3_close_v2(db);
+        throw;
+    }
+
+    if (!keyed) {
+        // Wrong passphrase or a file the derivation here does not cover,
+        // e.g. one with a plaintext header. SQLCipher reports the error on
+        // the first query like it always did
+        sqlite3_close_v2(db);
+        status = sqlite3_open_v2(filename.c_str(), &db, flags, vfs);
+        if (status != SQLITE_OK) {
+            std::string error = sqlite3_errmsg(db);
+            sqlite3_close_v2(db);
+            throw std::runtime_error(error + ": " + final_path);
+        }
+
+        auto passphrase = encryption;
+        passphrase.cache_derived_key = false;
+        try {
+            opsqlite_key(db, final_path, passphrase);
+        } catch (...) {
+            sqlite3_close_v2(db);
+            throw;
+        }
     }
 #endif
 
+    if (read_only) {
+        // Pages are read straight from the mapped file instead of being
+        // copied into the page cache, capped by SQLITE_MAX_MMAP_SIZE
+        std::error_code error;
+        auto size = std::filesystem::file_size(final_path, error);
+        if (!error) {
+            opsqlite_execute(db,
+                             "PRAGMA mmap_size = " + std::to_string(size),
+                             nullptr);
+        }
+    }
+
+    register_array_param_module(db);
+
 #ifndef OP_SQLITE_USE_PHONE_VERSION
     sqlite3_enable_load_extension(db, 1);
 #endif
@@ -180,6 +458,90 @@ void opsqlite_detach(sqlite3 *db, std::string const &alias) {
     opsqlite_execute(db, statement, nullptr);
 }
 
+/// The headers can be newer than the library that is loaded (iOS embedded
+/// version, system library on host builds), so this is decided at runtime
+static bool has_clientdata() {
+#if SQLITE_VERSION_NUMBER >= 3044000
+    return sqlite3_libversion_number() >= 3044000 &&
+           sqlite3_set_clientdata != nullptr;
+#else
+    return false;
+#endif
+}
+
+void opsqlite_deserialize(sqlite3 *db, ArrayBuffer const &data,
+                          bool read_only) {
+    auto *bytes = data.data.get();
+    auto size = static_cast<sqlite3_int64>(data.size);
+    // memdb cannot open a database in WAL mode, the header of a file saved in
+    // WAL mode has to be switched back to the rollback journal
+    bool wal = data.size >= 20 && bytes[18] == 2 && bytes[19] == 2;
+    unsigned char *buffer = bytes;
+    unsigned int flags = SQLITE_DESERIALIZE_READONLY;
+
+    // Older system libraries have no client data to tie the lifetime of the
+    // buffer to the connection, the content is copied there
+    bool in_place = read_only && !wal && has_clientdata();
+
+    if (!in_place) {
+        buffer = static_cast<unsigned char *>(sqlite3_malloc64(data.size));
+        if (buffer == nullptr && data.size > 0) {
+            throw std::runtime_error(
+                "[op-sqlite] Not enough memory to deserialize the database");
+        }
+        if (data.size > 0) {
+            memcpy(buffer, bytes, data.size);
+        }
+        if (wal) {
+            buffer[18] = 1;
+            buffer[19] = 1;
+        }
+        flags = SQLITE_DESERIALIZE_FREEONCLOSE |
+                (read_only ? SQLITE_DESERIALIZE_READONLY
+                           : SQLITE_DESERIALIZE_RESIZEABLE);
+    }
+
+    // The buffer is freed by sqlite if this fails
+    if (sqlite3_deserialize(db, "main", buffer, size, size, flags) !=
+        SQLITE_OK) {
+        throw std::runtime_error(
+            std::string("[op-sqlite] Could not deserialize database: ") +
+            sqlite3_errmsg(db));
+    }
+
+#if SQLITE_VERSION_NUMBER >= 3044000
+    if (in_place) {
+        // Destroyed after the pager is closed, even when the connection is
+        // kept open by statements that outlive close
+        sqlite3_set_clientdata(db, "op-sqlite-deserialized",
+                               new ArrayBuffer(data), [](void *buffer) {
+                                   delete static_cast<ArrayBuffer *>(buffer);
+                               });
+    }
+#endif
+
+    // sqlite3_deserialize does not look at the content
+    if (sqlite3_exec(db, "SELECT count(*) FROM sqlite_master", nullptr,
+                     nullptr, nullptr) != SQLITE_OK) {
+        throw std::runtime_error(
+            std::string("[op-sqlite] Could not deserialize database: ") +
+            sqlite3_errmsg(db));
+    }
+}
+
+ArrayBuffer opsqlite_serialize(sqlite3 *db) {
+    sqlite3_int64 size = 0;
+    unsigned char *data = sqlite3_serialize(db, "main", &size, 0);
+
+    if (data == nullptr) {
+        throw std::runtime_error("[op-sqlite] Could not serialize database: " +
+                                 std::string(sqlite3_errmsg(db)));
+    }
+
+    return ArrayBuffer{.data = std::shared_ptr<uint8_t>(data, sqlite3_free),
+                       .size = static_cast<size_t>(size)};
+}
+
 void opsqlite_remove(sqlite3 *db, std::string const &name,
                      std::string const &doc_path) {
     opsqlite_close(db);
@@ -207,8 +569,14 @@ BridgeResult opsqlite_execute_prepared_statement(
     int i, count, column_type;
     std::string column_name, column_declared_type;
 
+    QueryTimings timings;
+    uint64_t timer_start = now_ns();
+    uint64_t timer_end;
+
     while (isConsuming) {
         result = sqlite3_step(statement);
+        timer_end = now_ns();
+        timings.step_ns += timer_end - timer_start;
 
         switch (result) {
         case SQLITE_ROW: {
@@ -228,12 +596,14 @@ BridgeResult opsqlite_execute_prepared_statement(
                      */
                     double column_value = sqlite3_column_double(statement, i);
                     row.values.emplace_back(column_value);
+                    timings.bytes += sizeof(double);
                     break;
                 }
 
                 case SQLITE_FLOAT: {
                     double column_value = sqlite3_column_double(statement, i);
                     row.values.emplace_back(column_value);
+                    timings.bytes += sizeof(double);
                     break;
                 }
 
@@ -244,6 +614,7 @@ BridgeResult opsqlite_execute_prepared_statement(
                     // Specify length too; in case string contains NULL in the
                     // middle
                     row.values.emplace_back(std::string(column_value, byteLen));
+                    timings.bytes += byteLen;
                     break;
                 }
 
@@ -257,6 +628,7 @@ BridgeResult opsqlite_execute_prepared_statement(
                     row.values.emplace_back(
                         ArrayBuffer{.data = std::shared_ptr<uint8_t>{data},
                                     .size = static_cast<size_t>(blob_size)});
+                    timings.bytes += blob_size;
                     break;
                 }
 
@@ -271,7 +643,10 @@ BridgeResult opsqlite_execute_prepared_statement(
             }
 
             results->emplace_back(row);
+            timings.rows++;
 
+            timer_start = now_ns();
+            timings.conversion_ns += timer_start - timer_end;
             break;
         }
 
@@ -315,7 +690,8 @@ BridgeResult opsqlite_execute_prepared_statement(
     long long latestInsertRowId = sqlite3_last_insert_rowid(db);
 
     return {.affectedRows = changedRowCount,
-            .insertId = static_cast<double>(latestInsertRowId)};
+            .insertId = static_cast<double>(latestInsertRowId),
+            .timings = timings};
 }
 
 sqlite3_stmt *opsqlite_prepare_statement(sqlite3 *db,
@@ -348,13 +724,18 @@ BridgeResult opsqlite_execute(sqlite3 *db, std::string const &query,
     std::vector<std::vector<JSVariant>> rows;
     rows.reserve(20);
     std::vector<JSVariant> row;
+    QueryTimings timings;
+    uint64_t timer_start, timer_end;
 
     do {
         const char *query_str =
             remainingStatement == nullptr ? query.c_str() : remainingStatement;
 
+        timer_start = now_ns();
         status = sqlite3_prepare_v2(db, query_str, -1, &statement,
                                     &remainingStatement);
+        timer_end = now_ns();
+        timings.prepare_ns += timer_end - timer_start;
 
         if (status != SQLITE_OK) {
             errorMessage = sqlite3_errmsg(db);
@@ -384,8 +765,12 @@ BridgeResult opsqlite_execute(sqlite3 *db, std::string const &query,
             column_names.emplace_back(column_name);
         }
 
+        timer_start = now_ns();
+
         while (is_consuming_rows) {
             status = sqlite3_step(statement);
+            timer_end = now_ns();
+            timings.step_ns += timer_end - timer_start;
 
             switch (status) {
             case SQLITE_ROW:
@@ -405,6 +790,7 @@ BridgeResult opsqlite_execute(sqlite3 *db, std::string const &query,
                         double_value =
                             sqlite3_column_double(statement, current_column);
                         row.emplace_back(double_value);
+                        timings.bytes += sizeof(double);
                         break;
                     }
 
@@ -416,6 +802,7 @@ BridgeResult opsqlite_execute(sqlite3 *db, std::string const &query,
                         // Specify length too; in case string contains NULL in
                         // the middle
                         row.emplace_back(std::string(string_value, len));
+                        timings.bytes += len;
                         break;
                     }
 
@@ -429,6 +816,7 @@ BridgeResult opsqlite_execute(sqlite3 *db, std::string const &query,
                         row.emplace_back(ArrayBuffer{
                             .data = std::shared_ptr<uint8_t>{data},
                             .size = static_cast<size_t>(blob_size)});
+                        timings.bytes += blob_size;
                         break;
                     }
 
@@ -443,6 +831,10 @@ BridgeResult opsqlite_execute(sqlite3 *db, std::string const &query,
                 }
 
                 rows.emplace_back(std::move(row));
+                timings.rows++;
+
+                timer_start = now_ns();
+                timings.conversion_ns += timer_start - timer_end;
                 break;
 
             case SQLITE_DONE:
@@ -470,7 +862,8 @@ BridgeResult opsqlite_execute(sqlite3 *db, std::string const &query,
     return {.affectedRows = changedRowCount,
             .insertId = static_cast<double>(latestInsertRowId),
             .rows = std::move(rows),
-            .column_names = std::move(column_names)};
+            .column_names = std::move(column_names),
+            .timings = timings};
 }
 
 BridgeResult opsqlite_execute_host_objects(
@@ -487,12 +880,18 @@ BridgeResult opsqlite_execute_host_objects(
 
     int result = SQLITE_OK;
 
+    QueryTimings timings;
+    uint64_t timer_start, timer_end;
+
     do {
         const char *queryStr =
             remainingStatement == nullptr ? query.c_str() : remainingStatement;
 
+        timer_start = now_ns();
         int statementStatus = sqlite3_prepare_v2(db, queryStr, -1, &statement,
                                                  &remainingStatement);
+        timer_end = now_ns();
+        timings.prepare_ns += timer_end - timer_start;
 
         if (statementStatus != SQLITE_OK) {
             const char *message = sqlite3_errmsg(db);
@@ -515,12 +914,17 @@ BridgeResult opsqlite_execute_host_objects(
         int i, count, column_type;
         std::string column_name, column_declared_type;
 
+        timer_start = now_ns();
+
         while (isConsuming) {
             result = sqlite3_step(statement);
+            timer_end = now_ns();
+            timings.step_ns += timer_end - timer_start;
 
             switch (result) {
             case SQLITE_ROW: {
                 if (results == nullptr) {
+                    timer_start = timer_end;
                     break;
                 }
 
@@ -541,6 +945,7 @@ BridgeResult opsqlite_execute_host_objects(
                         double column_value =
                             sqlite3_column_double(statement, i);
                         row.values.emplace_back(column_value);
+                        timings.bytes += sizeof(double);
                         break;
                     }
 
@@ -548,6 +953,7 @@ BridgeResult opsqlite_execute_host_objects(
                         double column_value =
                             sqlite3_column_double(statement, i);
                         row.values.emplace_back(column_value);
+                        timings.bytes += sizeof(double);
                         break;
                     }
 
@@ -560,6 +966,7 @@ BridgeResult opsqlite_execute_host_objects(
                         // the middle
                         row.values.emplace_back(
                             std::string(column_value, byteLen));
+                        timings.bytes += byteLen;
                         break;
                     }
 
@@ -573,6 +980,7 @@ BridgeResult opsqlite_execute_host_objects(
                         row.values.emplace_back(ArrayBuffer{
                             .data = std::shared_ptr<uint8_t>{data},
                             .size = static_cast<size_t>(blob_size)});
+                        timings.bytes += blob_size;
                         break;
                     }
 
@@ -587,6 +995,10 @@ BridgeResult opsqlite_execute_host_objects(
                 }
 
                 results->emplace_back(row);
+                timings.rows++;
+
+                timer_start = now_ns();
+                timings.conversion_ns += timer_start - timer_end;
                 break;
             }
 
@@ -634,7 +1046,8 @@ BridgeResult opsqlite_execute_host_objects(
     long long latestInsertRowId = sqlite3_last_insert_rowid(db);
 
     return {.affectedRows = changedRowCount,
-            .insertId = static_cast<double>(latestInsertRowId)};
+            .insertId = static_cast<double>(latestInsertRowId),
+            .timings = timings};
 }
 
 /// Executes returning data in raw arrays, a small performance optimization
@@ -652,12 +1065,18 @@ opsqlite_execute_raw(sqlite3 *db, std::string const &query,
 
     int step = SQLITE_OK;
 
+    QueryTimings timings;
+    uint64_t timer_start, timer_end;
+
     do {
         const char *queryStr =
             remainingStatement == nullptr ? query.c_str() : remainingStatement;
 
+        timer_start = now_ns();
         int statementStatus = sqlite3_prepare_v2(db, queryStr, -1, &statement,
                                                  &remainingStatement);
+        timer_end = now_ns();
+        timings.prepare_ns += timer_end - timer_start;
 
         if (statementStatus != SQLITE_OK) {
             const char *message = sqlite3_errmsg(db);
@@ -681,12 +1100,17 @@ opsqlite_execute_raw(sqlite3 *db, std::string const &query,
 
         int column_count = sqlite3_column_count(statement);
 
+        timer_start = now_ns();
+
         while (isConsuming) {
             step = sqlite3_step(statement);
+            timer_end = now_ns();
+            timings.step_ns += timer_end - timer_start;
 
             switch (step) {
             case SQLITE_ROW: {
                 if (results == nullptr) {
+                    timer_start = timer_end;
                     break;
                 }
 
@@ -704,6 +1128,7 @@ opsqlite_execute_raw(sqlite3 *db, std::string const &query,
                         double column_value =
                             sqlite3_column_double(statement, i);
                         row.emplace_back(column_value);
+                        timings.bytes += sizeof(double);
                         break;
                     }
 
@@ -715,6 +1140,7 @@ opsqlite_execute_raw(sqlite3 *db, std::string const &query,
                         // Specify length too; in case string contains NULL in
                         // the middle
                         row.emplace_back(std::string(column_value, byteLen));
+                        timings.bytes += byteLen;
                         break;
                     }
 
@@ -726,6 +1152,7 @@ opsqlite_execute_raw(sqlite3 *db, std::string const &query,
                         row.emplace_back(ArrayBuffer{
                             .data = std::shared_ptr<uint8_t>{data},
                             .size = static_cast<size_t>(blob_size)});
+                        timings.bytes += blob_size;
                         break;
                     }
 
@@ -739,7 +1166,10 @@ opsqlite_execute_raw(sqlite3 *db, std::string const &query,
                 }
 
                 results->emplace_back(row);
+                timings.rows++;
 
+                timer_start = now_ns();
+                timings.conversion_ns += timer_start - timer_end;
                 break;
             }
 
@@ -769,7 +1199,8 @@ opsqlite_execute_raw(sqlite3 *db, std::string const &query,
     long long latestInsertRowId = sqlite3_last_insert_rowid(db);
 
     return {.affectedRows = changedRowCount,
-            .insertId = static_cast<double>(latestInsertRowId)};
+            .insertId = static_cast<double>(latestInsertRowId),
+            .timings = timings};
 }
 
 std::string operation_to_string(int operation_type) {
@@ -831,6 +1262,126 @@ void opsqlite_deregister_rollback_hook(sqlite3 *db) {
     sqlite3_rollback_hook(db, nullptr, nullptr);
 }
 
+int profile_callback(unsigned int type, void *slow_query_log_ptr,
+                     void *statement_ptr, void *elapsed_ptr) {
+    if (type != SQLITE_TRACE_PROFILE) {
+        return 0;
+    }
+
+    auto slow_query_log = reinterpret_cast<SlowQueryLog *>(slow_query_log_ptr);
+    auto statement = reinterpret_cast<sqlite3_stmt *>(statement_ptr);
+
+    // getSlowQueries explains the logged statements on this connection, the
+    // plans would push the queries out of the log
+    if (sqlite3_stmt_isexplain(statement) != 0) {
+        return 0;
+    }
+    auto elapsed_ns = *reinterpret_cast<sqlite3_uint64 *>(elapsed_ptr);
+
+    // Counters are reset on every run, otherwise re-used statements would
+    // report the sum of all their executions
+    int fullscan_steps = sqlite3_stmt_status(
+        statement, SQLITE_STMTSTATUS_FULLSCAN_STEP, 1);
+    int sorts = sqlite3_stmt_status(statement, SQLITE_STMTSTATUS_SORT, 1);
+    int autoindexes =
+        sqlite3_stmt_status(statement, SQLITE_STMTSTATUS_AUTOINDEX, 1);
+    int vm_steps = sqlite3_stmt_status(statement, SQLITE_STMTSTATUS_VM_STEP, 1);
+
+    uint64_t threshold_ns = slow_query_log->threshold_ns();
+    if (threshold_ns == 0 || elapsed_ns < threshold_ns) {
+        return 0;
+    }
+
+    char *expanded_sql = sqlite3_expanded_sql(statement);
+    std::string sql = expanded_sql != nullptr ? expanded_sql
+                                              : sqlite3_sql(statement);
+    sqlite3_free(expanded_sql);
+
+    auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
+                         std::chrono::system_clock::now().time_since_epoch())
+                         .count();
+
+    slow_query_log->push({.timestamp = static_cast<double>(timestamp),
+                          .duration_ms = static_cast<double>(elapsed_ns) / 1e6,
+                          .sql = std::move(sql),
+                          .fullscan_steps = fullscan_steps,
+                          .sorts = sorts,
+                          .autoindexes = autoindexes,
+                          .vm_steps = vm_steps,
+                          .has_query_plan = false});
+
+    return 0;
+}
+
+void opsqlite_register_profile_hook(sqlite3 *db,
+                                    SlowQueryLog *slow_query_log) {
+    sqlite3_trace_v2(db, SQLITE_TRACE_PROFILE, &profile_callback,
+                     slow_query_log);
+}
+
+void opsqlite_deregister_profile_hook(sqlite3 *db) {
+    sqlite3_trace_v2(db, 0, nullptr, nullptr);
+}
+
+#ifndef SQLITE_OMIT_PROGRESS_CALLBACK
+int deadline_callback(void *deadline_ns) {
+    // Non-zero aborts the statement with SQLITE_INTERRUPT
+    return now_ns() > *reinterpret_cast<uint64_t *>(deadline_ns);
+}
+#endif
+
+void opsqlite_register_deadline(sqlite3 *db, uint64_t *deadline_ns) {
+#ifndef SQLITE_OMIT_PROGRESS_CALLBACK
+    sqlite3_progress_handler(db, 1000, &deadline_callback, deadline_ns);
+#endif
+}
+
+void opsqlite_deregister_deadline(sqlite3 *db) {
+#ifndef SQLITE_OMIT_PROGRESS_CALLBACK
+    sqlite3_progress_handler(db, 0, nullptr, nullptr);
+#endif
+}
+
+void opsqlite_interrupt(sqlite3 *db) { sqlite3_interrupt(db); }
+
+/// Runs EXPLAIN QUERY PLAN and returns the plan as an indented tree, one node
+/// per line
+std::string opsqlite_explain_query_plan(sqlite3 *db,
+                                        std::string const &query) {
+    sqlite3_stmt *statement;
+    std::string explain = "EXPLAIN QUERY PLAN " + query;
+
+    int status =
+        sqlite3_prepare_v2(db, explain.c_str(), -1, &statement, nullptr);
+
+    if (status != SQLITE_OK) {
+        throw std::runtime_error("[op-sqlite] could not explain query: " +
+                                 std::string(sqlite3_errmsg(db)));
+    }
+
+    std::unordered_map<int, int> depths;
+    std::string plan;
+
+    while (sqlite3_step(statement) == SQLITE_ROW) {
+        int id = sqlite3_column_int(statement, 0);
+        int parent = sqlite3_column_int(statement, 1);
+        auto detail =
+            reinterpret_cast<const char *>(sqlite3_column_text(statement, 3));
+
+        int depth = depths.count(parent) ? depths[parent] + 1 : 0;
+        depths[id] = depth;
+
+        if (!plan.empty()) {
+            plan += "\n";
+        }
+        plan += std::string(depth * 2, ' ') + (detail ? detail : "");
+    }
+
+    sqlite3_finalize(statement);
+
+    return plan;
+}
+
 void opsqlite_load_extension(sqlite3 *db, std::string &path,
                              std::string &entry_point) {
 #ifdef OP_SQLITE_USE_PHONE_VERSION
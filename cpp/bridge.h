@@ -1,6 +1,7 @@
 #pragma once
 
 #include "DumbHostObject.h"
+#include "SlowQueryLog.h"
 #include "SmartHostObject.h"
 #include "types.h"
 #include "utils.h"
@@ -26,12 +27,14 @@ sqlite3 *opsqlite_open(std::string const &dbName, std::string const &path,
                        std::string const &crsqlite_path,
                        std::string const &sqlite_vec_path,
                        std::string const &zstd_path,
-                       std::string const &encryption_key);
+                       EncryptionOptions const &encryption,
+                       bool read_only = false, bool compressed = false);
 #else
 sqlite3 *opsqlite_open(std::string const &name, std::string const &path,
                        [[maybe_unused]] std::string const &crsqlite_path,
                        std::string const &sqlite_vec_path,
-                       std::string const &zstd_path);
+                       std::string const &zstd_path, bool read_only = false,
+                       bool compressed = false);
 #endif
 
 void opsqlite_close(sqlite3 *db);
@@ -45,6 +48,15 @@ void opsqlite_attach(sqlite3 *db, std::string const &doc_path,
 
 void opsqlite_detach(sqlite3 *db, std::string const &alias);
 
+/// Replaces the main database of an in-memory connection with a serialized
+/// database. Read only connections use the buffer in place when possible and
+/// keep it alive until the connection is closed, writable ones work on a copy
+void opsqlite_deserialize(sqlite3 *db, ArrayBuffer const &data,
+                          bool read_only);
+
+/// Copy of the main database in the format sqlite uses on disk
+ArrayBuffer opsqlite_serialize(sqlite3 *db);
+
 BridgeResult opsqlite_execute(sqlite3 *db, std::string const &query,
                               const std::vector<JSVariant> *params);
 
@@ -67,6 +79,18 @@ void opsqlite_deregister_commit_hook(sqlite3 *db);
 void opsqlite_register_rollback_hook(sqlite3 *db, void *db_host_object_ptr);
 void opsqlite_deregister_rollback_hook(sqlite3 *db);
 
+void opsqlite_register_profile_hook(sqlite3 *db,
+                                    SlowQueryLog *slow_query_log);
+void opsqlite_deregister_profile_hook(sqlite3 *db);
+
+/// Aborts the running statement once now_ns() passes the deadline. Compiled
+/// out together with the progress callback in performance mode
+void opsqlite_register_deadline(sqlite3 *db, uint64_t *deadline_ns);
+void opsqlite_deregister_deadline(sqlite3 *db);
+void opsqlite_interrupt(sqlite3 *db);
+
+std::string opsqlite_explain_query_plan(sqlite3 *db, std::string const &query);
+
 sqlite3_stmt *opsqlite_prepare_statement(sqlite3 *db, std::string const &query);
 
 void opsqlite_bind_statement(sqlite3_stmt *statement,
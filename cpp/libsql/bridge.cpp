@@ -211,6 +211,9 @@ void opsqlite_libsql_bind_statement(libsql_stmt_t statement,
             ArrayBuffer buffer = std::get<ArrayBuffer>(value);
             status = libsql_bind_blob(statement, index, buffer.data.get(),
                                       static_cast<int>(buffer.size), &err);
+        } else if (std::holds_alternative<ArrayParam>(value)) {
+            throw std::runtime_error(
+                "[op-sqlite] arrayParam is not supported on libsql");
         } else {
             status = libsql_bind_null(statement, index, &err);
         }
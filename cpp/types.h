@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <variant>
@@ -10,8 +11,45 @@ struct ArrayBuffer {
     size_t size;
 };
 
+/// Values bound as a single parameter and read back as rows by the op_array
+/// table valued function, e.g. WHERE id IN op_array(?)
+struct ArrayParam {
+    using Values = std::variant<std::vector<int32_t>, std::vector<int64_t>,
+                                std::vector<double>, std::vector<std::string>>;
+    /// Shared so binding and copying the params does not copy the values
+    std::shared_ptr<const Values> values;
+};
+
 using JSVariant = std::variant<nullptr_t, bool, int, double, long, long long,
-                               std::string, ArrayBuffer>;
+                               std::string, ArrayBuffer, ArrayParam>;
+
+/// Key and SQLCipher settings passed to open, ignored by the other backends
+struct EncryptionOptions {
+    std::string key;
+    // The key is 64 hex characters, optionally followed by 32 of salt, and
+    // is used as is instead of being derived from a passphrase
+    bool raw_key = false;
+    // 0 keeps SQLCipher's default
+    int kdf_iter = 0;
+    int cipher_page_size = 0;
+    // -1 keeps SQLCipher's default, otherwise 0 or 1
+    int cipher_memory_security = -1;
+    // Keep the key derived from the passphrase for later opens of the file
+    bool cache_derived_key = true;
+};
+
+/// Nanoseconds spent on every stage of a query, the bridge fills the sqlite
+/// stages and DBHostObject the queue and JSI ones
+struct QueryTimings {
+    uint64_t queue_ns = 0;
+    uint64_t prepare_ns = 0;
+    uint64_t step_ns = 0;
+    uint64_t conversion_ns = 0;
+    uint64_t materialization_ns = 0;
+    uint64_t total_ns = 0;
+    uint64_t rows = 0;
+    uint64_t bytes = 0;
+};
 
 struct BridgeResult {
     std::string message;
@@ -19,6 +57,7 @@ struct BridgeResult {
     double insertId;
     std::vector<std::vector<JSVariant>> rows;
     std::vector<std::string> column_names;
+    QueryTimings timings;
 };
 
 struct BatchResult {
@@ -3,8 +3,12 @@
 #ifndef OP_SQLITE_USE_LIBSQL
 #include "bridge.h"
 #endif
+#include <cmath>
+#include <fcntl.h>
 #include <fstream>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 namespace opsqlite {
 
@@ -131,12 +135,91 @@ std::vector<int> to_int_vec(jsi::Runtime &rt, jsi::Value const &xs) {
     return res;
 }
 
+/// Typed arrays are copied with a single memcpy, plain arrays value by value
+static ArrayParam to_array_param(jsi::Runtime &rt, const jsi::Value &value) {
+    auto values = std::make_shared<ArrayParam::Values>();
+    auto object = value.asObject(rt);
+
+    if (object.isArray(rt)) {
+        auto array = object.asArray(rt);
+        size_t length = array.length(rt);
+        std::vector<double> numbers;
+        std::vector<std::string> strings;
+        bool integers = true;
+
+        for (size_t i = 0; i < length; i++) {
+            auto item = array.getValueAtIndex(rt, i);
+            if (item.isString() && numbers.empty()) {
+                strings.emplace_back(item.asString(rt).utf8(rt));
+            } else if (item.isNumber() && strings.empty()) {
+                double number = item.asNumber();
+                integers = integers && std::floor(number) == number &&
+                           std::abs(number) < 9.2e18;
+                numbers.push_back(number);
+            } else {
+                throw std::runtime_error("[op-sqlite] arrayParam takes an "
+                                         "array of only numbers or strings");
+            }
+        }
+
+        if (!strings.empty()) {
+            *values = std::move(strings);
+        } else if (integers) {
+            *values = std::vector<int64_t>(numbers.begin(), numbers.end());
+        } else {
+            *values = std::move(numbers);
+        }
+        return ArrayParam{values};
+    }
+
+    auto type = object.getPropertyAsObject(rt, "constructor")
+                    .getProperty(rt, "name")
+                    .toString(rt)
+                    .utf8(rt);
+    auto buffer = object.getProperty(rt, "buffer");
+    if (!buffer.isObject() || !buffer.asObject(rt).isArrayBuffer(rt)) {
+        throw std::runtime_error(
+            "[op-sqlite] arrayParam takes an array, an Int32Array, a "
+            "Float64Array or a BigInt64Array");
+    }
+
+    auto offset =
+        static_cast<size_t>(object.getProperty(rt, "byteOffset").asNumber());
+    auto length =
+        static_cast<size_t>(object.getProperty(rt, "length").asNumber());
+    auto data = buffer.asObject(rt).getArrayBuffer(rt).data(rt) + offset;
+
+    auto copy = [&](auto vector) {
+        memcpy(vector.data(), data, length * sizeof(vector[0]));
+        *values = std::move(vector);
+    };
+    if (type == "Int32Array") {
+        copy(std::vector<int32_t>(length));
+    } else if (type == "Float64Array") {
+        copy(std::vector<double>(length));
+    } else if (type == "BigInt64Array") {
+        copy(std::vector<int64_t>(length));
+    } else {
+        throw std::runtime_error("[op-sqlite] arrayParam does not take " +
+                                 type + ", only Int32Array, Float64Array "
+                                        "and BigInt64Array");
+    }
+    return ArrayParam{values};
+}
+
 std::vector<JSVariant> to_variant_vec(jsi::Runtime &rt, jsi::Value const &xs) {
     std::vector<JSVariant> res;
     jsi::Array values = xs.asObject(rt).asArray(rt);
 
     for (int ii = 0; ii < values.length(rt); ii++) {
         jsi::Value value = values.getValueAtIndex(rt, ii);
+        // Wrapped by arrayParam in JS, other objects are bound as blobs
+        if (value.isObject() &&
+            value.asObject(rt).hasProperty(rt, "__opSqliteArray")) {
+            res.emplace_back(to_array_param(
+                rt, value.asObject(rt).getProperty(rt, "__opSqliteArray")));
+            continue;
+        }
         res.emplace_back(to_variant(rt, value));
     }
 
@@ -229,6 +312,50 @@ create_raw_result(jsi::Runtime &rt, const BridgeResult &status,
     return res;
 }
 
+static jsi::Object create_stats_object(jsi::Runtime &rt,
+                                       const QueryStatsSnapshot &snapshot) {
+    static const char *stage_names[query_stage_count] = {
+        "queueWait", "prepare",         "step",
+        "conversion", "materialization", "total"};
+
+    jsi::Object res = jsi::Object(rt);
+    res.setProperty(rt, "calls", static_cast<double>(snapshot.calls));
+    res.setProperty(rt, "rows", static_cast<double>(snapshot.rows));
+    res.setProperty(rt, "bytes", static_cast<double>(snapshot.bytes));
+
+    jsi::Object stages = jsi::Object(rt);
+    for (size_t i = 0; i < query_stage_count; i++) {
+        const auto &stage = snapshot.stages[i];
+        jsi::Object js_stage = jsi::Object(rt);
+        js_stage.setProperty(rt, "count", static_cast<double>(stage.count));
+        js_stage.setProperty(rt, "totalMs", stage.total_ms);
+        js_stage.setProperty(rt, "p50Ms", stage.p50_ms);
+        js_stage.setProperty(rt, "p95Ms", stage.p95_ms);
+        js_stage.setProperty(rt, "p99Ms", stage.p99_ms);
+        stages.setProperty(rt, stage_names[i], std::move(js_stage));
+    }
+    res.setProperty(rt, "stages", std::move(stages));
+
+    return res;
+}
+
+jsi::Value
+create_stats_result(jsi::Runtime &rt,
+                    const std::vector<QueryStatsSnapshot> &snapshots) {
+    jsi::Object res = create_stats_object(rt, snapshots.at(0));
+
+    auto queries = jsi::Array(rt, snapshots.size() - 1);
+    for (size_t i = 1; i < snapshots.size(); i++) {
+        jsi::Object query = create_stats_object(rt, snapshots[i]);
+        query.setProperty(rt, "sql",
+                          jsi::String::createFromUtf8(rt, snapshots[i].sql));
+        queries.setValueAtIndex(rt, i - 1, std::move(query));
+    }
+    res.setProperty(rt, "queries", std::move(queries));
+
+    return res;
+}
+
 void to_batch_arguments(jsi::Runtime &rt, jsi::Array const &tuples,
                         std::vector<BatchArguments> *commands) {
     for (int i = 0; i < tuples.length(rt); i++) {
@@ -272,42 +399,6 @@ void to_batch_arguments(jsi::Runtime &rt, jsi::Array const &tuples,
     }
 }
 
-#ifndef OP_SQLITE_USE_LIBSQL
-BatchResult import_sql_file(sqlite3 *db, std::string path) {
-    std::string line;
-    std::ifstream sqFile(path);
-    if (!sqFile.is_open()) {
-        throw std::runtime_error("Could not open file: " + path);
-    }
-
-    try {
-        int affectedRows = 0;
-        int commands = 0;
-        opsqlite_execute(db, "BEGIN EXCLUSIVE TRANSACTION", nullptr);
-        while (std::getline(sqFile, line, '\n')) {
-            if (!line.empty()) {
-                try {
-                    auto result = opsqlite_execute(db, line, nullptr);
-                    affectedRows += result.affectedRows;
-                    commands++;
-                } catch (std::exception &exc) {
-                    opsqlite_execute(db, "ROLLBACK", nullptr);
-                    sqFile.close();
-                    throw exc;
-                }
-            }
-        }
-        sqFile.close();
-        opsqlite_execute(db, "COMMIT", nullptr);
-        return {"", affectedRows, commands};
-    } catch (std::exception &exc) {
-        sqFile.close();
-        opsqlite_execute(db, "ROLLBACK", nullptr);
-        throw exc;
-    }
-}
-#endif
-
 bool folder_exists(const std::string &name) {
     struct stat buffer;
     return (stat(name.c_str(), &buffer) == 0);
@@ -318,6 +409,46 @@ bool file_exists(const std::string &path) {
     return (stat(path.c_str(), &buffer) == 0);
 }
 
+std::string quote_identifier(const std::string &name) {
+    std::string quoted = "\"";
+    for (char c : name) {
+        quoted += c;
+        if (c == '"') {
+            quoted += '"';
+        }
+    }
+    return quoted + "\"";
+}
+
+ArrayBuffer map_file(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("[op-sqlite] File not found: " + path);
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        throw std::runtime_error("[op-sqlite] Could not read file: " + path);
+    }
+
+    auto size = static_cast<size_t>(info.st_size);
+    void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("[op-sqlite] Could not map file: " + path);
+    }
+
+    return ArrayBuffer{
+        .data = std::shared_ptr<uint8_t>(static_cast<uint8_t *>(data),
+                                         [size](uint8_t *data) {
+                                             munmap(data, size);
+                                         }),
+        .size = size};
+}
+
 void log_to_console(jsi::Runtime &runtime, const std::string &message) {
     auto console = runtime.global().getPropertyAsObject(runtime, "console");
     auto log = console.getPropertyAsFunction(runtime, "log");
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "DumbHostObject.h"
+#include "QueryStats.h"
 #include "SmartHostObject.h"
 #include "types.h"
 #include <jsi/jsi.h>
@@ -33,15 +34,23 @@ jsi::Value
 create_raw_result(jsi::Runtime &rt, const BridgeResult &status,
                   const std::vector<std::vector<JSVariant>> *results);
 
+jsi::Value
+create_stats_result(jsi::Runtime &rt,
+                    const std::vector<QueryStatsSnapshot> &snapshots);
+
 void to_batch_arguments(jsi::Runtime &rt, jsi::Array const &batch_params,
                         std::vector<BatchArguments> *commands);
 
-BatchResult import_sql_file(sqlite3 *db, std::string path);
-
 bool folder_exists(const std::string &name);
 
 bool file_exists(const std::string &path);
 
+/// Double quotes a table or column name for SQL, doubling quotes in it
+std::string quote_identifier(const std::string &name);
+
+/// Maps a file read only, it is unmapped when the last reference is dropped
+ArrayBuffer map_file(const std::string &path);
+
 void log_to_console(jsi::Runtime &rt, const std::string &message);
 
 } // namespace opsqlite
@@ -139,5 +139,141 @@ export function blobTests() {
 
       expect(decompressedText).to.equal(originalText);
     });
+
+    it('Dictionary compression of small rows', async () => {
+      await db.execute('DROP TABLE IF EXISTS Messages');
+      await db.execute('DROP TABLE IF EXISTS zstd_dictionaries');
+      await db.execute(
+        'CREATE TABLE Messages (id INTEGER PRIMARY KEY, body TEXT)',
+      );
+      const rows = [];
+      for (let i = 0; i < 500; i++) {
+        rows.push([
+          i,
+          JSON.stringify({
+            id: i,
+            type: 'message',
+            author: `user${i % 37}`,
+            status: ['read', 'sent', 'draft'][i % 3],
+            createdAt: `2024-05-${10 + (i % 20)}T12:00:00Z`,
+          }),
+        ]);
+      }
+      await db.executeBatch([
+        ['INSERT INTO Messages (id, body) VALUES (?, ?)', rows],
+      ]);
+
+      const trained = await db.execute(
+        'SELECT zstd_train_dict(body, 8192) AS id FROM Messages',
+      );
+      const dictionaryId = trained.rows[0]!.id as number;
+      expect(dictionaryId).to.be.greaterThan(0);
+
+      const sizes = await db.execute(
+        `SELECT sum(length(zstd_compress(body))) AS plain,
+          sum(length(zstd_compress(body, ?, 3))) AS dictionary,
+          sum(zstd_decompress(zstd_compress(body, ?), 1) = body) AS same
+          FROM Messages`,
+        [dictionaryId, dictionaryId],
+      );
+      const {plain, dictionary, same} = sizes.rows[0]!;
+      expect(dictionary as number).to.be.lessThan((plain as number) / 2);
+      expect(same).to.equal(500);
+    });
+
+    it('Compressed columns read and write through the view', async () => {
+      await db.execute('DROP VIEW IF EXISTS Notes');
+      await db.execute('DROP TABLE IF EXISTS Notes');
+      await db.execute('DROP TABLE IF EXISTS Notes_zstd');
+      await db.execute('DROP TABLE IF EXISTS zstd_columns');
+      await db.execute(
+        'CREATE TABLE Notes (id INTEGER PRIMARY KEY, title TEXT, body TEXT)',
+      );
+      await db.compressColumns('Notes', ['body']);
+
+      const body = 'Lorem ipsum dolor sit amet. '.repeat(100);
+      await db.execute('INSERT INTO Notes (id, title, body) VALUES (?, ?, ?)', [
+        1,
+        'long',
+        body,
+      ]);
+      await db.execute('INSERT INTO Notes (id, title, body) VALUES (?, ?, ?)', [
+        2,
+        'short',
+        'hi',
+      ]);
+
+      let notes = await db.execute('SELECT * FROM Notes ORDER BY id');
+      expect(notes.rows[0]!.body).to.equal(body);
+      expect(notes.rows[1]!.body).to.equal('hi');
+
+      const stored = await db.execute(
+        'SELECT length(body) AS size FROM Notes_zstd WHERE id = 1',
+      );
+      expect(stored.rows[0]!.size as number).to.be.lessThan(body.length / 10);
+
+      await db.execute('UPDATE Notes SET body = ? WHERE id = 2', ['bye']);
+      await db.execute('DELETE FROM Notes WHERE id = 1');
+      notes = await db.execute('SELECT * FROM Notes');
+      expect(notes.rows).to.eql([{id: 2, title: 'short', body: 'bye'}]);
+
+      await db.compressColumns('Notes', []);
+      const tables = await db.execute(
+        "SELECT type FROM sqlite_master WHERE name = 'Notes'",
+      );
+      expect(tables.rows[0]!.type).to.equal('table');
+      notes = await db.execute('SELECT body FROM Notes');
+      expect(notes.rows[0]!.body).to.equal('bye');
+    });
+
+    it('Compressed columns reject foreign key parents', async () => {
+      await db.execute('DROP TABLE IF EXISTS Replies');
+      await db.execute('DROP TABLE IF EXISTS Threads');
+      await db.execute(
+        'CREATE TABLE Threads (id INTEGER PRIMARY KEY, body TEXT)',
+      );
+      await db.execute(
+        'CREATE TABLE Replies (id INTEGER PRIMARY KEY, thread INTEGER REFERENCES threads (id))',
+      );
+
+      try {
+        await db.compressColumns('Threads', ['body']);
+        expect.fail('compressColumns should have thrown');
+      } catch (e: any) {
+        expect(e.message).to.include('referenced by a foreign key of Replies');
+      }
+      const tables = await db.execute(
+        "SELECT type FROM sqlite_master WHERE name = 'Threads'",
+      );
+      expect(tables.rows[0]!.type).to.equal('table');
+    });
+
+    it('Compressed database survives reopening', async () => {
+      let compressed = open({name: 'compressed.sqlite', compressed: true});
+      await compressed.execute('PRAGMA journal_mode = WAL');
+      await compressed.execute('DROP TABLE IF EXISTS Logs');
+      await compressed.execute(
+        'CREATE TABLE Logs (id INTEGER PRIMARY KEY, line TEXT)',
+      );
+      await compressed.execute('CREATE INDEX LogsLine ON Logs (line)');
+      const rows = [];
+      for (let i = 0; i < 2000; i++) {
+        rows.push([i, `GET /api/messages/${i % 50} 200 in ${i % 17}ms`]);
+      }
+      await compressed.executeBatch([
+        ['INSERT INTO Logs (id, line) VALUES (?, ?)', rows],
+      ]);
+      await compressed.execute('PRAGMA wal_checkpoint(TRUNCATE)');
+      compressed.close();
+
+      compressed = open({name: 'compressed.sqlite', compressed: true});
+      const check = await compressed.execute('PRAGMA integrity_check');
+      expect(check.rows[0]!.integrity_check).to.equal('ok');
+      const count = await compressed.execute(
+        "SELECT count(*) AS count FROM Logs WHERE line LIKE 'GET /api/messages/7 %'",
+      );
+      expect(count.rows[0]!.count).to.equal(40);
+      compressed.delete();
+    });
   });
 }
@@ -1,5 +1,7 @@
 import {
   ANDROID_DATABASE_PATH,
+  deserialize,
+  IOS_BUNDLE_PATH,
   ANDROID_EXTERNAL_FILES_PATH,
   IOS_LIBRARY_PATH,
   isIOSEmbeeded,
@@ -7,6 +9,7 @@ import {
   isSQLCipher,
   moveAssetsDatabase,
   open,
+  openAsync,
 } from '@op-engineering/op-sqlite';
 import chai from 'chai';
 import {describe, it} from './MochaRNAdapter';
@@ -70,6 +73,195 @@ export function dbSetupTests() {
       inMemoryDb.close();
     });
 
+    if (isSQLCipher()) {
+      it('Reopens an encrypted database with the cached key', async () => {
+        const options = {
+          name: 'cipherCacheTest.sqlite',
+          encryptionKey: 'test',
+          encryption: {kdfIter: 64000},
+        };
+        let cipherDb = open(options);
+        await cipherDb.execute('DROP TABLE IF EXISTS User;');
+        await cipherDb.execute(
+          'CREATE TABLE User ( id INT PRIMARY KEY, name TEXT NOT NULL) STRICT;',
+        );
+        await cipherDb.execute('INSERT INTO User (id, name) VALUES (1, ?)', [
+          'Foo',
+        ]);
+        cipherDb.close();
+
+        // Derives the key natively and caches it, then uses the cache
+        for (let i = 0; i < 2; i++) {
+          cipherDb = open(options);
+          const res = await cipherDb.execute('SELECT * FROM User');
+          expect(res.rows[0]!.name).to.equal('Foo');
+          cipherDb.close();
+        }
+
+        cipherDb = open({...options, encryptionKey: 'wrong'});
+        let error: Error | undefined;
+        try {
+          await cipherDb.execute('SELECT * FROM User');
+        } catch (e) {
+          error = e as Error;
+        }
+        expect(error).to.not.equal(undefined);
+        cipherDb.delete();
+      });
+
+      it('Opens an encrypted database with a raw key', async () => {
+        const options = {
+          name: 'cipherRawKeyTest.sqlite',
+          encryptionKey: '2DD29CA851E7B56E4697B0E1F08507293D761A05CE4D1B628663F411A8086D99',
+          encryption: {rawKey: true, cipherPageSize: 8192},
+        };
+        let cipherDb = open(options);
+        await cipherDb.execute('CREATE TABLE IF NOT EXISTS T (id INT)');
+        await cipherDb.execute('INSERT INTO T (id) VALUES (1)');
+        cipherDb.close();
+
+        cipherDb = open(options);
+        const res = await cipherDb.execute('SELECT * FROM T');
+        expect(res.rows.length).to.equal(1);
+        cipherDb.delete();
+
+        expect(() =>
+          open({...options, name: 'cipherBadKey.sqlite', encryptionKey: 'zz'}),
+        ).to.throw();
+      });
+    }
+
+    it('Opens a database without blocking the JS thread', async () => {
+      let asyncDb = await openAsync({
+        name: 'openAsyncTest.sqlite',
+        encryptionKey: 'test',
+      });
+
+      await asyncDb.execute('DROP TABLE IF EXISTS User;');
+      await asyncDb.execute(
+        'CREATE TABLE User ( id INT PRIMARY KEY, name TEXT NOT NULL) STRICT;',
+      );
+      await asyncDb.execute('INSERT INTO User (id, name) VALUES (?, ?)', [
+        1,
+        'Foo',
+      ]);
+      const res = asyncDb.executeSync('SELECT * FROM User');
+      expect(res.rows.length).to.equal(1);
+
+      asyncDb.delete();
+    });
+
+    if (!isLibsql()) {
+      it('Opens a database read only in place', async () => {
+        let writableDb = open({
+          name: 'readOnlyTest.sqlite',
+          encryptionKey: 'test',
+        });
+        await writableDb.execute('DROP TABLE IF EXISTS User;');
+        await writableDb.execute(
+          'CREATE TABLE User ( id INT PRIMARY KEY, name TEXT NOT NULL) STRICT;',
+        );
+        await writableDb.execute('INSERT INTO User (id, name) VALUES (1, ?)', [
+          'Foo',
+        ]);
+        writableDb.close();
+
+        const readOnlyDb = open({
+          name: 'readOnlyTest.sqlite',
+          encryptionKey: 'test',
+          readOnly: true,
+        });
+        const res = await readOnlyDb.execute('SELECT name FROM User');
+        expect(res.rows[0]!.name).to.equal('Foo');
+        let error: Error | undefined;
+        try {
+          await readOnlyDb.execute('DELETE FROM User');
+        } catch (e) {
+          error = e as Error;
+        }
+        expect(error).to.not.equal(undefined);
+        readOnlyDb.close();
+
+        expect(() =>
+          open({name: 'missing.sqlite', location: 'missing', readOnly: true}),
+        ).to.throw();
+
+        open({name: 'readOnlyTest.sqlite', encryptionKey: 'test'}).delete();
+      });
+
+      // The bundled database is not encrypted
+      if (Platform.OS === 'ios' && !isSQLCipher()) {
+        it('Opens a bundled database in place', async () => {
+          const bundledDb = open({
+            name: 'sample.sqlite',
+            location: IOS_BUNDLE_PATH,
+            readOnly: true,
+          });
+          const res = await bundledDb.execute(
+            "SELECT name FROM sqlite_master WHERE type = 'table' AND name = 'User'",
+          );
+          expect(res.rows.length).to.equal(1);
+          bundledDb.close();
+        });
+      }
+
+      it('Serializes and deserializes a database', async () => {
+        let fileDb = open({
+          name: 'serializeTest.sqlite',
+          encryptionKey: 'test',
+        });
+        await fileDb.execute('DROP TABLE IF EXISTS User;');
+        await fileDb.execute(
+          'CREATE TABLE User ( id INT PRIMARY KEY, name TEXT NOT NULL) STRICT;',
+        );
+        await fileDb.execute('INSERT INTO User (id, name) VALUES (1, ?)', [
+          'Foo',
+        ]);
+        const data = await fileDb.serialize();
+        fileDb.delete();
+
+        const readOnlyDb = deserialize({name: 'readOnly', data});
+        const res = await readOnlyDb.execute('SELECT name FROM User');
+        expect(res.rows[0]!.name).to.equal('Foo');
+        let error: Error | undefined;
+        try {
+          await readOnlyDb.execute('INSERT INTO User (id, name) VALUES (2, ?)', [
+            'Bar',
+          ]);
+        } catch (e) {
+          error = e as Error;
+        }
+        expect(error).to.not.equal(undefined);
+        readOnlyDb.close();
+
+        const writableDb = deserialize({name: 'writable', data, readOnly: false});
+        await writableDb.execute('INSERT INTO User (id, name) VALUES (2, ?)', [
+          'Bar',
+        ]);
+        const count = await writableDb.execute('SELECT * FROM User');
+        expect(count.rows.length).to.equal(2);
+        const snapshot = await writableDb.serialize();
+        expect(snapshot.byteLength).to.be.greaterThan(0);
+        writableDb.close();
+      });
+
+      it('Deserializes a bundled database', async () => {
+        const assetDb = deserialize({
+          name: 'assetTest',
+          asset: Platform.OS === 'android' ? 'custom/sample.sqlite' : 'sample.sqlite',
+        });
+        const res = await assetDb.execute(
+          "SELECT name FROM sqlite_master WHERE type = 'table' AND name = 'User'",
+        );
+        expect(res.rows.length).to.equal(1);
+        assetDb.close();
+
+        expect(() =>
+          deserialize({name: 'missingAsset', asset: 'missing.sqlite'}),
+        ).to.throw();
+      });
+    }
+
     if (Platform.OS === 'android') {
       it('Create db in external directory Android', async () => {
         let androidDb = open({
@@ -1,6 +1,8 @@
 import Chance from 'chance';
 import {
+  arrayParam,
   isLibsql,
+  isSQLCipher,
   open,
   // openRemote,
   // openSync,
@@ -506,6 +508,324 @@ export function queriesTests() {
       }
     });
 
+    it('loadFile rejects a missing file', async () => {
+      if (isLibsql()) {
+        return;
+      }
+
+      let progressCalls = 0;
+      try {
+        await db.loadFile('/does/not/exist.sql', {
+          chunkSize: 100,
+          onProgress: () => {
+            progressCalls++;
+          },
+        });
+        expect.fail('loadFile should have thrown');
+      } catch (e: any) {
+        expect(e.message).to.include('/does/not/exist.sql');
+      }
+      expect(progressCalls).to.equal(0);
+    });
+
+    it('importCsv requires a table', async () => {
+      if (isLibsql()) {
+        return;
+      }
+
+      expect(() =>
+        // @ts-ignore
+        db.importCsv('/does/not/exist.csv', {header: false}),
+      ).to.throw('options.table is required');
+    });
+
+    it('importCsv reads escaped quotes in the first record', async () => {
+      if (isLibsql()) {
+        return;
+      }
+
+      const path = `${db.getDbPath().replace(/[^/]*$/, '')}escaped.csv`;
+      await db.execute('INSERT INTO User (id, name) VALUES (?, ?), (?, ?)', [
+        1,
+        'say "hi"',
+        2,
+        'plain',
+      ]);
+      await db.exportQuery('SELECT name, id FROM User ORDER BY id', [], {
+        path,
+        header: false,
+      });
+
+      await db.execute('CREATE TABLE T1 (name TEXT, id INTEGER)');
+      const result = await db.importCsv(path, {table: 'T1', header: false});
+      expect(result.rowsAffected).to.equal(2);
+      const res = await db.execute('SELECT name, id FROM T1 ORDER BY id');
+      expect(res.rows).to.deep.equal([
+        {name: 'say "hi"', id: 1},
+        {name: 'plain', id: 2},
+      ]);
+    });
+
+    it('importNdjson rejects a missing file', async () => {
+      if (isLibsql()) {
+        return;
+      }
+
+      try {
+        await db.importNdjson('/does/not/exist.ndjson', {table: 'User'});
+        expect.fail('importNdjson should have thrown');
+      } catch (e: any) {
+        expect(e.message).to.include('/does/not/exist.ndjson');
+      }
+    });
+
+    it('exportQuery writes ndjson and arrow', async () => {
+      if (isLibsql()) {
+        return;
+      }
+
+      const dir = db.getDbPath().replace(/[^/]*$/, '');
+      await db.execute(
+        'INSERT INTO User (id, name, networth) VALUES (?, ?, ?), (?, ?, ?)',
+        [1, 'Foo', 2.5, 2, 'Bar', null],
+      );
+
+      const ndjson = await db.exportQuery(
+        'SELECT id, name FROM User ORDER BY id',
+        [],
+        {format: 'ndjson', path: `${dir}users.ndjson`},
+      );
+      expect(ndjson.rows).to.equal(2);
+      expect(ndjson.bytesWritten).to.be.greaterThan(0);
+      await db.execute('CREATE TABLE T1 (id INTEGER, name TEXT)');
+      await db.importNdjson(`${dir}users.ndjson`, {table: 'T1'});
+      const res = await db.execute('SELECT id, name FROM T1 ORDER BY id');
+      expect(res.rows).to.deep.equal([
+        {id: 1, name: 'Foo'},
+        {id: 2, name: 'Bar'},
+      ]);
+
+      const arrow = await db.exportQuery(
+        'SELECT id, name, networth FROM User ORDER BY id',
+        [],
+        {format: 'arrow', path: `${dir}users.arrow`, batchSize: 1},
+      );
+      expect(arrow.rows).to.equal(2);
+      expect(arrow.bytesWritten).to.be.greaterThan(0);
+    });
+
+    it('exportQuery rejects mixed arrow column types', async () => {
+      if (isLibsql()) {
+        return;
+      }
+
+      try {
+        await db.exportQuery(
+          'SELECT NULL AS v UNION ALL SELECT 3 UNION ALL SELECT 4.5',
+          [],
+          {
+            format: 'arrow',
+            path: `${db.getDbPath().replace(/[^/]*$/, '')}mixed.arrow`,
+            batchSize: 2,
+          },
+        );
+        expect.fail('exportQuery should have thrown');
+      } catch (e: any) {
+        expect(e.message).to.include('row 3: column v holds a real');
+      }
+    });
+
+    it('exportQuery rejects an unwritable path', async () => {
+      if (isLibsql()) {
+        return;
+      }
+
+      try {
+        await db.exportQuery('SELECT * FROM User WHERE id > ?', [0], {
+          format: 'ndjson',
+          path: '/does/not/exist/users.ndjson',
+        });
+        expect.fail('exportQuery should have thrown');
+      } catch (e: any) {
+        expect(e.message).to.include('/does/not/exist/users.ndjson');
+      }
+    });
+
+    it('exportQuery requires a known format', async () => {
+      if (isLibsql()) {
+        return;
+      }
+
+      expect(() =>
+        db.exportQuery('SELECT * FROM User', undefined, {
+          // @ts-ignore
+          format: 'xml',
+          path: '/tmp/users.xml',
+        }),
+      ).to.throw('Unknown format xml');
+    });
+
+    it('backup and restore round trip', async () => {
+      // SQLCipher cannot copy an encrypted database to a plain file
+      if (isLibsql() || isSQLCipher()) {
+        return;
+      }
+
+      const path = `${db.getDbPath().replace(/[^/]*$/, '')}backup.sqlite`;
+      await db.execute('INSERT INTO User (id, name) VALUES (?, ?)', [1, 'Foo']);
+
+      const progress: number[] = [];
+      const result = await db.backup(path, {
+        pagesPerStep: 1,
+        onProgress: ({remaining}) => progress.push(remaining),
+      });
+      expect(result.pageCount).to.be.greaterThan(0);
+      expect(progress[progress.length - 1]).to.equal(0);
+
+      await db.execute('DELETE FROM User');
+      await db.restore(path);
+
+      const res = await db.execute('SELECT name FROM User');
+      expect(res.rows).to.deep.equal([{name: 'Foo'}]);
+    });
+
+    it('restore rejects a missing file', async () => {
+      if (isLibsql()) {
+        return;
+      }
+
+      try {
+        await db.restore('/does/not/exist.sqlite');
+        expect.fail('restore should have thrown');
+      } catch (e: any) {
+        expect(e.message).to.include('/does/not/exist.sqlite');
+      }
+    });
+
+    it('Maintenance runs once the connection is idle', async () => {
+      if (isLibsql()) {
+        return;
+      }
+
+      const tasks: string[] = [];
+      const errors: string[] = [];
+      db.setMaintenance({
+        idleMs: 10,
+        onMaintenance: ({task, error}) => {
+          tasks.push(task);
+          if (error) {
+            errors.push(error);
+          }
+        },
+      });
+      await db.execute('INSERT INTO User (id, name) VALUES (?, ?)', [1, 'Foo']);
+      await new Promise(resolve => setTimeout(resolve, 200));
+      db.setMaintenance(null);
+
+      expect(tasks).to.include('optimize');
+      expect(errors).to.deep.equal([]);
+    });
+
+    it('Closes with maintenance on', async () => {
+      if (isLibsql()) {
+        return;
+      }
+
+      let maintained = open({name: 'maintained.sqlite'});
+      await maintained.execute('DROP TABLE IF EXISTS Items');
+      await maintained.execute('CREATE TABLE Items (id INTEGER PRIMARY KEY)');
+      maintained.setMaintenance({idleMs: 10});
+      await maintained.execute('INSERT INTO Items DEFAULT VALUES');
+      // Closed while a tick and PRAGMA optimize are still queued
+      maintained.close();
+      await new Promise(resolve => setTimeout(resolve, 100));
+
+      maintained = open({name: 'maintained.sqlite'});
+      const res = await maintained.execute('SELECT count(*) AS n FROM Items');
+      expect(res.rows[0]!.n).to.equal(1);
+      maintained.delete();
+    });
+
+    it('Binds arrays as a single parameter for op_array', async () => {
+      if (isLibsql()) {
+        return;
+      }
+
+      await db.execute('DROP TABLE IF EXISTS Items');
+      await db.execute(
+        'CREATE TABLE Items (id INTEGER PRIMARY KEY, name TEXT)'
+      );
+      await db.executeBatch([
+        [
+          'INSERT INTO Items (id, name) VALUES (?, ?)',
+          [
+            [1, 'one'],
+            [2, 'two'],
+            [3, 'three'],
+            [4, 'four'],
+          ],
+        ],
+      ]);
+
+      const byId = await db.execute(
+        'SELECT name FROM Items WHERE id IN op_array(?) ORDER BY id',
+        [arrayParam(new Int32Array([4, 2, 9]))]
+      );
+      expect(byId.rows.map(row => row.name)).to.deep.equal(['two', 'four']);
+
+      const byName = await db.execute(
+        'SELECT id FROM Items WHERE name IN op_array(?) ORDER BY id',
+        [arrayParam(['one', 'three'])]
+      );
+      expect(byName.rows.map(row => row.id)).to.deep.equal([1, 3]);
+
+      const values = await db.execute(
+        'SELECT sum(value) AS total FROM op_array(?)',
+        [arrayParam(new Float64Array([0.5, 1.25]))]
+      );
+      expect(values.rows[0]!.total).to.equal(1.75);
+
+      const statement = db.prepareStatement(
+        'SELECT count(*) AS count FROM Items WHERE id IN op_array(?)'
+      );
+      await statement.bind([arrayParam([1, 2, 3])]);
+      expect((await statement.execute()).rows[0]!.count).to.equal(3);
+      await statement.bind([arrayParam([])]);
+      expect((await statement.execute()).rows[0]!.count).to.equal(0);
+    });
+
+    it('Reads and writes a blob in chunks', async () => {
+      if (isLibsql()) {
+        return;
+      }
+
+      await db.execute('DROP TABLE IF EXISTS Files');
+      await db.execute(
+        'CREATE TABLE Files (id INTEGER PRIMARY KEY, data BLOB)'
+      );
+      await db.execute('INSERT INTO Files (id) VALUES (1)');
+
+      const writer = await db.openBlob('Files', 'data', 1, {size: 8});
+      expect(writer.size).to.equal(8);
+      await writer.write(0, new Uint8Array([1, 2, 3, 4]));
+      await writer.write(4, new Uint8Array([5, 6, 7, 8]).buffer);
+      await writer.close();
+
+      const reader = await db.openBlob('Files', 'data', 1);
+      const chunk = await reader.read(2, 4);
+      expect(Array.from(new Uint8Array(chunk))).to.deep.equal([3, 4, 5, 6]);
+      const rest = await reader.read(6);
+      expect(Array.from(new Uint8Array(rest))).to.deep.equal([7, 8]);
+
+      try {
+        await reader.read(4, 8);
+        expect.fail('read past the end should have thrown');
+      } catch (e: any) {
+        expect(e.message).to.include('outside of its 8 bytes');
+      }
+      await reader.close();
+    });
+
     it('Rollback', async () => {
       const id = chance.integer();
       const name = chance.name();
@@ -771,6 +1091,171 @@ export function queriesTests() {
       expect(res.rows.length).to.equal(2);
     });
 
+    it('Collects query statistics', async () => {
+      // libsql does not report the sqlite stages
+      if (isLibsql()) {
+        return;
+      }
+
+      db.resetStats();
+
+      await db.execute('INSERT INTO User (id, name) VALUES (?, ?)', [1, 'Foo']);
+      await db.execute('SELECT * FROM User WHERE id = ?', [1]);
+      await db.execute('SELECT * FROM User WHERE id = ?', [1]);
+      await db.executeRaw('SELECT name FROM User');
+
+      const stats = db.getStats();
+      expect(stats.calls).to.equal(4);
+      expect(stats.rows).to.equal(3);
+      expect(stats.stages.total.count).to.equal(4);
+
+      const select = stats.queries.find(
+        q => q.sql === 'SELECT * FROM User WHERE id = ?',
+      );
+      expect(select?.calls).to.equal(2);
+      expect(select?.rows).to.equal(2);
+
+      db.resetStats();
+      expect(db.getStats().calls).to.equal(0);
+      expect(db.getStats().queries.length).to.equal(0);
+    });
+
+    it('Records slow queries with their plan', async () => {
+      if (isLibsql()) {
+        return;
+      }
+
+      await db.execute('INSERT INTO User (id, name) VALUES (?, ?)', [1, 'Foo']);
+
+      // Any positive duration is above the threshold
+      db.setSlowQueryThreshold(0.000001, 2);
+
+      await db.execute('SELECT * FROM User WHERE name = ?', ['Foo']);
+      await db.execute('SELECT * FROM User WHERE id = ?', [1]);
+      await db.execute('SELECT * FROM User WHERE age = ?', [30]);
+
+      db.setSlowQueryThreshold(0);
+
+      const slowQueries = await db.getSlowQueries();
+      expect(slowQueries.length).to.equal(2);
+      expect(slowQueries[0]!.sql).to.equal(
+        'SELECT * FROM User WHERE id = 1',
+      );
+      expect(slowQueries[1]!.sql).to.equal(
+        'SELECT * FROM User WHERE age = 30',
+      );
+      expect(slowQueries[1]!.queryPlan).to.contain('SCAN');
+      expect(slowQueries[1]!.fullscanSteps).to.be.greaterThan(0);
+
+      db.clearSlowQueries();
+      expect((await db.getSlowQueries()).length).to.equal(0);
+    });
+
+    it('Does not record the plans of slow queries', async () => {
+      if (isLibsql()) {
+        return;
+      }
+
+      db.setSlowQueryThreshold(0.000001, 2);
+      await db.execute('SELECT * FROM User WHERE age = ?', [30]);
+
+      // Explaining runs with the log still on
+      await db.getSlowQueries();
+      const slowQueries = await db.getSlowQueries();
+      db.setSlowQueryThreshold(0);
+
+      expect(slowQueries.length).to.equal(1);
+      expect(slowQueries[0]!.sql).to.equal(
+        'SELECT * FROM User WHERE age = 30',
+      );
+    });
+
+    it('Records a workload to a file', async () => {
+      const path = `${db.getDbPath().replace(/[^/]*$/, '')}workload.oprec`;
+
+      db.startRecording(path, {includeValues: true});
+      await db.execute('INSERT INTO User (id, name) VALUES (?, ?)', [1, 'Foo']);
+      await db.executeBatch([
+        ['INSERT INTO User (id, name) VALUES (?, ?)', [2, 'Bar']],
+      ]);
+      db.executeSync('SELECT * FROM User');
+      db.stopRecording();
+
+      const res = await db.execute('SELECT * FROM User');
+      expect(res.rows.length).to.equal(2);
+
+      expect(() =>
+        db.startRecording('/this/folder/does/not/exist/workload.oprec'),
+      ).to.throw();
+    });
+
+    it('Cancels a running query with an AbortSignal', async () => {
+      if (isLibsql()) {
+        return;
+      }
+
+      const controller = new AbortController();
+      const promise = db.execute(
+        'WITH RECURSIVE c(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM c WHERE x < 100000000) SELECT count(*) FROM c',
+        [],
+        {signal: controller.signal},
+      );
+      setTimeout(() => controller.abort(), 20);
+
+      let error: any;
+      try {
+        await promise;
+      } catch (e) {
+        error = e;
+      }
+      expect(error?.name).to.equal('AbortError');
+
+      // The connection is still usable afterwards
+      const res = await db.execute('SELECT 1 AS one');
+      expect(res.rows[0]!.one).to.equal(1);
+    });
+
+    it('Times out running queries and drops aborted queued ones', async () => {
+      if (isLibsql()) {
+        return;
+      }
+
+      const running = db
+        .execute(
+          'WITH RECURSIVE c(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM c WHERE x < 100000000) SELECT count(*) FROM c',
+          [],
+          {timeout: 50},
+        )
+        .catch(e => e);
+
+      const controller = new AbortController();
+      const queued = db
+        .execute('SELECT 1', [], {signal: controller.signal})
+        .catch(e => e);
+      controller.abort();
+
+      expect((await queued)?.name).to.equal('AbortError');
+      expect((await running)?.name).to.equal('TimeoutError');
+    });
+
+    it('Runs interactive queries before queued background work', async () => {
+      const order: string[] = [];
+
+      // Keeps the connection busy while the other two get queued
+      const blocker = db.execute(
+        'WITH RECURSIVE c(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM c WHERE x < 1000000) SELECT count(*) FROM c',
+      );
+      const background = db
+        .execute('SELECT 1', [], {priority: 'background'})
+        .then(() => order.push('background'));
+      const interactive = db
+        .execute('SELECT 1', [], {priority: 'interactive'})
+        .then(() => order.push('interactive'));
+
+      await Promise.all([blocker, background, interactive]);
+      expect(order).to.eql(['interactive', 'background']);
+    });
+
     it('Pragma user_version', () => {
       const res = db.executeSync('PRAGMA user_version');
       console.warn(res.rows);
@@ -199,6 +199,78 @@ export function reactiveTests() {
       unsubscribe3();
     });
 
+    it('Identical reactive queries share a single result', async () => {
+      let firstResult: any = null;
+      let secondResult: any = null;
+      let otherArgumentsRan = false;
+
+      const unsubscribe = db.reactiveExecute({
+        query: 'SELECT name FROM User WHERE id = ?;',
+        arguments: [1],
+        fireOn: [
+          {
+            table: 'User',
+          },
+        ],
+        callback: data => {
+          firstResult = data;
+        },
+      });
+
+      const unsubscribe2 = db.reactiveExecute({
+        query: 'SELECT name FROM User WHERE id = ?;',
+        arguments: [1],
+        fireOn: [
+          {
+            table: 'User',
+          },
+        ],
+        callback: data => {
+          secondResult = data;
+        },
+      });
+
+      const unsubscribe3 = db.reactiveExecute({
+        query: 'SELECT name FROM User WHERE id = ?;',
+        arguments: [2],
+        fireOn: [
+          {
+            table: 'User',
+          },
+        ],
+        callback: data => {
+          otherArgumentsRan = data.rows.length === 0;
+        },
+      });
+
+      await db.transaction(async tx => {
+        await tx.execute(
+          'INSERT INTO User (id, name, age, networth, nickname) VALUES (?, ?, ?, ?, ?);',
+          [1, 'John', 30, 1000, 'Johnny'],
+        );
+      });
+
+      await sleep(0);
+
+      expect(firstResult.rows[0]).to.deep.eq({name: 'John'});
+      expect(secondResult).to.eq(firstResult);
+      expect(otherArgumentsRan).to.be.true;
+
+      unsubscribe();
+
+      await db.transaction(async tx => {
+        await tx.execute('UPDATE User SET name = ? WHERE id = ?;', ['Foo', 1]);
+      });
+
+      await sleep(0);
+
+      expect(secondResult.rows[0]).to.deep.eq({name: 'Foo'});
+      expect(firstResult.rows[0]).to.deep.eq({name: 'John'});
+
+      unsubscribe2();
+      unsubscribe3();
+    });
+
     it('Update hook and reactive queries work at the same time', async () => {
       let promiseResolve: any;
       let promise = new Promise(resolve => {
@@ -252,5 +324,49 @@ export function reactiveTests() {
 
       unsubscribe();
     });
+
+    it('Reactive query fires on a table with compressed columns', async () => {
+      await db.execute('DROP TABLE IF EXISTS Notes');
+      await db.execute(
+        'CREATE TABLE Notes (id INTEGER PRIMARY KEY, body TEXT)',
+      );
+      await db.compressColumns('Notes', ['body']);
+
+      const tables: string[] = [];
+      db.updateHook(({table}) => {
+        tables.push(table);
+      });
+
+      let emittedNotes: any[] = [];
+      const unsubscribe = db.reactiveExecute({
+        query: 'SELECT body FROM Notes;',
+        arguments: [],
+        fireOn: [
+          {
+            table: 'Notes',
+          },
+        ],
+        callback: data => {
+          emittedNotes = data.rows;
+        },
+      });
+
+      await db.transaction(async tx => {
+        await tx.execute('INSERT INTO Notes (id, body) VALUES (?, ?);', [
+          1,
+          'Lorem ipsum dolor sit amet. '.repeat(10),
+        ]);
+      });
+
+      await sleep(20);
+
+      expect(tables).to.deep.eq(['Notes']);
+      expect(emittedNotes).to.deep.eq([
+        {body: 'Lorem ipsum dolor sit amet. '.repeat(10)},
+      ]);
+
+      unsubscribe();
+      db.updateHook(null);
+    });
   });
 }
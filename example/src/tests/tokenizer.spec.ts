@@ -42,6 +42,57 @@ export function tokenizerTests() {
         expect(res.rows.length).to.be.equal(1);
         expect(res.rows[0]!.content).to.be.equal('This is a test document');
       });
+
+      it('Built-in tokenizers fold case, diacritics and stem', async () => {
+        await db.execute(
+          `CREATE VIRTUAL TABLE notes USING fts5(body, tokenize = 'op_porter');`,
+        );
+        await db.execute('INSERT INTO notes(body) VALUES (?), (?)', [
+          'Crème brûlée recipes were RUNNING late',
+          'Встреча в Москве',
+        ]);
+        let res = await db.execute(
+          'SELECT rowid FROM notes WHERE notes MATCH ?',
+          ['creme AND recipe AND runs'],
+        );
+        expect(res.rows).to.eql([{rowid: 1}]);
+        res = await db.execute('SELECT rowid FROM notes WHERE notes MATCH ?', [
+          'МОСКВЕ',
+        ]);
+        expect(res.rows).to.eql([{rowid: 2}]);
+      });
+
+      it('Trigram and CJK tokenizers', async () => {
+        await db.execute(
+          `CREATE VIRTUAL TABLE trigrams USING fts5(body, tokenize = 'op_trigram');`,
+        );
+        await db.execute(
+          `CREATE VIRTUAL TABLE cjk USING fts5(body, tokenize = 'op_cjk');`,
+        );
+        await db.execute('INSERT INTO trigrams(body) VALUES (?)', [
+          'Database indexing',
+        ]);
+        await db.execute('INSERT INTO cjk(body) VALUES (?)', [
+          '東京都に住む developers',
+        ]);
+        let res = await db.execute(
+          'SELECT count(*) AS count FROM trigrams WHERE trigrams MATCH ?',
+          ['NDEXI'],
+        );
+        expect(res.rows[0]!.count).to.equal(1);
+        for (const query of ['京都', '住', 'developers']) {
+          res = await db.execute(
+            'SELECT count(*) AS count FROM cjk WHERE cjk MATCH ?',
+            [query],
+          );
+          expect(res.rows[0]!.count).to.equal(1);
+        }
+        res = await db.execute(
+          'SELECT count(*) AS count FROM cjk WHERE cjk MATCH ?',
+          ['都京'],
+        );
+        expect(res.rows[0]!.count).to.equal(0);
+      });
     }
   });
 }
@@ -1,5 +1,6 @@
 #import "OPSQLite.h"
 #import "../cpp/bindings.h"
+#import "../cpp/utils.h"
 #import <React/RCTBridge+Private.h>
 #import <React/RCTLog.h>
 #import <React/RCTUtils.h>
@@ -26,7 +27,8 @@ RCT_EXPORT_MODULE()
     NSString *documentPath = [documentPaths objectAtIndex:0];
     return @{
         @"IOS_DOCUMENT_PATH" : documentPath,
-        @"IOS_LIBRARY_PATH" : libraryPath
+        @"IOS_LIBRARY_PATH" : libraryPath,
+        @"IOS_BUNDLE_PATH" : [[NSBundle mainBundle] resourcePath]
     };
 }
 
@@ -94,6 +96,13 @@ RCT_EXPORT_BLOCKING_SYNCHRONOUS_METHOD(install) {
     opsqlite::install(runtime, callInvoker, [documentPath UTF8String],
                       [crsqlite_path UTF8String], [sqlite_vec_path UTF8String],
                       [@"" UTF8String]);
+
+    // Bundled resources are regular files, they are mapped in place
+    std::string resource_path =
+        [[[NSBundle mainBundle] resourcePath] UTF8String];
+    opsqlite::set_asset_reader([resource_path](std::string const &name) {
+        return opsqlite::map_file(resource_path + "/" + name);
+    });
     return @true;
 }
 
@@ -4,6 +4,7 @@ export interface Spec extends TurboModule {
   getConstants: () => {
     IOS_DOCUMENT_PATH: string;
     IOS_LIBRARY_PATH: string;
+    IOS_BUNDLE_PATH: string;
     ANDROID_DATABASE_PATH: string;
     ANDROID_FILES_PATH: string;
     ANDROID_EXTERNAL_FILES_PATH: string;
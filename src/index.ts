@@ -9,6 +9,34 @@ export type Scalar =
   | ArrayBuffer
   | ArrayBufferView;
 
+/**
+ * Values bound as a single parameter, see arrayParam
+ */
+export type ArrayParam = {
+  __opSqliteArray: ArrayParamValues;
+};
+
+export type ArrayParamValues =
+  | Int32Array
+  | Float64Array
+  | BigInt64Array
+  | number[]
+  | string[];
+
+export type SQLParam = Scalar | ArrayParam;
+
+/**
+ * Binds a list of values as a single parameter that the op_array table
+ * valued function returns as rows, e.g.
+ * `SELECT * FROM users WHERE id IN op_array(?)`. The SQL stays the same
+ * whatever the number of values, so the statement can be reused. Typed
+ * arrays are copied in one go instead of value by value. Not available on
+ * libsql
+ */
+export function arrayParam(values: ArrayParamValues): ArrayParam {
+  return { __opSqliteArray: values };
+}
+
 /**
  * Object returned by SQL Query executions {
  *  insertId: Represent the auto-generated row id if applicable
@@ -55,7 +83,7 @@ export type ColumnMetadata = {
  */
 export type SQLBatchTuple =
   | [string]
-  | [string, Array<Scalar> | Array<Array<Scalar>>];
+  | [string, Array<SQLParam> | Array<Array<SQLParam>>];
 
 export type UpdateHookOperation = 'INSERT' | 'DELETE' | 'UPDATE';
 
@@ -69,16 +97,288 @@ export type BatchQueryResult = {
 };
 
 /**
- * Result of loading a file and executing every line as a SQL command
+ * Result of loading a file and executing every statement in it
  * Similar to BatchQueryResult
  */
 export type FileLoadResult = BatchQueryResult & {
   commands?: number;
 };
 
+export type LoadFileProgress = {
+  bytesRead: number;
+  totalBytes: number;
+  commands: number;
+  rowsAffected: number;
+};
+
+export type LoadFileOptions = {
+  /**
+   * Commits every chunkSize statements, by default the whole file is
+   * imported in a single transaction
+   */
+  chunkSize?: number;
+  /**
+   * Called at most every 100ms while the file is imported and once when it
+   * is done
+   */
+  onProgress?: (progress: LoadFileProgress) => void;
+};
+
+export type ImportNdjsonOptions = LoadFileOptions & {
+  table: string;
+  /**
+   * Keys to read, by default all columns of the table. Missing keys are
+   * inserted as NULL
+   */
+  columns?: string[];
+};
+
+export type ImportCsvOptions = LoadFileOptions & {
+  table: string;
+  /**
+   * Table columns of the fields in file order, by default the header or all
+   * columns of the table when there is none
+   */
+  columns?: string[];
+  /** The first line names the columns, true by default */
+  header?: boolean;
+  /** Defaults to ',' */
+  delimiter?: string;
+};
+
+export type ExportFormat = 'csv' | 'ndjson' | 'arrow';
+
+export type ExportProgress = {
+  rows: number;
+  bytesWritten: number;
+};
+
+export type ExportResult = ExportProgress;
+
+export type ExportOptions = {
+  /** Defaults to 'csv' */
+  format?: ExportFormat;
+  /** Absolute path of the file to write, replaced if it exists */
+  path: string;
+  /** csv only, writes the column names first, true by default */
+  header?: boolean;
+  /**
+   * arrow only, rows per record batch, 65536 by default. Columns without a
+   * declared type take the type of their values in the first batch
+   */
+  batchSize?: number;
+  /**
+   * Called at most every 100ms while rows are written and once when the
+   * export is done
+   */
+  onProgress?: (progress: ExportProgress) => void;
+};
+
+export type BackupProgress = {
+  /** Pages left to copy */
+  remaining: number;
+  pageCount: number;
+};
+
+export type BackupResult = {
+  pageCount: number;
+};
+
+export type BackupOptions = {
+  /**
+   * Pages copied per step, 100 by default. Queries on the database run
+   * between steps, -1 copies everything in one step
+   */
+  pagesPerStep?: number;
+  /** Pause between steps, 0 by default. Restores ignore it */
+  sleepMs?: number;
+  /**
+   * Called at most every 100ms while pages are copied and once when the
+   * copy is done
+   */
+  onProgress?: (progress: BackupProgress) => void;
+};
+
+export type MaintenanceEvent = {
+  task: 'checkpoint' | 'optimize' | 'incrementalVacuum' | 'compact';
+  durationMs: number;
+  /** WAL frames checkpointed or pages given back to the file system */
+  pages: number;
+  /** Set when the task failed, maintenance carries on */
+  error?: string;
+};
+
+export type MaintenanceOptions = {
+  /**
+   * Tasks only run once no query was queued for this long, 1000 by default
+   */
+  idleMs?: number;
+  /** Time between two runs of optimize and the freelist checks, 1 hour */
+  intervalMs?: number;
+  /** Passive WAL checkpoint once idle after writes, true by default */
+  checkpoint?: boolean;
+  /** PRAGMA optimize every interval and on close, true by default */
+  optimize?: boolean;
+  /**
+   * Share of free pages above which a database with
+   * auto_vacuum = INCREMENTAL gives them back, 0.1 by default, 0 disables it
+   */
+  vacuumThreshold?: number;
+  /**
+   * Share of free pages above which a database without auto_vacuum is
+   * rebuilt with VACUUM INTO and copied back, disabled by default
+   */
+  compactThreshold?: number;
+  onMaintenance?: (event: MaintenanceEvent) => void;
+};
+
+export type BlobOptions = {
+  /** Opens the blob for writing, false by default */
+  write?: boolean;
+  /**
+   * Sets the value to this many zero bytes before opening it for writing.
+   * A blob handle cannot change the size of the value
+   */
+  size?: number;
+  /** Attached database the table is in, 'main' by default */
+  database?: string;
+};
+
+export type BlobHandle = {
+  /** Size of the blob in bytes */
+  readonly size: number;
+  /** Reads length bytes from offset, by default up to the end */
+  read: (offset?: number, length?: number) => Promise<ArrayBuffer>;
+  /** Overwrites bytes at offset, cannot write past the end of the blob */
+  write: (offset: number, data: ArrayBuffer | ArrayBufferView) => Promise<void>;
+  /** Moves the handle to the same column of another row */
+  reopen: (rowid: number) => Promise<void>;
+  /** Closes the handle after the pending reads and writes */
+  close: () => Promise<void>;
+};
+
+export type CompressColumnsOptions = {
+  /** Values shorter than this many bytes are stored as is, 64 by default */
+  threshold?: number;
+  /** Dictionary registered with zstd_register_dict or zstd_train_dict */
+  dictionaryId?: number;
+  /** zstd compression level, 1 by default */
+  level?: number;
+};
+
+/**
+ * Latency of a single query stage in milliseconds
+ */
+export type StageStats = {
+  count: number;
+  totalMs: number;
+  p50Ms: number;
+  p95Ms: number;
+  p99Ms: number;
+};
+
+export type QueryStats = {
+  calls: number;
+  rows: number;
+  bytes: number;
+  stages: {
+    /** Time spent waiting in the thread pool queue */
+    queueWait: StageStats;
+    prepare: StageStats;
+    step: StageStats;
+    /** Conversion of sqlite values into native values */
+    conversion: StageStats;
+    /** Creation of the JS result on the JS thread */
+    materialization: StageStats;
+    total: StageStats;
+  };
+};
+
+/**
+ * Totals across every query plus the break down per SQL text
+ */
+export type DBStats = QueryStats & {
+  queries: Array<QueryStats & { sql: string }>;
+};
+
+/**
+ * Statement that took longer than the slow query threshold
+ */
+export type SlowQuery = {
+  /** SQL with the bound parameters expanded */
+  sql: string;
+  /** Milliseconds since epoch when the statement finished */
+  timestamp: number;
+  durationMs: number;
+  /** Steps taken by full table scans */
+  fullscanSteps: number;
+  sorts: number;
+  /** Rows inserted into automatic indexes */
+  autoindexes: number;
+  vmSteps: number;
+  /** Output of EXPLAIN QUERY PLAN, indented by depth */
+  queryPlan: string;
+};
+
+/**
+ * SQLCipher settings applied right after the key, ignored by the other
+ * backends
+ */
+export type EncryptionOptions = {
+  /**
+   * encryptionKey is a raw key: 64 hex characters, optionally followed by the
+   * 32 hex characters of the database salt. No key derivation runs on open
+   */
+  rawKey?: boolean;
+  /**
+   * PBKDF2 iterations used to derive the key from the passphrase, SQLCipher
+   * defaults to 256000. Must match the value the database was created with
+   */
+  kdfIter?: number;
+  cipherPageSize?: number;
+  /** Wipe memory SQLCipher allocated before releasing it */
+  cipherMemorySecurity?: boolean;
+  /**
+   * Keep the key derived from the passphrase in memory so opening the same
+   * file again in this process skips the derivation. On by default
+   */
+  cacheDerivedKey?: boolean;
+};
+
+export type RecordingOptions = {
+  /**
+   * Keep the values of the params. Off by default, only their types and the
+   * length of strings and blobs are recorded
+   */
+  includeValues?: boolean;
+};
+
+/**
+ * Every connection runs its queries one at a time. Interactive queries are
+ * dequeued before normal ones, which go before background ones. A query that
+ * waited too long (250ms for normal, 1s for background) is served first so
+ * lower lanes are never starved
+ */
+export type QueryPriority = 'interactive' | 'normal' | 'background';
+
+export type PriorityOptions = {
+  /** Defaults to normal */
+  priority?: QueryPriority;
+};
+
+export type ExecuteOptions = PriorityOptions & {
+  /** Cancels the query when aborted, the promise rejects with an `AbortError` */
+  signal?: AbortSignal;
+  /**
+   * Milliseconds, counting the time spent waiting in the queue, after which
+   * the query is interrupted and the promise rejects with a `TimeoutError`
+   */
+  timeout?: number;
+};
+
 export type Transaction = {
   commit: () => Promise<QueryResult>;
-  execute: (query: string, params?: Scalar[]) => Promise<QueryResult>;
+  execute: (query: string, params?: SQLParam[]) => Promise<QueryResult>;
   rollback: () => Promise<QueryResult>;
 };
 
@@ -111,14 +411,54 @@ type InternalDB = {
   }) => void;
   detach: (alias: string) => void;
   transaction: (fn: (tx: Transaction) => Promise<void>) => Promise<void>;
-  executeSync: (query: string, params?: Scalar[]) => QueryResult;
-  execute: (query: string, params?: Scalar[]) => Promise<QueryResult>;
+  executeSync: (query: string, params?: SQLParam[]) => QueryResult;
+  execute: (
+    query: string,
+    params?: SQLParam[],
+    options?: { id?: number; timeout?: number; priority?: QueryPriority }
+  ) => Promise<QueryResult>;
+  cancel: (id: number, reason?: 'AbortError' | 'TimeoutError') => void;
   executeWithHostObjects: (
     query: string,
-    params?: Scalar[]
+    params?: SQLParam[],
+    options?: PriorityOptions
   ) => Promise<QueryResult>;
-  executeBatch: (commands: SQLBatchTuple[]) => Promise<BatchQueryResult>;
-  loadFile: (location: string) => Promise<FileLoadResult>;
+  executeBatch: (
+    commands: SQLBatchTuple[],
+    options?: PriorityOptions
+  ) => Promise<BatchQueryResult>;
+  loadFile: (
+    location: string,
+    options?: LoadFileOptions
+  ) => Promise<FileLoadResult>;
+  importCsv: (
+    location: string,
+    options: ImportCsvOptions
+  ) => Promise<FileLoadResult>;
+  importNdjson: (
+    location: string,
+    options: ImportNdjsonOptions
+  ) => Promise<FileLoadResult>;
+  exportQuery: (
+    query: string,
+    params: SQLParam[] | undefined,
+    options: ExportOptions
+  ) => Promise<ExportResult>;
+  backup: (path: string, options?: BackupOptions) => Promise<BackupResult>;
+  restore: (path: string, options?: BackupOptions) => Promise<BackupResult>;
+  setMaintenance: (options: MaintenanceOptions | null) => void;
+  openBlob: (
+    table: string,
+    column: string,
+    rowid: number,
+    options?: BlobOptions
+  ) => Promise<BlobHandle>;
+  compressColumns: (
+    table: string,
+    columns: string[],
+    options?: CompressColumnsOptions
+  ) => Promise<void>;
+  serialize: () => Promise<ArrayBuffer>;
   updateHook: (
     callback?:
       | ((params: {
@@ -133,7 +473,11 @@ type InternalDB = {
   rollbackHook: (callback?: (() => void) | null) => void;
   prepareStatement: (query: string) => PreparedStatement;
   loadExtension: (path: string, entryPoint?: string) => void;
-  executeRaw: (query: string, params?: Scalar[]) => Promise<any[]>;
+  executeRaw: (
+    query: string,
+    params?: SQLParam[],
+    options?: PriorityOptions
+  ) => Promise<any[]>;
   getDbPath: (location?: string) => string;
   reactiveExecute: (params: {
     query: string;
@@ -146,6 +490,14 @@ type InternalDB = {
   }) => () => void;
   sync: () => void;
   flushPendingReactiveQueries: () => Promise<void>;
+  getStats: () => DBStats;
+  resetStats: () => void;
+  setLowerBackgroundPriority: (lower: boolean) => void;
+  setSlowQueryThreshold: (thresholdMs: number, capacity?: number) => void;
+  getSlowQueries: () => Promise<SlowQuery[]>;
+  clearSlowQueries: () => void;
+  startRecording: (path: string, options?: RecordingOptions) => void;
+  stopRecording: () => void;
 };
 
 export type DB = {
@@ -182,7 +534,7 @@ export type DB = {
    * @param params
    * @returns QueryResult
    */
-  executeSync: (query: string, params?: Scalar[]) => QueryResult;
+  executeSync: (query: string, params?: SQLParam[]) => QueryResult;
   /**
    * Basic query execution function, it is async don't forget to await it
    *
@@ -199,11 +551,19 @@ export type DB = {
    *
    * If you need a large amount of queries ran as fast as possible you should be using `executeBatch`, `executeRaw`, `loadFile` or `executeWithHostObjects`
    *
+   * A query can be cancelled with an AbortSignal or given a timeout, it is
+   * dropped if still queued and interrupted if already running
+   *
    * @param query string of your SQL query
    * @param params a list of parameters to bind to the query, if any
+   * @param options optional AbortSignal and timeout
    * @returns Promise<QueryResult> with the result of the query
    */
-  execute: (query: string, params?: Scalar[]) => Promise<QueryResult>;
+  execute: (
+    query: string,
+    params?: SQLParam[],
+    options?: ExecuteOptions
+  ) => Promise<QueryResult>;
   /**
    * Similar to the execute function but returns the response in HostObjects
    * Read more about HostObjects in the documentation and their pitfalls
@@ -212,24 +572,109 @@ export type DB = {
    * as the conversion is done the moment you access any field
    * @param query
    * @param params
+   * @param options optional queue priority
    * @returns
    */
   executeWithHostObjects: (
     query: string,
-    params?: Scalar[]
+    params?: SQLParam[],
+    options?: PriorityOptions
   ) => Promise<QueryResult>;
   /**
    * Executes all the queries in the params inside a single transaction
    *
    * It's faster than executing single queries as data is sent to the native side only once
+   * Large syncs should use the background priority so they do not delay queries the user is waiting on
    * @param commands
+   * @param options optional queue priority
    * @returns Promise<BatchQueryResult>
    */
-  executeBatch: (commands: SQLBatchTuple[]) => Promise<BatchQueryResult>;
+  executeBatch: (
+    commands: SQLBatchTuple[],
+    options?: PriorityOptions
+  ) => Promise<BatchQueryResult>;
   /**
    * Loads a SQLite Dump from disk. It will be the fastest way to execute a large set of queries as no JS is involved
    */
-  loadFile: (location: string) => Promise<FileLoadResult>;
+  loadFile: (
+    location: string,
+    options?: LoadFileOptions
+  ) => Promise<FileLoadResult>;
+  /**
+   * Inserts the records of a CSV file into an existing table on a background
+   * thread, without passing the values through JS. Not available on libsql
+   */
+  importCsv: (
+    location: string,
+    options: ImportCsvOptions
+  ) => Promise<FileLoadResult>;
+  /**
+   * Inserts a JSON object per line into an existing table on a background
+   * thread. Not available on libsql
+   */
+  importNdjson: (
+    location: string,
+    options: ImportNdjsonOptions
+  ) => Promise<FileLoadResult>;
+  /**
+   * Runs the query on a background thread and writes its rows to a CSV,
+   * NDJSON or Arrow IPC file as they are stepped, so large results never
+   * reach JS. Blobs are written as hex in CSV and NDJSON. Not available on
+   * libsql
+   */
+  exportQuery: (
+    query: string,
+    params: SQLParam[] | undefined,
+    options: ExportOptions
+  ) => Promise<ExportResult>;
+  /**
+   * Copies the database to a file a few pages at a time on a background
+   * thread, with the sqlite backup API. Queries keep running between the
+   * steps and writes made meanwhile are included. The file is only created
+   * once the copy is complete. Not available on libsql
+   */
+  backup: (path: string, options?: BackupOptions) => Promise<BackupResult>;
+  /**
+   * Replaces the content of the database with a backup. Queries wait until
+   * it is done. Not available on libsql
+   */
+  restore: (path: string, options?: BackupOptions) => Promise<BackupResult>;
+  /**
+   * Turns on background upkeep of the database: WAL checkpoints and
+   * incremental vacuum when the connection is idle, PRAGMA optimize
+   * periodically and on close. Pass null to turn it off. Not available on
+   * libsql
+   */
+  setMaintenance: (options: MaintenanceOptions | null) => void;
+  /**
+   * Opens a handle to read or write a blob in chunks on a background
+   * thread, without loading the whole value. Close it when done, the row
+   * cannot be changed by other statements while it is open. Not available
+   * on libsql
+   */
+  openBlob: (
+    table: string,
+    column: string,
+    rowid: number,
+    options?: BlobOptions
+  ) => Promise<BlobHandle>;
+  /**
+   * Stores the columns of a table compressed with zstd. The table is
+   * renamed to `<table>_zstd` and a view takes its name, reading only
+   * decompresses the columns a query selects. Calling it again re-encodes
+   * the rows with the new columns and options, an empty list restores the
+   * table. The table needs a primary key. Needs zstd, only on iOS
+   */
+  compressColumns: (
+    table: string,
+    columns: string[],
+    options?: CompressColumnsOptions
+  ) => Promise<void>;
+  /**
+   * Snapshot of the database in the sqlite file format, on a background
+   * thread. Pass it to `deserialize` to open it again. Not available on libsql
+   */
+  serialize: () => Promise<ArrayBuffer>;
   updateHook: (
     callback?:
       | ((params: {
@@ -261,7 +706,11 @@ export type DB = {
    * Same as `execute` except the results are not returned in objects but rather in arrays with just the values and not the keys
    * It will be faster since a lot of repeated work is skipped and only the values you care about are returned
    */
-  executeRaw: (query: string, params?: Scalar[]) => Promise<any[]>;
+  executeRaw: (
+    query: string,
+    params?: SQLParam[],
+    options?: PriorityOptions
+  ) => Promise<any[]>;
   /**
    * Get's the absolute path to the db file. Useful for debugging on local builds and for attaching the DB from users devices
    */
@@ -286,6 +735,59 @@ export type DB = {
    * The database is hosted in turso
    **/
   sync: () => void;
+  /**
+   * Returns call counts, rows and bytes returned and latency percentiles for
+   * every stage of the queries executed on this connection, in total and per
+   * SQL query
+   */
+  getStats: () => DBStats;
+  /**
+   * Clears all the statistics returned by getStats
+   */
+  resetStats: () => void;
+  /**
+   * Runs background priority queries with a lower OS thread priority (QoS on
+   * iOS, niceness on Android). Off by default, while a background query runs
+   * at a lower priority it also delays the queries queued behind it
+   */
+  setLowerBackgroundPriority: (lower: boolean) => void;
+  /**
+   * Records every statement that takes longer than the threshold, keeping the
+   * last `capacity` ones (50 by default). Pass 0 to stop recording
+   * Not available on libsql
+   */
+  setSlowQueryThreshold: (thresholdMs: number, capacity?: number) => void;
+  /**
+   * Returns the recorded slow queries, oldest first, with their sqlite
+   * counters and query plan
+   */
+  getSlowQueries: () => Promise<SlowQuery[]>;
+  clearSlowQueries: () => void;
+  /**
+   * Writes every execute, executeRaw, executeWithHostObjects, executeBatch and
+   * executeSync call to a binary file at `path` until stopRecording is
+   * called. Only the shape of the params is kept unless `includeValues` is
+   * set. Replay the file with the op-sqlite-replay tool in benchmarks/
+   */
+  startRecording: (path: string, options?: RecordingOptions) => void;
+  stopRecording: () => void;
+};
+
+export type DeserializeOptions = {
+  name: string;
+  /** Content of a database file, e.g. downloaded or from `serialize` */
+  data?: ArrayBuffer;
+  /**
+   * Path of a database shipped with the app, relative to the assets folder on
+   * Android and to the main bundle on iOS
+   */
+  asset?: string;
+  /**
+   * Read only databases use the asset in place without copying it, writable
+   * ones work on an in-memory copy that is lost when the database is closed.
+   * Defaults to true
+   */
+  readOnly?: boolean;
 };
 
 export type DBParams = {
@@ -301,7 +803,19 @@ export type OPSQLiteProxy = {
     name: string;
     location?: string;
     encryptionKey?: string;
+    encryption?: EncryptionOptions;
+    readOnly?: boolean;
+    compressed?: boolean;
   }) => InternalDB;
+  openAsync: (options: {
+    name: string;
+    location?: string;
+    encryptionKey?: string;
+    encryption?: EncryptionOptions;
+    readOnly?: boolean;
+    compressed?: boolean;
+  }) => Promise<InternalDB>;
+  deserialize: (options: DeserializeOptions) => InternalDB;
   openRemote: (options: { url: string; authToken: string }) => InternalDB;
   openSync: (options: DBParams) => InternalDB;
   isSQLCipher: () => boolean;
@@ -342,6 +856,7 @@ const OPSQLite = proxy as OPSQLiteProxy;
 export const {
   IOS_DOCUMENT_PATH,
   IOS_LIBRARY_PATH,
+  IOS_BUNDLE_PATH,
   ANDROID_DATABASE_PATH,
   ANDROID_FILES_PATH,
   ANDROID_EXTERNAL_FILES_PATH,
@@ -349,6 +864,47 @@ export const {
   ? NativeModules.OPSQLite.getConstants()
   : NativeModules.OPSQLite;
 
+let nextCancellableQueryId = 1;
+
+function cancellationError(name: 'AbortError' | 'TimeoutError') {
+  const error = new Error(
+    name === 'TimeoutError'
+      ? '[op-sqlite] Query timed out'
+      : '[op-sqlite] Query was cancelled'
+  );
+  error.name = name;
+  return error;
+}
+
+// The native side drops the query if it is still queued or interrupts it if
+// it is running. Timeouts are also enforced natively, the timer here covers
+// builds where the sqlite progress handler is compiled out
+async function executeCancellable(
+  db: InternalDB,
+  query: string,
+  params: SQLParam[],
+  { signal, timeout, priority }: ExecuteOptions
+): Promise<QueryResult> {
+  if (signal?.aborted) {
+    throw cancellationError('AbortError');
+  }
+
+  const id = nextCancellableQueryId++;
+  const onAbort = () => db.cancel(id, 'AbortError');
+  const timer =
+    timeout != null && timeout > 0
+      ? setTimeout(() => db.cancel(id, 'TimeoutError'), timeout)
+      : undefined;
+
+  signal?.addEventListener('abort', onAbort);
+  try {
+    return await db.execute(query, params, { id, timeout, priority });
+  } finally {
+    signal?.removeEventListener('abort', onAbort);
+    clearTimeout(timer);
+  }
+}
+
 function enhanceDB(db: InternalDB, options: DBParams): DB {
   const lock = {
     queue: [] as PendingTransaction[],
@@ -402,7 +958,8 @@ function enhanceDB(db: InternalDB, options: DBParams): DB {
     attach: db.attach,
     detach: db.detach,
     executeBatch: async (
-      commands: SQLBatchTuple[]
+      commands: SQLBatchTuple[],
+      executeOptions?: PriorityOptions
     ): Promise<BatchQueryResult> => {
       const sanitizedCommands = commands.map(([query, params]) => {
         if (params) {
@@ -412,9 +969,28 @@ function enhanceDB(db: InternalDB, options: DBParams): DB {
         return [query];
       });
 
-      return db.executeBatch(sanitizedCommands as any[]);
+      return db.executeBatch(sanitizedCommands as any[], executeOptions);
     },
     loadFile: db.loadFile,
+    importCsv: db.importCsv,
+    importNdjson: db.importNdjson,
+    exportQuery: (
+      query: string,
+      params: SQLParam[] | undefined,
+      exportOptions: ExportOptions
+    ): Promise<ExportResult> => {
+      return db.exportQuery(
+        query,
+        sanitizeArrayBuffersInArray(params),
+        exportOptions
+      );
+    },
+    backup: db.backup,
+    restore: db.restore,
+    setMaintenance: db.setMaintenance,
+    openBlob: db.openBlob,
+    compressColumns: db.compressColumns,
+    serialize: db.serialize,
     updateHook: db.updateHook,
     commitHook: db.commitHook,
     rollbackHook: db.rollbackHook,
@@ -422,35 +998,56 @@ function enhanceDB(db: InternalDB, options: DBParams): DB {
     getDbPath: db.getDbPath,
     reactiveExecute: db.reactiveExecute,
     sync: db.sync,
+    getStats: db.getStats,
+    resetStats: db.resetStats,
+    setLowerBackgroundPriority: db.setLowerBackgroundPriority,
+    setSlowQueryThreshold: db.setSlowQueryThreshold,
+    getSlowQueries: db.getSlowQueries,
+    clearSlowQueries: db.clearSlowQueries,
+    startRecording: db.startRecording,
+    stopRecording: db.stopRecording,
     close: db.close,
     executeWithHostObjects: async (
       query: string,
-      params?: Scalar[]
+      params?: SQLParam[],
+      executeOptions?: PriorityOptions
     ): Promise<QueryResult> => {
       const sanitizedParams = sanitizeArrayBuffersInArray(params);
 
       return sanitizedParams
-        ? await db.executeWithHostObjects(query, sanitizedParams as Scalar[])
-        : await db.executeWithHostObjects(query);
+        ? await db.executeWithHostObjects(
+            query,
+            sanitizedParams as SQLParam[],
+            executeOptions
+          )
+        : await db.executeWithHostObjects(query, undefined, executeOptions);
     },
-    executeRaw: async (query: string, params?: Scalar[]) => {
+    executeRaw: async (
+      query: string,
+      params?: SQLParam[],
+      executeOptions?: PriorityOptions
+    ) => {
       const sanitizedParams = sanitizeArrayBuffersInArray(params);
 
-      return db.executeRaw(query, sanitizedParams as Scalar[]);
+      return db.executeRaw(
+        query,
+        sanitizedParams as SQLParam[],
+        executeOptions
+      );
     },
     // Wrapper for executeRaw, drizzleORM uses this function
     // at some point I changed the API but they did not pin their dependency to a specific version
     // so re-inserting this so it starts working again
-    executeRawAsync: async (query: string, params?: Scalar[]) => {
+    executeRawAsync: async (query: string, params?: SQLParam[]) => {
       const sanitizedParams = sanitizeArrayBuffersInArray(params);
 
-      return db.executeRaw(query, sanitizedParams as Scalar[]);
+      return db.executeRaw(query, sanitizedParams as SQLParam[]);
     },
-    executeSync: (query: string, params?: Scalar[]): QueryResult => {
+    executeSync: (query: string, params?: SQLParam[]): QueryResult => {
       const sanitizedParams = sanitizeArrayBuffersInArray(params);
 
       let intermediateResult = sanitizedParams
-        ? db.executeSync(query, sanitizedParams as Scalar[])
+        ? db.executeSync(query, sanitizedParams as SQLParam[])
         : db.executeSync(query);
 
       let rows: Record<string, Scalar>[] = [];
@@ -477,20 +1074,28 @@ function enhanceDB(db: InternalDB, options: DBParams): DB {
     },
     executeAsync: async (
       query: string,
-      params?: Scalar[] | undefined
+      params?: SQLParam[] | undefined
     ): Promise<QueryResult> => {
       return db.execute(query, params);
     },
     execute: async (
       query: string,
-      params?: Scalar[] | undefined
+      params?: SQLParam[] | undefined,
+      executeOptions?: ExecuteOptions
     ): Promise<QueryResult> => {
       const sanitizedParams = sanitizeArrayBuffersInArray(params);
 
-      let intermediateResult = await db.execute(
-        query,
-        sanitizedParams as Scalar[]
-      );
+      let intermediateResult =
+        executeOptions?.signal == null && executeOptions?.timeout == null
+          ? await db.execute(query, sanitizedParams as SQLParam[], {
+              priority: executeOptions?.priority,
+            })
+          : await executeCancellable(
+              db,
+              query,
+              sanitizedParams as SQLParam[],
+              executeOptions
+            );
 
       let rows: Record<string, Scalar>[] = [];
       for (let i = 0; i < (intermediateResult.rawRows?.length ?? 0); i++) {
@@ -518,12 +1123,12 @@ function enhanceDB(db: InternalDB, options: DBParams): DB {
       const stmt = db.prepareStatement(query);
 
       return {
-        bindSync: (params: Scalar[]) => {
+        bindSync: (params: SQLParam[]) => {
           const sanitizedParams = sanitizeArrayBuffersInArray(params);
 
           stmt.bindSync(sanitizedParams!);
         },
-        bind: async (params: Scalar[]) => {
+        bind: async (params: SQLParam[]) => {
           const sanitizedParams = sanitizeArrayBuffersInArray(params);
 
           await stmt.bind(sanitizedParams!);
@@ -536,7 +1141,7 @@ function enhanceDB(db: InternalDB, options: DBParams): DB {
     ): Promise<void> => {
       let isFinalized = false;
 
-      const execute = async (query: string, params?: Scalar[]) => {
+      const execute = async (query: string, params?: SQLParam[]) => {
         if (isFinalized) {
           throw Error(
             `OP-Sqlite Error: Database: ${
@@ -667,13 +1272,21 @@ export const open = (params: {
   name: string;
   location?: string;
   encryptionKey?: string;
+  encryption?: EncryptionOptions;
+  /**
+   * Opens the file read only and immutable, with no locking and memory
+   * mapped, e.g. a database in the app bundle. The file must not change
+   * while it is open
+   */
+  readOnly?: boolean;
+  /**
+   * Stores the pages of the database file compressed with zstd, journals
+   * and WAL files are not. Needs zstd, only on iOS. Existing uncompressed
+   * databases stay uncompressed
+   */
+  compressed?: boolean;
 }): DB => {
-  if (params.location?.startsWith('file://')) {
-    console.warn(
-      "[op-sqlite] You are passing a path with 'file://' prefix, it's automatically removed"
-    );
-    params.location = params.location.substring(7);
-  }
+  stripFilePrefix(params);
 
   const db = OPSQLite.open(params);
   const enhancedDb = enhanceDB(db, params);
@@ -681,6 +1294,52 @@ export const open = (params: {
   return enhancedDb;
 };
 
+/**
+ * Same as open, but the file is opened, decrypted and the extensions are
+ * loaded on a background thread, so opening a large or encrypted database
+ * does not block the JS thread. Rejects if the database cannot be opened
+ */
+export const openAsync = async (params: {
+  name: string;
+  location?: string;
+  encryptionKey?: string;
+  encryption?: EncryptionOptions;
+  readOnly?: boolean;
+  compressed?: boolean;
+}): Promise<DB> => {
+  stripFilePrefix(params);
+
+  const db = await OPSQLite.openAsync(params);
+  const enhancedDb = enhanceDB(db, params);
+
+  return enhancedDb;
+};
+
+/**
+ * Opens an in-memory database with the content of a database file, without
+ * copying assets to the documents folder first. Check the docs for how read
+ * only and writable databases differ
+ */
+export const deserialize = (params: DeserializeOptions): DB => {
+  if (isLibsql()) {
+    throw new Error('[op-sqlite] deserialize is not available on libsql');
+  }
+
+  const db = OPSQLite.deserialize(params);
+  const enhancedDb = enhanceDB(db, { name: params.name });
+
+  return enhancedDb;
+};
+
+function stripFilePrefix(params: { location?: string }) {
+  if (params.location?.startsWith('file://')) {
+    console.warn(
+      "[op-sqlite] You are passing a path with 'file://' prefix, it's automatically removed"
+    );
+    params.location = params.location.substring(7);
+  }
+}
+
 /**
  * Moves the database from the assets folder to the default path (check the docs) or to a custom path
  * It DOES NOT OVERWRITE the database if it already exists in the destination path